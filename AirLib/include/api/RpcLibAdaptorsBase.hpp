@@ -40,6 +40,113 @@ namespace airlib_rpclib
                 d.push_back(TDest(s.at(i)));
         }
 
+        //servers from this version have "...Packed" variants of methods returning large numeric arrays
+        static constexpr int kPackedArraysServerVersion = 2;
+
+        //msgpack ext type codes for packed arrays
+        template <typename T>
+        struct PackedArrayType;
+
+        /*
+            Numeric array member of an adaptor. As a plain msgpack array every element is encoded and decoded
+            separately, which dominates RPC time for float images, lidar point clouds and meshes. With packed
+            set the array is sent as a single msgpack ext blob of little endian values copied with memcpy.
+
+            Unpacking accepts both encodings. Servers only set packed for the "...Packed" methods which clients
+            call after checking getServerVersion() so older clients, including Python, keep getting plain arrays.
+        */
+        template <typename TContainer>
+        struct NumericArray
+        {
+            typedef typename TContainer::value_type ValueType;
+
+            TContainer data;
+            bool packed = false;
+
+            NumericArray()
+            {
+            }
+
+            NumericArray(const TContainer& data_val)
+                : data(data_val)
+            {
+            }
+
+            template <typename Packer>
+            void msgpack_pack(Packer& o) const
+            {
+                const size_t count = data.size();
+                if (packed) {
+                    const uint32_t bytes = static_cast<uint32_t>(count * sizeof(ValueType));
+                    if (bytes / sizeof(ValueType) != count)
+                        throw std::length_error("Array is too big for msgpack ext");
+                    o.pack_ext(bytes, PackedArrayType<ValueType>::code);
+                    if (isLittleEndian())
+                        o.pack_ext_body(reinterpret_cast<const char*>(data.data()), bytes);
+                    else {
+                        std::vector<ValueType> swapped(data.data(), data.data() + count);
+                        swapBytes(swapped.data(), count);
+                        o.pack_ext_body(reinterpret_cast<const char*>(swapped.data()), bytes);
+                    }
+                }
+                else {
+                    //same as std::vector
+                    o.pack_array(static_cast<uint32_t>(count));
+                    for (const ValueType& value : data)
+                        o.pack(value);
+                }
+            }
+
+            void msgpack_unpack(clmdep_msgpack::object const& o)
+            {
+                if (o.type == clmdep_msgpack::type::EXT) {
+                    if (o.via.ext.type() != PackedArrayType<ValueType>::code || o.via.ext.size % sizeof(ValueType) != 0)
+                        throw clmdep_msgpack::type_error();
+                    const size_t count = o.via.ext.size / sizeof(ValueType);
+                    resizeUninitialized(data, count);
+                    if (count > 0) {
+                        ValueType* values = data.data();
+                        std::memcpy(values, o.via.ext.data(), o.via.ext.size);
+                        if (!isLittleEndian())
+                            swapBytes(values, count);
+                    }
+                }
+                else if (o.type == clmdep_msgpack::type::ARRAY) {
+                    resizeUninitialized(data, o.via.array.size);
+                    ValueType* values = data.data();
+                    for (uint32_t i = 0; i < o.via.array.size; ++i)
+                        values[i] = o.via.array.ptr[i].as<ValueType>();
+                }
+                else
+                    throw clmdep_msgpack::type_error();
+            }
+
+        private:
+            static bool isLittleEndian()
+            {
+                const uint16_t value = 1;
+                return *reinterpret_cast<const uint8_t*>(&value) == 1;
+            }
+
+            static void swapBytes(ValueType* values, size_t count)
+            {
+                for (size_t i = 0; i < count; ++i) {
+                    uint8_t* bytes = reinterpret_cast<uint8_t*>(values + i);
+                    std::reverse(bytes, bytes + sizeof(ValueType));
+                }
+            }
+
+            static void resizeUninitialized(std::vector<ValueType>& container, size_t count)
+            {
+                container.resize(count);
+            }
+
+            static void resizeUninitialized(common_utils::PooledBuffer<ValueType>& container, size_t count)
+            {
+                container.resizeUninitialized(count);
+            }
+        };
+
         struct Vector2r
         {
             msr::airlib::real_T x_val = 0, y_val = 0;
@@ -525,8 +632,9 @@ namespace airlib_rpclib
 
         struct ImageResponse
         {
-            std::vector<uint8_t> image_data_uint8;
-            std::vector<float> image_data_float;
+            //shares pixel buffers with ImageCaptureBase::ImageResponse, bytes are always sent as msgpack bin
+            common_utils::PooledBuffer<uint8_t> image_data_uint8;
+            NumericArray<common_utils::PooledBuffer<float>> image_data_float;
 
             std::string camera_name;
             Vector3r camera_position;
@@ -550,7 +658,7 @@ namespace airlib_rpclib
                 pixels_as_float = s.pixels_as_float;
 
                 image_data_uint8 = s.image_data_uint8;
-                image_data_float = s.image_data_float;
+                image_data_float.data = s.image_data_float;
 
                 camera_name = s.camera_name;
                 camera_position = Vector3r(s.camera_position);
@@ -572,7 +680,7 @@ namespace airlib_rpclib
                 if (!pixels_as_float)
                     d.image_data_uint8 = image_data_uint8;
                 else
-                    d.image_data_float = image_data_float;
+                    d.image_data_float = image_data_float.data;
 
                 d.camera_name = camera_name;
                 d.camera_position = camera_position.to();
@@ -597,11 +705,13 @@ namespace airlib_rpclib
                 return response;
             }
             static std::vector<ImageResponse> from(
-                const std::vector<msr::airlib::ImageCaptureBase::ImageResponse>& response)
+                const std::vector<msr::airlib::ImageCaptureBase::ImageResponse>& response, bool packed = false)
             {
                 std::vector<ImageResponse> response_adapter;
-                for (const auto& item : response)
+                for (const auto& item : response) {
                     response_adapter.push_back(ImageResponse(item));
+                    response_adapter.back().image_data_float.packed = packed;
+                }
 
                 return response_adapter;
             }
@@ -611,9 +721,9 @@ namespace airlib_rpclib
         {
 
             msr::airlib::TTimePoint time_stamp; // timestamp
-            std::vector<float> point_cloud; // data
+            NumericArray<std::vector<float>> point_cloud; // data
             Pose pose;
-            std::vector<int> segmentation;
+            NumericArray<std::vector<int>> segmentation;
 
             MSGPACK_DEFINE_ARRAY(time_stamp, point_cloud, pose, segmentation);
 
@@ -621,12 +731,14 @@ namespace airlib_rpclib
             {
             }
 
-            LidarData(const msr::airlib::LidarData& s)
+            LidarData(const msr::airlib::LidarData& s, bool packed = false)
             {
                 time_stamp = s.time_stamp;
-                point_cloud = s.point_cloud;
+                point_cloud.data = s.point_cloud;
+                point_cloud.packed = packed;
                 pose = s.pose;
-                segmentation = s.segmentation;
+                segmentation.data = s.segmentation;
+                segmentation.packed = packed;
             }
 
             msr::airlib::LidarData to() const
@@ -634,9 +746,9 @@ namespace airlib_rpclib
                 msr::airlib::LidarData d;
 
                 d.time_stamp = time_stamp;
-                d.point_cloud = point_cloud;
+                d.point_cloud = point_cloud.data;
                 d.pose = pose.to();
-                d.segmentation = segmentation;
+                d.segmentation = segmentation.data;
 
                 return d;
             }
@@ -853,8 +965,8 @@ namespace airlib_rpclib
             Vector3r position;
             Quaternionr orientation;
 
-            std::vector<float> vertices;
-            std::vector<uint32_t> indices;
+            NumericArray<std::vector<float>> vertices;
+            NumericArray<std::vector<uint32_t>> indices;
             std::string name;
 
             MSGPACK_DEFINE_ARRAY(position, orientation, vertices, indices, name);
@@ -868,13 +980,13 @@ namespace airlib_rpclib
                 position = Vector3r(s.position);
                 orientation = Quaternionr(s.orientation);
 
-                vertices = s.vertices;
-                indices = s.indices;
+                vertices.data = s.vertices;
+                indices.data = s.indices;
 
-                if (vertices.size() == 0)
-                    vertices.push_back(0);
-                if (indices.size() == 0)
-                    indices.push_back(0);
+                if (vertices.data.size() == 0)
+                    vertices.data.push_back(0);
+                if (indices.data.size() == 0)
+                    indices.data.push_back(0);
 
                 name = s.name;
             }
@@ -884,8 +996,8 @@ namespace airlib_rpclib
                 msr::airlib::MeshPositionVertexBuffersResponse d;
                 d.position = position.to();
                 d.orientation = orientation.to();
-                d.vertices = vertices;
-                d.indices = indices;
+                d.vertices = vertices.data;
+                d.indices = indices.data;
                 d.name = name;
 
                 return d;
@@ -902,16 +1014,35 @@ namespace airlib_rpclib
             }
 
             static std::vector<MeshPositionVertexBuffersResponse> from(
-                const std::vector<msr::airlib::MeshPositionVertexBuffersResponse>& response)
+                const std::vector<msr::airlib::MeshPositionVertexBuffersResponse>& response, bool packed = false)
             {
                 std::vector<MeshPositionVertexBuffersResponse> response_adapter;
-                for (const auto& item : response)
+                for (const auto& item : response) {
                     response_adapter.push_back(MeshPositionVertexBuffersResponse(item));
+                    response_adapter.back().vertices.packed = packed;
+                    response_adapter.back().indices.packed = packed;
+                }
 
                 return response_adapter;
             }
         };
     };
+
+    template <>
+    struct RpcLibAdaptorsBase::PackedArrayType<float>
+    {
+        static constexpr int8_t code = 1;
+    };
+    template <>
+    struct RpcLibAdaptorsBase::PackedArrayType<int32_t>
+    {
+        static constexpr int8_t code = 2;
+    };
+    template <>
+    struct RpcLibAdaptorsBase::PackedArrayType<uint32_t>
+    {
+        static constexpr int8_t code = 3;
+    };
 }
 } //namespace
 
@@ -921,4 +1052,51 @@ MSGPACK_ADD_ENUM(msr::airlib::ImageCaptureBase::ImageType);
 MSGPACK_ADD_ENUM(msr::airlib::WorldSimApiBase::WeatherParameter);
 MSGPACK_ADD_ENUM(msr::airlib::GpsBase::GnssFixType);
 
+namespace clmdep_msgpack
+{
+MSGPACK_API_VERSION_NAMESPACE(MSGPACK_DEFAULT_API_NS)
+{
+    namespace adaptor
+    {
+        //same wire format as std::vector<uint8_t> (bin) so old clients still work
+        template <>
+        struct pack<common_utils::PooledBuffer<uint8_t>>
+        {
+            template <typename Stream>
+            packer<Stream>& operator()(packer<Stream>& o, const common_utils::PooledBuffer<uint8_t>& v) const
+            {
+                const uint32_t size = checked_get_container_size(v.size());
+                o.pack_bin(size);
+                o.pack_bin_body(reinterpret_cast<const char*>(v.data()), size);
+                return o;
+            }
+        };
+
+        template <>
+        struct convert<common_utils::PooledBuffer<uint8_t>>
+        {
+            clmdep_msgpack::object const& operator()(clmdep_msgpack::object const& o, common_utils::PooledBuffer<uint8_t>& v) const
+            {
+                switch (o.type) {
+                case clmdep_msgpack::type::BIN:
+                    v.assign(reinterpret_cast<const uint8_t*>(o.via.bin.ptr), o.via.bin.size);
+                    break;
+                case clmdep_msgpack::type::STR:
+                    v.assign(reinterpret_cast<const uint8_t*>(o.via.str.ptr), o.via.str.size);
+                    break;
+                case clmdep_msgpack::type::ARRAY:
+                    v.resizeUninitialized(o.via.array.size);
+                    for (uint32_t i = 0; i < o.via.array.size; ++i)
+                        v[i] = o.via.array.ptr[i].as<uint8_t>();
+                    break;
+                default:
+                    throw clmdep_msgpack::type_error();
+                }
+                return o;
+            }
+        };
+    }
+}
+}
+
 #endif
@@ -15,12 +15,35 @@
 #include "physics/Kinematics.hpp"
 #include "physics/Environment.hpp"
 #include "api/WorldSimApiBase.hpp"
+#include "api/RpcLibTaskHandle.hpp"
 
 namespace msr
 {
 namespace airlib
 {
 
+    /*
+        Set of rpclib connections that several clients can share, for example one
+        client object per vehicle in a swarm. Async calls are pipelined on a connection
+        so a single connection is usually enough; more than one helps when large
+        responses such as images would otherwise delay small ones behind them.
+        Clients take connections round robin and keep them alive after the pool is gone.
+    */
+    class RpcLibConnectionPool
+    {
+    public:
+        RpcLibConnectionPool(const string& ip_address = "localhost", uint16_t port = RpcLibPort, float timeout_sec = 60, uint connection_count = 1);
+        ~RpcLibConnectionPool(); //required for pimpl
+
+        uint getConnectionCount() const;
+
+    private:
+        friend class RpcLibClientBase;
+
+        struct impl;
+        std::unique_ptr<impl> pimpl_;
+    };
+
     //common methods for RCP clients of different vehicles
     class RpcLibClientBase
     {
@@ -36,6 +59,7 @@ namespace airlib
 
     public:
         RpcLibClientBase(const string& ip_address = "localhost", uint16_t port = RpcLibPort, float timeout_sec = 60);
+        explicit RpcLibClientBase(RpcLibConnectionPool& connection_pool);
         virtual ~RpcLibClientBase(); //required for pimpl
 
         void confirmConnection();
@@ -176,6 +200,8 @@ namespace airlib
     protected:
         void* getClient();
         const void* getClient() const;
+        //true if server has "...Packed" variants of methods returning large numeric arrays, asked once per client
+        bool usePackedArrays() const;
 
     private:
         struct impl;
@@ -0,0 +1,55 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef air_RpcLibTaskHandle_hpp
+#define air_RpcLibTaskHandle_hpp
+
+#include "common/Common.hpp"
+#include <memory>
+
+namespace msr
+{
+namespace airlib
+{
+
+    /*
+        Handle to one in-flight async task (takeoffAsync, moveToPositionAsync, ...).
+
+        rpclib sends each async call on the connection as soon as it is made and matches
+        responses by message id, so any number of tasks can be in flight on a single
+        connection. Handles are cheap to copy; all copies refer to the same result, which
+        can be read any number of times. Errors raised by the server (or a dropped
+        connection) are rethrown by getResult().
+
+        Timeouts follow waitOnLastTask: NaN or Utils::max<float>() means wait forever.
+    */
+    class RpcLibTaskHandle
+    {
+    public:
+        RpcLibTaskHandle();
+        //future must point to the std::future<object_handle> returned by rpc::client::async_call,
+        //it is moved from
+        RpcLibTaskHandle(void* future, const std::string& vehicle_name);
+
+        bool valid() const;
+        const std::string& getVehicleName() const;
+
+        //true if the server has replied, never blocks
+        bool isDone() const;
+        //true if the server replied before timeout
+        bool wait(float timeout_sec = Utils::nan<float>()) const;
+        //blocks until done. Returns true if task completed without cancellation or timeout
+        bool getResult() const;
+
+        //true if every valid task finished before timeout
+        static bool waitAll(const vector<RpcLibTaskHandle>& tasks, float timeout_sec = Utils::nan<float>());
+        //index of a finished task, or -1 if none finished before timeout (or there were no valid tasks)
+        static int waitAny(const vector<RpcLibTaskHandle>& tasks, float timeout_sec = Utils::nan<float>());
+
+    private:
+        struct State;
+        std::shared_ptr<State> state_;
+    };
+}
+} //namespace
+#endif
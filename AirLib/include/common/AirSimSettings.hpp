@@ -267,6 +267,7 @@ namespace airlib
 
             //optional
             std::string default_vehicle_state;
+            std::string state_estimator;
             std::string pawn_path;
             bool allow_api_always = true;
             bool auto_create = true;
@@ -836,6 +837,7 @@ namespace airlib
             //optional settings_json
             vehicle_setting->pawn_path = settings_json.getString("PawnPath", "");
             vehicle_setting->default_vehicle_state = settings_json.getString("DefaultVehicleState", "");
+            vehicle_setting->state_estimator = settings_json.getString("StateEstimator", "");
             vehicle_setting->allow_api_always = settings_json.getBool("AllowAPIAlways",
                                                                       vehicle_setting->allow_api_always);
             vehicle_setting->auto_create = settings_json.getBool("AutoCreate",
@@ -6,6 +6,7 @@
 
 #include <thread>
 #include <chrono>
+#include <cmath>
 #include "Common.hpp"
 
 namespace msr
@@ -38,7 +39,8 @@ namespace airlib
         }
         TTimePoint addTo(TTimePoint t, TTimeDelta dt)
         {
-            return static_cast<TTimePoint>(t + dt * 1.0E9);
+            //t doesn't fit in a double's mantissa, so only dt goes through floating point
+            return static_cast<TTimePoint>(static_cast<int64_t>(t) + std::llround(dt * 1.0E9));
         }
         TTimeDelta updateSince(TTimePoint& since) const
         {
@@ -13,6 +13,7 @@
 #include <cstdint>
 #include "common/common_utils/Utils.hpp"
 #include "common_utils/RandomGenerator.hpp"
+#include "common_utils/StateSnapshot.hpp"
 #include "VectorMath.hpp"
 
 #ifndef _CRT_SECURE_NO_WARNINGS
@@ -45,6 +46,7 @@ namespace airlib
     typedef common_utils::RandomGeneratorGaussianF RandomGeneratorGausianR;
     typedef std::string string;
     typedef common_utils::Utils Utils;
+    typedef common_utils::StateSnapshot StateSnapshot;
     typedef VectorMath::RandomVectorGaussianT RandomVectorGaussianR;
     typedef VectorMath::RandomVectorT RandomVectorR;
     typedef uint64_t TTimePoint;
@@ -252,6 +252,31 @@ namespace airlib
             : has_collided(has_collided_val), normal(normal_val), impact_point(impact_point_val), position(position_val), penetration_depth(penetration_depth_val), time_stamp(time_stamp_val), object_name(object_name_val), object_id(object_id_val)
         {
         }
+
+        void saveState(StateSnapshot& snapshot) const
+        {
+            snapshot.write(has_collided);
+            snapshot.write(normal);
+            snapshot.write(impact_point);
+            snapshot.write(position);
+            snapshot.write(penetration_depth);
+            snapshot.writeTime(time_stamp);
+            snapshot.write(collision_count);
+            snapshot.write(object_name);
+            snapshot.write(object_id);
+        }
+        void restoreState(StateSnapshot& snapshot)
+        {
+            snapshot.read(has_collided);
+            snapshot.read(normal);
+            snapshot.read(impact_point);
+            snapshot.read(position);
+            snapshot.read(penetration_depth);
+            snapshot.readTime(time_stamp);
+            snapshot.read(collision_count);
+            snapshot.read(object_name);
+            snapshot.read(object_id);
+        }
     };
 
     struct CameraInfo
@@ -370,6 +395,34 @@ namespace airlib
             throttle /= k;
             yaw /= k;
         }
+        void saveState(StateSnapshot& snapshot) const
+        {
+            snapshot.writeTime(timestamp);
+            snapshot.write(pitch);
+            snapshot.write(roll);
+            snapshot.write(throttle);
+            snapshot.write(yaw);
+            snapshot.write(left_z);
+            snapshot.write(right_z);
+            snapshot.write(switches);
+            snapshot.write(vendor_id);
+            snapshot.write(is_initialized);
+            snapshot.write(is_valid);
+        }
+        void restoreState(StateSnapshot& snapshot)
+        {
+            snapshot.readTime(timestamp);
+            snapshot.read(pitch);
+            snapshot.read(roll);
+            snapshot.read(throttle);
+            snapshot.read(yaw);
+            snapshot.read(left_z);
+            snapshot.read(right_z);
+            snapshot.read(switches);
+            snapshot.read(vendor_id);
+            snapshot.read(is_initialized);
+            snapshot.read(is_valid);
+        }
         bool isAnyMoreThan(float k)
         {
             using std::abs;
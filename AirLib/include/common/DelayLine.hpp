@@ -60,6 +60,27 @@ namespace airlib
                 values_.pop_front();
             }
         }
+
+        virtual void saveState(StateSnapshot& snapshot) const override
+        {
+            snapshot.write(values_);
+            snapshot.write(times_);
+            snapshot.write(last_value_);
+            snapshot.writeTime(last_time_);
+        }
+
+        virtual void restoreState(StateSnapshot& snapshot) override
+        {
+            snapshot.read(values_);
+            for (T& value : values_)
+                snapshot.shiftTimeStamp(value);
+            snapshot.read(times_);
+            for (TTimePoint& time : times_)
+                snapshot.shiftTime(time);
+            snapshot.read(last_value_);
+            snapshot.shiftTimeStamp(last_value_);
+            snapshot.readTime(last_time_);
+        }
         //*** End: UpdatableState implementation ***//
 
         T getOutput() const
@@ -54,16 +54,40 @@ namespace airlib
 
         virtual void update() override
         {
-            UpdatableObject::update();
+            const TTimePoint now = clock()->nowNanos();
+            update(now, getDecay(now));
+        }
 
-            TTimeDelta dt = clock()->updateSince(last_time_);
+        //steps the filter to now with the decay from getDecay(now), filters with the same time constant
+        //and last update time can share one decay instead of each calling exp
+        void update(TTimePoint now, double alpha)
+        {
+            UpdatableObject::update();
 
-            //lower the weight for previous value if its been long time
-            //TODO: minimize use of exp
-            double alpha = exp(-dt / timeConstant_);
+            last_time_ = now;
             // x(k+1) = Ad*x(k) + Bd*u(k)
             output_ = static_cast<real_T>(output_ * alpha + input_ * (1 - alpha));
         }
+
+        //weight of the previous output, lower if its been long time
+        double getDecay(TTimePoint now) const
+        {
+            return exp(-ClockBase::elapsedBetween(now, last_time_) / timeConstant_);
+        }
+
+        virtual void saveState(StateSnapshot& snapshot) const override
+        {
+            snapshot.write(input_);
+            snapshot.write(output_);
+            snapshot.writeTime(last_time_);
+        }
+
+        virtual void restoreState(StateSnapshot& snapshot) override
+        {
+            snapshot.read(input_);
+            snapshot.read(output_);
+            snapshot.readTime(last_time_);
+        }
         //*** End: UpdatableState implementation ***//
 
         void setInput(T input)
@@ -80,6 +104,15 @@ namespace airlib
             return output_;
         }
 
+        float getTimeConstant() const
+        {
+            return timeConstant_;
+        }
+        TTimePoint getLastUpdateTime() const
+        {
+            return last_time_;
+        }
+
     private:
         float timeConstant_;
         T output_, input_;
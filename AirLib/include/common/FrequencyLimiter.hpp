@@ -58,33 +58,50 @@ namespace airlib
         {
             UpdatableObject::update();
 
-            elapsed_total_sec_ = clock()->elapsedSince(first_time_);
-            elapsed_interval_sec_ = clock()->elapsedSince(last_time_);
+            const TTimePoint now = clock()->nowNanos();
+            elapsed_total_sec_ = ClockBase::elapsedBetween(now, first_time_);
+            elapsed_interval_sec_ = ClockBase::elapsedBetween(now, last_time_);
             ++update_count_;
 
-            //if startup_delay_ > 0 then we consider startup_delay_ as the first interval
-            //that needs to be complete
-            if (!startup_complete_) {
-                if (Utils::isDefinitelyGreaterThan(startup_delay_, 0.0f)) {
-                    //see if we have spent startup_delay_ time yet
-                    interval_complete_ = elapsed_interval_sec_ >= startup_delay_;
-                }
-                else //no special startup delay is needed
-                    startup_complete_ = true;
-            }
+            //no special startup delay is needed
+            if (!startup_complete_ && !hasStartupDelay())
+                startup_complete_ = true;
 
-            //if startup is complete, we will do regular intervals from now one
-            if (startup_complete_)
-                interval_complete_ = elapsed_interval_sec_ >= interval_size_sec_;
+            //compared in nanos as getNextUpdateTime() is so schedulers using it agree with us
+            interval_complete_ = now >= getNextUpdateTime();
 
             //when any interval is done, reset the state and repeat
             if (interval_complete_) {
                 last_elapsed_interval_sec_ = elapsed_interval_sec_;
-                last_time_ = clock()->nowNanos();
+                last_time_ = now;
                 elapsed_interval_sec_ = 0;
                 startup_complete_ = true;
             }
         }
+
+        virtual void saveState(StateSnapshot& snapshot) const override
+        {
+            snapshot.write(elapsed_total_sec_);
+            snapshot.write(elapsed_interval_sec_);
+            snapshot.write(last_elapsed_interval_sec_);
+            snapshot.write(update_count_);
+            snapshot.write(interval_complete_);
+            snapshot.write(startup_complete_);
+            snapshot.writeTime(last_time_);
+            snapshot.writeTime(first_time_);
+        }
+
+        virtual void restoreState(StateSnapshot& snapshot) override
+        {
+            snapshot.read(elapsed_total_sec_);
+            snapshot.read(elapsed_interval_sec_);
+            snapshot.read(last_elapsed_interval_sec_);
+            snapshot.read(update_count_);
+            snapshot.read(interval_complete_);
+            snapshot.read(startup_complete_);
+            snapshot.readTime(last_time_);
+            snapshot.readTime(first_time_);
+        }
         //*** End: UpdatableState implementation ***//
 
         TTimeDelta getElapsedTotalSec() const
@@ -117,6 +134,23 @@ namespace airlib
             return update_count_;
         }
 
+        //clock time at which update() completes the current interval, if startup_delay_ > 0
+        //then we consider startup_delay_ as the first interval that needs to be complete
+        TTimePoint getNextUpdateTime() const
+        {
+            const real_T wait_sec = !startup_complete_ && hasStartupDelay() ? startup_delay_ : interval_size_sec_;
+            const double wait_nanos = std::ceil(static_cast<double>(wait_sec) * 1.0E9);
+            if (wait_nanos >= static_cast<double>(Utils::max<TTimePoint>() - last_time_))
+                return Utils::max<TTimePoint>();
+            return last_time_ + static_cast<TTimePoint>(wait_nanos);
+        }
+
+    private:
+        bool hasStartupDelay() const
+        {
+            return Utils::isDefinitelyGreaterThan(startup_delay_, 0.0f);
+        }
+
     private:
         real_T interval_size_sec_;
         TTimeDelta elapsed_total_sec_;
@@ -62,6 +62,20 @@ namespace airlib
             double alpha = exp(-dt / tau_);
             output_ = static_cast<real_T>(alpha * output_ + (1 - alpha) * getNextRandom() * sigma_);
         }
+
+        virtual void saveState(StateSnapshot& snapshot) const override
+        {
+            rand_.saveState(snapshot);
+            snapshot.write(output_);
+            snapshot.writeTime(last_time_);
+        }
+
+        virtual void restoreState(StateSnapshot& snapshot) override
+        {
+            rand_.restoreState(snapshot);
+            snapshot.read(output_);
+            snapshot.readTime(last_time_);
+        }
         //*** End: UpdatableState implementation ***//
 
         real_T getNextRandom()
@@ -0,0 +1,279 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef air_GeodeticBatchConverter_hpp
+#define air_GeodeticBatchConverter_hpp
+
+#include <cmath>
+#include <algorithm>
+#include "common/Common.hpp"
+#include "common/CommonStructs.hpp"
+
+namespace msr
+{
+namespace airlib
+{
+
+    /*
+    GeodeticBatchConverter converts arrays of points between local NED frame around home point and
+    geodetic (WGS84) coordinates. This is meant for fleets of vehicles and for converting recorded
+    trajectories where GeodeticConverter would recompute same home dependent terms and evaluate
+    closed form ecef2Geodetic with cbrt/pow for every point.
+
+    Everything that only depends on home (its ECEF position, ECEF->NED rotation and radii of
+    curvature) is computed once in setHome. Points are then processed in fixed size chunks of
+    Eigen arrays so that sqrt, sin, cos and arithmetic are vectorized. ECEF to geodetic uses one
+    iteration of Bowring's method which is accurate to well below a millimeter for altitudes
+    up to several hundred kilometers.
+
+    The *Fast versions use local tangent plane approximation which is purely linear and is much
+    faster. Its error grows quadratically with distance from home, use getFastErrorBound to
+    decide if it is acceptable for the area of operation.
+    */
+    class GeodeticBatchConverter
+    {
+    public:
+        GeodeticBatchConverter(const GeoPoint& home = GeoPoint())
+        {
+            setHome(home);
+        }
+
+        void setHome(const GeoPoint& home)
+        {
+            home_ = home;
+
+            const double lat_rad = home.latitude * kDegToRad;
+            const double lon_rad = home.longitude * kDegToRad;
+            const double s_lat = std::sin(lat_rad), c_lat = std::cos(lat_rad);
+            const double s_lon = std::sin(lon_rad), c_lon = std::cos(lon_rad);
+
+            const double w_sq = 1 - kFirstEccentricitySquared * s_lat * s_lat;
+            const double prime_vertical_radius = kSemimajorAxis / std::sqrt(w_sq);
+            home_ecef_x_ = (prime_vertical_radius + home.altitude) * c_lat * c_lon;
+            home_ecef_y_ = (prime_vertical_radius + home.altitude) * c_lat * s_lon;
+            home_ecef_z_ = (prime_vertical_radius * (1 - kFirstEccentricitySquared) + home.altitude) * s_lat;
+
+            //rows are north, east and up axis expressed in ECEF, same as GeodeticConverter::nRe
+            ecef_to_ned_[0] = -s_lat * c_lon;
+            ecef_to_ned_[1] = -s_lat * s_lon;
+            ecef_to_ned_[2] = c_lat;
+            ecef_to_ned_[3] = -s_lon;
+            ecef_to_ned_[4] = c_lon;
+            ecef_to_ned_[5] = 0;
+            ecef_to_ned_[6] = c_lat * c_lon;
+            ecef_to_ned_[7] = c_lat * s_lon;
+            ecef_to_ned_[8] = s_lat;
+
+            //meters per radian of latitude and longitude at home for local tangent plane
+            meridian_radius_ = kSemimajorAxis * (1 - kFirstEccentricitySquared) / (w_sq * std::sqrt(w_sq)) + home.altitude;
+            parallel_radius_ = (prime_vertical_radius + home.altitude) * c_lat;
+            tan_home_lat_ = std::abs(s_lat / c_lat);
+        }
+
+        const GeoPoint& getHome() const
+        {
+            return home_;
+        }
+
+        //upper bound of position error in meters for *Fast functions for points within horizontal distance
+        //and height meters from home
+        double getFastErrorBound(double distance, double height = 0) const
+        {
+            //earth curvature drops the tangent plane by d^2/2R, meridian convergence moves east by up to d^2*tan(lat)/R
+            //and horizontal scale is only correct at home altitude
+            return (distance * distance * (0.5 + tan_home_lat_) + distance * std::abs(height)) / kSemiminorAxis * 1.1 + 1E-3;
+        }
+
+        //SoA versions, latitude and longitude are in degrees
+        void nedToGeodetic(const double* north, const double* east, const double* down,
+                           double* latitude, double* longitude, double* altitude, size_t count) const
+        {
+            convertSoA(north, east, down, latitude, longitude, altitude, count, 0, 0, 0,
+                       [this](Chunk& a, Chunk& b, Chunk& c) { nedToGeodeticChunk(a, b, c); });
+        }
+        void geodeticToNed(const double* latitude, const double* longitude, const double* altitude,
+                           double* north, double* east, double* down, size_t count) const
+        {
+            convertSoA(latitude, longitude, altitude, north, east, down, count, home_.latitude, home_.longitude, home_.altitude,
+                       [this](Chunk& a, Chunk& b, Chunk& c) { geodeticToNedChunk(a, b, c); });
+        }
+        void nedToGeodeticFast(const double* north, const double* east, const double* down,
+                               double* latitude, double* longitude, double* altitude, size_t count) const
+        {
+            convertSoA(north, east, down, latitude, longitude, altitude, count, 0, 0, 0,
+                       [this](Chunk& a, Chunk& b, Chunk& c) { nedToGeodeticFastChunk(a, b, c); });
+        }
+        void geodeticToNedFast(const double* latitude, const double* longitude, const double* altitude,
+                               double* north, double* east, double* down, size_t count) const
+        {
+            convertSoA(latitude, longitude, altitude, north, east, down, count, home_.latitude, home_.longitude, home_.altitude,
+                       [this](Chunk& a, Chunk& b, Chunk& c) { geodeticToNedFastChunk(a, b, c); });
+        }
+
+        //AoS versions for AirLib types, output is resized to input
+        void nedToGeodetic(const vector<Vector3r>& ned, vector<GeoPoint>& geo) const
+        {
+            convertAoS(ned, geo, [this](Chunk& a, Chunk& b, Chunk& c) { nedToGeodeticChunk(a, b, c); });
+        }
+        void geodeticToNed(const vector<GeoPoint>& geo, vector<Vector3r>& ned) const
+        {
+            convertAoS(geo, ned, [this](Chunk& a, Chunk& b, Chunk& c) { geodeticToNedChunk(a, b, c); });
+        }
+        void nedToGeodeticFast(const vector<Vector3r>& ned, vector<GeoPoint>& geo) const
+        {
+            convertAoS(ned, geo, [this](Chunk& a, Chunk& b, Chunk& c) { nedToGeodeticFastChunk(a, b, c); });
+        }
+        void geodeticToNedFast(const vector<GeoPoint>& geo, vector<Vector3r>& ned) const
+        {
+            convertAoS(geo, ned, [this](Chunk& a, Chunk& b, Chunk& c) { geodeticToNedFastChunk(a, b, c); });
+        }
+
+    private:
+        static constexpr int kChunkSize = 64;
+        typedef Eigen::Array<double, kChunkSize, 1> Chunk;
+
+        // Geodetic system parameters, same as GeodeticConverter
+        static constexpr double kSemimajorAxis = 6378137;
+        static constexpr double kSemiminorAxis = 6356752.3142;
+        static constexpr double kFirstEccentricitySquared = 6.69437999014 * 0.001;
+        static constexpr double kSecondEccentricitySquared = 6.73949674228 * 0.001;
+        static constexpr double kDegToRad = M_PI / 180.0;
+        static constexpr double kRadToDeg = 180.0 / M_PI;
+
+        static Chunk atan2(const Chunk& y, const Chunk& x)
+        {
+            return y.binaryExpr(x, [](double a, double b) { return std::atan2(a, b); });
+        }
+
+        //all chunk functions convert in place: (a, b, c) in -> (a, b, c) out
+        void geodeticToNedChunk(Chunk& lat_north, Chunk& lon_east, Chunk& alt_down) const
+        {
+            const Chunk lat = lat_north * kDegToRad, lon = lon_east * kDegToRad;
+            const Chunk s_lat = lat.sin(), c_lat = lat.cos();
+            const Chunk prime = kSemimajorAxis / (1 - kFirstEccentricitySquared * s_lat.square()).sqrt();
+            const Chunk horizontal = (prime + alt_down) * c_lat;
+
+            const Chunk dx = horizontal * lon.cos() - home_ecef_x_;
+            const Chunk dy = horizontal * lon.sin() - home_ecef_y_;
+            const Chunk dz = (prime * (1 - kFirstEccentricitySquared) + alt_down) * s_lat - home_ecef_z_;
+
+            lat_north = ecef_to_ned_[0] * dx + ecef_to_ned_[1] * dy + ecef_to_ned_[2] * dz;
+            lon_east = ecef_to_ned_[3] * dx + ecef_to_ned_[4] * dy;
+            alt_down = -(ecef_to_ned_[6] * dx + ecef_to_ned_[7] * dy + ecef_to_ned_[8] * dz);
+        }
+
+        void nedToGeodeticChunk(Chunk& north_lat, Chunk& east_lon, Chunk& down_alt) const
+        {
+            //NED -> ECEF using transpose of ecef_to_ned_
+            const Chunk up = -down_alt;
+            const Chunk x = ecef_to_ned_[0] * north_lat + ecef_to_ned_[3] * east_lon + ecef_to_ned_[6] * up + home_ecef_x_;
+            const Chunk y = ecef_to_ned_[1] * north_lat + ecef_to_ned_[4] * east_lon + ecef_to_ned_[7] * up + home_ecef_y_;
+            const Chunk z = ecef_to_ned_[2] * north_lat + ecef_to_ned_[8] * up + home_ecef_z_;
+
+            //ECEF -> geodetic, Bowring's method with one iteration
+            const Chunk p = (x.square() + y.square()).sqrt();
+            const Chunk theta = atan2(z * kSemimajorAxis, p * kSemiminorAxis);
+            const Chunk s_theta = theta.sin(), c_theta = theta.cos();
+            const Chunk lat = atan2(z + kSecondEccentricitySquared * kSemiminorAxis * s_theta.cube(),
+                                    p - kFirstEccentricitySquared * kSemimajorAxis * c_theta.cube());
+            const Chunk s_lat = lat.sin();
+            const Chunk w = (1 - kFirstEccentricitySquared * s_lat.square()).sqrt();
+
+            north_lat = lat * kRadToDeg;
+            east_lon = atan2(y, x) * kRadToDeg;
+            //h = p*cos(lat) + z*sin(lat) - a^2/N, this form is stable near poles
+            down_alt = p * lat.cos() + z * s_lat - kSemimajorAxis * w;
+        }
+
+        void geodeticToNedFastChunk(Chunk& lat_north, Chunk& lon_east, Chunk& alt_down) const
+        {
+            lat_north = (lat_north - home_.latitude) * (kDegToRad * meridian_radius_);
+            lon_east = (lon_east - home_.longitude) * (kDegToRad * parallel_radius_);
+            alt_down = home_.altitude - alt_down;
+        }
+
+        void nedToGeodeticFastChunk(Chunk& north_lat, Chunk& east_lon, Chunk& down_alt) const
+        {
+            north_lat = home_.latitude + north_lat * (kRadToDeg / meridian_radius_);
+            east_lon = home_.longitude + east_lon * (kRadToDeg / parallel_radius_);
+            down_alt = home_.altitude - down_alt;
+        }
+
+        template <typename TChunkFunc>
+        static void convertSoA(const double* in_a, const double* in_b, const double* in_c,
+                               double* out_a, double* out_b, double* out_c, size_t count,
+                               double pad_a, double pad_b, double pad_c, TChunkFunc&& func)
+        {
+            typedef Eigen::Map<const Eigen::ArrayXd> ConstMap;
+            typedef Eigen::Map<Eigen::ArrayXd> Map;
+
+            Chunk a, b, c;
+            for (size_t start = 0; start < count; start += kChunkSize) {
+                const int n = static_cast<int>(std::min<size_t>(kChunkSize, count - start));
+                //last chunk is padded with valid input so math stays finite
+                if (n < kChunkSize) {
+                    a.setConstant(pad_a);
+                    b.setConstant(pad_b);
+                    c.setConstant(pad_c);
+                }
+                a.head(n) = ConstMap(in_a + start, n);
+                b.head(n) = ConstMap(in_b + start, n);
+                c.head(n) = ConstMap(in_c + start, n);
+
+                func(a, b, c);
+
+                Map(out_a + start, n) = a.head(n);
+                Map(out_b + start, n) = b.head(n);
+                Map(out_c + start, n) = c.head(n);
+            }
+        }
+
+        static void toArrays(const Vector3r& v, Chunk& a, Chunk& b, Chunk& c, int i)
+        {
+            a[i] = v.x();
+            b[i] = v.y();
+            c[i] = v.z();
+        }
+        static void toArrays(const GeoPoint& g, Chunk& a, Chunk& b, Chunk& c, int i)
+        {
+            a[i] = g.latitude;
+            b[i] = g.longitude;
+            c[i] = g.altitude;
+        }
+        static void fromArrays(const Chunk& a, const Chunk& b, const Chunk& c, int i, Vector3r& v)
+        {
+            v = Vector3r(static_cast<real_T>(a[i]), static_cast<real_T>(b[i]), static_cast<real_T>(c[i]));
+        }
+        static void fromArrays(const Chunk& a, const Chunk& b, const Chunk& c, int i, GeoPoint& g)
+        {
+            g.set(a[i], b[i], static_cast<float>(c[i]));
+        }
+
+        template <typename TIn, typename TOut, typename TChunkFunc>
+        void convertAoS(const vector<TIn>& input, vector<TOut>& output, TChunkFunc&& func) const
+        {
+            output.resize(input.size());
+
+            Chunk a, b, c;
+            for (size_t start = 0; start < input.size(); start += kChunkSize) {
+                const int n = static_cast<int>(std::min<size_t>(kChunkSize, input.size() - start));
+                for (int i = 0; i < kChunkSize; ++i)
+                    toArrays(input[start + std::min(i, n - 1)], a, b, c, i);
+
+                func(a, b, c);
+
+                for (int i = 0; i < n; ++i)
+                    fromArrays(a, b, c, i, output[start + i]);
+            }
+        }
+
+    private:
+        GeoPoint home_;
+        double home_ecef_x_, home_ecef_y_, home_ecef_z_;
+        double ecef_to_ned_[9];
+        double meridian_radius_, parallel_radius_;
+        double tan_home_lat_;
+    };
+}
+} //namespace
+#endif
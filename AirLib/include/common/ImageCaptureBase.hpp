@@ -6,6 +6,7 @@
 
 #include "common/Common.hpp"
 #include "common/common_utils/EnumFlags.hpp"
+#include "common/common_utils/BufferPool.hpp"
 
 namespace msr
 {
@@ -56,8 +57,9 @@ namespace airlib
 
         struct ImageResponse
         {
-            vector<uint8_t> image_data_uint8;
-            vector<float> image_data_float;
+            //pooled so per frame captures don't allocate, copies of a response share pixel data
+            common_utils::PooledBuffer<uint8_t> image_data_uint8;
+            common_utils::PooledBuffer<float> image_data_float;
 
             std::string camera_name;
             Vector3r camera_position = Vector3r::Zero();
@@ -13,6 +13,7 @@ namespace msr
 namespace airlib
 {
 
+    //tab separated text flushed every line, TelemetryLogger is the one for per-tick data
     class LogFileWriter
     {
     public:
@@ -0,0 +1,166 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef airsim_core_ReplayJournal_hpp
+#define airsim_core_ReplayJournal_hpp
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include "common/Common.hpp"
+#include "common/CommonStructs.hpp"
+
+namespace msr
+{
+namespace airlib
+{
+
+    class PhysicsEngineBase;
+    class VehicleApiBase;
+    class World;
+    class SteppableClock;
+
+    /*
+        Journal of everything from outside that changes a World, so a run can be replayed exactly
+        and without waiting on the wall clock.
+
+        Inputs (wind, external force, RC data, API control, arming and vehicle specific commands)
+        are sent to the journal instead of the physics engine or vehicle API, from any thread.
+        The World the journal is attached to applies them at the start of its next reset or update,
+        so they take effect at the same point of the simulation however the calling thread was
+        scheduled. While recording, every world frame is kept with its clock time and the inputs
+        applied in it, together with the RandomGenerator seed offset of the run.
+
+        Replay installs a SteppableClock, restores the seed offset, and then moves the clock to
+        each recorded time and resets or updates the world, applying the recorded inputs in the
+        same frames. Inputs sent during replay are ignored. Results are bit exact when the run was
+        recorded with a SteppableClock; with a wall clock every object reads time at a slightly
+        different moment in a frame, which replay can't reproduce.
+
+        Only inputs sent here are journaled. RpcLibServerBase, WorldSimApi and the vehicle APIs still
+        call the physics engine and vehicles directly, so a host that wants those inputs recorded
+        sends them to the journal itself. Vehicle specific commands are applied by handlers registered
+        with addCommandHandler and none are registered by default; multirotor move* calls run a loop
+        on the calling thread, so journaling one means sending the commands it issues each iteration.
+    */
+    class ReplayJournal
+    {
+    public:
+        enum class Mode
+        {
+            Idle,
+            Recording,
+            Replaying
+        };
+
+        enum class FrameType : uint32_t
+        {
+            Reset = 0,
+            Update
+        };
+
+        enum class InputType : uint32_t
+        {
+            Wind = 0,
+            ExtForce,
+            RCData,
+            ApiControl,
+            ArmDisarm,
+            Command
+        };
+
+        struct Input
+        {
+            InputType type = InputType::Command;
+            string vehicle_name;
+            string command; //for InputType::Command
+            vector<uint8_t> payload;
+        };
+
+        struct Frame
+        {
+            FrameType type = FrameType::Update;
+            TTimePoint time = 0;
+            vector<Input> inputs;
+        };
+
+        typedef std::function<void(VehicleApiBase* api, const vector<uint8_t>& payload)> CommandHandler;
+
+    public:
+        ReplayJournal();
+        ~ReplayJournal();
+
+        //what inputs are applied to, World::setJournal sets the physics engine
+        void setPhysicsEngine(PhysicsEngineBase* physics_engine);
+        void addVehicle(const string& vehicle_name, VehicleApiBase* api);
+        void addCommandHandler(const string& command, const CommandHandler& handler);
+
+        //inputs, applied at the start of the next world frame
+        void setWind(const Vector3r& wind);
+        void setExtForce(const Vector3r& ext_force);
+        void setRCData(const string& vehicle_name, const RCData& rc_data);
+        void enableApiControl(const string& vehicle_name, bool is_enabled);
+        void armDisarm(const string& vehicle_name, bool arm);
+        void sendCommand(const string& vehicle_name, const string& command, const vector<uint8_t>& payload);
+
+        //called by World at the start of every reset and after the clock step of every update
+        void beginFrame(FrameType type);
+
+        //drops earlier frames, reset the world right after so the replay starts from the same state
+        void startRecording();
+        void stopRecording();
+
+        void save(const string& file_name) const;
+        //throws std::runtime_error if the file is not a journal
+        void load(const string& file_name);
+
+        //installs a SteppableClock at the first recorded time with ClockFactory and restores the
+        //seed offset, then replayFrame() runs recorded frames on world one at a time. If the first
+        //frame is a reset the world must not have been reset since it was created or last updated,
+        //as UpdatableObject doesn't allow two resets in a row
+        void startReplay();
+        bool replayFrame(World& world);
+        //all frames as fast as they run
+        void replay(World& world);
+
+        Mode getMode() const
+        {
+            return mode_;
+        }
+        const vector<Frame>& getFrames() const
+        {
+            return frames_;
+        }
+        uint getSeedOffset() const
+        {
+            return seed_offset_;
+        }
+        size_t getReplayPosition() const
+        {
+            return replay_index_;
+        }
+
+    private:
+        void submit(Input&& input);
+        void apply(const Input& input);
+        VehicleApiBase* getVehicle(const string& vehicle_name) const;
+
+    private:
+        std::atomic<Mode> mode_{ Mode::Idle };
+        PhysicsEngineBase* physics_engine_ = nullptr;
+        std::map<string, VehicleApiBase*> vehicles_;
+        std::map<string, CommandHandler> command_handlers_;
+
+        std::mutex pending_mutex_;
+        vector<Input> pending_;
+
+        vector<Frame> frames_;
+        uint seed_offset_ = 0;
+        size_t replay_index_ = 0;
+        std::shared_ptr<SteppableClock> replay_clock_;
+    };
+}
+} //namespace
+#endif
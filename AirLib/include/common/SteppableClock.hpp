@@ -44,6 +44,12 @@ namespace airlib
             return current_;
         }
 
+        //sets the time without counting a step, e.g. to a time recorded earlier for replay
+        void advanceTo(TTimePoint time)
+        {
+            current_ = time;
+        }
+
         TTimeDelta getStepSize() const
         {
             return step_;
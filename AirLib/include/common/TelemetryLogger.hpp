@@ -0,0 +1,324 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef msr_airlib_TelemetryLogger_hpp
+#define msr_airlib_TelemetryLogger_hpp
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include "common/Common.hpp"
+
+namespace msr
+{
+namespace airlib
+{
+
+    /*
+        Binary logger for per-tick data such as IMU samples and kinematics of many vehicles,
+        where LogFileWriter's formatting and flush per line would slow the physics loop down.
+
+        Channels with a fixed list of typed fields are added before open() and written as the
+        file's schema. Every record is a 16 byte header (time stamp, channel, record size) and
+        the channel's fields packed in order, padded to 8 bytes.
+
+        The file is memory mapped one segment at a time with two segments in flight: writers
+        reserve space in the active segment with an atomic add and copy their record in, and the
+        one that runs past its end switches to the standby segment. A background thread flushes
+        and fsyncs full segments and maps them again further into the file as the next standby,
+        and flushes the active segment every sync_period. Writers never wait on the disk or a
+        lock: if the standby is not ready yet the record is dropped and counted in
+        getDroppedCount(). write() and log() may be called from any number of threads. If the
+        flush thread can't map the next segment, e.g. on a full disk, records are dropped until it
+        can and the error is logged and kept for getError().
+
+        TelemetryReader reads the file back and converts it to one CSV per channel or to a
+        column per field for analysis tools.
+    */
+    class TelemetryLogger
+    {
+    public:
+        enum class FieldType : uint32_t
+        {
+            Float32 = 0,
+            Float64,
+            Int32,
+            UInt32,
+            Int64,
+            UInt64
+        };
+
+        struct Field
+        {
+            string name;
+            FieldType type = FieldType::Float32;
+
+            Field()
+            {
+            }
+            Field(const string& name_val, FieldType type_val)
+                : name(name_val), type(type_val)
+            {
+            }
+        };
+
+        struct Channel
+        {
+            string name;
+            vector<Field> fields;
+            uint payload_size = 0; //bytes of packed fields
+            uint record_size = 0; //with header and padding
+        };
+
+        struct Params
+        {
+            //multiple of 64KB so segments can be mapped on every platform
+            uint64_t segment_size = 8 * 1024 * 1024;
+            TTimeDelta sync_period = 0.1;
+        };
+
+        static constexpr uint kRecordHeaderSize = 16;
+
+    public:
+        TelemetryLogger();
+        explicit TelemetryLogger(const Params& params);
+        ~TelemetryLogger();
+
+        //fields of a Vector3r or Quaternionr as logged by log(), named name.x, ... and name.w, ...
+        static vector<Field> vector3Fields(const string& name);
+        static vector<Field> quaternionFields(const string& name);
+        static uint getFieldSize(FieldType type);
+        static string getFieldTypeName(FieldType type);
+
+        //channels can only be added while closed, returns the id to log with
+        uint addChannel(const string& name, const vector<Field>& fields);
+        const vector<Channel>& getChannels() const
+        {
+            return channels_;
+        }
+
+        //creates or truncates the file and starts the flush thread, throws if the file can't be mapped
+        void open(const string& file_name);
+        //writers must have stopped, records written during close() may be lost
+        void close();
+        bool isOpen() const
+        {
+            return is_open_;
+        }
+
+        //payload is the channel's fields packed in order, payload_size bytes
+        bool write(uint channel, TTimePoint time_stamp, const void* payload);
+
+        //packs args as the channel's fields: arithmetic values as is, Vector3r as 3 and Quaternionr
+        //as 4 real_T. Returns false if the record was dropped or the logger is closed
+        template <typename... Args>
+        bool log(uint channel, TTimePoint time_stamp, const Args&... args)
+        {
+            static constexpr uint payload_size = packedSize<Args...>();
+            if (channel >= channels_.size() || channels_[channel].payload_size != payload_size)
+                throw std::invalid_argument(Utils::stringf("TelemetryLogger: arguments don't match fields of channel %u", channel));
+
+            Segment* segment;
+            uint8_t* record = beginRecord(channel, time_stamp, segment);
+            if (record == nullptr)
+                return false;
+            uint8_t* payload = record + kRecordHeaderSize;
+            pack(payload, args...);
+            endRecord(segment);
+            return true;
+        }
+
+        uint64_t getRecordCount() const
+        {
+            return record_count_;
+        }
+        uint64_t getDroppedCount() const
+        {
+            return dropped_count_;
+        }
+        //last error of the flush thread since open(), empty if none
+        string getError() const;
+
+    private:
+        struct MappedFile;
+
+        struct Segment
+        {
+            uint8_t* data = nullptr;
+            uint64_t file_offset = 0;
+            std::atomic<uint64_t> reserved{ 0 }; //may run past segment_size once it is full
+            std::atomic<uint64_t> used{ 0 }; //end of the last record, set once the segment is full
+            std::atomic<uint> writers{ 0 }; //inside beginRecord/endRecord
+            std::atomic<bool> ready{ false }; //mapped and empty, waiting to become active
+            std::atomic<bool> retired{ false }; //full, waiting for the flush thread
+        };
+
+        uint8_t* beginRecord(uint channel, TTimePoint time_stamp, Segment*& segment);
+        void endRecord(Segment* segment)
+        {
+            ++record_count_;
+            segment->writers.fetch_sub(1);
+        }
+        Segment* getOther(Segment* segment)
+        {
+            return segment == &segments_[0] ? &segments_[1] : &segments_[0];
+        }
+        void mapSegment(Segment& segment);
+        void retireSegment(Segment& segment);
+        void flushLoop();
+
+        //Quaternionr::Identity() and friends are aligned Eigen types rather than Quaternionr, so
+        //Eigen vectors and quaternions of real_T are taken whatever their options
+        template <typename T>
+        struct Packed
+        {
+            static constexpr uint size = sizeof(T);
+        };
+        template <int Options, int MaxRows, int MaxCols>
+        struct Packed<Eigen::Matrix<real_T, 3, 1, Options, MaxRows, MaxCols>>
+        {
+            static constexpr uint size = 3 * sizeof(real_T);
+        };
+        template <int Options>
+        struct Packed<Eigen::Quaternion<real_T, Options>>
+        {
+            static constexpr uint size = 4 * sizeof(real_T);
+        };
+        template <typename... Args>
+        static constexpr uint packedSize()
+        {
+            uint size = 0;
+            for (uint s : { 0u, Packed<Args>::size... })
+                size += s;
+            return size;
+        }
+
+        template <typename T>
+        static void packOne(uint8_t*& out, const T& value)
+        {
+            static_assert(std::is_arithmetic<T>::value, "TelemetryLogger can only log arithmetic values, Vector3r and Quaternionr");
+            std::memcpy(out, &value, sizeof(T));
+            out += sizeof(T);
+        }
+        template <int Options, int MaxRows, int MaxCols>
+        static void packOne(uint8_t*& out, const Eigen::Matrix<real_T, 3, 1, Options, MaxRows, MaxCols>& value)
+        {
+            const real_T values[3] = { value.x(), value.y(), value.z() };
+            std::memcpy(out, values, sizeof(values));
+            out += sizeof(values);
+        }
+        template <int Options>
+        static void packOne(uint8_t*& out, const Eigen::Quaternion<real_T, Options>& value)
+        {
+            const real_T values[4] = { value.w(), value.x(), value.y(), value.z() };
+            std::memcpy(out, values, sizeof(values));
+            out += sizeof(values);
+        }
+        static void pack(uint8_t*&)
+        {
+        }
+        template <typename T, typename... Rest>
+        static void pack(uint8_t*& out, const T& value, const Rest&... rest)
+        {
+            packOne(out, value);
+            pack(out, rest...);
+        }
+
+    private:
+        Params params_;
+        vector<Channel> channels_;
+        bool is_open_ = false;
+
+        std::unique_ptr<MappedFile> file_;
+        uint64_t next_offset_ = 0; //where the next segment is mapped
+        Segment segments_[2];
+        std::atomic<Segment*> active_{ nullptr };
+        std::atomic<uint64_t> record_count_{ 0 };
+        std::atomic<uint64_t> dropped_count_{ 0 };
+
+        std::thread flush_thread_;
+        std::mutex flush_mutex_;
+        std::condition_variable flush_signal_;
+        std::atomic<bool> segment_retired_{ false };
+        bool is_stopping_ = false;
+
+        mutable std::mutex error_mutex_;
+        string error_;
+    };
+
+    //reads files written by TelemetryLogger, throws std::runtime_error if the file is not one
+    class TelemetryReader
+    {
+    public:
+        typedef TelemetryLogger::Channel Channel;
+        typedef TelemetryLogger::FieldType FieldType;
+
+        struct Record
+        {
+            uint channel = 0;
+            TTimePoint time_stamp = 0;
+            const uint8_t* payload = nullptr; //fields packed in order, not aligned
+        };
+
+        explicit TelemetryReader(const string& file_name);
+
+        const vector<Channel>& getChannels() const
+        {
+            return channels_;
+        }
+
+        //calls callback(const Record&) for every record in file order, which is only roughly time
+        //order when several threads were logging
+        template <typename TCallback>
+        void forEachRecord(TCallback callback) const
+        {
+            vector<uint8_t> segment;
+            for (uint64_t offset = data_offset_; readSegment(offset, segment); offset += segment_size_) {
+                uint64_t pos = 0;
+                while (pos + TelemetryLogger::kRecordHeaderSize <= segment.size()) {
+                    Record record;
+                    uint32_t size;
+                    std::memcpy(&record.time_stamp, &segment[pos], 8);
+                    std::memcpy(&record.channel, &segment[pos + 8], 4);
+                    std::memcpy(&size, &segment[pos + 12], 4);
+                    //rest of the segment was left empty when the next record didn't fit
+                    if (size == 0 || pos + size > segment.size() || record.channel >= channels_.size())
+                        break;
+                    record.payload = &segment[pos + TelemetryLogger::kRecordHeaderSize];
+                    callback(record);
+                    pos += size;
+                }
+            }
+        }
+
+        //field of a record as double, for printing and conversions
+        double getValue(const Record& record, uint field) const;
+
+        //one <channel>.csv per channel with time_stamp and a column per field
+        void exportCsv(const string& folder) const;
+        //one raw little endian array per field (<channel>.<field>.bin) in the field's type, with
+        //columns.json listing channels, their row counts, columns, types and files
+        void exportColumns(const string& folder) const;
+
+    private:
+        bool readSegment(uint64_t offset, vector<uint8_t>& segment) const;
+        static string toFileName(const string& name);
+
+    private:
+        string file_name_;
+        vector<Channel> channels_;
+        vector<vector<uint>> field_offsets_;
+        uint64_t segment_size_ = 0;
+        uint64_t data_offset_ = 0;
+        uint64_t file_size_ = 0;
+    };
+}
+} //namespace
+#endif
@@ -68,6 +68,18 @@ namespace airlib
                 member->reportState(reporter);
         }
 
+        virtual void saveState(StateSnapshot& snapshot) const override
+        {
+            for (const TUpdatableObjectPtr& member : members_)
+                member->saveState(snapshot);
+        }
+
+        virtual void restoreState(StateSnapshot& snapshot) override
+        {
+            for (TUpdatableObjectPtr& member : members_)
+                member->restoreState(snapshot);
+        }
+
         //*** End: UpdatableState implementation ***//
 
         virtual ~UpdatableContainer() = default;
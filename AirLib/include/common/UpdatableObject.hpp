@@ -62,6 +62,18 @@ init->reset calls for base-derived class that would be incorrect.
             //default implementation doesn't do anything
         }
 
+        //run time state for StateSnapshot, written and read back in the same order. Restoring
+        //puts the object where it was when saved without a reset, so the object must have been
+        //reset since it was created. Objects with nothing but their initial state keep the default
+        virtual void saveState(StateSnapshot& snapshot) const
+        {
+            unused(snapshot);
+        }
+        virtual void restoreState(StateSnapshot& snapshot)
+        {
+            unused(snapshot);
+        }
+
         virtual UpdatableObject* getPhysicsBody()
         {
             return nullptr;
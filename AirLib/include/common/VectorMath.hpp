@@ -130,6 +130,19 @@ namespace airlib
                 return Vector3T(rx_.next(), ry_.next(), rz_.next());
             }
 
+            void saveState(common_utils::StateSnapshot& snapshot) const
+            {
+                rx_.saveState(snapshot);
+                ry_.saveState(snapshot);
+                rz_.saveState(snapshot);
+            }
+            void restoreState(common_utils::StateSnapshot& snapshot)
+            {
+                rx_.restoreState(snapshot);
+                ry_.restoreState(snapshot);
+                rz_.restoreState(snapshot);
+            }
+
         private:
             RandomGeneratorXT rx_;
             RandomGeneratorYT ry_;
@@ -163,6 +176,19 @@ namespace airlib
                 return Vector3T(rx_.next(), ry_.next(), rz_.next());
             }
 
+            void saveState(common_utils::StateSnapshot& snapshot) const
+            {
+                rx_.saveState(snapshot);
+                ry_.saveState(snapshot);
+                rz_.saveState(snapshot);
+            }
+            void restoreState(common_utils::StateSnapshot& snapshot)
+            {
+                rx_.restoreState(snapshot);
+                ry_.restoreState(snapshot);
+                rz_.restoreState(snapshot);
+            }
+
         private:
             RandomGeneratorGausianXT rx_;
             RandomGeneratorGausianYT ry_;
@@ -0,0 +1,261 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef air_VectorMathBatch_hpp
+#define air_VectorMathBatch_hpp
+
+#include <cstddef>
+#include <algorithm>
+#include <vector>
+#include "common/VectorMath.hpp"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define AIRLIB_BATCH_SSE 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define AIRLIB_BATCH_NEON 1
+#endif
+
+namespace msr
+{
+namespace airlib
+{
+
+    /*
+    VectorMathBatch provides rigid transforms for large arrays of float points such as lidar
+    point clouds and back projected depth images. VectorMath::transformToWorldFrame works on
+    one vector at a time and rotates using quaternion, here we convert the pose to 3x4 matrix
+    once and then stream all points through it.
+
+    Points can be in AoS layout (x0, y0, z0, x1, ...), which is what LidarData::point_cloud uses,
+    or in SoA layout (separate x, y and z arrays). SSE (x86-64) or NEON (ARM) is used for AoS, AVX is
+    used for SoA when compiled with it. Input and output may be the same buffer.
+    */
+    class VectorMathBatch
+    {
+    public:
+        typedef VectorMathf::Vector3f Vector3f;
+        typedef VectorMathf::Quaternionf Quaternionf;
+        typedef VectorMathf::Matrix3x3f Matrix3x3f;
+        typedef VectorMathf::Pose Pose;
+
+        //row major rotation followed by translation: out = R * in + t
+        struct AffineTransform
+        {
+            float r[9];
+            float t[3];
+
+            AffineTransform()
+                : r{ 1, 0, 0, 0, 1, 0, 0, 0, 1 }, t{ 0, 0, 0 }
+            {
+            }
+
+            AffineTransform(const Matrix3x3f& rotation, const Vector3f& translation)
+            {
+                for (int row = 0; row < 3; ++row) {
+                    for (int col = 0; col < 3; ++col)
+                        r[row * 3 + col] = rotation(row, col);
+                    t[row] = translation[row];
+                }
+            }
+
+            //transform that takes points from body frame to world frame where body is at body_world
+            static AffineTransform bodyToWorld(const Pose& body_world)
+            {
+                return AffineTransform(body_world.orientation.toRotationMatrix(), body_world.position);
+            }
+
+            //transform that takes points from world frame to body frame where body is at body_world
+            static AffineTransform worldToBody(const Pose& body_world)
+            {
+                const Matrix3x3f rotation_inv = body_world.orientation.toRotationMatrix().transpose();
+                return AffineTransform(rotation_inv, -(rotation_inv * body_world.position));
+            }
+
+            //NED <-> ENU is same swap in both directions: (x, y, z) -> (y, x, -z)
+            static AffineTransform nedToEnu()
+            {
+                AffineTransform transform;
+                const float r_ned_enu[9] = { 0, 1, 0, 1, 0, 0, 0, 0, -1 };
+                std::copy(r_ned_enu, r_ned_enu + 9, transform.r);
+                return transform;
+            }
+
+            //apply this transform after other: result(p) = this(other(p))
+            AffineTransform compose(const AffineTransform& other) const
+            {
+                AffineTransform result;
+                for (int row = 0; row < 3; ++row) {
+                    for (int col = 0; col < 3; ++col)
+                        result.r[row * 3 + col] = r[row * 3] * other.r[col] + r[row * 3 + 1] * other.r[3 + col] + r[row * 3 + 2] * other.r[6 + col];
+                    result.t[row] = r[row * 3] * other.t[0] + r[row * 3 + 1] * other.t[1] + r[row * 3 + 2] * other.t[2] + t[row];
+                }
+                return result;
+            }
+
+            Vector3f apply(const Vector3f& v) const
+            {
+                return Vector3f(r[0] * v.x() + r[1] * v.y() + r[2] * v.z() + t[0],
+                                r[3] * v.x() + r[4] * v.y() + r[5] * v.z() + t[1],
+                                r[6] * v.x() + r[7] * v.y() + r[8] * v.z() + t[2]);
+            }
+        };
+
+    public:
+        //AoS: out[i] = transform(in[i]) for count xyz points
+        static void transformPoints(const float* in_xyz, float* out_xyz, size_t count, const AffineTransform& transform)
+        {
+            size_t i = 0;
+#if defined(AIRLIB_BATCH_SSE)
+            const __m128 r0 = _mm_set1_ps(transform.r[0]), r1 = _mm_set1_ps(transform.r[1]), r2 = _mm_set1_ps(transform.r[2]);
+            const __m128 r3 = _mm_set1_ps(transform.r[3]), r4 = _mm_set1_ps(transform.r[4]), r5 = _mm_set1_ps(transform.r[5]);
+            const __m128 r6 = _mm_set1_ps(transform.r[6]), r7 = _mm_set1_ps(transform.r[7]), r8 = _mm_set1_ps(transform.r[8]);
+            const __m128 t0 = _mm_set1_ps(transform.t[0]), t1 = _mm_set1_ps(transform.t[1]), t2 = _mm_set1_ps(transform.t[2]);
+
+            for (; i + 4 <= count; i += 4) {
+                //4 points are in 3 registers: [x0 y0 z0 x1] [y1 z1 x2 y2] [z2 x3 y3 z3]
+                const __m128 a = _mm_loadu_ps(in_xyz + i * 3);
+                const __m128 b = _mm_loadu_ps(in_xyz + i * 3 + 4);
+                const __m128 c = _mm_loadu_ps(in_xyz + i * 3 + 8);
+
+                //deinterleave in to x, y, z registers
+                const __m128 b2b3c0c1 = _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 0, 3, 2));
+                const __m128 a1a2b0b1 = _mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 0, 2, 1));
+                const __m128 b3b3c2c3 = _mm_shuffle_ps(b, c, _MM_SHUFFLE(3, 2, 3, 3));
+                const __m128 x = _mm_shuffle_ps(a, b2b3c0c1, _MM_SHUFFLE(3, 0, 3, 0));
+                const __m128 y = _mm_shuffle_ps(a1a2b0b1, b3b3c2c3, _MM_SHUFFLE(2, 0, 2, 0));
+                const __m128 z = _mm_shuffle_ps(a1a2b0b1, c, _MM_SHUFFLE(3, 0, 3, 1));
+
+                const __m128 ox = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r0, x), _mm_mul_ps(r1, y)), _mm_add_ps(_mm_mul_ps(r2, z), t0));
+                const __m128 oy = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r3, x), _mm_mul_ps(r4, y)), _mm_add_ps(_mm_mul_ps(r5, z), t1));
+                const __m128 oz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r6, x), _mm_mul_ps(r7, y)), _mm_add_ps(_mm_mul_ps(r8, z), t2));
+
+                //interleave back
+                const __m128 xy_lo = _mm_unpacklo_ps(ox, oy);
+                const __m128 zx_lo = _mm_unpacklo_ps(oz, ox);
+                const __m128 yz_lo = _mm_unpacklo_ps(oy, oz);
+                const __m128 xy_hi = _mm_unpackhi_ps(ox, oy);
+                const __m128 zx_hi = _mm_unpackhi_ps(oz, ox);
+                const __m128 yz_hi = _mm_unpackhi_ps(oy, oz);
+                _mm_storeu_ps(out_xyz + i * 3, _mm_shuffle_ps(xy_lo, zx_lo, _MM_SHUFFLE(3, 0, 1, 0)));
+                _mm_storeu_ps(out_xyz + i * 3 + 4, _mm_shuffle_ps(yz_lo, xy_hi, _MM_SHUFFLE(1, 0, 3, 2)));
+                _mm_storeu_ps(out_xyz + i * 3 + 8, _mm_shuffle_ps(zx_hi, yz_hi, _MM_SHUFFLE(3, 2, 3, 0)));
+            }
+#elif defined(AIRLIB_BATCH_NEON)
+            for (; i + 4 <= count; i += 4) {
+                const float32x4x3_t p = vld3q_f32(in_xyz + i * 3);
+                float32x4x3_t o;
+                for (int row = 0; row < 3; ++row) {
+                    float32x4_t acc = vdupq_n_f32(transform.t[row]);
+                    acc = vmlaq_n_f32(acc, p.val[0], transform.r[row * 3]);
+                    acc = vmlaq_n_f32(acc, p.val[1], transform.r[row * 3 + 1]);
+                    o.val[row] = vmlaq_n_f32(acc, p.val[2], transform.r[row * 3 + 2]);
+                }
+                vst3q_f32(out_xyz + i * 3, o);
+            }
+#endif
+            for (; i < count; ++i)
+                transformPoint(in_xyz + i * 3, out_xyz + i * 3, transform);
+        }
+
+        //SoA: (out_x[i], out_y[i], out_z[i]) = transform(x[i], y[i], z[i])
+        static void transformPoints(const float* x, const float* y, const float* z,
+                                    float* out_x, float* out_y, float* out_z, size_t count, const AffineTransform& transform)
+        {
+            size_t i = 0;
+#if defined(__AVX__)
+            const __m256 r0 = _mm256_set1_ps(transform.r[0]), r1 = _mm256_set1_ps(transform.r[1]), r2 = _mm256_set1_ps(transform.r[2]);
+            const __m256 r3 = _mm256_set1_ps(transform.r[3]), r4 = _mm256_set1_ps(transform.r[4]), r5 = _mm256_set1_ps(transform.r[5]);
+            const __m256 r6 = _mm256_set1_ps(transform.r[6]), r7 = _mm256_set1_ps(transform.r[7]), r8 = _mm256_set1_ps(transform.r[8]);
+            const __m256 t0 = _mm256_set1_ps(transform.t[0]), t1 = _mm256_set1_ps(transform.t[1]), t2 = _mm256_set1_ps(transform.t[2]);
+
+            for (; i + 8 <= count; i += 8) {
+                const __m256 px = _mm256_loadu_ps(x + i), py = _mm256_loadu_ps(y + i), pz = _mm256_loadu_ps(z + i);
+                _mm256_storeu_ps(out_x + i, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(r0, px), _mm256_mul_ps(r1, py)), _mm256_add_ps(_mm256_mul_ps(r2, pz), t0)));
+                _mm256_storeu_ps(out_y + i, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(r3, px), _mm256_mul_ps(r4, py)), _mm256_add_ps(_mm256_mul_ps(r5, pz), t1)));
+                _mm256_storeu_ps(out_z + i, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(r6, px), _mm256_mul_ps(r7, py)), _mm256_add_ps(_mm256_mul_ps(r8, pz), t2)));
+            }
+#elif defined(AIRLIB_BATCH_SSE)
+            const __m128 r0 = _mm_set1_ps(transform.r[0]), r1 = _mm_set1_ps(transform.r[1]), r2 = _mm_set1_ps(transform.r[2]);
+            const __m128 r3 = _mm_set1_ps(transform.r[3]), r4 = _mm_set1_ps(transform.r[4]), r5 = _mm_set1_ps(transform.r[5]);
+            const __m128 r6 = _mm_set1_ps(transform.r[6]), r7 = _mm_set1_ps(transform.r[7]), r8 = _mm_set1_ps(transform.r[8]);
+            const __m128 t0 = _mm_set1_ps(transform.t[0]), t1 = _mm_set1_ps(transform.t[1]), t2 = _mm_set1_ps(transform.t[2]);
+
+            for (; i + 4 <= count; i += 4) {
+                const __m128 px = _mm_loadu_ps(x + i), py = _mm_loadu_ps(y + i), pz = _mm_loadu_ps(z + i);
+                _mm_storeu_ps(out_x + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(r0, px), _mm_mul_ps(r1, py)), _mm_add_ps(_mm_mul_ps(r2, pz), t0)));
+                _mm_storeu_ps(out_y + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(r3, px), _mm_mul_ps(r4, py)), _mm_add_ps(_mm_mul_ps(r5, pz), t1)));
+                _mm_storeu_ps(out_z + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(r6, px), _mm_mul_ps(r7, py)), _mm_add_ps(_mm_mul_ps(r8, pz), t2)));
+            }
+#elif defined(AIRLIB_BATCH_NEON)
+            for (; i + 4 <= count; i += 4) {
+                const float32x4_t px = vld1q_f32(x + i), py = vld1q_f32(y + i), pz = vld1q_f32(z + i);
+                float* out[3] = { out_x, out_y, out_z };
+                for (int row = 0; row < 3; ++row) {
+                    float32x4_t acc = vdupq_n_f32(transform.t[row]);
+                    acc = vmlaq_n_f32(acc, px, transform.r[row * 3]);
+                    acc = vmlaq_n_f32(acc, py, transform.r[row * 3 + 1]);
+                    vst1q_f32(out[row] + i, vmlaq_n_f32(acc, pz, transform.r[row * 3 + 2]));
+                }
+            }
+#endif
+            for (; i < count; ++i) {
+                const float in[3] = { x[i], y[i], z[i] };
+                float out[3];
+                transformPoint(in, out, transform);
+                out_x[i] = out[0];
+                out_y[i] = out[1];
+                out_z[i] = out[2];
+            }
+        }
+
+        //convenience overloads for LidarData::point_cloud style buffers, transformed in place
+        static void transformToWorldFrame(std::vector<float>& point_cloud, const Pose& body_world)
+        {
+            transformPoints(point_cloud.data(), point_cloud.data(), point_cloud.size() / 3, AffineTransform::bodyToWorld(body_world));
+        }
+        static void transformToBodyFrame(std::vector<float>& point_cloud, const Pose& body_world)
+        {
+            transformPoints(point_cloud.data(), point_cloud.data(), point_cloud.size() / 3, AffineTransform::worldToBody(body_world));
+        }
+        static void rotatePoints(std::vector<float>& point_cloud, const Quaternionf& q)
+        {
+            transformPoints(point_cloud.data(), point_cloud.data(), point_cloud.size() / 3, AffineTransform(q.toRotationMatrix(), Vector3f::Zero()));
+        }
+        static void nedToEnu(std::vector<float>& point_cloud)
+        {
+            transformPoints(point_cloud.data(), point_cloud.data(), point_cloud.size() / 3, AffineTransform::nedToEnu());
+        }
+        static void enuToNed(std::vector<float>& point_cloud)
+        {
+            nedToEnu(point_cloud);
+        }
+
+        //same as VectorMath::transformToWorldFrame(Pose, Pose) for each element of poses_body
+        static void composePoses(const Pose* poses_body, Pose* poses_world, size_t count, const Pose& body_world)
+        {
+            //rotateQuaternion(q, ref) is ref * q * ref^-1, position is rotated by matrix
+            const Matrix3x3f rotation = body_world.orientation.toRotationMatrix();
+            const Quaternionf ref_conj = body_world.orientation.conjugate();
+            for (size_t i = 0; i < count; ++i) {
+                poses_world[i].position = rotation * poses_body[i].position + body_world.position;
+                poses_world[i].orientation = body_world.orientation * poses_body[i].orientation * ref_conj;
+            }
+        }
+
+    private:
+        static void transformPoint(const float* in, float* out, const AffineTransform& transform)
+        {
+            const float x = in[0], y = in[1], z = in[2];
+            out[0] = transform.r[0] * x + transform.r[1] * y + transform.r[2] * z + transform.t[0];
+            out[1] = transform.r[3] * x + transform.r[4] * y + transform.r[5] * z + transform.t[1];
+            out[2] = transform.r[6] * x + transform.r[7] * y + transform.r[8] * z + transform.t[2];
+        }
+    };
+}
+} //namespace
+#endif
@@ -12,6 +12,7 @@
 #include <exception>
 #include <future>
 #include <mutex>
+#include <condition_variable>
 #include "common/common_utils/Utils.hpp"
 #include "ClockFactory.hpp" //TODO: move this out of common_utils
 #include "CancelToken.hpp"
@@ -31,10 +32,11 @@ namespace airlib
             : is_complete_(false)
         {
         }
-        virtual ~CancelableAction();
+        virtual ~CancelableAction() = default;
 
         void reset()
         {
+            CancelToken::reset();
             is_complete_ = false;
         }
 
@@ -42,7 +44,8 @@ namespace airlib
         {
             try {
                 executeAction();
-                is_complete_ = true;
+                //an action that was cancelled returns early, so it did not complete
+                is_complete_ = !isCancelled();
             }
             catch (...) {
                 is_complete_ = false;
@@ -61,6 +64,8 @@ namespace airlib
 
     // This wraps a condition_variable so we can handle the case where we may signal before wait
     // and implement the semantics that say wait should be a noop in that case.
+    // Waits block on the condition variable until they are signaled, cancelled or time out, they
+    // never poll, so whoever makes the cancel predicate of a wait true calls notifyCancel().
     class WorkerThreadSignal
     {
         std::condition_variable cv_;
@@ -82,38 +87,47 @@ namespace airlib
             cv_.notify_one();
         }
 
-        template <class _Predicate>
-        void wait(_Predicate cancel)
+        //wakes waits whose cancel predicate has become true, call after changing what it reads
+        void notifyCancel()
         {
-            // wait for signal or cancel predicate
-            while (!signaled_) {
+            //taking the lock makes sure a waiter is either past checking its predicate and
+            //blocked, so it gets the notification, or has not checked it yet and will see it
+            {
                 std::unique_lock<std::mutex> lock(mutex_);
-                cv_.wait_for(lock, std::chrono::milliseconds(1), [this, cancel] {
-                    return cancel();
-                });
             }
-            signaled_ = false;
+            cv_.notify_all();
+        }
+
+        //returns true if signaled, false if woken by the cancel predicate
+        template <class _Predicate>
+        bool wait(_Predicate cancel)
+        {
+            // wait for signal or cancel predicate
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this, &cancel] {
+                return signaled_ || cancel();
+            });
+            return consumeSignal();
         }
 
+        //returns false if not signaled within timeout
         bool waitFor(double timeout_sec)
         {
-            // wait for signal or timeout or cancel predicate
-            while (!signaled_) {
-                std::unique_lock<std::mutex> lock(mutex_);
-                cv_.wait_for(lock, std::chrono::milliseconds(static_cast<long long>(timeout_sec * 1000)));
-            }
-            signaled_ = false;
-            return true;
+            // wait for signal or timeout
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait_for(lock, std::chrono::duration<double>(timeout_sec), [this] {
+                return static_cast<bool>(signaled_);
+            });
+            return consumeSignal();
         }
 
         void wait()
         {
-            // wait for signal or timeout or cancel predicate
+            // wait for signal
             std::unique_lock<std::mutex> lock(mutex_);
-            while (!signaled_) {
-                cv_.wait(lock);
-            }
-            lock.unlock();
+            cv_.wait(lock, [this] {
+                return static_cast<bool>(signaled_);
+            });
             signaled_ = false;
         }
 
@@ -133,6 +147,15 @@ namespace airlib
                 return true;
             }
         }
+
+    private:
+        //call with mutex_ held
+        bool consumeSignal()
+        {
+            const bool signaled = signaled_;
+            signaled_ = false;
+            return signaled;
+        }
     };
 
     // This class provides a synchronized worker thread that guarantees to execute
@@ -153,6 +176,7 @@ namespace airlib
         ~WorkerThread()
         {
             cancel_request_ = true;
+            item_arrived_.notifyCancel();
             cancel();
         }
         void enqueue(std::shared_ptr<CancelableAction> item)
@@ -160,10 +184,7 @@ namespace airlib
             //cancel previous item
             {
                 std::unique_lock<std::mutex> lock(mutex_);
-                std::shared_ptr<CancelableAction> pending = pending_item_;
-                if (pending != nullptr) {
-                    pending->cancel();
-                }
+                cancelItem(pending_item_);
             }
 
             bool running = false;
@@ -187,10 +208,7 @@ namespace airlib
             //cancel previous item
             {
                 std::unique_lock<std::mutex> lock(mutex_);
-                std::shared_ptr<CancelableAction> pending = pending_item_;
-                if (pending != nullptr) {
-                    pending->cancel();
-                }
+                cancelItem(pending_item_);
             }
 
             bool running = false;
@@ -209,7 +227,7 @@ namespace airlib
                 start();
             }
 
-            item->sleep(timeout_sec);
+            waitForItem(*item, timeout_sec);
 
             //after the wait if item is still running then cancel it
             if (!item->isCancelled() && !item->isComplete())
@@ -223,9 +241,7 @@ namespace airlib
             std::unique_lock<std::mutex> lock(mutex_);
             std::shared_ptr<CancelableAction> pending = pending_item_;
             pending_item_ = nullptr;
-            if (pending != nullptr) {
-                pending->cancel();
-            }
+            cancelItem(pending);
             if (thread_.joinable()) {
                 item_arrived_.signal();
                 thread_.join();
@@ -233,6 +249,40 @@ namespace airlib
         }
 
     private:
+        void cancelItem(const std::shared_ptr<CancelableAction>& item)
+        {
+            if (item != nullptr) {
+                item->cancel();
+                notifyItemFinished();
+            }
+        }
+
+        void notifyItemFinished()
+        {
+            //see WorkerThreadSignal::notifyCancel
+            {
+                std::unique_lock<std::mutex> lock(item_finished_mutex_);
+            }
+            item_finished_.notify_all();
+        }
+
+        //waits until the item completes or is cancelled, timeout is on the sim clock as the
+        //item's own sleep() is, so the wall clock wait is repeated until the sim clock is past it
+        void waitForItem(const CancelableAction& item, double timeout_sec)
+        {
+            const ClockBase* clock = ClockFactory::get();
+            const TTimePoint start = clock->nowNanos();
+            std::unique_lock<std::mutex> lock(item_finished_mutex_);
+            while (!item.isComplete() && !item.isCancelled()) {
+                const double remaining = timeout_sec - clock->elapsedSince(start);
+                if (remaining <= 0)
+                    break;
+                item_finished_.wait_for(lock, std::chrono::duration<double>(remaining), [&item] {
+                    return item.isComplete() || item.isCancelled();
+                });
+            }
+        }
+
         void start()
         {
             //if state == not running
@@ -287,6 +337,7 @@ namespace airlib
                         //Utils::DebugBreak();
                         Utils::log(Utils::stringf("WorkerThread caught unhandled exception: %s", e.what()), Utils::kLogLevelError);
                     }
+                    notifyItemFinished();
                 }
 
                 if (!cancel_request_) {
@@ -303,6 +354,9 @@ namespace airlib
         WorkerThreadSignal thread_started_;
         //when new item arrived, we signal this so waiting thread can continue
         WorkerThreadSignal item_arrived_;
+        //notified when an item completes or is cancelled for enqueueAndWait
+        std::condition_variable item_finished_;
+        std::mutex item_finished_mutex_;
 
         // thread state
         std::shared_ptr<CancelableAction> pending_item_;
@@ -0,0 +1,264 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef common_utils_AsyncLogger_hpp
+#define common_utils_AsyncLogger_hpp
+
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include "Utils.hpp"
+
+namespace common_utils
+{
+
+/*
+    Utils::Logger that hands messages to a background thread which passes them on to another
+    logger (the sink: console, Unreal log, file ...). Install it with Utils::getSetLogger(&async_logger).
+
+    Every thread that logs gets its own single-producer ring buffer the first time it logs, so
+    logging is a couple of stores and one release store with no lock and no shared cache line
+    between threads. Messages from Utils::logf with arithmetic arguments are stored unformatted
+    and formatted on the sink thread. A full buffer drops the message and counts it instead of
+    waiting, so a slow sink can never stall the caller (e.g. the physics loop); the sink thread
+    reports how many were dropped.
+
+    The sink thread drains all buffers every flush_interval, or right away for error messages,
+    and emits each batch ordered by time stamp. Buffers of threads that have exited are released
+    once drained. On destruction remaining messages are flushed and, if this logger is still
+    installed, the sink is installed in its place.
+*/
+class AsyncLogger : public Utils::Logger
+{
+public:
+    AsyncLogger(Utils::Logger* sink, size_t buffer_capacity = 1024,
+                std::chrono::milliseconds flush_interval = std::chrono::milliseconds(10))
+        : sink_(sink), capacity_(roundUpPow2(buffer_capacity)), flush_interval_(flush_interval), id_(nextId())
+    {
+        thread_ = std::thread(&AsyncLogger::sinkLoop, this);
+    }
+
+    virtual ~AsyncLogger()
+    {
+        if (Utils::getSetLogger() == this)
+            Utils::getSetLogger(sink_);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        thread_.join();
+    }
+
+    virtual void log(int level, const std::string& message) override
+    {
+        ThreadBuffer* buffer = getThreadBuffer();
+        Record* record = reserve(*buffer);
+        if (record) {
+            record->message = message;
+            record->is_deferred = false;
+            commit(*buffer, *record, level);
+        }
+    }
+
+    virtual void logDeferred(int level, const Utils::DeferredMessage& message) override
+    {
+        ThreadBuffer* buffer = getThreadBuffer();
+        Record* record = reserve(*buffer);
+        if (record) {
+            record->deferred = message;
+            record->is_deferred = true;
+            commit(*buffer, *record, level);
+        }
+    }
+
+    //blocks until everything logged before this call has been given to the sink
+    void flush()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        const uint64_t target = ++flush_requested_;
+        cv_.notify_all();
+        flushed_cv_.wait(lock, [this, target]() { return flush_done_ >= target || stop_; });
+    }
+
+    uint64_t getDroppedCount() const
+    {
+        return dropped_total_.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Record
+    {
+        int level = 0;
+        int64_t time_ns = 0;
+        bool is_deferred = false;
+        Utils::DeferredMessage deferred;
+        std::string message;
+    };
+
+    //single producer (the owning thread), single consumer (sink thread)
+    struct ThreadBuffer
+    {
+        explicit ThreadBuffer(size_t capacity)
+            : records(capacity), mask(capacity - 1)
+        {
+        }
+
+        std::vector<Record> records;
+        const size_t mask;
+        alignas(64) std::atomic<size_t> head{ 0 }; //written by producer
+        alignas(64) std::atomic<size_t> tail{ 0 }; //written by consumer
+        alignas(64) std::atomic<uint64_t> dropped{ 0 };
+    };
+
+    struct ThreadCacheEntry
+    {
+        uint64_t logger_id;
+        std::shared_ptr<ThreadBuffer> buffer;
+    };
+
+    static size_t roundUpPow2(size_t capacity)
+    {
+        size_t size = 2;
+        while (size < capacity)
+            size <<= 1;
+        return size;
+    }
+
+    static uint64_t nextId()
+    {
+        static std::atomic<uint64_t> next_id{ 0 };
+        return ++next_id;
+    }
+
+    static int64_t nowNanos()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    ThreadBuffer* getThreadBuffer()
+    {
+        //ids are never reused, so entries of destroyed loggers are never matched again
+        thread_local std::vector<ThreadCacheEntry> cache;
+        for (const auto& entry : cache)
+            if (entry.logger_id == id_)
+                return entry.buffer.get();
+
+        auto buffer = std::make_shared<ThreadBuffer>(capacity_);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            buffers_.push_back(buffer);
+        }
+        cache.push_back(ThreadCacheEntry{ id_, buffer });
+        return buffer.get();
+    }
+
+    static Record* reserve(ThreadBuffer& buffer)
+    {
+        const size_t head = buffer.head.load(std::memory_order_relaxed);
+        if (head - buffer.tail.load(std::memory_order_acquire) > buffer.mask) {
+            buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        return &buffer.records[head & buffer.mask];
+    }
+
+    void commit(ThreadBuffer& buffer, Record& record, int level)
+    {
+        record.level = level;
+        record.time_ns = nowNanos();
+        buffer.head.store(buffer.head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+
+        //set under the lock so the sink can't miss it between checking and waiting, errors are rare
+        if (level <= Utils::kLogLevelError) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                urgent_ = true;
+            }
+            cv_.notify_one();
+        }
+    }
+
+    //called on sink thread with mutex_ held
+    void drain(std::vector<Record>& batch)
+    {
+        uint64_t dropped = 0;
+        for (auto it = buffers_.begin(); it != buffers_.end();) {
+            ThreadBuffer& buffer = **it;
+            const size_t head = buffer.head.load(std::memory_order_acquire);
+            size_t tail = buffer.tail.load(std::memory_order_relaxed);
+            for (; tail != head; ++tail)
+                batch.push_back(std::move(buffer.records[tail & buffer.mask]));
+            buffer.tail.store(tail, std::memory_order_release);
+            dropped += buffer.dropped.exchange(0, std::memory_order_relaxed);
+
+            //only we hold it once the thread's cache is gone, so nothing can be pushed anymore
+            if (it->use_count() == 1 && buffer.head.load(std::memory_order_acquire) == tail)
+                it = buffers_.erase(it);
+            else
+                ++it;
+        }
+
+        std::stable_sort(batch.begin(), batch.end(), [](const Record& a, const Record& b) { return a.time_ns < b.time_ns; });
+
+        if (dropped > 0) {
+            dropped_total_.fetch_add(dropped, std::memory_order_relaxed);
+            Record record;
+            record.level = Utils::kLogLevelWarn;
+            record.message = "AsyncLogger: " + std::to_string(dropped) + " messages dropped because the log buffer was full";
+            batch.push_back(std::move(record));
+        }
+    }
+
+    void sinkLoop()
+    {
+        std::vector<Record> batch;
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            cv_.wait_for(lock, flush_interval_, [this]() { return stop_ || urgent_ || flush_requested_ != flush_done_; });
+            const bool stopping = stop_;
+            const uint64_t flush_target = flush_requested_;
+
+            drain(batch);
+            urgent_ = false;
+
+            //sink may be slow, never hold the lock while calling it
+            lock.unlock();
+            for (const Record& record : batch)
+                sink_->log(record.level, record.is_deferred ? record.deferred.toString() : record.message);
+            batch.clear();
+            lock.lock();
+
+            flush_done_ = flush_target;
+            flushed_cv_.notify_all();
+            if (stopping)
+                break;
+        }
+    }
+
+private:
+    Utils::Logger* sink_;
+    const size_t capacity_;
+    const std::chrono::milliseconds flush_interval_;
+    const uint64_t id_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::condition_variable flushed_cv_;
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers_;
+    uint64_t flush_requested_ = 0;
+    uint64_t flush_done_ = 0;
+    bool urgent_ = false; //an error was logged since the last drain
+    bool stop_ = false;
+    std::atomic<uint64_t> dropped_total_{ 0 };
+    std::thread thread_;
+};
+
+}
+#endif
@@ -4,14 +4,15 @@
 #ifndef commn_utils_AsyncTasker_hpp
 #define commn_utils_AsyncTasker_hpp
 
-#include "ctpl_stl.h"
+#include "TaskScheduler.hpp"
 #include <functional>
 
+//runs functions on its own TaskScheduler so long running tasks don't hold up the shared pool
 class AsyncTasker
 {
 public:
     AsyncTasker(unsigned int thread_count = 4)
-        : threads_(thread_count), error_handler_([](std::exception e) { unused(e); })
+        : error_handler_([](std::exception e) { unused(e); }), threads_(makeParams(thread_count))
     {
     }
 
@@ -26,8 +27,7 @@ public:
             return;
 
         if (iterations == 1) {
-            threads_.push([=](int i) {
-                unused(i);
+            threads_.submit([=]() {
                 try {
                     func();
                 }
@@ -37,8 +37,7 @@ public:
             });
         }
         else {
-            threads_.push([=](int i) {
-                unused(i);
+            threads_.submit([=]() {
                 try {
                     for (unsigned int itr = 0; itr < iterations; ++itr) {
                         func();
@@ -53,8 +52,17 @@ public:
     }
 
 private:
-    ctpl::thread_pool threads_;
+    static common_utils::TaskScheduler::Params makeParams(unsigned int thread_count)
+    {
+        common_utils::TaskScheduler::Params params;
+        params.thread_count = thread_count;
+        return params;
+    }
+
+private:
     std::function<void(std::exception&)> error_handler_;
+    //destroyed first so queued tasks can still use error_handler_
+    common_utils::TaskScheduler threads_;
 };
 
 #endif
@@ -0,0 +1,432 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef common_utils_BoundedMpmcQueue_hpp
+#define common_utils_BoundedMpmcQueue_hpp
+
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <memory>
+#include <new>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <stdexcept>
+
+namespace common_utils
+{
+
+/*
+    Bounded multi-producer multi-consumer queue based on Dmitry Vyukov's ring buffer. Each slot
+    carries a sequence number that tells producers and consumers whether it is free or filled for
+    the current lap, so tryPush/tryPop are a single CAS on the shared position plus one store to
+    the slot and no lock is taken.
+
+    Batch calls claim several consecutive slots with one CAS, which cuts contention on the shared
+    positions when items arrive in bursts (e.g. all images of one capture).
+
+    Blocking push/pop spin briefly and then sleep on a condition variable. The mutex is only touched
+    when the queue is actually full or empty and a waiter is registered, so the uncontended fast
+    path stays lock-free. close() wakes all waiters: push fails from then on and pop drains
+    whatever is left before failing.
+
+    Capacity is rounded up to a power of two. Unlike ProsumerQueue this never grows so a slow
+    consumer throttles producers instead of growing memory.
+*/
+template <typename T>
+class BoundedMpmcQueue
+{
+public:
+    explicit BoundedMpmcQueue(size_t capacity)
+    {
+        if (capacity < 2)
+            capacity = 2;
+        size_t size = 1;
+        while (size < capacity)
+            size <<= 1;
+
+        mask_ = size - 1;
+        cells_.reset(new Cell[size]);
+        for (size_t i = 0; i < size; ++i)
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    ~BoundedMpmcQueue()
+    {
+        const size_t enqueue_pos = enqueue_pos_.load();
+        for (size_t pos = dequeue_pos_.load(); pos != enqueue_pos; ++pos) {
+            Cell& cell = cells_[pos & mask_];
+            if (cell.sequence.load() == pos + 1)
+                cell.get()->~T();
+        }
+    }
+
+    size_t capacity() const
+    {
+        return mask_ + 1;
+    }
+
+    //may be stale by the time it returns when other threads are active
+    size_t sizeApprox() const
+    {
+        const size_t enqueue_pos = enqueue_pos_.load(std::memory_order_relaxed);
+        const size_t dequeue_pos = dequeue_pos_.load(std::memory_order_relaxed);
+        return enqueue_pos > dequeue_pos ? enqueue_pos - dequeue_pos : 0;
+    }
+
+    bool tryPush(const T& item)
+    {
+        T copy(item);
+        return tryPush(std::move(copy));
+    }
+
+    bool tryPush(T&& item)
+    {
+        size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;) {
+            cell = &cells_[pos & mask_];
+            const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            const intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+                return false; //full
+            else
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+        }
+
+        new (&cell->storage) T(std::move(item));
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        notifyWaiters(not_empty_, 1);
+        return true;
+    }
+
+    bool tryPop(T& item)
+    {
+        size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;) {
+            cell = &cells_[pos & mask_];
+            const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            const intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+                return false; //empty
+            else
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+        }
+
+        T* stored = cell->get();
+        item = std::move(*stored);
+        stored->~T();
+        cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+        notifyWaiters(not_full_, 1);
+        return true;
+    }
+
+    //moves up to count items from the front of items in to queue, returns number pushed
+    size_t tryPushBatch(T* items, size_t count)
+    {
+        if (count == 0)
+            return 0;
+
+        size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        size_t claimed;
+        for (;;) {
+            claimed = countReady(pos, 0, count);
+            if (claimed == 0) {
+                const size_t sequence = cells_[pos & mask_].sequence.load(std::memory_order_acquire);
+                if (static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos) < 0)
+                    return 0; //full
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+            else if (enqueue_pos_.compare_exchange_weak(pos, pos + claimed, std::memory_order_relaxed))
+                break;
+        }
+
+        for (size_t i = 0; i < claimed; ++i) {
+            Cell& cell = cells_[(pos + i) & mask_];
+            new (&cell.storage) T(std::move(items[i]));
+            cell.sequence.store(pos + i + 1, std::memory_order_release);
+        }
+        notifyWaiters(not_empty_, claimed);
+        return claimed;
+    }
+
+    //moves up to max_count items in to items, returns number popped
+    size_t tryPopBatch(T* items, size_t max_count)
+    {
+        if (max_count == 0)
+            return 0;
+
+        size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        size_t claimed;
+        for (;;) {
+            claimed = countReady(pos, 1, max_count);
+            if (claimed == 0) {
+                const size_t sequence = cells_[pos & mask_].sequence.load(std::memory_order_acquire);
+                if (static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1) < 0)
+                    return 0; //empty
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+            }
+            else if (dequeue_pos_.compare_exchange_weak(pos, pos + claimed, std::memory_order_relaxed))
+                break;
+        }
+
+        for (size_t i = 0; i < claimed; ++i) {
+            Cell& cell = cells_[(pos + i) & mask_];
+            T* stored = cell.get();
+            items[i] = std::move(*stored);
+            stored->~T();
+            cell.sequence.store(pos + i + mask_ + 1, std::memory_order_release);
+        }
+        notifyWaiters(not_full_, claimed);
+        return claimed;
+    }
+
+    //blocks while full, returns false if queue was closed
+    bool push(T&& item)
+    {
+        return waitFor(not_full_, [&] { return !is_closed_ && tryPush(std::move(item)); });
+    }
+
+    bool push(const T& item)
+    {
+        T copy(item);
+        return push(std::move(copy));
+    }
+
+    //blocks while empty, returns false once queue is closed and drained
+    bool pop(T& item)
+    {
+        return waitFor(not_empty_, [&] { return tryPop(item); });
+    }
+
+    //blocks until all items are pushed, returns number pushed which is less than count only if closed
+    size_t pushBatch(T* items, size_t count)
+    {
+        size_t pushed = 0;
+        while (pushed < count) {
+            if (!waitFor(not_full_, [&] {
+                    const size_t n = is_closed_ ? 0 : tryPushBatch(items + pushed, count - pushed);
+                    pushed += n;
+                    return n > 0;
+                }))
+                break;
+        }
+        return pushed;
+    }
+
+    //blocks until at least one item is available, returns 0 once queue is closed and drained
+    size_t popBatch(T* items, size_t max_count)
+    {
+        size_t popped = 0;
+        waitFor(not_empty_, [&] {
+            popped = tryPopBatch(items, max_count);
+            return popped > 0;
+        });
+        return popped;
+    }
+
+    void close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            is_closed_ = true;
+        }
+        not_full_.cond.notify_all();
+        not_empty_.cond.notify_all();
+    }
+
+    bool isClosed() const
+    {
+        return is_closed_;
+    }
+
+    // non-copiable
+    BoundedMpmcQueue(const BoundedMpmcQueue&) = delete;
+    BoundedMpmcQueue& operator=(const BoundedMpmcQueue&) = delete;
+
+private:
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+
+        T* get()
+        {
+            return reinterpret_cast<T*>(&storage);
+        }
+    };
+
+    static constexpr size_t kCacheLineSize = 64;
+    static constexpr int kSpinCount = 64;
+
+    //number of consecutive slots from pos that are ready, offset is 0 for producers and 1 for consumers
+    size_t countReady(size_t pos, size_t offset, size_t max_count) const
+    {
+        const size_t limit = max_count < capacity() ? max_count : capacity();
+        size_t count = 0;
+        while (count < limit && cells_[(pos + count) & mask_].sequence.load(std::memory_order_acquire) == pos + count + offset)
+            ++count;
+        return count;
+    }
+
+    //threads sleeping until queue is not full or not empty, epoch changes on every notification
+    struct WaitList
+    {
+        std::atomic<int> waiters{ 0 };
+        std::atomic<uint64_t> epoch{ 0 };
+        std::condition_variable cond;
+    };
+
+    //try_op is retried until it succeeds or queue is closed, try_op must not hold mutex_ because
+    //successful operations notify waiters
+    template <typename TryOp>
+    bool waitFor(WaitList& wait_list, TryOp try_op)
+    {
+        for (int spin = 0; spin < kSpinCount; ++spin) {
+            if (try_op())
+                return true;
+            if (is_closed_)
+                return try_op();
+            if (spin > kSpinCount / 2)
+                std::this_thread::yield();
+        }
+
+        for (;;) {
+            //epoch is read before the last attempt so a notification after it can't be missed
+            const uint64_t epoch = wait_list.epoch.load();
+            wait_list.waiters.fetch_add(1);
+            //pairs with fence in notifyWaiters so either we see the new state or the notifier sees us
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            const bool success = try_op();
+            if (!success && !is_closed_) {
+                std::unique_lock<std::mutex> lock(mutex_);
+                wait_list.cond.wait(lock, [&] { return wait_list.epoch.load() != epoch || is_closed_; });
+            }
+            wait_list.waiters.fetch_sub(1);
+
+            if (success)
+                return true;
+            //consumers still drain a closed queue
+            if (is_closed_)
+                return try_op();
+        }
+    }
+
+    void notifyWaiters(WaitList& wait_list, size_t count)
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (wait_list.waiters.load(std::memory_order_relaxed) == 0)
+            return;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            ++wait_list.epoch;
+        }
+        if (count == 1)
+            wait_list.cond.notify_one();
+        else
+            wait_list.cond.notify_all();
+    }
+
+private:
+    std::unique_ptr<Cell[]> cells_;
+    size_t mask_;
+
+    //keep producer and consumer positions on separate cache lines
+    char pad0_[kCacheLineSize];
+    std::atomic<size_t> enqueue_pos_{ 0 };
+    char pad1_[kCacheLineSize - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> dequeue_pos_{ 0 };
+    char pad2_[kCacheLineSize - sizeof(std::atomic<size_t>)];
+
+    std::atomic<bool> is_closed_{ false };
+    std::mutex mutex_;
+    WaitList not_full_, not_empty_;
+};
+
+/*
+    Reuses heap allocated objects such as image buffers instead of freeing and allocating them for
+    every sample. acquire() hands out a unique_ptr that returns the object to the pool when it goes
+    out of scope; objects keep their state (e.g. vector capacity) so reset them as needed.
+    Pool holds at most capacity idle objects, extra ones are freed. The pool must outlive the
+    pointers it hands out.
+*/
+template <typename T>
+class ObjectPool
+{
+public:
+    class Deleter
+    {
+    public:
+        Deleter(ObjectPool* pool = nullptr)
+            : pool_(pool)
+        {
+        }
+
+        void operator()(T* obj) const
+        {
+            if (pool_)
+                pool_->release(obj);
+            else
+                delete obj;
+        }
+
+    private:
+        ObjectPool* pool_;
+    };
+    typedef std::unique_ptr<T, Deleter> Ptr;
+
+public:
+    explicit ObjectPool(size_t capacity)
+        : free_(capacity)
+    {
+    }
+
+    ~ObjectPool()
+    {
+        T* obj;
+        while (free_.tryPop(obj))
+            delete obj;
+    }
+
+    Ptr acquire()
+    {
+        T* obj;
+        if (!free_.tryPop(obj)) {
+            obj = new T();
+            ++allocation_count_;
+        }
+        return Ptr(obj, Deleter(this));
+    }
+
+    //number of objects ever allocated by the pool, stops growing once pool is warm
+    size_t getAllocationCount() const
+    {
+        return allocation_count_;
+    }
+
+private:
+    void release(T* obj)
+    {
+        if (!free_.tryPush(obj))
+            delete obj;
+    }
+
+private:
+    BoundedMpmcQueue<T*> free_;
+    std::atomic<size_t> allocation_count_{ 0 };
+};
+}
+#endif
@@ -0,0 +1,486 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef common_utils_BufferPool_hpp
+#define common_utils_BufferPool_hpp
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <type_traits>
+#include <initializer_list>
+#include <stdexcept>
+#include "BoundedMpmcQueue.hpp"
+
+namespace common_utils
+{
+
+/*
+    Pool of reusable memory blocks for large transient buffers such as captured images. Requests
+    are rounded up to power of two size classes between min_block_size and max_block_size and
+    released blocks are kept in a lock free free list per class. Blocks bigger than max_block_size
+    are allocated and freed directly.
+
+    Blocks are refcounted and handed out wrapped in PooledBuffer. A pool must outlive all buffers
+    acquired from it, the default pool is never destroyed.
+*/
+class BufferPool
+{
+public:
+    struct Params
+    {
+        size_t min_block_size = 4 * 1024;
+        size_t max_block_size = 256 * 1024 * 1024;
+        //free blocks kept per size class, more are freed on release
+        size_t max_free_blocks = 16;
+    };
+
+    struct Stats
+    {
+        //blocks handed out, and how many of those came from a free list
+        uint64_t acquired = 0;
+        uint64_t reused = 0;
+        //blocks allocated from and freed to the heap
+        uint64_t allocated = 0;
+        uint64_t freed = 0;
+        uint64_t bytes_in_use = 0;
+        uint64_t peak_bytes_in_use = 0;
+        uint64_t bytes_free = 0;
+    };
+
+    class Block
+    {
+    public:
+        uint8_t* data() const
+        {
+            return data_.get();
+        }
+        size_t capacity() const
+        {
+            return capacity_;
+        }
+        unsigned int useCount() const
+        {
+            return ref_count_.load(std::memory_order_acquire);
+        }
+
+        void addRef()
+        {
+            ref_count_.fetch_add(1, std::memory_order_relaxed);
+        }
+        void release()
+        {
+            if (ref_count_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                pool_->recycle(this);
+        }
+
+    private:
+        friend class BufferPool;
+
+        Block(BufferPool* pool, size_t capacity, int size_class)
+            : pool_(pool), capacity_(capacity), size_class_(size_class), data_(new uint8_t[capacity])
+        {
+        }
+
+        BufferPool* pool_;
+        size_t capacity_;
+        //-1 for blocks too big to pool
+        int size_class_;
+        std::unique_ptr<uint8_t[]> data_;
+        std::atomic<unsigned int> ref_count_{ 0 };
+    };
+
+public:
+    explicit BufferPool(const Params& params)
+        : params_(params)
+    {
+        if (params_.min_block_size == 0 || params_.max_block_size < params_.min_block_size)
+            throw std::invalid_argument("BufferPool block sizes must be non-zero and max_block_size >= min_block_size");
+
+        for (size_t size = params_.min_block_size; size <= params_.max_block_size && size != 0; size *= 2)
+            free_lists_.emplace_back(new BoundedMpmcQueue<Block*>(std::max<size_t>(1, params_.max_free_blocks)));
+    }
+
+    BufferPool()
+        : BufferPool(Params())
+    {
+    }
+
+    ~BufferPool()
+    {
+        for (auto& free_list : free_lists_) {
+            Block* block;
+            while (free_list->tryPop(block))
+                delete block;
+        }
+    }
+
+    //shared by all image responses, intentionally leaked so buffers in static objects stay valid
+    static BufferPool& getDefault()
+    {
+        static BufferPool* pool = new BufferPool();
+        return *pool;
+    }
+
+    //returns block with refcount 1 and capacity of at least size bytes
+    Block* acquire(size_t size)
+    {
+        const int size_class = getSizeClass(size);
+        Block* block = nullptr;
+        if (size_class >= 0 && free_lists_[size_class]->tryPop(block)) {
+            bytes_free_.fetch_sub(block->capacity(), std::memory_order_relaxed);
+            reused_.fetch_add(1, std::memory_order_relaxed);
+        }
+        else {
+            const size_t capacity = size_class >= 0 ? params_.min_block_size << size_class : size;
+            block = new Block(this, capacity, size_class);
+            allocated_.fetch_add(1, std::memory_order_relaxed);
+        }
+        acquired_.fetch_add(1, std::memory_order_relaxed);
+
+        const uint64_t in_use = bytes_in_use_.fetch_add(block->capacity(), std::memory_order_relaxed) + block->capacity();
+        uint64_t peak = peak_bytes_in_use_.load(std::memory_order_relaxed);
+        while (in_use > peak && !peak_bytes_in_use_.compare_exchange_weak(peak, in_use, std::memory_order_relaxed))
+            ;
+
+        block->ref_count_.store(1, std::memory_order_relaxed);
+        return block;
+    }
+
+    Stats getStats() const
+    {
+        Stats stats;
+        stats.acquired = acquired_.load(std::memory_order_relaxed);
+        stats.reused = reused_.load(std::memory_order_relaxed);
+        stats.allocated = allocated_.load(std::memory_order_relaxed);
+        stats.freed = freed_.load(std::memory_order_relaxed);
+        stats.bytes_in_use = bytes_in_use_.load(std::memory_order_relaxed);
+        stats.peak_bytes_in_use = peak_bytes_in_use_.load(std::memory_order_relaxed);
+        stats.bytes_free = bytes_free_.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+    //frees all blocks in free lists, e.g. after a burst of large captures
+    void trim()
+    {
+        for (auto& free_list : free_lists_) {
+            Block* block;
+            while (free_list->tryPop(block)) {
+                bytes_free_.fetch_sub(block->capacity(), std::memory_order_relaxed);
+                freeBlock(block);
+            }
+        }
+    }
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+private:
+    int getSizeClass(size_t size) const
+    {
+        if (size > params_.max_block_size)
+            return -1;
+        int size_class = 0;
+        for (size_t capacity = params_.min_block_size; capacity < size; capacity *= 2)
+            ++size_class;
+        return size_class;
+    }
+
+    void recycle(Block* block)
+    {
+        bytes_in_use_.fetch_sub(block->capacity(), std::memory_order_relaxed);
+        if (block->size_class_ >= 0 && free_lists_[block->size_class_]->tryPush(block))
+            bytes_free_.fetch_add(block->capacity(), std::memory_order_relaxed);
+        else
+            freeBlock(block);
+    }
+
+    void freeBlock(Block* block)
+    {
+        freed_.fetch_add(1, std::memory_order_relaxed);
+        delete block;
+    }
+
+private:
+    Params params_;
+    std::vector<std::unique_ptr<BoundedMpmcQueue<Block*>>> free_lists_;
+
+    std::atomic<uint64_t> acquired_{ 0 }, reused_{ 0 }, allocated_{ 0 }, freed_{ 0 };
+    std::atomic<uint64_t> bytes_in_use_{ 0 }, peak_bytes_in_use_{ 0 }, bytes_free_{ 0 };
+};
+
+/*
+    Array of trivially copyable T stored in a BufferPool block. Copies share the block and
+    non-const access copies it first if it is shared (copy on write), so passing buffers around
+    by value is cheap and copies behave like independent vectors.
+
+    Provides the subset of std::vector interface used for image data and converts implicitly to
+    and from std::vector so existing code using vectors keeps working.
+*/
+template <typename T>
+class PooledBuffer
+{
+    static_assert(std::is_trivially_copyable<T>::value, "PooledBuffer only holds trivially copyable types");
+
+public:
+    typedef T value_type;
+    typedef T* iterator;
+    typedef const T* const_iterator;
+
+public:
+    PooledBuffer()
+    {
+    }
+
+    //count value initialized elements like std::vector
+    explicit PooledBuffer(size_t count, BufferPool& pool = BufferPool::getDefault())
+        : pool_(&pool)
+    {
+        resizeUninitialized(count);
+        std::fill(data_, data_ + size_, T());
+    }
+
+    PooledBuffer(const T* data, size_t count, BufferPool& pool = BufferPool::getDefault())
+        : pool_(&pool)
+    {
+        assign(data, count);
+    }
+
+    PooledBuffer(const std::vector<T>& vec)
+        : PooledBuffer(vec.data(), vec.size())
+    {
+    }
+
+    PooledBuffer(std::initializer_list<T> values)
+        : PooledBuffer(values.begin(), values.size())
+    {
+    }
+
+    //elements are left uninitialized, for producers that overwrite whole buffer
+    static PooledBuffer uninitialized(size_t count, BufferPool& pool = BufferPool::getDefault())
+    {
+        PooledBuffer buffer;
+        buffer.pool_ = &pool;
+        buffer.resizeUninitialized(count);
+        return buffer;
+    }
+
+    PooledBuffer(const PooledBuffer& other)
+        : block_(other.block_), data_(other.data_), size_(other.size_), pool_(other.pool_)
+    {
+        if (block_)
+            block_->addRef();
+    }
+
+    PooledBuffer(PooledBuffer&& other) noexcept
+        : block_(other.block_), data_(other.data_), size_(other.size_), pool_(other.pool_)
+    {
+        other.block_ = nullptr;
+        other.data_ = nullptr;
+        other.size_ = 0;
+    }
+
+    PooledBuffer& operator=(const PooledBuffer& other)
+    {
+        if (this != &other) {
+            if (other.block_)
+                other.block_->addRef();
+            releaseBlock();
+            block_ = other.block_;
+            data_ = other.data_;
+            size_ = other.size_;
+            pool_ = other.pool_;
+        }
+        return *this;
+    }
+
+    PooledBuffer& operator=(PooledBuffer&& other) noexcept
+    {
+        if (this != &other) {
+            releaseBlock();
+            block_ = other.block_;
+            data_ = other.data_;
+            size_ = other.size_;
+            pool_ = other.pool_;
+            other.block_ = nullptr;
+            other.data_ = nullptr;
+            other.size_ = 0;
+        }
+        return *this;
+    }
+
+    ~PooledBuffer()
+    {
+        releaseBlock();
+    }
+
+    size_t size() const
+    {
+        return size_;
+    }
+    bool empty() const
+    {
+        return size_ == 0;
+    }
+    size_t capacity() const
+    {
+        return block_ ? block_->capacity() / sizeof(T) : 0;
+    }
+    //number of buffers sharing the block, 0 if nothing is allocated
+    unsigned int useCount() const
+    {
+        return block_ ? block_->useCount() : 0;
+    }
+
+    const T* data() const
+    {
+        return data_;
+    }
+    T* data()
+    {
+        makeUnique();
+        return data_;
+    }
+
+    const T& operator[](size_t index) const
+    {
+        return data_[index];
+    }
+    T& operator[](size_t index)
+    {
+        makeUnique();
+        return data_[index];
+    }
+
+    const_iterator begin() const
+    {
+        return data_;
+    }
+    const_iterator end() const
+    {
+        return data_ + size_;
+    }
+    iterator begin()
+    {
+        return data();
+    }
+    iterator end()
+    {
+        return data() + size_;
+    }
+
+    void assign(const T* data, size_t count)
+    {
+        resizeUninitialized(count);
+        if (count > 0)
+            std::memcpy(data_, data, count * sizeof(T));
+    }
+
+    //new elements are value initialized
+    void resize(size_t count)
+    {
+        const size_t old_size = size_;
+        resizeUninitialized(count);
+        if (count > old_size)
+            std::fill(data_ + old_size, data_ + count, T());
+    }
+
+    //keeps existing elements, new ones are uninitialized
+    void resizeUninitialized(size_t count)
+    {
+        if (count <= capacity() && (!block_ || block_->useCount() == 1)) {
+            size_ = count;
+            return;
+        }
+        if (count == 0) {
+            releaseBlock();
+            return;
+        }
+
+        BufferPool::Block* block = getPool().acquire(count * sizeof(T));
+        T* data = reinterpret_cast<T*>(block->data());
+        if (size_ > 0)
+            std::memcpy(data, data_, std::min(size_, count) * sizeof(T));
+        releaseBlock();
+        block_ = block;
+        data_ = data;
+        size_ = count;
+    }
+
+    void push_back(const T& value)
+    {
+        if (size_ == capacity() || useCount() > 1) {
+            const T copy = value; //value may point in to this buffer
+            reserve(std::max<size_t>(size_ * 2, 1));
+            data_[size_++] = copy;
+        }
+        else {
+            makeUnique();
+            data_[size_++] = value;
+        }
+    }
+
+    void reserve(size_t count)
+    {
+        if (count <= capacity())
+            return;
+        const size_t old_size = size_;
+        resizeUninitialized(count);
+        size_ = old_size;
+    }
+
+    //keeps block so buffer can be refilled without allocation
+    void clear()
+    {
+        if (useCount() > 1)
+            releaseBlock();
+        size_ = 0;
+    }
+
+    std::vector<T> toVector() const
+    {
+        return std::vector<T>(data_, data_ + size_);
+    }
+
+    operator std::vector<T>() const
+    {
+        return toVector();
+    }
+
+private:
+    BufferPool& getPool() const
+    {
+        return pool_ ? *pool_ : BufferPool::getDefault();
+    }
+
+    void makeUnique()
+    {
+        if (block_ && block_->useCount() > 1) {
+            BufferPool::Block* block = getPool().acquire(size_ * sizeof(T));
+            std::memcpy(block->data(), data_, size_ * sizeof(T));
+            block_->release();
+            block_ = block;
+            data_ = reinterpret_cast<T*>(block->data());
+        }
+    }
+
+    void releaseBlock()
+    {
+        if (block_)
+            block_->release();
+        block_ = nullptr;
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+private:
+    BufferPool::Block* block_ = nullptr;
+    T* data_ = nullptr;
+    size_t size_ = 0;
+    BufferPool* pool_ = nullptr;
+};
+}
+#endif
@@ -0,0 +1,292 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef common_utils_IndexableSkipList_hpp
+#define common_utils_IndexableSkipList_hpp
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+
+namespace common_utils
+{
+
+/*
+    Sorted multiset of at most capacity values with O(log n) insert, erase, lookup by rank and
+    sums over value ranges, for rolling statistics over a sliding window.
+
+    Every link of the skip list stores how many values it skips over (its width) and the sum and
+    sum of squares of those values, including the one it lands on. Walking down from the top
+    level while adding up links gives the rank or prefix sums of any value, as in Hettinger's
+    indexable skip list.
+
+    Nodes come from a pool sized at construction, so insert and erase never allocate. Sums are
+    kept in double whatever T is.
+*/
+template <typename T>
+class IndexableSkipList
+{
+public:
+    struct Sums
+    {
+        size_t count = 0;
+        double sum = 0;
+        double sum_squares = 0;
+    };
+
+    explicit IndexableSkipList(size_t capacity = 0)
+    {
+        reserve(capacity);
+    }
+
+    //removes all values and makes room for capacity of them
+    void reserve(size_t capacity)
+    {
+        capacity_ = capacity;
+        level_count_ = 1;
+        while (level_count_ < kMaxLevels && (size_t(1) << level_count_) < capacity)
+            ++level_count_;
+
+        //node 0 is the head
+        const size_t node_count = capacity + 1;
+        values_.assign(node_count, T());
+        heights_.assign(node_count, 0);
+        links_.assign(node_count * level_count_, Link());
+        free_.clear();
+        for (size_t i = node_count - 1; i > 0; --i)
+            free_.push_back(static_cast<uint32_t>(i));
+        //end of the list is treated as a node after the last value
+        for (uint32_t level = 0; level < level_count_; ++level)
+            links_[level].width = 1;
+        heights_[0] = level_count_;
+        size_ = 0;
+    }
+
+    void clear()
+    {
+        reserve(capacity_);
+    }
+
+    size_t size() const
+    {
+        return size_;
+    }
+
+    size_t capacity() const
+    {
+        return capacity_;
+    }
+
+    //false if full
+    bool insert(const T& value)
+    {
+        if (free_.empty())
+            return false;
+
+        uint32_t preds[kMaxLevels];
+        size_t pred_counts[kMaxLevels];
+        Sums pred_sums[kMaxLevels];
+        findPreds(value, preds, pred_counts, pred_sums);
+
+        const uint32_t node = free_.back();
+        free_.pop_back();
+        values_[node] = value;
+        heights_[node] = randomHeight();
+
+        //position and prefix sums of the new node
+        const double v = static_cast<double>(value);
+        const size_t node_count = pred_counts[0] + 1;
+        const double node_sum = pred_sums[0].sum + v, node_sum_squares = pred_sums[0].sum_squares + v * v;
+
+        for (uint32_t level = 0; level < level_count_; ++level) {
+            Link& pred_link = link(preds[level], level);
+            if (level < heights_[node]) {
+                //split pred -> next into pred -> node -> next
+                Link& node_link = link(node, level);
+                node_link.next = pred_link.next;
+                node_link.width = pred_link.width + 1 - (node_count - pred_counts[level]);
+                node_link.sum = pred_link.sum + v - (node_sum - pred_sums[level].sum);
+                node_link.sum_squares = pred_link.sum_squares + v * v - (node_sum_squares - pred_sums[level].sum_squares);
+
+                pred_link.next = node;
+                pred_link.width = node_count - pred_counts[level];
+                pred_link.sum = node_sum - pred_sums[level].sum;
+                pred_link.sum_squares = node_sum_squares - pred_sums[level].sum_squares;
+            }
+            else {
+                //node is somewhere under this link
+                ++pred_link.width;
+                pred_link.sum += v;
+                pred_link.sum_squares += v * v;
+            }
+        }
+
+        ++size_;
+        return true;
+    }
+
+    //removes one value equal to value, false if there is none
+    bool erase(const T& value)
+    {
+        uint32_t preds[kMaxLevels];
+        size_t pred_counts[kMaxLevels];
+        Sums pred_sums[kMaxLevels];
+        findPreds(value, preds, pred_counts, pred_sums);
+
+        //first value not less than value is under pred's level 0 link, and as it is the first
+        //one it is also what every pred links to on levels the node reaches
+        const uint32_t node = link(preds[0], 0).next;
+        if (node == kEnd || values_[node] < value || value < values_[node])
+            return false;
+
+        const double v = static_cast<double>(value);
+        for (uint32_t level = 0; level < level_count_; ++level) {
+            Link& pred_link = link(preds[level], level);
+            if (level < heights_[node]) {
+                const Link& node_link = link(node, level);
+                pred_link.next = node_link.next;
+                pred_link.width += node_link.width - 1;
+                pred_link.sum += node_link.sum - v;
+                pred_link.sum_squares += node_link.sum_squares - v * v;
+            }
+            else {
+                --pred_link.width;
+                pred_link.sum -= v;
+                pred_link.sum_squares -= v * v;
+            }
+        }
+
+        free_.push_back(node);
+        --size_;
+        return true;
+    }
+
+    //value at rank in sorted order, rank < size()
+    const T& at(size_t rank) const
+    {
+        uint32_t node = 0;
+        size_t remaining = rank + 1;
+        for (uint32_t level = level_count_; level-- > 0;) {
+            while (true) {
+                const Link& l = link(node, level);
+                if (l.next == kEnd || l.width > remaining)
+                    break;
+                remaining -= l.width;
+                node = l.next;
+            }
+        }
+        return values_[node];
+    }
+
+    //count and sums of values less than value
+    Sums sumsBelow(const T& value) const
+    {
+        return prefixSums(value, false);
+    }
+
+    //count and sums of values less than or equal to value
+    Sums sumsUpTo(const T& value) const
+    {
+        return prefixSums(value, true);
+    }
+
+    //count and sums of values in [low, high]
+    Sums sumsBetween(const T& low, const T& high) const
+    {
+        Sums result = sumsUpTo(high);
+        const Sums below = sumsBelow(low);
+        if (result.count <= below.count)
+            return Sums();
+        result.count -= below.count;
+        result.sum -= below.sum;
+        result.sum_squares -= below.sum_squares;
+        return result;
+    }
+
+private:
+    static constexpr uint32_t kEnd = UINT32_MAX;
+    static constexpr uint32_t kMaxLevels = 24;
+
+    struct Link
+    {
+        uint32_t next = kEnd;
+        size_t width = 0;
+        double sum = 0;
+        double sum_squares = 0;
+    };
+
+    Link& link(uint32_t node, uint32_t level)
+    {
+        return links_[node * level_count_ + level];
+    }
+    const Link& link(uint32_t node, uint32_t level) const
+    {
+        return links_[node * level_count_ + level];
+    }
+
+    //last node before value on every level, with its position and prefix sums
+    void findPreds(const T& value, uint32_t* preds, size_t* pred_counts, Sums* pred_sums) const
+    {
+        uint32_t node = 0;
+        Sums sums;
+        for (uint32_t level = level_count_; level-- > 0;) {
+            while (true) {
+                const Link& l = link(node, level);
+                if (l.next == kEnd || !(values_[l.next] < value))
+                    break;
+                sums.count += l.width;
+                sums.sum += l.sum;
+                sums.sum_squares += l.sum_squares;
+                node = l.next;
+            }
+            preds[level] = node;
+            pred_counts[level] = sums.count;
+            pred_sums[level] = sums;
+        }
+    }
+
+    Sums prefixSums(const T& value, bool inclusive) const
+    {
+        uint32_t node = 0;
+        Sums sums;
+        for (uint32_t level = level_count_; level-- > 0;) {
+            while (true) {
+                const Link& l = link(node, level);
+                if (l.next == kEnd || (inclusive ? value < values_[l.next] : !(values_[l.next] < value)))
+                    break;
+                sums.count += l.width;
+                sums.sum += l.sum;
+                sums.sum_squares += l.sum_squares;
+                node = l.next;
+            }
+        }
+        return sums;
+    }
+
+    //each level up with probability 1/2, xorshift so the list has no dependency on <random> state
+    uint32_t randomHeight()
+    {
+        random_state_ ^= random_state_ << 13;
+        random_state_ ^= random_state_ >> 17;
+        random_state_ ^= random_state_ << 5;
+        uint32_t height = 1;
+        for (uint32_t bits = random_state_; (bits & 1) && height < level_count_; bits >>= 1)
+            ++height;
+        return height;
+    }
+
+private:
+    size_t capacity_ = 0;
+    size_t size_ = 0;
+    uint32_t level_count_ = 1;
+    uint32_t random_state_ = 2463534242u;
+
+    std::vector<T> values_;
+    std::vector<uint32_t> heights_;
+    std::vector<Link> links_; //level_count_ per node
+    std::vector<uint32_t> free_;
+};
+
+} //namespace
+#endif
@@ -1,99 +1,303 @@
-// Copyright (c) Microsoft Corporation. All rights reserved.
-// Licensed under the MIT License.
-
-#ifndef common_utils_MedianFilter_hpp
-#define common_utils_MedianFilter_hpp
-
-#include <vector>
-#include <algorithm>
-#include <tuple>
-
-namespace common_utils
-{
-
-template <typename T>
-class MedianFilter
-{
-private:
-    std::vector<T> buffer_, buffer_copy_;
-    int window_size_, window_size_2x_, window_size_half_;
-    float outlier_factor_;
-    int buffer_index_;
-
-public:
-    MedianFilter();
-    MedianFilter(int window_size, float outlier_factor);
-    void initialize(int window_size, float outlier_factor);
-    std::tuple<double, double> filter(T value);
-};
-
-template <typename T>
-void MedianFilter<T>::initialize(int window_size, float outlier_factor)
-{
-    buffer_.resize(window_size);
-    buffer_copy_.resize(window_size);
-    window_size_ = window_size;
-    window_size_2x_ = window_size_ * 2;
-    window_size_half_ = window_size_ / 2;
-    outlier_factor_ = outlier_factor;
-    buffer_index_ = 0;
-}
-
-template <typename T>
-MedianFilter<T>::MedianFilter()
-{
-    initialize(buffer_.capacity(), std::numeric_limits<float>::infinity());
-}
-
-template <typename T>
-MedianFilter<T>::MedianFilter(int window_size, float outlier_factor)
-{
-    initialize(window_size, std::numeric_limits<float>::infinity());
-}
-
-template <typename T>
-std::tuple<double, double> MedianFilter<T>::filter(T value)
-{
-    buffer_[buffer_index_++ % window_size_] = value;
-    if (buffer_index_ == window_size_2x_)
-        buffer_index_ = window_size_;
-
-    if (buffer_index_ >= window_size_) {
-        //find median
-        for (auto i = 0; i < window_size_; ++i)
-            buffer_copy_[i] = buffer_[i];
-        std::sort(buffer_copy_.begin(), buffer_copy_.end());
-        double median = buffer_copy_[window_size_half_];
-
-        //average values that fall between upper and lower bound of median
-        auto lower_bound = median - median * outlier_factor_, upper_bound = median + median * outlier_factor_;
-        double sum = 0;
-        int count = 0;
-        for (auto i = 0; i < window_size_; ++i) {
-            if (buffer_copy_[i] >= lower_bound && buffer_copy_[i] <= upper_bound) {
-                sum += buffer_copy_[i];
-                ++count;
-            }
-        }
-        double mean = sum / count;
-
-        double std_dev_sum = 0;
-        for (auto i = 0; i < window_size_; ++i) {
-            if (buffer_copy_[i] >= lower_bound && buffer_copy_[i] <= upper_bound) {
-                double diff = buffer_copy_[i] - mean;
-                sum += diff * diff;
-            }
-        }
-        double variance = std_dev_sum / count;
-
-        return std::make_tuple(mean, variance);
-    }
-    else {
-        //window is not full, return the input as-is
-        //TODO: use growing window here
-        return std::make_tuple(double(value), 0);
-    }
-}
-
-} //namespace
-#endif
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef common_utils_MedianFilter_hpp
+#define common_utils_MedianFilter_hpp
+
+#include <vector>
+#include <algorithm>
+#include <tuple>
+#include <limits>
+#include <cmath>
+#include <type_traits>
+#include "IndexableSkipList.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define COMMON_UTILS_MEDIAN_SSE 1
+#endif
+
+namespace common_utils
+{
+
+/*
+    Rolling median over the last window_size samples that returns mean and variance of the samples
+    within outlier_factor * |median| of the median. Until the window fills up the input is returned
+    as is with zero variance.
+
+    How the window is kept depends on its size:
+        - up to kSmallWindow: the median is found by counting each value's rank against the whole
+          window, which is branch free and done four values at a time with SSE for float
+        - up to kSortedWindow: a sorted copy is updated with a binary search and a shift for the
+          oldest and newest sample, and inliers are one contiguous run of it
+        - larger: an IndexableSkipList gives the median and sums over the inlier range in
+          O(log n), so cost stays flat as the window grows
+*/
+template <typename T>
+class MedianFilter
+{
+public:
+    static constexpr int kSmallWindow = 16;
+    static constexpr int kSortedWindow = 128;
+
+private:
+    std::vector<T> buffer_, buffer_copy_; //copy is sorted for windows up to kSortedWindow
+    int window_size_, window_size_2x_, window_size_half_;
+    float outlier_factor_;
+    int buffer_index_;
+    IndexableSkipList<T> sorted_;
+
+    std::tuple<double, double> filterSmall();
+    std::tuple<double, double> filterSortedCopy();
+    std::tuple<double, double> filterSkipList();
+    template <typename TIter>
+    static std::tuple<double, double> getMeanVariance(TIter begin, TIter end, double lower_bound, double upper_bound);
+    void getInlierRange(double median, double& lower_bound, double& upper_bound) const;
+    static T toInnerBound(double bound, bool is_upper);
+    static T selectSmall(const T* values, int count, int k);
+#ifdef COMMON_UTILS_MEDIAN_SSE
+    template <int kLanes>
+    static int selectSmallSse(const float* padded, int count, int k);
+#endif
+
+public:
+    MedianFilter();
+    MedianFilter(int window_size, float outlier_factor);
+    void initialize(int window_size, float outlier_factor);
+    std::tuple<double, double> filter(T value);
+};
+
+template <typename T>
+void MedianFilter<T>::initialize(int window_size, float outlier_factor)
+{
+    window_size = std::max(window_size, 1);
+    buffer_.assign(window_size, T());
+    buffer_copy_.clear();
+    buffer_copy_.reserve(window_size);
+    window_size_ = window_size;
+    window_size_2x_ = window_size_ * 2;
+    window_size_half_ = window_size_ / 2;
+    outlier_factor_ = outlier_factor;
+    buffer_index_ = 0;
+    sorted_.reserve(window_size_ > kSortedWindow ? window_size_ : 0);
+}
+
+template <typename T>
+MedianFilter<T>::MedianFilter()
+{
+    initialize(1, std::numeric_limits<float>::infinity());
+}
+
+template <typename T>
+MedianFilter<T>::MedianFilter(int window_size, float outlier_factor)
+{
+    initialize(window_size, outlier_factor);
+}
+
+template <typename T>
+std::tuple<double, double> MedianFilter<T>::filter(T value)
+{
+    T& slot = buffer_[buffer_index_++ % window_size_];
+    //oldest sample leaves the window once it has filled up
+    const bool is_replacing = buffer_index_ > window_size_;
+    if (window_size_ > kSortedWindow) {
+        if (is_replacing)
+            sorted_.erase(slot);
+        sorted_.insert(value);
+    }
+    else if (window_size_ > kSmallWindow) {
+        if (is_replacing)
+            buffer_copy_.erase(std::lower_bound(buffer_copy_.begin(), buffer_copy_.end(), slot));
+        buffer_copy_.insert(std::upper_bound(buffer_copy_.begin(), buffer_copy_.end(), value), value);
+    }
+    slot = value;
+    if (buffer_index_ == window_size_2x_)
+        buffer_index_ = window_size_;
+
+    if (buffer_index_ >= window_size_) {
+        if (window_size_ > kSortedWindow)
+            return filterSkipList();
+        else if (window_size_ > kSmallWindow)
+            return filterSortedCopy();
+        else
+            return filterSmall();
+    }
+    else {
+        //window is not full, return the input as-is
+        //TODO: use growing window here
+        return std::make_tuple(double(value), 0);
+    }
+}
+
+//inliers are within outlier_factor * |median| of median, infinite factor takes every sample
+template <typename T>
+void MedianFilter<T>::getInlierRange(double median, double& lower_bound, double& upper_bound) const
+{
+    const double half_range = std::isinf(outlier_factor_) ? std::numeric_limits<double>::infinity() : std::abs(median) * outlier_factor_;
+    lower_bound = median - half_range;
+    upper_bound = median + half_range;
+}
+
+//closest T inside the bound so comparing in T selects the same samples as comparing in double
+template <typename T>
+T MedianFilter<T>::toInnerBound(double bound, bool is_upper)
+{
+    if (bound <= static_cast<double>(std::numeric_limits<T>::lowest()))
+        return std::numeric_limits<T>::lowest();
+    if (bound >= static_cast<double>(std::numeric_limits<T>::max()))
+        return std::numeric_limits<T>::max();
+    if (std::is_integral<T>::value)
+        return static_cast<T>(is_upper ? std::floor(bound) : std::ceil(bound));
+
+    T result = static_cast<T>(bound);
+    if (is_upper && static_cast<double>(result) > bound)
+        result = std::nextafter(result, std::numeric_limits<T>::lowest());
+    else if (!is_upper && static_cast<double>(result) < bound)
+        result = std::nextafter(result, std::numeric_limits<T>::max());
+    return result;
+}
+
+//average values that fall between upper and lower bound of median
+template <typename T>
+template <typename TIter>
+std::tuple<double, double> MedianFilter<T>::getMeanVariance(TIter begin, TIter end, double lower_bound, double upper_bound)
+{
+    double sum = 0;
+    int count = 0;
+    for (auto i = begin; i != end; ++i) {
+        if (*i >= lower_bound && *i <= upper_bound) {
+            sum += *i;
+            ++count;
+        }
+    }
+    double mean = sum / count;
+
+    double std_dev_sum = 0;
+    for (auto i = begin; i != end; ++i) {
+        if (*i >= lower_bound && *i <= upper_bound) {
+            double diff = *i - mean;
+            std_dev_sum += diff * diff;
+        }
+    }
+    double variance = std_dev_sum / count;
+
+    return std::make_tuple(mean, variance);
+}
+
+template <typename T>
+std::tuple<double, double> MedianFilter<T>::filterSmall()
+{
+    double median = selectSmall(buffer_.data(), window_size_, window_size_half_);
+
+    double lower_bound, upper_bound;
+    getInlierRange(median, lower_bound, upper_bound);
+    return getMeanVariance(buffer_.begin(), buffer_.end(), lower_bound, upper_bound);
+}
+
+template <typename T>
+std::tuple<double, double> MedianFilter<T>::filterSortedCopy()
+{
+    double median = buffer_copy_[window_size_half_];
+
+    //inliers are a run around the median
+    double lower_bound, upper_bound;
+    getInlierRange(median, lower_bound, upper_bound);
+    const auto begin = std::lower_bound(buffer_copy_.begin(), buffer_copy_.end(), lower_bound,
+                                        [](const T& value, double bound) { return value < bound; });
+    const auto end = std::upper_bound(begin, buffer_copy_.end(), upper_bound,
+                                      [](double bound, const T& value) { return bound < value; });
+    return getMeanVariance(begin, end, lower_bound, upper_bound);
+}
+
+template <typename T>
+std::tuple<double, double> MedianFilter<T>::filterSkipList()
+{
+    double median = sorted_.at(window_size_half_);
+
+    double lower_bound, upper_bound;
+    getInlierRange(median, lower_bound, upper_bound);
+    const auto inliers = sorted_.sumsBetween(toInnerBound(lower_bound, false), toInnerBound(upper_bound, true));
+    double mean = inliers.sum / inliers.count;
+    double variance = std::max(0.0, inliers.sum_squares / inliers.count - mean * mean);
+
+    return std::make_tuple(mean, variance);
+}
+
+#ifdef COMMON_UTILS_MEDIAN_SSE
+//ranks of four candidates at a time against every value, returns index of the one with rank k.
+//Padding past count is infinity and never selected
+template <typename T>
+template <int kLanes>
+int MedianFilter<T>::selectSmallSse(const float* padded, int count, int k)
+{
+    __m128 candidates[kLanes];
+    __m128i indices[kLanes], ranks[kLanes];
+    for (int c = 0; c < kLanes; ++c) {
+        candidates[c] = _mm_load_ps(padded + 4 * c);
+        indices[c] = _mm_setr_epi32(4 * c, 4 * c + 1, 4 * c + 2, 4 * c + 3);
+        ranks[c] = _mm_setzero_si128();
+    }
+
+    for (int j = 0; j < count; ++j) {
+        const __m128 value = _mm_set1_ps(padded[j]);
+        const __m128i index = _mm_set1_epi32(j);
+        for (int c = 0; c < kLanes; ++c) {
+            const __m128 before = _mm_and_ps(_mm_cmpeq_ps(value, candidates[c]), _mm_castsi128_ps(_mm_cmplt_epi32(index, indices[c])));
+            //true lanes are -1, so subtracting counts them
+            ranks[c] = _mm_sub_epi32(ranks[c], _mm_castps_si128(_mm_or_ps(_mm_cmplt_ps(value, candidates[c]), before)));
+        }
+    }
+
+    //only NaN in the window can leave rank k unfilled
+    static const int lowest_bit[16] = { 0, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0 };
+    const __m128i rank_k = _mm_set1_epi32(k);
+    int selected = k;
+    for (int c = 0; c < kLanes; ++c) {
+        const int valid = count - 4 * c >= 4 ? 0xF : (1 << (count - 4 * c)) - 1;
+        const int found = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(ranks[c], rank_k))) & valid;
+        selected = found ? 4 * c + lowest_bit[found] : selected;
+    }
+    return selected;
+}
+#endif
+
+//value with rank k, counting equal values before it as smaller so every value has its own rank
+template <typename T>
+T MedianFilter<T>::selectSmall(const T* values, int count, int k)
+{
+#ifdef COMMON_UTILS_MEDIAN_SSE
+    if constexpr (std::is_same<T, float>::value) {
+        //fixed lane count keeps candidates and ranks in registers
+        alignas(16) float padded[kSmallWindow];
+        std::copy(values, values + count, padded);
+        std::fill(padded + count, padded + kSmallWindow, std::numeric_limits<float>::infinity());
+        int selected;
+        switch ((count + 3) / 4) {
+        case 1:
+            selected = selectSmallSse<1>(padded, count, k);
+            break;
+        case 2:
+            selected = selectSmallSse<2>(padded, count, k);
+            break;
+        case 3:
+            selected = selectSmallSse<3>(padded, count, k);
+            break;
+        default:
+            selected = selectSmallSse<4>(padded, count, k);
+            break;
+        }
+        return values[selected];
+    }
+#endif
+    int selected = k;
+    for (int i = 0; i < count; ++i) {
+        int rank = 0;
+        for (int j = 0; j < count; ++j)
+            rank += (values[j] < values[i]) | ((values[j] == values[i]) & (j < i));
+        selected = rank == k ? i : selected;
+    }
+    return values[selected];
+}
+
+} //namespace
+#endif
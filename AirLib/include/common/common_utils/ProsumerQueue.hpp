@@ -29,6 +29,8 @@ namespace common_utils
     the number of thread so queue size doesn't grow out of bound. If you have
     only one producer and oner consumer than it might be better idea to do time consuming stuff
     such as I/O on sepratae threads so queue doesn't become too large.
+
+    For high rate or many threads prefer BoundedMpmcQueue which is lock-free and bounded.
 */
 
 template <typename T>
@@ -5,10 +5,20 @@
 #define commn_utils_sincos_hpp
 
 #include <random>
+#include <atomic>
+#include "StateSnapshot.hpp"
 
 namespace common_utils
 {
 
+//added to the Seed of every RandomGenerator when it is created or reset, so a whole run can be
+//reseeded at once and a replay can restore the seeds of the run it replays
+inline std::atomic<unsigned int>& getRandomGeneratorSeedOffset()
+{
+    static std::atomic<unsigned int> offset{ 0 };
+    return offset;
+}
+
 template <typename TReturn, typename TDistribution, unsigned int Seed = 42>
 class RandomGenerator
 {
@@ -17,7 +27,7 @@ public:
     //for gaussian distribution supply mean and sigma
     template <typename... DistArgs>
     RandomGenerator(DistArgs... dist_args)
-        : dist_(dist_args...), rand_(Seed)
+        : dist_(dist_args...), rand_(Seed + getRandomGeneratorSeedOffset())
     {
     }
 
@@ -33,10 +43,21 @@ public:
 
     void reset()
     {
-        rand_.seed(Seed);
+        rand_.seed(Seed + getRandomGeneratorSeedOffset());
         dist_.reset();
     }
 
+    void saveState(StateSnapshot& snapshot) const
+    {
+        snapshot.write(rand_);
+        snapshot.write(dist_);
+    }
+    void restoreState(StateSnapshot& snapshot)
+    {
+        snapshot.read(rand_);
+        snapshot.read(dist_);
+    }
+
 private:
     TDistribution dist_;
     std::mt19937 rand_;
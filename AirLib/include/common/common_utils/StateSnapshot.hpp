@@ -0,0 +1,249 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef common_utils_StateSnapshot_hpp
+#define common_utils_StateSnapshot_hpp
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <list>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace common_utils
+{
+
+/*
+    Byte buffer that objects write their run time state to and read it back from, so a simulation
+    can be put back to an earlier point without resetting it and running it there again.
+
+    Objects write their fields in a fixed order in saveState() and read them in the same order in
+    restoreState(). Values are copied as raw bytes, so a snapshot can only be restored by the same
+    build into objects created with the same settings. Types with a saveState/restoreState pair of
+    their own are written through it, which is how structs with strings or vectors are handled.
+
+    Time points (clock nanoseconds, or board millis with readTime(time, 1000)) are moved on restore
+    by how far the clock has moved since the snapshot was saved, so filters, delays and frequency
+    limiters see the same elapsed times as they did then, whether or not the clock can go back.
+*/
+class StateSnapshot
+{
+public:
+    static constexpr uint64_t kNanosPerSecond = 1000000000;
+
+    //clears the snapshot, now is the clock time the state belongs to
+    void beginSave(uint64_t now_nanos)
+    {
+        data_.clear();
+        read_pos_ = 0;
+        write(now_nanos);
+    }
+
+    //reads from the start, now is the clock time the state is restored at
+    void beginRestore(uint64_t now_nanos)
+    {
+        read_pos_ = 0;
+        read(capture_time_);
+        restore_time_ = now_nanos;
+    }
+
+    //throws if the objects restored read less than was saved, which means they are not the
+    //objects the snapshot was saved from
+    void endRestore() const
+    {
+        if (read_pos_ != data_.size())
+            throw std::runtime_error("StateSnapshot: state was restored into objects that don't match the ones it was saved from");
+    }
+
+    template <typename T>
+    void write(const T& value)
+    {
+        if constexpr (HasStateMembers<T>::value)
+            value.saveState(*this);
+        else {
+            static_assert(isBitwise<T>(), "StateSnapshot can only copy plain values, give the type saveState and restoreState");
+            writeBytes(&value, sizeof(T));
+        }
+    }
+    template <typename T>
+    void write(const std::vector<T>& values)
+    {
+        write(static_cast<uint64_t>(values.size()));
+        for (const T& value : values)
+            write(value);
+    }
+    template <typename T>
+    void write(const std::list<T>& values)
+    {
+        write(static_cast<uint64_t>(values.size()));
+        for (const T& value : values)
+            write(value);
+    }
+    void write(const std::string& value)
+    {
+        write(static_cast<uint64_t>(value.size()));
+        writeBytes(value.data(), value.size());
+    }
+
+    template <typename T>
+    void read(T& value)
+    {
+        if constexpr (HasStateMembers<T>::value)
+            value.restoreState(*this);
+        else {
+            static_assert(isBitwise<T>(), "StateSnapshot can only copy plain values, give the type saveState and restoreState");
+            readBytes(&value, sizeof(T));
+        }
+    }
+    template <typename T>
+    void read(std::vector<T>& values)
+    {
+        values.resize(readSize());
+        for (T& value : values)
+            read(value);
+    }
+    template <typename T>
+    void read(std::list<T>& values)
+    {
+        values.resize(readSize());
+        for (T& value : values)
+            read(value);
+    }
+    void read(std::string& value)
+    {
+        value.resize(readSize());
+        readBytes(&value[0], value.size());
+    }
+    template <typename T>
+    T read()
+    {
+        T value;
+        read(value);
+        return value;
+    }
+
+    void writeTime(uint64_t time)
+    {
+        write(time);
+    }
+    //units_per_second is 1000 for times in millis and so on
+    void readTime(uint64_t& time, uint64_t units_per_second = kNanosPerSecond)
+    {
+        read(time);
+        shiftTime(time, units_per_second);
+    }
+    //moves a time point that was read as a plain value, as readTime does
+    void shiftTime(uint64_t& time, uint64_t units_per_second = kNanosPerSecond) const
+    {
+        //in whole units of the clock the time came from, so board millis stay in step with the
+        //millis the board reads after restore; unsigned wrap around handles clocks moved back
+        const uint64_t nanos_per_unit = kNanosPerSecond / units_per_second;
+        time = time + restore_time_ / nanos_per_unit - capture_time_ / nanos_per_unit;
+    }
+    //moves value.time_stamp if there is one, for sensor outputs read as plain values
+    template <typename T>
+    void shiftTimeStamp(T& value) const
+    {
+        if constexpr (HasTimeStamp<T>::value)
+            shiftTime(value.time_stamp);
+    }
+
+    void writeBytes(const void* data, size_t size)
+    {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        data_.insert(data_.end(), bytes, bytes + size);
+    }
+    void readBytes(void* data, size_t size)
+    {
+        if (size > data_.size() - read_pos_)
+            throw std::out_of_range("StateSnapshot: read past the end of the snapshot");
+        if (size > 0)
+            std::memcpy(data, &data_[read_pos_], size);
+        read_pos_ += size;
+    }
+
+    uint64_t getCaptureTime() const
+    {
+        uint64_t time = 0;
+        if (data_.size() >= sizeof(time))
+            std::memcpy(&time, data_.data(), sizeof(time));
+        return time;
+    }
+    size_t size() const
+    {
+        return data_.size();
+    }
+    const std::vector<uint8_t>& getData() const
+    {
+        return data_;
+    }
+    void setData(std::vector<uint8_t> data)
+    {
+        data_ = std::move(data);
+        read_pos_ = 0;
+    }
+
+    void save(const std::string& file_name) const
+    {
+        std::ofstream file(file_name, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(data_.data()), data_.size());
+        if (!file)
+            throw std::ios_base::failure("StateSnapshot: could not write " + file_name);
+    }
+    void load(const std::string& file_name)
+    {
+        std::ifstream file(file_name, std::ios::binary);
+        if (!file)
+            throw std::ios_base::failure("StateSnapshot: could not read " + file_name);
+        setData(std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()));
+    }
+
+private:
+    template <typename T, typename = void>
+    struct HasStateMembers : std::false_type
+    {
+    };
+    template <typename T>
+    struct HasStateMembers<T, std::void_t<decltype(std::declval<const T&>().saveState(std::declval<StateSnapshot&>())),
+                                          decltype(std::declval<T&>().restoreState(std::declval<StateSnapshot&>()))>> : std::true_type
+    {
+    };
+
+    template <typename T, typename = void>
+    struct HasTimeStamp : std::false_type
+    {
+    };
+    template <typename T>
+    struct HasTimeStamp<T, std::void_t<decltype(std::declval<T&>().time_stamp)>> : std::true_type
+    {
+    };
+
+    //Eigen's fixed size types and structs of them are not trivially copyable by the standard's
+    //rules but are plain memory all the same
+    template <typename T>
+    static constexpr bool isBitwise()
+    {
+        return std::is_trivially_copyable<T>::value ||
+               (std::is_standard_layout<T>::value && std::is_trivially_destructible<T>::value);
+    }
+
+    size_t readSize()
+    {
+        const uint64_t size = read<uint64_t>();
+        if (size > data_.size() - read_pos_)
+            throw std::out_of_range("StateSnapshot: read past the end of the snapshot");
+        return static_cast<size_t>(size);
+    }
+
+private:
+    std::vector<uint8_t> data_;
+    size_t read_pos_ = 0;
+    uint64_t capture_time_ = 0, restore_time_ = 0;
+};
+}
+#endif
@@ -0,0 +1,669 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef common_utils_TaskScheduler_hpp
+#define common_utils_TaskScheduler_hpp
+
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <deque>
+#include <exception>
+#include <stdexcept>
+#include <algorithm>
+#include <cstdint>
+#include "Utils.hpp"
+
+namespace common_utils
+{
+
+/*
+    Queries NUMA layout and pins threads to nodes. Implemented per OS in TaskScheduler.cpp. Machines
+    without NUMA or where the layout can't be read report a single node.
+*/
+class CpuTopology
+{
+public:
+    //logical processors of each NUMA node
+    static std::vector<std::vector<unsigned int>> getNumaNodes();
+    //restricts calling thread to processors of the node, returns false if not supported
+    static bool pinCurrentThreadToNode(unsigned int node);
+};
+
+enum class TaskPriority : unsigned int
+{
+    High = 0,
+    Normal = 1,
+    Low = 2
+};
+
+/*
+    Tracks completion of a set of tasks submitted with TaskScheduler::submit(group, ...). The first
+    exception thrown by any task is rethrown from TaskScheduler::wait(group).
+*/
+class TaskGroup
+{
+public:
+    bool isDone() const
+    {
+        return pending_.load(std::memory_order_acquire) == 0;
+    }
+
+    TaskGroup() = default;
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+private:
+    friend class TaskScheduler;
+
+    std::atomic<unsigned int> pending_{ 0 };
+    std::mutex error_mutex_;
+    std::exception_ptr error_;
+};
+
+/*
+    Work-stealing thread pool meant to be shared by everything in the process that needs CPU
+    parallelism so subsystems don't each spawn their own threads and oversubscribe cores.
+
+    Each worker owns one Chase-Lev deque per priority. Tasks submitted from a worker go to its own
+    deque and are popped LIFO which keeps caches warm for nested work, idle workers steal the
+    oldest task FIFO from others. Tasks submitted from other threads go to a shared injection queue.
+    Higher priority tasks are always looked for first everywhere before lower ones.
+
+    Threads waiting on a TaskGroup execute tasks themselves instead of blocking, so parallelFor can
+    be nested and called from inside tasks without deadlock.
+
+    With numa_aware set and more than one NUMA node, workers are spread round-robin over nodes,
+    pinned to their node and steal from workers on the same node first.
+
+    Idle workers sleep on a condition variable. Submitting only touches the mutex if some
+    worker is actually asleep.
+*/
+class TaskScheduler
+{
+public:
+    struct Params
+    {
+        //0 uses one thread less than hardware threads because waiting threads help with work
+        unsigned int thread_count = 0;
+        bool numa_aware = true;
+    };
+
+    struct Stats
+    {
+        uint64_t executed = 0;
+        uint64_t stolen = 0;
+    };
+
+public:
+    explicit TaskScheduler(const Params& params)
+    {
+        unsigned int thread_count = params.thread_count;
+        if (thread_count == 0) {
+            const unsigned int hardware_threads = std::thread::hardware_concurrency();
+            thread_count = hardware_threads > 1 ? hardware_threads - 1 : 1;
+        }
+
+        std::vector<std::vector<unsigned int>> nodes;
+        if (params.numa_aware)
+            nodes = CpuTopology::getNumaNodes();
+        const bool pin_to_nodes = nodes.size() > 1;
+
+        for (unsigned int i = 0; i < thread_count; ++i) {
+            workers_.emplace_back(new Worker());
+            workers_.back()->node = pin_to_nodes ? i % static_cast<unsigned int>(nodes.size()) : 0;
+        }
+
+        //steal order: same node first, starting after self so victims are spread
+        for (unsigned int i = 0; i < thread_count; ++i) {
+            Worker& worker = *workers_[i];
+            for (unsigned int k = 1; k < thread_count; ++k) {
+                const unsigned int victim = (i + k) % thread_count;
+                if (workers_[victim]->node == worker.node)
+                    worker.victims.push_back(victim);
+            }
+            for (unsigned int k = 1; k < thread_count; ++k) {
+                const unsigned int victim = (i + k) % thread_count;
+                if (workers_[victim]->node != worker.node)
+                    worker.victims.push_back(victim);
+            }
+        }
+
+        for (unsigned int i = 0; i < thread_count; ++i)
+            workers_[i]->thread = std::thread(&TaskScheduler::workerLoop, this, i, pin_to_nodes);
+    }
+
+    TaskScheduler()
+        : TaskScheduler(Params())
+    {
+    }
+
+    //runs all queued tasks before returning, submitting after destruction started is not allowed
+    ~TaskScheduler()
+    {
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex_);
+            is_stopping_ = true;
+            ++sleep_epoch_;
+        }
+        sleep_cond_.notify_all();
+
+        for (auto& worker : workers_)
+            worker->thread.join();
+    }
+
+    //process wide scheduler
+    static TaskScheduler& getDefault()
+    {
+        static TaskScheduler scheduler;
+        return scheduler;
+    }
+
+    unsigned int getThreadCount() const
+    {
+        return static_cast<unsigned int>(workers_.size());
+    }
+
+    //index of worker thread of this scheduler running the caller, -1 for other threads
+    int getCurrentWorkerIndex() const
+    {
+        const WorkerContext& context = currentContext();
+        return context.scheduler == this ? static_cast<int>(context.index) : -1;
+    }
+
+    Stats getStats() const
+    {
+        Stats stats;
+        for (const auto& worker : workers_) {
+            stats.executed += worker->executed.load(std::memory_order_relaxed);
+            stats.stolen += worker->stolen.load(std::memory_order_relaxed);
+        }
+        return stats;
+    }
+
+    //called with exceptions from tasks submitted without group
+    void setErrorHandler(std::function<void(std::exception&)> error_handler)
+    {
+        std::lock_guard<std::mutex> lock(error_handler_mutex_);
+        error_handler_ = error_handler;
+    }
+
+    void submit(std::function<void()> func, TaskPriority priority = TaskPriority::Normal)
+    {
+        enqueue(new Task(std::move(func), nullptr), priority);
+    }
+
+    void submit(TaskGroup& group, std::function<void()> func, TaskPriority priority = TaskPriority::Normal)
+    {
+        group.pending_.fetch_add(1, std::memory_order_relaxed);
+        enqueue(new Task(std::move(func), &group), priority);
+    }
+
+    //executes tasks until all tasks of the group are done, then rethrows first exception of group
+    void wait(TaskGroup& group)
+    {
+        const int worker_index = getCurrentWorkerIndex();
+        while (!group.isDone()) {
+            Task* task = findTask(worker_index);
+            if (task) {
+                runTask(task, worker_index);
+                continue;
+            }
+
+            sleepUntil(worker_index, [&group] { return group.isDone(); });
+        }
+
+        std::exception_ptr error;
+        {
+            std::lock_guard<std::mutex> lock(group.error_mutex_);
+            std::swap(error, group.error_);
+        }
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    //calls func(chunk_begin, chunk_end) for chunks of [begin, end) in parallel, grain 0 picks chunk size
+    template <typename Func>
+    void parallelForRange(size_t begin, size_t end, Func func, size_t grain = 0, TaskPriority priority = TaskPriority::Normal)
+    {
+        if (begin >= end)
+            return;
+        grain = getGrain(end - begin, grain);
+        if (end - begin <= grain) {
+            func(begin, end);
+            return;
+        }
+
+        TaskGroup group;
+        for (size_t chunk_begin = begin + grain; chunk_begin < end; chunk_begin += grain) {
+            const size_t chunk_end = std::min(chunk_begin + grain, end);
+            submit(group, [&func, chunk_begin, chunk_end] { func(chunk_begin, chunk_end); }, priority);
+        }
+        runAndWait(group, [&] { func(begin, begin + grain); });
+    }
+
+    //calls func(i) for each i in [begin, end) in parallel
+    template <typename Func>
+    void parallelFor(size_t begin, size_t end, Func func, size_t grain = 0, TaskPriority priority = TaskPriority::Normal)
+    {
+        parallelForRange(
+            begin, end, [&func](size_t chunk_begin, size_t chunk_end) {
+                for (size_t i = chunk_begin; i < chunk_end; ++i)
+                    func(i);
+            },
+            grain,
+            priority);
+    }
+
+    /*
+        Returns combine of map(chunk_begin, chunk_end) over chunks of [begin, end). Chunk results are
+        combined in chunk order so result is deterministic for a given grain, pass non-zero grain
+        when floating point results must match across machines with different core counts.
+    */
+    template <typename T, typename MapFunc, typename CombineFunc>
+    T parallelReduce(size_t begin, size_t end, const T& identity, MapFunc map, CombineFunc combine, size_t grain = 0,
+                     TaskPriority priority = TaskPriority::Normal)
+    {
+        if (begin >= end)
+            return identity;
+        grain = getGrain(end - begin, grain);
+
+        const size_t chunk_count = (end - begin + grain - 1) / grain;
+        std::vector<T> results(chunk_count, identity);
+        parallelFor(
+            0, chunk_count, [&](size_t chunk) {
+                const size_t chunk_begin = begin + chunk * grain;
+                results[chunk] = map(chunk_begin, std::min(chunk_begin + grain, end));
+            },
+            1,
+            priority);
+
+        T result = identity;
+        for (const T& chunk_result : results)
+            result = combine(result, chunk_result);
+        return result;
+    }
+
+    TaskScheduler(const TaskScheduler&) = delete;
+    TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+private:
+    static constexpr unsigned int kPriorityCount = 3;
+    static constexpr int kSpinCount = 64;
+
+    struct Task
+    {
+        Task(std::function<void()>&& func_val, TaskGroup* group_val)
+            : func(std::move(func_val)), group(group_val)
+        {
+        }
+
+        std::function<void()> func;
+        TaskGroup* group;
+    };
+
+    /*
+        Chase-Lev deque as described in "Correct and Efficient Work-Stealing for Weak Memory Models"
+        (Le et al. 2013). Only the owner pushes and pops at the bottom, any thread steals from the top.
+        Arrays replaced on growth are kept until destruction because thieves may still read them.
+    */
+    class WorkStealingDeque
+    {
+    public:
+        WorkStealingDeque()
+        {
+            arrays_.emplace_back(new Array(64));
+            array_.store(arrays_.back().get(), std::memory_order_relaxed);
+        }
+
+        ~WorkStealingDeque()
+        {
+            while (Task* task = pop())
+                delete task;
+        }
+
+        //owner only
+        void push(Task* task)
+        {
+            const int64_t bottom = bottom_.load(std::memory_order_relaxed);
+            const int64_t top = top_.load(std::memory_order_acquire);
+            Array* array = array_.load(std::memory_order_relaxed);
+            if (bottom - top > static_cast<int64_t>(array->mask)) {
+                arrays_.emplace_back(new Array((array->mask + 1) * 2));
+                Array* grown = arrays_.back().get();
+                for (int64_t i = top; i < bottom; ++i)
+                    grown->put(i, array->get(i));
+                array_.store(grown, std::memory_order_release);
+                array = grown;
+            }
+            array->put(bottom, task);
+            std::atomic_thread_fence(std::memory_order_release);
+            bottom_.store(bottom + 1, std::memory_order_relaxed);
+        }
+
+        //owner only
+        Task* pop()
+        {
+            const int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+            Array* array = array_.load(std::memory_order_relaxed);
+            bottom_.store(bottom, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t top = top_.load(std::memory_order_relaxed);
+
+            Task* task = nullptr;
+            if (top <= bottom) {
+                task = array->get(bottom);
+                if (top == bottom) {
+                    //last item, race with thieves
+                    if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                        task = nullptr;
+                    bottom_.store(bottom + 1, std::memory_order_relaxed);
+                }
+            }
+            else
+                bottom_.store(bottom + 1, std::memory_order_relaxed);
+            return task;
+        }
+
+        Task* steal()
+        {
+            int64_t top = top_.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            const int64_t bottom = bottom_.load(std::memory_order_acquire);
+            if (top >= bottom)
+                return nullptr;
+
+            Array* array = array_.load(std::memory_order_acquire);
+            Task* task = array->get(top);
+            if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                return nullptr;
+            return task;
+        }
+
+        bool isEmpty() const
+        {
+            return bottom_.load(std::memory_order_relaxed) <= top_.load(std::memory_order_relaxed);
+        }
+
+    private:
+        struct Array
+        {
+            explicit Array(size_t capacity)
+                : mask(capacity - 1), items(new std::atomic<Task*>[capacity])
+            {
+            }
+
+            Task* get(int64_t index) const
+            {
+                return items[static_cast<size_t>(index) & mask].load(std::memory_order_acquire);
+            }
+
+            void put(int64_t index, Task* task)
+            {
+                items[static_cast<size_t>(index) & mask].store(task, std::memory_order_release);
+            }
+
+            size_t mask;
+            std::unique_ptr<std::atomic<Task*>[]> items;
+        };
+
+        std::atomic<int64_t> top_{ 0 };
+        std::atomic<int64_t> bottom_{ 0 };
+        std::atomic<Array*> array_;
+        std::vector<std::unique_ptr<Array>> arrays_;
+    };
+
+    struct Worker
+    {
+        WorkStealingDeque deques[kPriorityCount];
+        std::vector<unsigned int> victims;
+        unsigned int node = 0;
+        std::atomic<uint64_t> executed{ 0 }, stolen{ 0 };
+        std::thread thread;
+    };
+
+    //tasks submitted from threads that are not workers
+    struct InjectionQueue
+    {
+        std::mutex mutex;
+        std::deque<Task*> tasks;
+        std::atomic<size_t> size{ 0 };
+    };
+
+    struct WorkerContext
+    {
+        const TaskScheduler* scheduler = nullptr;
+        unsigned int index = 0;
+    };
+
+    static WorkerContext& currentContext()
+    {
+        static thread_local WorkerContext context;
+        return context;
+    }
+
+    size_t getGrain(size_t count, size_t grain) const
+    {
+        if (grain > 0)
+            return grain;
+        //several chunks per thread so stealing can balance uneven work
+        const size_t chunks = static_cast<size_t>(getThreadCount() + 1) * 4;
+        return std::max<size_t>(1, (count + chunks - 1) / chunks);
+    }
+
+    template <typename Func>
+    void runAndWait(TaskGroup& group, Func func)
+    {
+        try {
+            func();
+        }
+        catch (...) {
+            //other chunks may still reference caller's stack so they must finish first
+            try {
+                wait(group);
+            }
+            catch (...) {
+            }
+            throw;
+        }
+        wait(group);
+    }
+
+    void enqueue(Task* task, TaskPriority priority)
+    {
+        const unsigned int level = static_cast<unsigned int>(priority);
+        const int worker_index = getCurrentWorkerIndex();
+        if (worker_index >= 0)
+            workers_[worker_index]->deques[level].push(task);
+        else {
+            InjectionQueue& queue = injection_[level];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks.push_back(task);
+            queue.size.fetch_add(1, std::memory_order_release);
+        }
+        wakeSleepers(false);
+    }
+
+    Task* popInjected(unsigned int level)
+    {
+        InjectionQueue& queue = injection_[level];
+        if (queue.size.load(std::memory_order_acquire) == 0)
+            return nullptr;
+
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty())
+            return nullptr;
+        Task* task = queue.tasks.front();
+        queue.tasks.pop_front();
+        queue.size.fetch_sub(1, std::memory_order_relaxed);
+        return task;
+    }
+
+    //worker_index is -1 for threads that are not workers of this scheduler
+    Task* findTask(int worker_index)
+    {
+        const unsigned int worker_count = getThreadCount();
+        for (unsigned int level = 0; level < kPriorityCount; ++level) {
+            if (worker_index >= 0) {
+                if (Task* task = workers_[worker_index]->deques[level].pop())
+                    return task;
+            }
+
+            if (Task* task = popInjected(level))
+                return task;
+
+            if (worker_index >= 0) {
+                Worker& worker = *workers_[worker_index];
+                for (unsigned int victim : worker.victims) {
+                    if (Task* task = workers_[victim]->deques[level].steal()) {
+                        worker.stolen.fetch_add(1, std::memory_order_relaxed);
+                        return task;
+                    }
+                }
+            }
+            else {
+                for (unsigned int victim = 0; victim < worker_count; ++victim) {
+                    if (Task* task = workers_[victim]->deques[level].steal())
+                        return task;
+                }
+            }
+        }
+        return nullptr;
+    }
+
+    bool hasQueuedTasks() const
+    {
+        for (unsigned int level = 0; level < kPriorityCount; ++level) {
+            if (injection_[level].size.load(std::memory_order_acquire) > 0)
+                return true;
+            for (const auto& worker : workers_)
+                if (!worker->deques[level].isEmpty())
+                    return true;
+        }
+        return false;
+    }
+
+    void runTask(Task* task, int worker_index)
+    {
+        try {
+            task->func();
+        }
+        catch (...) {
+            if (task->group) {
+                std::lock_guard<std::mutex> lock(task->group->error_mutex_);
+                if (!task->group->error_)
+                    task->group->error_ = std::current_exception();
+            }
+            else
+                reportError(std::current_exception());
+        }
+
+        if (worker_index >= 0)
+            workers_[worker_index]->executed.fetch_add(1, std::memory_order_relaxed);
+
+        TaskGroup* group = task->group;
+        delete task;
+        //waiters of the group may be asleep
+        if (group && group->pending_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            wakeSleepers(true);
+    }
+
+    void reportError(std::exception_ptr error)
+    {
+        std::function<void(std::exception&)> error_handler;
+        {
+            std::lock_guard<std::mutex> lock(error_handler_mutex_);
+            error_handler = error_handler_;
+        }
+        if (!error_handler)
+            return;
+
+        try {
+            std::rethrow_exception(error);
+        }
+        catch (std::exception& e) {
+            error_handler(e);
+        }
+        catch (...) {
+            std::runtime_error e("Task threw exception not derived from std::exception");
+            error_handler(e);
+        }
+    }
+
+    //sleeps until a task may be available or is_done returns true
+    template <typename DoneFunc>
+    void sleepUntil(int worker_index, DoneFunc is_done)
+    {
+        for (int spin = 0; spin < kSpinCount; ++spin) {
+            if (is_done() || hasQueuedTasks())
+                return;
+            std::this_thread::yield();
+        }
+
+        const uint64_t epoch = sleep_epoch_.load();
+        sleepers_.fetch_add(1);
+        //pairs with fence in wakeSleepers so either we see the new task or the submitter sees us
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!is_done() && !hasQueuedTasks() && !(worker_index >= 0 && is_stopping_)) {
+            std::unique_lock<std::mutex> lock(sleep_mutex_);
+            sleep_cond_.wait(lock, [&] { return sleep_epoch_.load() != epoch || is_stopping_; });
+        }
+        sleepers_.fetch_sub(1);
+    }
+
+    void wakeSleepers(bool all)
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleepers_.load(std::memory_order_relaxed) == 0)
+            return;
+
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex_);
+            ++sleep_epoch_;
+        }
+        //group waiters can't be told apart from idle workers so completion wakes everyone
+        if (all)
+            sleep_cond_.notify_all();
+        else
+            sleep_cond_.notify_one();
+    }
+
+    void workerLoop(unsigned int index, bool pin_to_node)
+    {
+        currentContext().scheduler = this;
+        currentContext().index = index;
+        if (pin_to_node)
+            CpuTopology::pinCurrentThreadToNode(workers_[index]->node);
+
+        const int worker_index = static_cast<int>(index);
+        for (;;) {
+            if (Task* task = findTask(worker_index)) {
+                runTask(task, worker_index);
+                continue;
+            }
+            if (is_stopping_ && !hasQueuedTasks())
+                break;
+
+            sleepUntil(worker_index, [] { return false; });
+        }
+    }
+
+private:
+    std::vector<std::unique_ptr<Worker>> workers_;
+    InjectionQueue injection_[kPriorityCount];
+
+    std::mutex sleep_mutex_;
+    std::condition_variable sleep_cond_;
+    std::atomic<uint64_t> sleep_epoch_{ 0 };
+    std::atomic<int> sleepers_{ 0 };
+    std::atomic<bool> is_stopping_{ false };
+
+    std::mutex error_handler_mutex_;
+    std::function<void(std::exception&)> error_handler_;
+};
+}
+#endif
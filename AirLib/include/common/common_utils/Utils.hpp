@@ -22,6 +22,10 @@
 #include <limits>
 #include <queue>
 #include <bitset>
+#include <tuple>
+#include <atomic>
+#include <utility>
+#include <type_traits>
 #include "type_utils.hpp"
 
 #ifndef _WIN32
@@ -92,6 +96,113 @@ private:
     using time_point = std::chrono::time_point<T>;
 
 public:
+    /*
+        printf style message whose arguments are kept in binary form until someone needs the text.
+        Only arithmetic and enum arguments qualify (anything that could point to memory owned by the
+        caller is formatted right away) and format must be a string literal, since both are read
+        later, possibly on another thread. Arguments are memcpy'd into inline storage so building
+        and copying a message never allocates.
+    */
+    class DeferredMessage
+    {
+    private:
+        template <typename... Args>
+        static constexpr size_t sizeofArgs()
+        {
+            const size_t sizes[] = { 0, sizeof(Args)... };
+            size_t total = 0;
+            for (size_t size : sizes)
+                total += size;
+            return total;
+        }
+
+        template <typename... Args>
+        static constexpr bool allDeferrable()
+        {
+            const bool flags[] = { true, (std::is_arithmetic<Args>::value || std::is_enum<Args>::value)... };
+            for (bool flag : flags)
+                if (!flag)
+                    return false;
+            return true;
+        }
+
+    public:
+        static constexpr size_t kMaxArgBytes = 64;
+
+        template <typename... Args>
+        struct IsDeferrable
+        {
+            static constexpr bool value = sizeofArgs<Args...>() <= kMaxArgBytes && allDeferrable<Args...>();
+        };
+
+        DeferredMessage()
+            : format_(""), formatter_(nullptr)
+        {
+        }
+
+        explicit DeferredMessage(const char* format)
+            : format_(format), formatter_(nullptr)
+        {
+        }
+
+        template <typename... Args>
+        DeferredMessage(const char* format, Args... args)
+            : format_(format), formatter_(&formatArgs<Args...>)
+        {
+            static_assert(IsDeferrable<Args...>::value, "only small sets of arithmetic or enum arguments can be deferred");
+            unsigned char* dst = args_;
+            int expand[] = { 0, (std::memcpy(dst, &args, sizeof(Args)), dst += sizeof(Args), 0)... };
+            unused(expand);
+            unused(dst);
+        }
+
+        string toString() const
+        {
+            string text;
+            if (formatter_)
+                formatter_(format_, args_, text);
+            else
+                text = format_;
+            return text;
+        }
+
+        const char* getFormat() const
+        {
+            return format_;
+        }
+
+    private:
+        template <typename T>
+        static T readArg(const unsigned char*& src)
+        {
+            T value;
+            std::memcpy(&value, src, sizeof(T));
+            src += sizeof(T);
+            return value;
+        }
+
+        template <typename Tuple, size_t... I>
+        static string formatTuple(const char* format, const Tuple& args, std::index_sequence<I...>)
+        {
+            IGNORE_FORMAT_STRING_ON
+            return Utils::stringf(format, std::get<I>(args)...);
+            IGNORE_FORMAT_STRING_OFF
+        }
+
+        template <typename... Args>
+        static void formatArgs(const char* format, const unsigned char* src, string& text)
+        {
+            //braced init is evaluated left to right, so arguments come back in order
+            const std::tuple<Args...> args{ readArg<Args>(src)... };
+            unused(src);
+            text = formatTuple(format, args, std::index_sequence_for<Args...>());
+        }
+
+        const char* format_;
+        void (*formatter_)(const char*, const unsigned char*, string&);
+        unsigned char args_[kMaxArgBytes];
+    };
+
     class Logger
     {
     public:
@@ -103,9 +214,63 @@ public:
                 std::cerr << message << std::endl;
         }
 
+        //loggers that can keep the arguments and format later (see AsyncLogger) override this
+        virtual void logDeferred(int level, const DeferredMessage& message)
+        {
+            log(level, message.toString());
+        }
+
         virtual ~Logger() = default;
     };
 
+    /*
+        Rate limit for one log call site, kept as a function static next to the call:
+
+            static Utils::LogRateLimiter limiter(1);
+            if (limiter.allow())
+                Utils::logf(Utils::kLogLevelWarn, "recv failed: %d, %u more suppressed", err, limiter.takeSuppressed());
+
+        Up to burst messages pass at once, after that one per 1/messages_per_sec. allow() is a
+        single CAS, so it can sit in loops that spin on errors.
+    */
+    class LogRateLimiter
+    {
+    public:
+        LogRateLimiter(double messages_per_sec, unsigned int burst = 1)
+            : interval_ns_(static_cast<int64_t>(1E9 / messages_per_sec)),
+              tolerance_ns_(interval_ns_ * (static_cast<int64_t>(burst) - 1)),
+              next_ns_(0), suppressed_(0)
+        {
+        }
+
+        bool allow()
+        {
+            const int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(steady_clock::now().time_since_epoch()).count();
+            int64_t next = next_ns_.load(std::memory_order_relaxed);
+            while (true) {
+                const int64_t start = std::max(next, now);
+                if (start - now > tolerance_ns_) {
+                    suppressed_.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+                if (next_ns_.compare_exchange_weak(next, start + interval_ns_, std::memory_order_relaxed))
+                    return true;
+            }
+        }
+
+        //number of messages rejected since last call
+        unsigned int takeSuppressed()
+        {
+            return suppressed_.exchange(0, std::memory_order_relaxed);
+        }
+
+    private:
+        const int64_t interval_ns_;
+        const int64_t tolerance_ns_;
+        std::atomic<int64_t> next_ns_;
+        std::atomic<unsigned int> suppressed_;
+    };
+
     static void enableImmediateConsoleFlush()
     {
         //disable buffering
@@ -180,6 +345,15 @@ public:
         if (level >= getSetMinLogLevel())
             getSetLogger()->log(level, message);
     }
+    //like log(stringf(...)) but nothing is formatted below min log level. Arithmetic and enum
+    //arguments are handed to the logger unformatted, so an AsyncLogger formats them on its own thread
+    template <typename... Args>
+    static void logf(int level, const char* format, Args... args)
+    {
+        if (level < getSetMinLogLevel())
+            return;
+        logfImpl(std::integral_constant<bool, DeferredMessage::IsDeferrable<Args...>::value>(), level, format, args...);
+    }
     static int getSetMinLogLevel(bool set_or_get = false,
                                  int set_min_log_level = std::numeric_limits<int>::min())
     {
@@ -190,6 +364,21 @@ public:
         return min_log_level;
     }
 
+private:
+    template <typename... Args>
+    static void logfImpl(std::true_type, int level, const char* format, Args... args)
+    {
+        getSetLogger()->logDeferred(level, DeferredMessage(format, args...));
+    }
+    template <typename... Args>
+    static void logfImpl(std::false_type, int level, const char* format, Args... args)
+    {
+        IGNORE_FORMAT_STRING_ON
+        getSetLogger()->log(level, stringf(format, args...));
+        IGNORE_FORMAT_STRING_OFF
+    }
+
+public:
     template <typename T>
     static int sign(T val)
     {
@@ -715,6 +904,43 @@ public:
         file.close();
     }
 
+    //same bytes as writePFMfile but in to memory buffer
+    static void writePFMbuffer(const float* const image_data, int width, int height, std::vector<uint8_t>& buffer, float scalef = 1)
+    {
+        if (isLittleEndian())
+            scalef = -scalef;
+
+        std::ostringstream header;
+        header << "Pf\n"
+               << width << " " << height << "\n"
+               << scalef << "\n";
+        const std::string header_str = header.str();
+
+        const size_t data_size = static_cast<size_t>(width) * height * sizeof(float);
+        buffer.resize(header_str.size() + data_size);
+        std::memcpy(buffer.data(), header_str.data(), header_str.size());
+        std::memcpy(buffer.data() + header_str.size(), image_data, data_size);
+    }
+
+    //reads file written by writePFMfile, returns false if file can't be read
+    static bool readPFMfile(const std::string& path, std::vector<float>& image_data, int& width, int& height)
+    {
+        std::ifstream file(path.c_str(), std::ios::binary);
+        if (!file)
+            return false;
+
+        std::string bands;
+        float scalef;
+        file >> bands >> width >> height >> scalef;
+        file.get(); // single whitespace after header
+        if (bands != "Pf" || width <= 0 || height <= 0)
+            return false;
+
+        image_data.resize(static_cast<size_t>(width) * height);
+        file.read(reinterpret_cast<char*>(image_data.data()), image_data.size() * sizeof(float));
+        return static_cast<bool>(file);
+    }
+
     static void writePPMfile(const uint8_t* const image_data, int width, int height, const std::string& path)
     {
         std::ofstream file(path.c_str(), std::ios::binary);
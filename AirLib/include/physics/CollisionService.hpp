@@ -0,0 +1,339 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef airsim_core_CollisionService_hpp
+#define airsim_core_CollisionService_hpp
+
+#include "common/Common.hpp"
+#include "common/CommonStructs.hpp"
+#include "common/common_utils/TaskScheduler.hpp"
+#include "PhysicsBody.hpp"
+#include "CollisionShape.hpp"
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+
+namespace msr
+{
+namespace airlib
+{
+
+    /*
+        Collision detection between physics bodies and static obstacles for runs without Unreal,
+        where nothing else fills PhysicsBody::CollisionInfo.
+
+        Each update places every shape at its body's pose, finds overlapping bounds by sweep and
+        prune along x and runs exact sphere/box/capsule tests on those pairs, in parallel on the
+        TaskScheduler when there are many. Bodies that touch something get their deepest contact
+        as CollisionInfo with a new time stamp, the same way PawnSimApi::onCollision reports hits,
+        so FastPhysicsEngine responds to it on its next step. Bodies not touching anything keep
+        their last CollisionInfo, as with Unreal.
+
+        Sweep order is kept from the previous update and fixed with insertion sort, which is close
+        to linear because bodies move little between ticks.
+
+        sweep() serves continuous collision: it moves a body's core sphere along a path against the
+        static entries and returns the first hit, so fast bodies can't step through thin obstacles.
+    */
+    class CollisionService
+    {
+    public:
+        typedef common_utils::TaskScheduler TaskScheduler;
+
+        struct Contact
+        {
+            uint first, second; //entry indices
+            CollisionContact contact; //normal pushes first out of second
+        };
+
+        struct SweepHit
+        {
+            real_T fraction = 0; //of the path where the body first touches
+            Vector3r position = Vector3r::Zero(); //body position at that point
+            Vector3r point = Vector3r::Zero();
+            Vector3r normal = Vector3r::Zero(); //pointing away from the obstacle
+            std::string object_name;
+            int object_id = -1;
+        };
+
+        explicit CollisionService(TaskScheduler* scheduler = &TaskScheduler::getDefault(), size_t parallel_min_pairs = 256)
+            : scheduler_(scheduler), parallel_min_pairs_(parallel_min_pairs)
+        {
+        }
+
+        //shape follows the body's pose, object_name defaults to the body's name.
+        //Adding a body again replaces its shape, e.g. one registered by FastPhysicsEngine
+        uint addBody(PhysicsBody* body, const CollisionShape& shape, const std::string& object_name = "", int object_id = -1)
+        {
+            Entry entry;
+            entry.body = body;
+            entry.shape = shape;
+            entry.object_name = object_name.empty() ? body->getName() : object_name;
+            entry.object_id = object_id;
+
+            const auto found = body_entries_.find(body);
+            if (found != body_entries_.end()) {
+                entries_[found->second] = entry;
+                return found->second;
+            }
+            return addEntry(entry);
+        }
+
+        uint addBody(PhysicsBody* body)
+        {
+            return addBody(body, CollisionShape::fromBodyVertices(*body));
+        }
+
+        //ground, buildings etc. Static entries are only tested against bodies
+        uint addStatic(const CollisionShape& shape, const Pose& pose, const std::string& object_name, int object_id = -1)
+        {
+            Entry entry;
+            entry.shape = shape;
+            entry.object_name = object_name;
+            entry.object_id = object_id;
+            entry.volume.place(shape, pose);
+            return addEntry(entry);
+        }
+
+        void removeBody(PhysicsBody* body)
+        {
+            entries_.erase(std::remove_if(entries_.begin(), entries_.end(), [body](const Entry& entry) { return entry.body == body; }),
+                           entries_.end());
+            rebuildIndex();
+        }
+
+        void clear()
+        {
+            entries_.clear();
+            order_.clear();
+            body_entries_.clear();
+            static_entries_.clear();
+            pairs_.clear();
+            contacts_.clear();
+        }
+
+        size_t size() const
+        {
+            return entries_.size();
+        }
+
+        //detect collisions at current body poses and report them with time_stamp
+        void update(TTimePoint time_stamp)
+        {
+            placeBodies();
+            sortOrder();
+            findPairs();
+            testPairs();
+            reportContacts(time_stamp);
+        }
+
+        //first static entry hit by the body's core sphere when moving from pose to to_position, orientation kept.
+        //Paths no longer than the core radius are not swept.
+        bool sweep(const PhysicsBody* body, const Pose& from, const Vector3r& to_position, SweepHit& hit) const
+        {
+            const auto found = body_entries_.find(body);
+            if (found == body_entries_.end())
+                return false;
+
+            const CollisionShape& shape = entries_[found->second].shape;
+            const real_T radius = shape.coreRadius();
+            const Vector3r offset = VectorMath::rotateVector(shape.center, from.orientation, true);
+            const Vector3r start = from.position + offset;
+            const Vector3r end = to_position + offset;
+            //shorter paths keep the core inside whatever it would pass, so discrete tests can't miss it
+            if ((end - start).squaredNorm() <= radius * radius)
+                return false;
+            const Vector3r path_min = start.cwiseMin(end) - Vector3r::Constant(radius);
+            const Vector3r path_max = start.cwiseMax(end) + Vector3r::Constant(radius);
+
+            const Entry* hit_entry = nullptr;
+            real_T fraction;
+            Vector3r normal;
+            for (uint entry_index : static_entries_) {
+                const Entry& entry = entries_[entry_index];
+                if ((path_min.array() > entry.volume.aabb_max.array()).any() || (entry.volume.aabb_min.array() > path_max.array()).any())
+                    continue;
+                if (CollisionTests::sweepSphere(start, end, radius, entry.volume, fraction, normal) &&
+                    (!hit_entry || fraction < hit.fraction)) {
+                    hit_entry = &entry;
+                    hit.fraction = fraction;
+                    hit.normal = normal;
+                }
+            }
+            if (!hit_entry)
+                return false;
+
+            hit.position = from.position + (to_position - from.position) * hit.fraction;
+            hit.point = start + (end - start) * hit.fraction - hit.normal * radius;
+            hit.object_name = hit_entry->object_name;
+            hit.object_id = hit_entry->object_id;
+            return true;
+        }
+
+        //pairs whose bounds overlapped in the last update
+        size_t getCandidatePairCount() const
+        {
+            return pairs_.size();
+        }
+
+        //touching pairs found in the last update
+        const vector<Contact>& getContacts() const
+        {
+            return contacts_;
+        }
+
+        const std::string& getObjectName(uint entry_index) const
+        {
+            return entries_.at(entry_index).object_name;
+        }
+
+    private:
+        struct Entry
+        {
+            PhysicsBody* body = nullptr; //null for static entries
+            CollisionShape shape;
+            std::string object_name;
+            int object_id = -1;
+            CollisionVolume volume;
+        };
+
+        uint addEntry(const Entry& entry)
+        {
+            const uint entry_index = static_cast<uint>(entries_.size());
+            entries_.push_back(entry);
+            order_.push_back(entry_index);
+            if (entry.body)
+                body_entries_[entry.body] = entry_index;
+            else
+                static_entries_.push_back(entry_index);
+            return entry_index;
+        }
+
+        void rebuildIndex()
+        {
+            order_.resize(entries_.size());
+            body_entries_.clear();
+            static_entries_.clear();
+            for (uint i = 0; i < entries_.size(); ++i) {
+                order_[i] = i;
+                if (entries_[i].body)
+                    body_entries_[entries_[i].body] = i;
+                else
+                    static_entries_.push_back(i);
+            }
+        }
+
+        template <typename Func>
+        void forEach(size_t count, bool parallel, Func func)
+        {
+            if (parallel && scheduler_)
+                scheduler_->parallelFor(0, count, func);
+            else
+                for (size_t i = 0; i < count; ++i)
+                    func(i);
+        }
+
+        void placeBodies()
+        {
+            forEach(entries_.size(), entries_.size() >= parallel_min_pairs_, [this](size_t i) {
+                Entry& entry = entries_[i];
+                if (entry.body)
+                    entry.volume.place(entry.shape, entry.body->getPose());
+            });
+        }
+
+        void sortOrder()
+        {
+            for (size_t i = 1; i < order_.size(); ++i) {
+                const uint index = order_[i];
+                const real_T key = entries_[index].volume.aabb_min.x();
+                size_t j = i;
+                for (; j > 0 && entries_[order_[j - 1]].volume.aabb_min.x() > key; --j)
+                    order_[j] = order_[j - 1];
+                order_[j] = index;
+            }
+        }
+
+        void findPairs()
+        {
+            pairs_.clear();
+            for (size_t i = 0; i < order_.size(); ++i) {
+                const Entry& a = entries_[order_[i]];
+                for (size_t j = i + 1; j < order_.size(); ++j) {
+                    const Entry& b = entries_[order_[j]];
+                    if (b.volume.aabb_min.x() > a.volume.aabb_max.x())
+                        break;
+                    if (!a.body && !b.body)
+                        continue;
+                    if (a.volume.aabb_min.y() > b.volume.aabb_max.y() || b.volume.aabb_min.y() > a.volume.aabb_max.y() ||
+                        a.volume.aabb_min.z() > b.volume.aabb_max.z() || b.volume.aabb_min.z() > a.volume.aabb_max.z())
+                        continue;
+                    pairs_.emplace_back(order_[i], order_[j]);
+                }
+            }
+        }
+
+        void testPairs()
+        {
+            pair_contacts_.resize(pairs_.size());
+            forEach(pairs_.size(), pairs_.size() >= parallel_min_pairs_, [this](size_t i) {
+                pair_contacts_[i] = CollisionTests::test(entries_[pairs_[i].first].volume, entries_[pairs_[i].second].volume);
+            });
+
+            contacts_.clear();
+            for (size_t i = 0; i < pairs_.size(); ++i)
+                if (pair_contacts_[i].has_contact)
+                    contacts_.push_back(Contact{ pairs_[i].first, pairs_[i].second, pair_contacts_[i] });
+        }
+
+        void reportContacts(TTimePoint time_stamp)
+        {
+            //deepest contact per entry, as contact index and which side of it the entry is on
+            deepest_.assign(entries_.size(), -1);
+            for (size_t i = 0; i < contacts_.size(); ++i) {
+                for (uint entry_index : { contacts_[i].first, contacts_[i].second }) {
+                    int& deepest = deepest_[entry_index];
+                    if (deepest < 0 || contacts_[deepest].contact.depth < contacts_[i].contact.depth)
+                        deepest = static_cast<int>(i);
+                }
+            }
+
+            for (uint entry_index = 0; entry_index < entries_.size(); ++entry_index) {
+                Entry& entry = entries_[entry_index];
+                if (!entry.body || deepest_[entry_index] < 0)
+                    continue;
+
+                const Contact& contact = contacts_[deepest_[entry_index]];
+                const bool is_first = contact.first == entry_index;
+                const Entry& other = entries_[is_first ? contact.second : contact.first];
+
+                CollisionInfo info = entry.body->getCollisionInfo();
+                info.has_collided = true;
+                info.normal = is_first ? contact.contact.normal : Vector3r(-contact.contact.normal);
+                info.impact_point = contact.contact.point;
+                info.position = entry.body->getPose().position;
+                info.penetration_depth = contact.contact.depth;
+                info.time_stamp = time_stamp;
+                ++info.collision_count;
+                info.object_name = other.object_name;
+                info.object_id = other.object_id;
+                entry.body->setCollisionInfo(info);
+            }
+        }
+
+    private:
+        TaskScheduler* scheduler_;
+        size_t parallel_min_pairs_;
+
+        vector<Entry> entries_;
+        vector<uint> order_; //entry indices sorted by aabb_min.x
+        std::unordered_map<const PhysicsBody*, uint> body_entries_;
+        vector<uint> static_entries_;
+        vector<std::pair<uint, uint>> pairs_;
+        vector<CollisionContact> pair_contacts_;
+        vector<Contact> contacts_;
+        vector<int> deepest_;
+    };
+}
+} //namespace
+#endif
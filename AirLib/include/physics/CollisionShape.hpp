@@ -0,0 +1,496 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef airsim_core_CollisionShape_hpp
+#define airsim_core_CollisionShape_hpp
+
+#include "common/Common.hpp"
+#include "common/CommonStructs.hpp"
+#include "PhysicsBody.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace msr
+{
+namespace airlib
+{
+
+    /*
+        Collision geometry of a body in its own frame. Capsules run along body z between
+        center - half_height and center + half_height, like a sphere swept along that segment.
+    */
+    struct CollisionShape
+    {
+        enum class Type : uint
+        {
+            Sphere = 0,
+            Box = 1,
+            Capsule = 2
+        };
+
+        Type type = Type::Sphere;
+        Vector3r center = Vector3r::Zero();
+        Vector3r half_extents = Vector3r::Zero(); //box only
+        real_T radius = 0; //sphere, capsule
+        real_T half_height = 0; //capsule
+
+        static CollisionShape sphere(real_T radius, const Vector3r& center = Vector3r::Zero())
+        {
+            CollisionShape shape;
+            shape.type = Type::Sphere;
+            shape.radius = radius;
+            shape.center = center;
+            return shape;
+        }
+
+        static CollisionShape box(const Vector3r& half_extents, const Vector3r& center = Vector3r::Zero())
+        {
+            CollisionShape shape;
+            shape.type = Type::Box;
+            shape.half_extents = half_extents;
+            shape.center = center;
+            return shape;
+        }
+
+        static CollisionShape capsule(real_T radius, real_T half_height, const Vector3r& center = Vector3r::Zero())
+        {
+            CollisionShape shape;
+            shape.type = Type::Capsule;
+            shape.radius = radius;
+            shape.half_height = half_height;
+            shape.center = center;
+            return shape;
+        }
+
+        //box around all wrench and drag vertices of the body (rotors and body box faces for multirotors),
+        //grown by margin. Bodies without vertices get a sphere of radius margin.
+        static CollisionShape fromBodyVertices(const PhysicsBody& body, real_T margin = 0.05f)
+        {
+            Vector3r min_corner = Vector3r::Constant(Utils::max<real_T>());
+            Vector3r max_corner = Vector3r::Constant(-Utils::max<real_T>());
+            uint count = 0;
+            for (uint i = 0; i < body.wrenchVertexCount(); ++i, ++count) {
+                min_corner = min_corner.cwiseMin(body.getWrenchVertex(i).getInitialPosition());
+                max_corner = max_corner.cwiseMax(body.getWrenchVertex(i).getInitialPosition());
+            }
+            for (uint i = 0; i < body.dragVertexCount(); ++i, ++count) {
+                min_corner = min_corner.cwiseMin(body.getDragVertex(i).getInitialPosition());
+                max_corner = max_corner.cwiseMax(body.getDragVertex(i).getInitialPosition());
+            }
+
+            if (count == 0)
+                return sphere(margin);
+            return box((max_corner - min_corner) / 2 + Vector3r::Constant(margin), (max_corner + min_corner) / 2);
+        }
+
+        //radius of the largest sphere around center that stays inside the shape, swept for continuous collision
+        real_T coreRadius() const
+        {
+            return type == Type::Box ? half_extents.minCoeff() : radius;
+        }
+    };
+
+    /*
+        Shape placed in the world, with the world axis aligned bounds used by the broadphase.
+        For capsules segment_a/segment_b are the world end points of the core segment.
+    */
+    struct CollisionVolume
+    {
+        CollisionShape::Type type = CollisionShape::Type::Sphere;
+        Vector3r center = Vector3r::Zero();
+        Matrix3x3r axes = Matrix3x3r::Identity(); //columns are body x, y, z in world frame
+        Vector3r half_extents = Vector3r::Zero();
+        real_T radius = 0;
+        Vector3r segment_a = Vector3r::Zero(), segment_b = Vector3r::Zero();
+        Vector3r aabb_min = Vector3r::Zero(), aabb_max = Vector3r::Zero();
+
+        void place(const CollisionShape& shape, const Pose& pose)
+        {
+            type = shape.type;
+            axes = pose.orientation.toRotationMatrix();
+            center = pose.position + axes * shape.center;
+            half_extents = shape.half_extents;
+            radius = shape.radius;
+
+            Vector3r extent;
+            switch (type) {
+            case CollisionShape::Type::Box:
+                extent = axes.cwiseAbs() * half_extents;
+                break;
+            case CollisionShape::Type::Capsule:
+                segment_a = center - axes.col(2) * shape.half_height;
+                segment_b = center + axes.col(2) * shape.half_height;
+                extent = axes.col(2).cwiseAbs() * shape.half_height + Vector3r::Constant(radius);
+                break;
+            default:
+                extent = Vector3r::Constant(radius);
+                break;
+            }
+            aabb_min = center - extent;
+            aabb_max = center + extent;
+        }
+    };
+
+    //result of a narrowphase test, normal points from b toward a (the direction that pushes a out of b)
+    struct CollisionContact
+    {
+        bool has_contact = false;
+        Vector3r normal = Vector3r::Zero();
+        Vector3r point = Vector3r::Zero();
+        real_T depth = 0;
+    };
+
+    //narrowphase tests between pairs of volumes
+    class CollisionTests
+    {
+    public:
+        static CollisionContact test(const CollisionVolume& a, const CollisionVolume& b)
+        {
+            typedef CollisionShape::Type Type;
+
+            if (a.type == Type::Box && b.type == Type::Box)
+                return boxBox(a, b);
+            if (a.type == Type::Box)
+                return flip(test(b, a));
+
+            //a is sphere or capsule from here on, reduce it to its closest core point
+            Vector3r core_a = a.center;
+            switch (b.type) {
+            case Type::Box:
+                if (a.type == Type::Capsule)
+                    core_a = closestOnSegmentToBox(a.segment_a, a.segment_b, b);
+                return sphereBox(core_a, a.radius, b);
+            case Type::Capsule: {
+                Vector3r core_b;
+                if (a.type == Type::Capsule)
+                    closestSegmentSegment(a.segment_a, a.segment_b, b.segment_a, b.segment_b, core_a, core_b);
+                else
+                    core_b = closestOnSegment(b.segment_a, b.segment_b, a.center);
+                return sphereSphere(core_a, a.radius, core_b, b.radius);
+            }
+            default:
+                if (a.type == Type::Capsule)
+                    core_a = closestOnSegment(a.segment_a, a.segment_b, b.center);
+                return sphereSphere(core_a, a.radius, b.center, b.radius);
+            }
+        }
+
+        static CollisionContact sphereSphere(const Vector3r& center_a, real_T radius_a, const Vector3r& center_b, real_T radius_b)
+        {
+            CollisionContact contact;
+            const Vector3r d = center_a - center_b;
+            const real_T dist_sq = d.squaredNorm();
+            const real_T radius_sum = radius_a + radius_b;
+            if (dist_sq > radius_sum * radius_sum)
+                return contact;
+
+            const real_T dist = std::sqrt(dist_sq);
+            contact.has_contact = true;
+            //coincident centers have no preferred direction, push up (NED)
+            contact.normal = dist > kEpsilon ? Vector3r(d / dist) : Vector3r(0, 0, -1);
+            contact.depth = radius_sum - dist;
+            contact.point = center_b + contact.normal * (radius_b - contact.depth / 2);
+            return contact;
+        }
+
+        static CollisionContact sphereBox(const Vector3r& center, real_T radius, const CollisionVolume& box)
+        {
+            CollisionContact contact;
+            const Vector3r local = box.axes.transpose() * (center - box.center);
+            const Vector3r clamped = local.cwiseMax(-box.half_extents).cwiseMin(box.half_extents);
+            const Vector3r d = local - clamped;
+            const real_T dist_sq = d.squaredNorm();
+            if (dist_sq > radius * radius)
+                return contact;
+
+            contact.has_contact = true;
+            if (dist_sq > kEpsilon * kEpsilon) {
+                const real_T dist = std::sqrt(dist_sq);
+                contact.normal = box.axes * (d / dist);
+                contact.depth = radius - dist;
+                contact.point = box.center + box.axes * clamped;
+            }
+            else {
+                //center inside the box, leave through the nearest face
+                const Vector3r face_dist = box.half_extents - local.cwiseAbs();
+                int axis;
+                face_dist.minCoeff(&axis);
+                const real_T sign = local[axis] >= 0 ? 1.0f : -1.0f;
+                contact.normal = box.axes.col(axis) * sign;
+                contact.depth = radius + face_dist[axis];
+                Vector3r on_face = local;
+                on_face[axis] = box.half_extents[axis] * sign;
+                contact.point = box.center + box.axes * on_face;
+            }
+            return contact;
+        }
+
+        //separating axis test over the 15 candidate axes, contact normal is the axis of least overlap
+        static CollisionContact boxBox(const CollisionVolume& a, const CollisionVolume& b)
+        {
+            CollisionContact contact;
+            const Vector3r t = a.center - b.center;
+            real_T best_depth = Utils::max<real_T>();
+            Vector3r best_axis = Vector3r::Zero();
+
+            auto try_axis = [&](Vector3r axis) -> bool {
+                const real_T len_sq = axis.squaredNorm();
+                //cross products of near parallel edges say nothing
+                if (len_sq < 1E-8f)
+                    return true;
+                axis /= std::sqrt(len_sq);
+                const real_T overlap = projectedRadius(a, axis) + projectedRadius(b, axis) - std::abs(t.dot(axis));
+                if (overlap < 0)
+                    return false;
+                if (overlap < best_depth) {
+                    best_depth = overlap;
+                    best_axis = t.dot(axis) >= 0 ? axis : Vector3r(-axis);
+                }
+                return true;
+            };
+
+            for (int i = 0; i < 3; ++i)
+                if (!try_axis(a.axes.col(i)) || !try_axis(b.axes.col(i)))
+                    return contact;
+            for (int i = 0; i < 3; ++i)
+                for (int j = 0; j < 3; ++j)
+                    if (!try_axis(a.axes.col(i).cross(b.axes.col(j))))
+                        return contact;
+
+            contact.has_contact = true;
+            contact.normal = best_axis;
+            contact.depth = best_depth;
+            //deepest feature of b (corner, edge or face center) meets the closest point of a
+            const Vector3r point_b = support(b, best_axis);
+            const Vector3r local = a.axes.transpose() * (point_b - a.center);
+            const Vector3r point_a = a.center + a.axes * local.cwiseMax(-a.half_extents).cwiseMin(a.half_extents);
+            contact.point = (point_a + point_b) / 2;
+            return contact;
+        }
+
+        static Vector3r closestOnSegment(const Vector3r& a, const Vector3r& b, const Vector3r& p)
+        {
+            const Vector3r ab = b - a;
+            const real_T len_sq = ab.squaredNorm();
+            if (len_sq < kEpsilon)
+                return a;
+            return a + ab * Utils::clip((p - a).dot(ab) / len_sq, 0.0f, 1.0f);
+        }
+
+        //closest points between segments p1-q1 and p2-q2 (Ericson, Real-Time Collision Detection 5.1.9)
+        static void closestSegmentSegment(const Vector3r& p1, const Vector3r& q1, const Vector3r& p2, const Vector3r& q2,
+                                          Vector3r& c1, Vector3r& c2)
+        {
+            const Vector3r d1 = q1 - p1, d2 = q2 - p2, r = p1 - p2;
+            const real_T a = d1.squaredNorm(), e = d2.squaredNorm(), f = d2.dot(r);
+            real_T s, t;
+
+            if (a <= kEpsilon && e <= kEpsilon) {
+                s = t = 0;
+            }
+            else if (a <= kEpsilon) {
+                s = 0;
+                t = Utils::clip(f / e, 0.0f, 1.0f);
+            }
+            else {
+                const real_T c = d1.dot(r);
+                if (e <= kEpsilon) {
+                    t = 0;
+                    s = Utils::clip(-c / a, 0.0f, 1.0f);
+                }
+                else {
+                    const real_T b = d1.dot(d2);
+                    const real_T denom = a * e - b * b;
+                    s = denom > kEpsilon ? Utils::clip((b * f - c * e) / denom, 0.0f, 1.0f) : 0.0f;
+                    t = (b * s + f) / e;
+                    if (t < 0) {
+                        t = 0;
+                        s = Utils::clip(-c / a, 0.0f, 1.0f);
+                    }
+                    else if (t > 1) {
+                        t = 1;
+                        s = Utils::clip((b - c) / a, 0.0f, 1.0f);
+                    }
+                }
+            }
+            c1 = p1 + d1 * s;
+            c2 = p2 + d2 * t;
+        }
+
+        //point of segment a-b closest to the box, by alternating projections which converge for convex sets
+        static Vector3r closestOnSegmentToBox(const Vector3r& a, const Vector3r& b, const CollisionVolume& box)
+        {
+            Vector3r p = closestOnSegment(a, b, box.center);
+            for (int i = 0; i < kProjectionIterations; ++i) {
+                const Vector3r local = box.axes.transpose() * (p - box.center);
+                const Vector3r on_box = box.center + box.axes * local.cwiseMax(-box.half_extents).cwiseMin(box.half_extents);
+                const Vector3r next = closestOnSegment(a, b, on_box);
+                if ((next - p).squaredNorm() < kEpsilon * kEpsilon)
+                    return next;
+                p = next;
+            }
+            return p;
+        }
+
+        /*
+            Sphere moving from -> to against a volume, for continuous collision. Returns false if the path
+            misses or starts already touching (discrete tests handle that), else the fraction of the path
+            at first touch and the volume's normal there. Boxes are grown by radius without rounding their
+            edges, so hits near edges come slightly early which is the safe side.
+        */
+        static bool sweepSphere(const Vector3r& from, const Vector3r& to, real_T radius, const CollisionVolume& volume,
+                                real_T& fraction, Vector3r& normal)
+        {
+            typedef CollisionShape::Type Type;
+
+            const Vector3r d = to - from;
+            switch (volume.type) {
+            case Type::Box:
+                return rayBox(from, d, volume, radius, fraction, normal);
+            case Type::Capsule: {
+                const real_T r = volume.radius + radius;
+                if ((from - closestOnSegment(volume.segment_a, volume.segment_b, from)).squaredNorm() <= r * r)
+                    return false;
+
+                bool is_hit = rayCylinder(from, d, volume.segment_a, volume.segment_b, r, fraction, normal);
+                real_T cap_fraction;
+                Vector3r cap_normal;
+                for (const Vector3r* cap : { &volume.segment_a, &volume.segment_b }) {
+                    if (raySphere(from, d, *cap, r, cap_fraction, cap_normal) && (!is_hit || cap_fraction < fraction)) {
+                        is_hit = true;
+                        fraction = cap_fraction;
+                        normal = cap_normal;
+                    }
+                }
+                return is_hit;
+            }
+            default:
+                return raySphere(from, d, volume.center, volume.radius + radius, fraction, normal);
+            }
+        }
+
+    private:
+        static constexpr real_T kEpsilon = 1E-6f;
+        static constexpr real_T kAxisTolerance = 1E-3f;
+        static constexpr int kProjectionIterations = 6;
+
+        static CollisionContact flip(CollisionContact contact)
+        {
+            contact.normal = -contact.normal;
+            return contact;
+        }
+
+        //ray from + t * d for t in [0, 1] entering a sphere, false if it starts inside
+        static bool raySphere(const Vector3r& from, const Vector3r& d, const Vector3r& center, real_T radius,
+                              real_T& fraction, Vector3r& normal)
+        {
+            const Vector3r m = from - center;
+            const real_T c = m.squaredNorm() - radius * radius;
+            const real_T b = m.dot(d);
+            const real_T a = d.squaredNorm();
+            if (c <= 0 || b >= 0 || a < kEpsilon)
+                return false;
+            const real_T disc = b * b - a * c;
+            if (disc < 0)
+                return false;
+
+            const real_T t = (-b - std::sqrt(disc)) / a;
+            if (t > 1)
+                return false;
+            fraction = std::max<real_T>(t, 0);
+            normal = (m + d * fraction) / radius;
+            return true;
+        }
+
+        //side wall of the cylinder around segment a-b, caps are left to raySphere
+        static bool rayCylinder(const Vector3r& from, const Vector3r& d, const Vector3r& a, const Vector3r& b, real_T radius,
+                                real_T& fraction, Vector3r& normal)
+        {
+            const Vector3r ab = b - a;
+            const real_T len = ab.norm();
+            if (len < kEpsilon)
+                return false;
+            const Vector3r axis = ab / len;
+
+            //solve in the plane perpendicular to the axis
+            const Vector3r m = from - a;
+            const Vector3r m_perp = m - axis * m.dot(axis);
+            const Vector3r d_perp = d - axis * d.dot(axis);
+            const real_T qa = d_perp.squaredNorm();
+            const real_T qb = m_perp.dot(d_perp);
+            const real_T qc = m_perp.squaredNorm() - radius * radius;
+            if (qa < kEpsilon || qb >= 0 || qc <= 0)
+                return false;
+            const real_T disc = qb * qb - qa * qc;
+            if (disc < 0)
+                return false;
+
+            const real_T t = (-qb - std::sqrt(disc)) / qa;
+            const real_T along = (m + d * t).dot(axis);
+            if (t > 1 || along < 0 || along > len)
+                return false;
+            fraction = t;
+            normal = (m_perp + d_perp * t) / radius;
+            return true;
+        }
+
+        //slab test against the box grown by margin, normal is the face entered last
+        static bool rayBox(const Vector3r& from, const Vector3r& d, const CollisionVolume& box, real_T margin,
+                           real_T& fraction, Vector3r& normal)
+        {
+            const Vector3r origin = box.axes.transpose() * (from - box.center);
+            const Vector3r dir = box.axes.transpose() * d;
+            real_T t_enter = -Utils::max<real_T>(), t_exit = Utils::max<real_T>();
+            int enter_axis = -1;
+            real_T enter_sign = 0;
+
+            for (int i = 0; i < 3; ++i) {
+                const real_T extent = box.half_extents[i] + margin;
+                if (std::abs(dir[i]) < kEpsilon) {
+                    if (std::abs(origin[i]) > extent)
+                        return false;
+                    continue;
+                }
+                real_T t1 = (-extent - origin[i]) / dir[i];
+                real_T t2 = (extent - origin[i]) / dir[i];
+                if (t1 > t2)
+                    std::swap(t1, t2);
+                if (t1 > t_enter) {
+                    t_enter = t1;
+                    enter_axis = i;
+                    enter_sign = dir[i] > 0 ? -1.0f : 1.0f;
+                }
+                t_exit = std::min(t_exit, t2);
+            }
+
+            //starting inside (t_enter < 0) is left to the discrete test
+            if (enter_axis < 0 || t_enter < 0 || t_enter > 1 || t_enter > t_exit)
+                return false;
+            fraction = t_enter;
+            normal = box.axes.col(enter_axis) * enter_sign;
+            return true;
+        }
+
+        static real_T projectedRadius(const CollisionVolume& box, const Vector3r& axis)
+        {
+            return box.half_extents.x() * std::abs(box.axes.col(0).dot(axis)) +
+                   box.half_extents.y() * std::abs(box.axes.col(1).dot(axis)) +
+                   box.half_extents.z() * std::abs(box.axes.col(2).dot(axis));
+        }
+
+        //center of the box feature furthest along dir, axes perpendicular to dir contribute nothing
+        //so a face or edge facing dir gives its center instead of an arbitrary corner
+        static Vector3r support(const CollisionVolume& box, const Vector3r& dir)
+        {
+            Vector3r point = box.center;
+            for (int i = 0; i < 3; ++i) {
+                const real_T along = box.axes.col(i).dot(dir);
+                if (std::abs(along) > kAxisTolerance)
+                    point += box.axes.col(i) * (along > 0 ? box.half_extents[i] : -box.half_extents[i]);
+            }
+            return point;
+        }
+    };
+}
+} //namespace
+#endif
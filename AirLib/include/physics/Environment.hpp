@@ -92,6 +92,16 @@ namespace airlib
             updateState(current_);
         }
 
+        virtual void saveState(StateSnapshot& snapshot) const override
+        {
+            snapshot.write(current_);
+        }
+
+        virtual void restoreState(StateSnapshot& snapshot) override
+        {
+            snapshot.read(current_);
+        }
+
     protected:
         virtual void resetImplementation() override
         {
@@ -12,6 +12,7 @@
 #include <memory>
 #include "common/CommonStructs.hpp"
 #include "common/SteppableClock.hpp"
+#include "physics/CollisionService.hpp"
 #include <cinttypes>
 
 namespace msr
@@ -41,12 +42,35 @@ namespace airlib
             PhysicsEngineBase::insert(body_ptr);
 
             initPhysicsBody(body_ptr);
+            if (collision_service_)
+                collision_service_->addBody(body_ptr);
+        }
+
+        virtual void erase_remove(PhysicsBody* body_ptr) override
+        {
+            if (collision_service_)
+                collision_service_->removeBody(body_ptr);
+
+            PhysicsEngineBase::erase_remove(body_ptr);
+        }
+
+        virtual void clear() override
+        {
+            if (collision_service_)
+                for (PhysicsBody* body_ptr : *this)
+                    collision_service_->removeBody(body_ptr);
+
+            PhysicsEngineBase::clear();
         }
 
         virtual void update() override
         {
             PhysicsEngineBase::update();
 
+            //without Unreal nobody else reports collisions, detect them at the poses bodies start this step with
+            if (collision_service_)
+                collision_service_->update(clock()->nowNanos());
+
             for (PhysicsBody* body_ptr : *this) {
                 updatePhysics(*body_ptr);
             }
@@ -62,6 +86,18 @@ namespace airlib
             //call base
             UpdatableObject::reportState(reporter);
         }
+
+        virtual void saveState(StateSnapshot& snapshot) const override
+        {
+            snapshot.write(wind_);
+            snapshot.write(ext_force_);
+        }
+
+        virtual void restoreState(StateSnapshot& snapshot) override
+        {
+            snapshot.read(wind_);
+            snapshot.read(ext_force_);
+        }
         //*** End: UpdatableState implementation ***//
 
         // Set Wind, for API and Settings implementation
@@ -75,6 +111,17 @@ namespace airlib
             ext_force_ = ext_force;
         }
 
+        //opt-in collision detection for headless runs, bodies already inserted and inserted later are
+        //registered with their vertex bounds. Static obstacles such as ground go to the service directly.
+        //With a service, fast bodies are also swept against static obstacles so they can't tunnel through.
+        void setCollisionService(CollisionService* collision_service)
+        {
+            collision_service_ = collision_service;
+            if (collision_service_)
+                for (PhysicsBody* body_ptr : *this)
+                    collision_service_->addBody(body_ptr);
+        }
+
     private:
         void initPhysicsBody(PhysicsBody* body_ptr)
         {
@@ -104,6 +151,9 @@ namespace airlib
                 updateCollisionResponseInfo(collision_info, next, is_collision_response, collision_response);
                 //throttledLogOutput("*** has collision", 0.1);
             }
+            else if (collision_service_) {
+                updateContinuousCollision(dt, body, current, next, next_wrench);
+            }
             //else throttledLogOutput("*** no collision", 0.1);
 
             //Utils::log(Utils::stringf("T-VEL %s %" PRIu64 ": ",
@@ -119,6 +169,35 @@ namespace airlib
             //body.getEnvironment().update();
         }
 
+        //a body moving further than its core radius in one step can pass through thin obstacles without
+        //ever overlapping them at a tick, so sweep its path and split the step at the first hit
+        void updateContinuousCollision(TTimeDelta dt, PhysicsBody& body, const Kinematics::State& current,
+                                       Kinematics::State& next, Wrench& next_wrench)
+        {
+            CollisionService::SweepHit hit;
+            if (!collision_service_->sweep(&body, current.pose, next.pose.position, hit))
+                return;
+
+            CollisionInfo collision_info = body.getCollisionInfo();
+            collision_info.has_collided = true;
+            collision_info.normal = hit.normal;
+            collision_info.impact_point = hit.point;
+            collision_info.position = hit.position;
+            collision_info.penetration_depth = 0;
+            collision_info.time_stamp = clock()->nowNanos();
+            ++collision_info.collision_count;
+            collision_info.object_name = hit.object_name;
+            collision_info.object_id = hit.object_id;
+            body.setCollisionInfo(collision_info);
+
+            //free flight up to the hit is hit.position, the response takes the rest of the step
+            const TTimeDelta dt_rest = dt * (1 - hit.fraction);
+            const bool is_collision_response = getNextKinematicsOnCollision(dt_rest, collision_info, body, current, next, next_wrench, enable_ground_lock_);
+            if (!is_collision_response)
+                next.pose.position = hit.position;
+            updateCollisionResponseInfo(collision_info, next, is_collision_response, body.getCollisionResponseInfo());
+        }
+
         static void updateCollisionResponseInfo(const CollisionInfo& collision_info, const Kinematics::State& next,
                                                 bool is_collision_response, CollisionResponse& collision_response)
         {
@@ -472,6 +551,7 @@ namespace airlib
         TTimePoint last_message_time;
         Vector3r wind_;
         Vector3r ext_force_;
+        CollisionService* collision_service_ = nullptr;
     };
 }
 } //namespace
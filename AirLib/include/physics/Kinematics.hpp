@@ -69,6 +69,16 @@ namespace airlib
             reporter.writeValue("Ang-Vel", current_.twist.angular);
             reporter.writeValue("Ang-Accl", current_.accelerations.angular);
         }
+
+        virtual void saveState(StateSnapshot& snapshot) const override
+        {
+            snapshot.write(current_);
+        }
+
+        virtual void restoreState(StateSnapshot& snapshot) override
+        {
+            snapshot.read(current_);
+        }
         //*** End: UpdatableState implementation ***//
 
         const Pose& getPose() const
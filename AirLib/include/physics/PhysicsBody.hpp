@@ -12,6 +12,7 @@
 #include "Environment.hpp"
 #include <unordered_set>
 #include <exception>
+#include <mutex>
 
 namespace msr
 {
@@ -128,11 +129,7 @@ namespace airlib
         {
             UpdatableObject::update();
 
-            //update individual vertices - each vertex takes control signal as input and
-            //produces force and thrust as output
-            for (uint vertex_index = 0; vertex_index < wrenchVertexCount(); ++vertex_index) {
-                getWrenchVertex(vertex_index).update();
-            }
+            updateWrenchVertices();
             for (uint vertex_index = 0; vertex_index < dragVertexCount(); ++vertex_index) {
                 getDragVertex(vertex_index).update();
             }
@@ -145,6 +142,41 @@ namespace airlib
 
             reporter.writeHeading("Kinematics");
         }
+
+        virtual void saveState(StateSnapshot& snapshot) const override
+        {
+            kinematics_->saveState(snapshot);
+            if (environment_)
+                environment_->saveState(snapshot);
+            snapshot.write(wrench_);
+            snapshot.write(collision_info_);
+            snapshot.write(collision_response_);
+            snapshot.write(grounded_);
+            snapshot.writeTime(last_kinematics_time);
+
+            for (uint vertex_index = 0; vertex_index < wrenchVertexCount(); ++vertex_index)
+                getWrenchVertex(vertex_index).saveState(snapshot);
+            for (uint vertex_index = 0; vertex_index < dragVertexCount(); ++vertex_index)
+                getDragVertex(vertex_index).saveState(snapshot);
+        }
+
+        virtual void restoreState(StateSnapshot& snapshot) override
+        {
+            kinematics_->restoreState(snapshot);
+            if (environment_)
+                environment_->restoreState(snapshot);
+            snapshot.read(wrench_);
+            snapshot.read(collision_info_);
+            snapshot.read(collision_response_);
+            snapshot.shiftTime(collision_response_.collision_time_stamp);
+            snapshot.read(grounded_);
+            snapshot.readTime(last_kinematics_time);
+
+            for (uint vertex_index = 0; vertex_index < wrenchVertexCount(); ++vertex_index)
+                getWrenchVertex(vertex_index).restoreState(snapshot);
+            for (uint vertex_index = 0; vertex_index < dragVertexCount(); ++vertex_index)
+                getDragVertex(vertex_index).restoreState(snapshot);
+        }
         //*** End: UpdatableState implementation ***//
 
         //getters
@@ -248,6 +280,16 @@ namespace airlib
         //for use in physics engine: //TODO: use getter/setter or friend method?
         TTimePoint last_kinematics_time;
 
+    protected:
+        //each vertex takes control signal as input and produces force and thrust as output, bodies
+        //that can update their vertices together override this
+        virtual void updateWrenchVertices()
+        {
+            for (uint vertex_index = 0; vertex_index < wrenchVertexCount(); ++vertex_index) {
+                getWrenchVertex(vertex_index).update();
+            }
+        }
+
     private:
         real_T mass_, mass_inv_;
         Matrix3x3r inertia_, inertia_inv_;
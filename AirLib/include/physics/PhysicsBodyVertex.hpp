@@ -63,6 +63,22 @@ namespace airlib
 
             setWrench(current_wrench_);
         }
+
+        virtual void saveState(StateSnapshot& snapshot) const override
+        {
+            snapshot.write(position_);
+            snapshot.write(normal_);
+            snapshot.write(current_wrench_);
+            snapshot.write(drag_factor_);
+        }
+
+        virtual void restoreState(StateSnapshot& snapshot) override
+        {
+            snapshot.read(position_);
+            snapshot.read(normal_);
+            snapshot.read(current_wrench_);
+            snapshot.read(drag_factor_);
+        }
         //*** End: UpdatableState implementation ***//
 
         //getters, setters
@@ -70,6 +86,11 @@ namespace airlib
         {
             return position_;
         }
+        //position in body frame before any reset or update, available right after initialize()
+        Vector3r getInitialPosition() const
+        {
+            return initial_position_;
+        }
         void setPosition(const Vector3r& position)
         {
             position_ = position;
@@ -27,6 +27,16 @@ namespace airlib
             //default nothing to report for physics engine
         }
 
+        //bodies are saved by the World they are members of, engines only save their own state
+        virtual void saveState(StateSnapshot& snapshot) const override
+        {
+            unused(snapshot);
+        }
+        virtual void restoreState(StateSnapshot& snapshot) override
+        {
+            unused(snapshot);
+        }
+
         virtual void setWind(const Vector3r& wind) { unused(wind); };
         virtual void setExtForce(const Vector3r& ext_force) { unused(ext_force); };
     };
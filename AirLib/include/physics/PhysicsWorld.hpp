@@ -59,6 +59,33 @@ namespace airlib
             return update_period_nanos_;
         }
 
+        void setJournal(ReplayJournal* journal)
+        {
+            lock();
+            world_.setJournal(journal);
+            unlock();
+        }
+
+        StateSnapshot saveSnapshot()
+        {
+            lock();
+            StateSnapshot snapshot = world_.saveSnapshot();
+            unlock();
+            return snapshot;
+        }
+        void restoreSnapshot(StateSnapshot& snapshot)
+        {
+            lock();
+            try {
+                world_.restoreSnapshot(snapshot);
+            }
+            catch (...) {
+                unlock();
+                throw;
+            }
+            unlock();
+        }
+
         void startAsyncUpdator()
         {
             world_.startAsyncUpdator(update_period_nanos_);
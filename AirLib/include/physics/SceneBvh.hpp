@@ -0,0 +1,153 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef airsim_core_SceneBvh_hpp
+#define airsim_core_SceneBvh_hpp
+
+#include "common/Common.hpp"
+#include "common/CommonStructs.hpp"
+#include "common/common_utils/TaskScheduler.hpp"
+#include <vector>
+
+namespace msr
+{
+namespace airlib
+{
+
+    /*
+    SceneBvh holds the static triangles of a scene, e.g. the export of getMeshPositionVertexBuffers,
+    in a bounding volume hierarchy so ray casts, line of sight and box overlap queries can run
+    without the game engine and on many threads at once.
+
+    The tree is built with binned surface area heuristic. Subtrees over a few thousand triangles
+    are built as separate tasks on the TaskScheduler. Nodes are 32 bytes with siblings stored
+    next to each other, and triangles are reordered so every leaf refers to one contiguous run.
+
+    Rays that start close together and point in similar directions, like neighbouring lidar beams,
+    can be cast as packets of kPacketSize which share one walk down the tree and are tested against
+    nodes and triangles together with SIMD (SSE or scalar fallback).
+
+    Meshes are added first and build() makes them queryable. Adding after build() needs another
+    build(). Queries are const and safe to call concurrently.
+    */
+    class SceneBvh
+    {
+    public:
+        //direction should be unit length for distances to be in meters
+        struct Ray
+        {
+            Vector3r origin = Vector3r::Zero();
+            Vector3r direction = Vector3r::UnitX();
+            real_T max_distance = Utils::max<real_T>();
+
+            Ray()
+            {
+            }
+            Ray(const Vector3r& origin_val, const Vector3r& direction_val, real_T max_distance_val = Utils::max<real_T>())
+                : origin(origin_val), direction(direction_val), max_distance(max_distance_val)
+            {
+            }
+        };
+
+        struct RayHit
+        {
+            bool hit = false;
+            real_T distance = Utils::max<real_T>();
+            Vector3r point = Vector3r::Zero();
+            Vector3r normal = Vector3r::Zero(); //of the triangle, facing the ray origin
+            int mesh_index = -1;
+            uint triangle_index = 0; //in build order, stable until the next build()
+        };
+
+    public:
+        static constexpr uint kPacketSize = 4;
+
+        SceneBvh();
+
+        /*
+        Vertices are transformed by linear * v + offset before use, e.g. to go from the Unreal world
+        frame in centimeters to NED meters pass diag(0.01, 0.01, -0.01) and the scaled origin.
+        Triangles referring to missing vertices are skipped. Returns mesh index reported in hits.
+        */
+        int addMesh(const MeshPositionVertexBuffersResponse& mesh, const Matrix3x3r& linear = Matrix3x3r::Identity(),
+                    const Vector3r& offset = Vector3r::Zero());
+        //vertices are x0, y0, z0, x1, ... and every three indices make one triangle
+        int addTriangles(const vector<float>& vertices, const vector<uint32_t>& indices, const std::string& name,
+                         const Matrix3x3r& linear = Matrix3x3r::Identity(), const Vector3r& offset = Vector3r::Zero());
+
+        void build(common_utils::TaskScheduler* scheduler = &common_utils::TaskScheduler::getDefault());
+        void clear();
+
+        //closest hit within ray.max_distance
+        RayHit castRay(const Ray& ray) const;
+        //hits[i] is result of rays[i], rays are split over scheduler threads
+        void castRays(const vector<Ray>& rays, vector<RayHit>& hits,
+                      common_utils::TaskScheduler* scheduler = &common_utils::TaskScheduler::getDefault()) const;
+        //up to kPacketSize coherent rays in one traversal, same results as castRay for each
+        void castRayPacket(const Ray* rays, RayHit* hits, uint count) const;
+        //like castRays but consecutive groups of kPacketSize rays are cast as packets
+        void castRayPackets(const vector<Ray>& rays, vector<RayHit>& hits,
+                            common_utils::TaskScheduler* scheduler = &common_utils::TaskScheduler::getDefault()) const;
+        //true if no triangle is between the two points, stops at the first one found
+        bool testLineOfSight(const Vector3r& from, const Vector3r& to) const;
+
+        //true if any triangle intersects the box
+        bool overlapsBox(const Vector3r& box_min, const Vector3r& box_max) const;
+        //appends every triangle intersecting the box, returns count appended
+        uint queryBox(const Vector3r& box_min, const Vector3r& box_max, vector<uint>& triangle_indices) const;
+
+        uint getTriangleCount() const;
+        uint getNodeCount() const;
+        uint getMeshCount() const;
+        const std::string& getMeshName(int mesh_index) const;
+        int getTriangleMesh(uint triangle_index) const;
+        //corners of triangle in build order
+        void getTriangle(uint triangle_index, Vector3r& v0, Vector3r& v1, Vector3r& v2) const;
+        void getBounds(Vector3r& bounds_min, Vector3r& bounds_max) const;
+
+    private:
+        //leaf if count > 0, then first is index of first triangle, else first is index of left child
+        //and right child follows it
+        struct Node
+        {
+            float bounds_min[3];
+            uint32_t first;
+            float bounds_max[3];
+            uint32_t count;
+        };
+
+        //vertex 0 and two edges, ready for ray intersection
+        struct Triangle
+        {
+            Vector3r v0, e1, e2;
+        };
+
+        struct BuildRef
+        {
+            Vector3r bounds_min, bounds_max, centroid;
+            uint triangle;
+        };
+
+        class Builder;
+        struct Packet;
+
+        template <bool kAnyHit>
+        bool traverse(const Vector3r& origin, const Vector3r& direction, real_T max_distance, RayHit* hit) const;
+
+        template <typename TVisitor>
+        bool visitBox(const Vector3r& box_min, const Vector3r& box_max, TVisitor&& visitor) const;
+
+        static bool intersectTriangle(const Triangle& triangle, const Vector3r& origin, const Vector3r& direction,
+                                      real_T max_distance, real_T& distance);
+        void fillHit(int triangle_index, real_T distance, const Vector3r& origin, const Vector3r& direction, RayHit& hit) const;
+        static bool triangleOverlapsBox(const Triangle& triangle, const Vector3r& box_center, const Vector3r& half_size);
+
+    private:
+        vector<Triangle> triangles_;
+        vector<int> triangle_meshes_;
+        vector<std::string> mesh_names_;
+        vector<Node> nodes_;
+    };
+}
+} //namespace
+#endif
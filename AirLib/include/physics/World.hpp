@@ -11,6 +11,7 @@
 #include "PhysicsBody.hpp"
 #include "common/common_utils/ScheduledExecutor.hpp"
 #include "common/ClockFactory.hpp"
+#include "common/ReplayJournal.hpp"
 
 namespace msr
 {
@@ -34,6 +35,9 @@ namespace airlib
         //*** Start: UpdatableState implementation ***//
         virtual void resetImplementation() override
         {
+            if (journal_)
+                journal_->beginFrame(ReplayJournal::FrameType::Reset);
+
             UpdatableContainer::resetImplementation();
 
             if (physics_engine_)
@@ -44,6 +48,9 @@ namespace airlib
         {
             ClockFactory::get()->step();
 
+            if (journal_)
+                journal_->beginFrame(ReplayJournal::FrameType::Update);
+
             //first update our objects
             UpdatableContainer::update();
 
@@ -61,8 +68,39 @@ namespace airlib
             //call base
             UpdatableContainer::reportState(reporter);
         }
+
+        virtual void saveState(StateSnapshot& snapshot) const override
+        {
+            UpdatableContainer::saveState(snapshot);
+            if (physics_engine_)
+                physics_engine_->saveState(snapshot);
+        }
+
+        virtual void restoreState(StateSnapshot& snapshot) override
+        {
+            UpdatableContainer::restoreState(snapshot);
+            if (physics_engine_)
+                physics_engine_->restoreState(snapshot);
+        }
         //*** End: UpdatableState implementation ***//
 
+        //state of every member and the physics engine at the current clock time, which
+        //restoreSnapshot() puts back in place of a reset. Restoring throws std::runtime_error or
+        //std::out_of_range if the snapshot came from a world with other members or settings
+        StateSnapshot saveSnapshot() const
+        {
+            StateSnapshot snapshot;
+            snapshot.beginSave(ClockFactory::get()->nowNanos());
+            saveState(snapshot);
+            return snapshot;
+        }
+        void restoreSnapshot(StateSnapshot& snapshot)
+        {
+            snapshot.beginRestore(ClockFactory::get()->nowNanos());
+            restoreState(snapshot);
+            snapshot.endRestore();
+        }
+
         //override membership modification methods so we can synchronize physics engine
         virtual void clear() override
         {
@@ -88,6 +126,19 @@ namespace airlib
             UpdatableContainer::erase_remove(member);
         }
 
+        //inputs sent to the journal are applied at the start of every reset and update, and
+        //recorded or replayed with them
+        void setJournal(ReplayJournal* journal)
+        {
+            journal_ = journal;
+            if (journal_)
+                journal_->setPhysicsEngine(physics_engine_.get());
+        }
+        ReplayJournal* getJournal() const
+        {
+            return journal_;
+        }
+
         //async updater thread
         void startAsyncUpdator(uint64_t period)
         {
@@ -166,6 +217,7 @@ namespace airlib
     private:
         std::unique_ptr<PhysicsEngineBase> physics_engine_ = nullptr;
         common_utils::ScheduledExecutor executor_;
+        ReplayJournal* journal_ = nullptr;
     };
 }
 } //namespace
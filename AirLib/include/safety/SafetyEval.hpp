@@ -8,6 +8,7 @@
 #include <array>
 #include <memory>
 #include "ObstacleMap.hpp"
+#include "VoxelOccupancyMap.hpp"
 #include "common/common_utils/Utils.hpp"
 #include "IGeoFence.hpp"
 #include "common/Common.hpp"
@@ -91,6 +92,8 @@ namespace airlib
         MultirotorApiParams vehicle_params_;
         shared_ptr<IGeoFence> fence_ptr_;
         shared_ptr<ObstacleMap> obs_xy_ptr_;
+        //if available, obstacle queries are answered by 3D map and obs_xy_ptr_ only provides tick geometry
+        shared_ptr<VoxelOccupancyMap> obs_3d_ptr_;
         SafetyViolationType enable_reasons_ = SafetyEval::SafetyViolationType_::GeoFence;
         ObsAvoidanceStrategy obs_strategy_ = SafetyEval::ObsAvoidanceStrategy::RaiseException;
 
@@ -98,12 +101,17 @@ namespace airlib
         void isSafeDestination(const Vector3r& dest, const Vector3r& cur_pos, const Quaternionr& quaternion, SafetyEval::EvalResult& result);
         Vector3r getDestination(const Vector3r& cur_pos, const Vector3r& velocity) const;
         bool isThisRiskDistLess(float this_risk_dist, float other_risk_dist) const;
-        void isCurrentSafer(SafetyEval::EvalResult& result);
+        void isCurrentSafer(SafetyEval::EvalResult& result, const Quaternionr& quaternion);
         void setSuggestedVelocity(SafetyEval::EvalResult& result, const Quaternionr& quaternion);
         float adjustClearanceForPrStl(float base_clearance, float obs_confidence);
+        ObstacleMap::ObstacleInfo getClosestObstacle(const Vector3r& cur_pos, const Quaternionr& quaternion);
+        ObstacleMap::ObstacleInfo getObstacleInTicks(const Vector3r& cur_pos, const Quaternionr& quaternion, int from_tick, int to_tick);
+        ObstacleMap::ObstacleInfo sweepObstacle(const Vector3r& cur_pos, const Vector3r& dir_world, float length, int tick);
 
     public:
-        SafetyEval(MultirotorApiParams vehicle_params, shared_ptr<IGeoFence> fence_ptr, shared_ptr<ObstacleMap> obs_xy);
+        //obs_xy may be null if obs_3d is supplied
+        SafetyEval(MultirotorApiParams vehicle_params, shared_ptr<IGeoFence> fence_ptr, shared_ptr<ObstacleMap> obs_xy,
+                   shared_ptr<VoxelOccupancyMap> obs_3d = nullptr);
         EvalResult isSafeVelocity(const Vector3r& cur_pos, const Vector3r& velocity, const Quaternionr& quaternion);
         EvalResult isSafeVelocityZ(const Vector3r& cur_pos, float vx, float vy, float z, const Quaternionr& quaternion);
         EvalResult isSafeDestination(const Vector3r& dest, const Vector3r& cur_pos, const Quaternionr& quaternion);
@@ -0,0 +1,131 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef air_VoxelOccupancyMap_hpp
+#define air_VoxelOccupancyMap_hpp
+
+#include <atomic>
+#include <memory>
+#include "common/Common.hpp"
+
+namespace msr
+{
+namespace airlib
+{
+
+    /*
+    VoxelOccupancyMap implements sparse 3D map of obstacles in world (NED) coordinates. Unlike
+    ObstacleMap which only knows about 2D disk around the vehicle, this map can represent overhangs,
+    ceilings and obstacles above or below the vehicle.
+
+    Space is divided in to voxels of voxel_size meters. Voxels are grouped in to blocks of
+    8x8x8 voxels and only blocks that have seen any update are allocated. Each block stores
+    one occupancy bit per voxel packed in 64-bit words, so updates are single atomic fetch_or/fetch_and
+    and queries can skip 64 empty voxels at a time.
+
+    Blocks are kept in open addressing hash table with fixed capacity. Slots are only ever filled
+    (never removed) using compare-and-swap, so queries never take any lock and can run concurrently
+    with any number of updating threads. Each block also carries version counter that is incremented
+    on every change so consumers can cheaply detect whether cached query results are stale.
+
+    If hash table is full (or probe sequence for a block is too long), updates for new blocks are
+    dropped and counted in getDroppedUpdates().
+    */
+    class VoxelOccupancyMap
+    {
+    public:
+        static constexpr int kBlockBits = 3;
+        static constexpr int kBlockSize = 1 << kBlockBits; //voxels per block side
+        static constexpr int kBlockWords = kBlockSize * kBlockSize * kBlockSize / 64;
+
+        //this will be return result of the queries
+        struct ObstacleInfo
+        {
+            bool found = false;
+            //for sweep queries this is distance along the sweep, for closest queries this is euclidean distance
+            float distance = Utils::max<float>();
+            //center of the voxel that was hit
+            Vector3r position = Vector3r::Zero();
+
+            string toString() const
+            {
+                return Utils::stringf("Obs3D: found=%i, distance=%f, position=%s", found, distance, VectorMath::toString(position).c_str());
+            }
+        };
+
+    public:
+        //block_capacity is rounded up to power of 2
+        VoxelOccupancyMap(float voxel_size = 0.25f, uint block_capacity = 1 << 16);
+        ~VoxelOccupancyMap();
+
+        //mark voxel containing point as occupied
+        void insertPoint(const Vector3r& point);
+        //mark all voxels along origin->end as free and voxel containing end as occupied if end_occupied is true
+        void insertRay(const Vector3r& origin, const Vector3r& end, bool end_occupied = true);
+        //mark voxel containing point as free
+        void clearPoint(const Vector3r& point);
+
+        //point_cloud is x0, y0, z0, x1, ... in frame specified by sensor_pose (use zero pose for world frame points)
+        //if clear_free_space is true then voxels between sensor and each point are cleared which is much more expensive
+        void insertPointCloud(const vector<real_T>& point_cloud, const Pose& sensor_pose, bool clear_free_space = false);
+        //depth_planar is row major image of planar depth in meters from camera with given horizontal fov,
+        //only every pixel_stride'th pixel in each direction is used and depths >= max_depth are ignored
+        void insertDepthImage(const vector<float>& depth_planar, int width, int height, float fov_degrees,
+                              const Pose& camera_pose, float max_depth, int pixel_stride = 1);
+        //distance sensor measures along its local x axis, readings outside [min_distance, max_distance) only clear space
+        void insertDistance(float distance, float min_distance, float max_distance, const Pose& sensor_pose);
+
+        //zero out all voxels, allocated blocks are kept and this is safe to call concurrently with queries
+        void clear();
+
+        bool isOccupied(const Vector3r& point) const;
+
+        //find first occupied voxel whose center is within radius of segment from->to, distance is measured along the segment
+        ObstacleInfo sweepSphere(const Vector3r& from, const Vector3r& to, float radius) const;
+        //find occupied voxel closest to center within max_radius
+        ObstacleInfo getClosestObstacle(const Vector3r& center, float max_radius) const;
+
+        //version of block containing point, 0 if block was never allocated
+        uint getBlockVersion(const Vector3r& point) const;
+        //incremented on any change in the map
+        uint getVersion() const;
+
+        float getVoxelSize() const;
+        uint getBlockCount() const;
+        uint getDroppedUpdates() const;
+
+    private:
+        struct Block;
+        typedef int64_t BlockKey;
+
+        struct VoxelIndex
+        {
+            int x, y, z;
+        };
+
+        VoxelIndex toVoxelIndex(const Vector3r& point) const;
+        Vector3r toVoxelCenter(int x, int y, int z) const;
+        static BlockKey toBlockKey(int bx, int by, int bz);
+        static uint hashKey(BlockKey key);
+
+        Block* findBlock(BlockKey key) const;
+        Block* findOrCreateBlock(BlockKey key);
+        void setVoxel(const VoxelIndex& index, bool occupied);
+
+        //calls visitor(x, y, z) for every occupied voxel in inclusive voxel index box
+        template <typename TVisitor>
+        void forEachOccupied(const VoxelIndex& min_index, const VoxelIndex& max_index, TVisitor&& visitor) const;
+
+    private:
+        float voxel_size_;
+        float inv_voxel_size_;
+        uint capacity_mask_;
+        uint max_probes_;
+        std::unique_ptr<std::atomic<Block*>[]> slots_;
+        std::atomic<uint> block_count_;
+        std::atomic<uint> dropped_updates_;
+        std::atomic<uint> version_;
+    };
+}
+} //namespace
+#endif
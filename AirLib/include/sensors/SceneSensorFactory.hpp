@@ -0,0 +1,50 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef msr_airlib_SceneSensorFactory_hpp
+#define msr_airlib_SceneSensorFactory_hpp
+
+#include "SensorFactory.hpp"
+#include "sensors/lidar/LidarBvh.hpp"
+#include <memory>
+
+namespace msr
+{
+namespace airlib
+{
+
+    //creates lidars traced against an in-memory scene, for vehicles running without Unreal
+    class SceneSensorFactory : public SensorFactory
+    {
+    public:
+        typedef common_utils::TaskScheduler TaskScheduler;
+
+        //segmentation_ids maps mesh index of the scene to the id reported by lidars
+        SceneSensorFactory(std::shared_ptr<const SceneBvh> scene, const vector<int>& segmentation_ids = vector<int>(),
+                           TaskScheduler* scheduler = &TaskScheduler::getDefault())
+            : scene_(scene), segmentation_ids_(segmentation_ids), scheduler_(scheduler)
+        {
+        }
+
+        virtual std::shared_ptr<SensorBase> createSensorFromSettings(
+            const AirSimSettings::SensorSetting* sensor_setting) const override
+        {
+            switch (sensor_setting->sensor_type) {
+            case SensorBase::SensorType::Lidar:
+                return std::shared_ptr<LidarBvh>(new LidarBvh(
+                    *static_cast<const AirSimSettings::LidarSetting*>(sensor_setting), scene_, segmentation_ids_, scheduler_));
+            default:
+                return SensorFactory::createSensorFromSettings(sensor_setting);
+            }
+        }
+
+        virtual ~SceneSensorFactory() = default;
+
+    private:
+        std::shared_ptr<const SceneBvh> scene_;
+        vector<int> segmentation_ids_;
+        TaskScheduler* scheduler_;
+    };
+}
+} //namespace
+#endif
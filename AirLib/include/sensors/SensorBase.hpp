@@ -62,6 +62,13 @@ namespace airlib
             return name_;
         }
 
+        //clock time the sensor next produces output at, SensorCollection doesn't update sensors
+        //before their time, 0 means the sensor needs update() on every tick
+        virtual TTimePoint getNextUpdateTime() const
+        {
+            return 0;
+        }
+
         virtual ~SensorBase() = default;
 
     private:
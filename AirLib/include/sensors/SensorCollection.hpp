@@ -5,6 +5,7 @@
 #define msr_airlib_SensorCollection_hpp
 
 #include <unordered_map>
+#include <algorithm>
 #include "sensors/SensorBase.hpp"
 #include "common/UpdatableContainer.hpp"
 #include "common/Common.hpp"
@@ -14,6 +15,13 @@ namespace msr
 namespace airlib
 {
 
+    /*
+    Updates each sensor only on the ticks it is due, as told by its getNextUpdateTime(), instead of
+    every sensor on every physics tick. Sensors that would only find out their interval isn't done
+    yet cost a compare of clock times read once per tick. Due sensors are updated in order of type.
+    All sensors are updated on the first tick after reset or restore so they see the update after
+    reset that UpdatableObject requires and so their next times are fresh.
+*/
     class SensorCollection : public UpdatableObject
     {
     public: //types
@@ -31,6 +39,12 @@ namespace airlib
             else {
                 it->second->insert(sensor);
             }
+
+            //after the sensors of the same type already in
+            const ScheduledSensor scheduled = { sensor, type_int, 0 };
+            const auto by_type = [](const ScheduledSensor& a, const ScheduledSensor& b) { return a.type < b.type; };
+            schedule_.insert(std::upper_bound(schedule_.begin(), schedule_.end(), scheduled, by_type), scheduled);
+            next_update_time_ = 0;
         }
 
         const SensorBase* getByType(SensorBase::SensorType type, uint index = 0) const
@@ -69,23 +83,34 @@ namespace airlib
         void clear()
         {
             sensors_.clear();
+            schedule_.clear();
         }
 
         //*** Start: UpdatableState implementation ***//
         virtual void resetImplementation() override
         {
-            for (auto& pair : sensors_) {
-                pair.second->reset();
-            }
+            for (ScheduledSensor& scheduled : schedule_)
+                scheduled.sensor->reset();
+            updateAllOnNextTick();
         }
 
         virtual void update() override
         {
             UpdatableObject::update();
 
-            for (auto& pair : sensors_) {
-                pair.second->update();
+            const TTimePoint now = clock()->nowNanos();
+            if (now < next_update_time_)
+                return;
+
+            TTimePoint next_update_time = Utils::max<TTimePoint>();
+            for (ScheduledSensor& scheduled : schedule_) {
+                if (now >= scheduled.next_update_time) {
+                    scheduled.sensor->update();
+                    scheduled.next_update_time = scheduled.sensor->getNextUpdateTime();
+                }
+                next_update_time = std::min(next_update_time, scheduled.next_update_time);
             }
+            next_update_time_ = next_update_time;
         }
 
         virtual void reportState(StateReporter& reporter) override
@@ -94,11 +119,53 @@ namespace airlib
                 pair.second->reportState(reporter);
             }
         }
+
+        //by sensor type, so the order doesn't depend on the map
+        virtual void saveState(StateSnapshot& snapshot) const override
+        {
+            for (uint type_int : getSortedTypes())
+                sensors_.at(type_int)->saveState(snapshot);
+        }
+
+        virtual void restoreState(StateSnapshot& snapshot) override
+        {
+            for (uint type_int : getSortedTypes())
+                sensors_.at(type_int)->restoreState(snapshot);
+            updateAllOnNextTick();
+        }
         //*** End: UpdatableState implementation ***//
 
     private:
+        void updateAllOnNextTick()
+        {
+            for (ScheduledSensor& scheduled : schedule_)
+                scheduled.next_update_time = 0;
+            next_update_time_ = 0;
+        }
+
+        vector<uint> getSortedTypes() const
+        {
+            vector<uint> types;
+            for (const auto& pair : sensors_)
+                types.push_back(pair.first);
+            std::sort(types.begin(), types.end());
+            return types;
+        }
+
+    private:
+        struct ScheduledSensor
+        {
+            SensorBasePtr sensor;
+            uint type;
+            TTimePoint next_update_time;
+        };
+
         typedef UpdatableContainer<SensorBasePtr> SensorBaseContainer;
         unordered_map<uint, unique_ptr<SensorBaseContainer>> sensors_;
+        //all sensors by type, with the time each is due next
+        vector<ScheduledSensor> schedule_;
+        //earliest of those, ticks before it update nothing
+        TTimePoint next_update_time_ = 0;
     };
 }
 } //namespace
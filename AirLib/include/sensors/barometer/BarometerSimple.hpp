@@ -66,6 +66,29 @@ namespace airlib
             if (freq_limiter_.isWaitComplete())
                 setOutput(delay_line_.getOutput());
         }
+
+        virtual TTimePoint getNextUpdateTime() const override
+        {
+            return freq_limiter_.getNextUpdateTime();
+        }
+
+        virtual void saveState(StateSnapshot& snapshot) const override
+        {
+            BarometerBase::saveState(snapshot);
+            pressure_factor_.saveState(snapshot);
+            uncorrelated_noise_.saveState(snapshot);
+            freq_limiter_.saveState(snapshot);
+            delay_line_.saveState(snapshot);
+        }
+
+        virtual void restoreState(StateSnapshot& snapshot) override
+        {
+            BarometerBase::restoreState(snapshot);
+            pressure_factor_.restoreState(snapshot);
+            uncorrelated_noise_.restoreState(snapshot);
+            freq_limiter_.restoreState(snapshot);
+            delay_line_.restoreState(snapshot);
+        }
         //*** End: UpdatableState implementation ***//
 
         virtual ~BarometerSimple() = default;
@@ -61,6 +61,27 @@ namespace airlib
             if (freq_limiter_.isWaitComplete())
                 setOutput(delay_line_.getOutput());
         }
+
+        virtual TTimePoint getNextUpdateTime() const override
+        {
+            return freq_limiter_.getNextUpdateTime();
+        }
+
+        virtual void saveState(StateSnapshot& snapshot) const override
+        {
+            DistanceBase::saveState(snapshot);
+            uncorrelated_noise_.saveState(snapshot);
+            freq_limiter_.saveState(snapshot);
+            delay_line_.saveState(snapshot);
+        }
+
+        virtual void restoreState(StateSnapshot& snapshot) override
+        {
+            DistanceBase::restoreState(snapshot);
+            uncorrelated_noise_.restoreState(snapshot);
+            freq_limiter_.restoreState(snapshot);
+            delay_line_.restoreState(snapshot);
+        }
         //*** End: UpdatableState implementation ***//
 
         virtual ~DistanceSimple() = default;
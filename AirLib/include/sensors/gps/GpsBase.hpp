@@ -126,6 +126,17 @@ namespace airlib
             return output_;
         }
 
+        virtual void saveState(StateSnapshot& snapshot) const override
+        {
+            snapshot.write(output_);
+        }
+
+        virtual void restoreState(StateSnapshot& snapshot) override
+        {
+            snapshot.read(output_);
+            snapshot.shiftTimeStamp(output_);
+        }
+
     protected:
         void setOutput(const Output& output)
         {
@@ -65,6 +65,29 @@ namespace airlib
                 setOutput(delay_line_.getOutput());
         }
 
+        virtual TTimePoint getNextUpdateTime() const override
+        {
+            return freq_limiter_.getNextUpdateTime();
+        }
+
+        virtual void saveState(StateSnapshot& snapshot) const override
+        {
+            GpsBase::saveState(snapshot);
+            eph_filter.saveState(snapshot);
+            epv_filter.saveState(snapshot);
+            freq_limiter_.saveState(snapshot);
+            delay_line_.saveState(snapshot);
+        }
+
+        virtual void restoreState(StateSnapshot& snapshot) override
+        {
+            GpsBase::restoreState(snapshot);
+            eph_filter.restoreState(snapshot);
+            epv_filter.restoreState(snapshot);
+            freq_limiter_.restoreState(snapshot);
+            delay_line_.restoreState(snapshot);
+        }
+
         //*** End: UpdatableState implementation ***//
 
         virtual ~GpsSimple() = default;
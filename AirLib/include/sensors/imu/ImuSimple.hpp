@@ -44,6 +44,22 @@ namespace airlib
 
             updateOutput();
         }
+
+        virtual void saveState(StateSnapshot& snapshot) const override
+        {
+            ImuBase::saveState(snapshot);
+            gauss_dist.saveState(snapshot);
+            snapshot.write(state_);
+            snapshot.writeTime(last_time_);
+        }
+
+        virtual void restoreState(StateSnapshot& snapshot) override
+        {
+            ImuBase::restoreState(snapshot);
+            gauss_dist.restoreState(snapshot);
+            snapshot.read(state_);
+            snapshot.readTime(last_time_);
+        }
         //*** End: UpdatableState implementation ***//
 
         virtual ~ImuSimple() = default;
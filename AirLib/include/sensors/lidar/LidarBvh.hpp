@@ -0,0 +1,144 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef msr_airlib_LidarBvh_hpp
+#define msr_airlib_LidarBvh_hpp
+
+#include <cmath>
+#include <memory>
+#include "common/Common.hpp"
+#include "common/common_utils/TaskScheduler.hpp"
+#include "physics/SceneBvh.hpp"
+#include "LidarSimple.hpp"
+
+namespace msr
+{
+namespace airlib
+{
+
+    /*
+        Lidar traced on the CPU against a SceneBvh instead of Unreal line traces, so point clouds
+        can be produced headless and on every TaskScheduler thread.
+
+        Scan pattern follows UnrealLidarSensor: channels evenly spaced from vertical_FOV_upper down
+        to vertical_FOV_lower, points_per_second * delta_time points per tick split over channels,
+        rotation_frequency * 360 * delta_time degrees swept per tick and rays outside the horizontal
+        FOV skipped. Consecutive azimuth steps of one channel leave from the same point in almost
+        the same direction, so they are cast as SceneBvh packets.
+
+        Segmentation id of a point is segmentation_ids[mesh_index] of the mesh it hit, or the mesh
+        index itself when no table is given or the mesh is past its end.
+    */
+    class LidarBvh : public LidarSimple
+    {
+    public:
+        typedef common_utils::TaskScheduler TaskScheduler;
+
+        LidarBvh(const AirSimSettings::LidarSetting& setting, std::shared_ptr<const SceneBvh> scene,
+                 const vector<int>& segmentation_ids = vector<int>(), TaskScheduler* scheduler = &TaskScheduler::getDefault())
+            : LidarSimple(setting), scene_(scene), segmentation_ids_(segmentation_ids), scheduler_(scheduler)
+        {
+            createLasers();
+        }
+
+        virtual ~LidarBvh() = default;
+
+        //azimuth where the next tick starts, degrees
+        real_T getCurrentHorizontalAngle() const
+        {
+            return current_horizontal_angle_;
+        }
+
+    protected:
+        virtual void getPointCloud(const Pose& lidar_pose, const Pose& vehicle_pose,
+                                   TTimeDelta delta_time, vector<real_T>& point_cloud, vector<int>& segmentation_cloud) override
+        {
+            point_cloud.clear();
+            segmentation_cloud.clear();
+
+            const LidarSimpleParams& params = getParams();
+            const uint number_of_lasers = params.number_of_channels;
+            if (number_of_lasers == 0 || !scene_)
+                return;
+
+            //same cap as UnrealLidarSensor so both produce the same scans for the same settings
+            const real_T max_points_in_scan = 1E+5f;
+            const real_T total_points = std::min(std::round(static_cast<real_T>(params.points_per_second * delta_time)), max_points_in_scan);
+            const uint points_per_laser = static_cast<uint>(std::round(total_points / number_of_lasers));
+            if (points_per_laser == 0)
+                return;
+
+            const real_T angle_of_tick = params.horizontal_rotation_frequency * 360.0f * static_cast<real_T>(delta_time);
+            const real_T angle_per_point = angle_of_tick / points_per_laser;
+            const real_T laser_start = std::fmod(360.0f + params.horizontal_FOV_start, 360.0f);
+            const real_T laser_end = std::fmod(360.0f + params.horizontal_FOV_end, 360.0f);
+
+            //composing ray, lidar and vehicle orientations is the same as rotating the lidar frame ray by the sensor pose
+            const Pose sensor_pose = lidar_pose + vehicle_pose;
+            const Matrix3x3r sensor_rotation = sensor_pose.orientation.toRotationMatrix();
+
+            rays_.clear();
+            for (uint laser = 0; laser < number_of_lasers; ++laser) {
+                const real_T vertical_angle = Utils::degreesToRadians(laser_angles_[laser]);
+                for (uint i = 0; i < points_per_laser; ++i) {
+                    const real_T horizontal_angle = std::fmod(current_horizontal_angle_ + angle_per_point * i, 360.0f);
+                    if (!VectorMath::isAngleBetweenAngles(horizontal_angle, laser_start, laser_end))
+                        continue;
+
+                    const Quaternionr ray_q_l = VectorMath::toQuaternion(vertical_angle, 0, Utils::degreesToRadians(horizontal_angle));
+                    const Vector3r direction = sensor_rotation * VectorMath::rotateVector(VectorMath::front(), ray_q_l, true);
+                    rays_.emplace_back(sensor_pose.position, direction.normalized(), params.range);
+                }
+            }
+
+            scene_->castRayPackets(rays_, hits_, scheduler_);
+
+            const bool local_frame = params.data_frame == AirSimSettings::LidarSetting::DataFrame::SensorLocalFrame;
+            for (const SceneBvh::RayHit& hit : hits_) {
+                if (!hit.hit)
+                    continue;
+                const Vector3r point = local_frame ? VectorMath::transformToBodyFrame(hit.point, sensor_pose, true) : hit.point;
+                point_cloud.insert(point_cloud.end(), { point.x(), point.y(), point.z() });
+                segmentation_cloud.push_back(getSegmentationId(hit.mesh_index));
+            }
+
+            current_horizontal_angle_ = std::fmod(current_horizontal_angle_ + angle_of_tick, 360.0f);
+        }
+
+    private:
+        void createLasers()
+        {
+            const LidarSimpleParams& params = getParams();
+            const uint number_of_lasers = params.number_of_channels;
+
+            real_T delta_angle = 0;
+            if (number_of_lasers > 1)
+                delta_angle = (params.vertical_FOV_upper - params.vertical_FOV_lower) / static_cast<real_T>(number_of_lasers - 1);
+
+            laser_angles_.clear();
+            for (uint i = 0; i < number_of_lasers; ++i)
+                laser_angles_.push_back(params.vertical_FOV_upper - static_cast<real_T>(i) * delta_angle);
+        }
+
+        int getSegmentationId(int mesh_index) const
+        {
+            if (mesh_index >= 0 && static_cast<size_t>(mesh_index) < segmentation_ids_.size())
+                return segmentation_ids_[mesh_index];
+            return mesh_index;
+        }
+
+    private:
+        std::shared_ptr<const SceneBvh> scene_;
+        vector<int> segmentation_ids_;
+        TaskScheduler* scheduler_;
+
+        vector<real_T> laser_angles_;
+        real_T current_horizontal_angle_ = 0;
+
+        //reused between ticks
+        vector<SceneBvh::Ray> rays_;
+        vector<SceneBvh::RayHit> hits_;
+    };
+}
+} //namespace
+#endif
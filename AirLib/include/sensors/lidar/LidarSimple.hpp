@@ -8,6 +8,7 @@
 #include "common/Common.hpp"
 #include "LidarSimpleParams.hpp"
 #include "LidarBase.hpp"
+#include "PointCloudFilter.hpp"
 #include "common/DelayLine.hpp"
 #include "common/FrequencyLimiter.hpp"
 
@@ -24,6 +25,7 @@ namespace airlib
         {
             // initialize params
             params_.initializeFromSettings(setting);
+            filter_.setParams(params_.filter);
 
             //initialize frequency limiter
             freq_limiter_.initialize(params_.update_frequency, params_.startup_delay);
@@ -49,6 +51,11 @@ namespace airlib
             }
         }
 
+        virtual TTimePoint getNextUpdateTime() const override
+        {
+            return freq_limiter_.getNextUpdateTime();
+        }
+
         virtual void reportState(StateReporter& reporter) override
         {
             //call base
@@ -96,6 +103,9 @@ namespace airlib
                           point_cloud_,
                           segmentation_cloud_);
 
+            if (params_.filter.isEnabled())
+                filter_.apply(point_cloud_, segmentation_cloud_, lidar_pose, params_.data_frame == AirSimSettings::LidarSetting::DataFrame::SensorLocalFrame);
+
             LidarData output;
             output.point_cloud = point_cloud_;
             output.time_stamp = clock()->nowNanos();
@@ -111,6 +121,7 @@ namespace airlib
         LidarSimpleParams params_;
         vector<real_T> point_cloud_;
         vector<int> segmentation_cloud_;
+        PointCloudFilter filter_;
 
         FrequencyLimiter freq_limiter_;
         TTimePoint last_time_;
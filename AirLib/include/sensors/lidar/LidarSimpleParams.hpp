@@ -6,6 +6,7 @@
 
 #include "common/Common.hpp"
 #include "common/AirSimSettings.hpp"
+#include "PointCloudFilter.hpp"
 
 namespace msr
 {
@@ -43,6 +44,9 @@ namespace airlib
         real_T update_frequency = 10; // Hz
         real_T startup_delay = 0; // sec
 
+        // post processing of each scan before it is published, disabled by default
+        PointCloudFilter::Params filter;
+
         void initializeFromSettings(const AirSimSettings::LidarSetting& settings)
         {
             std::string simmode_name = AirSimSettings::singleton().simmode_name;
@@ -87,6 +91,17 @@ namespace airlib
             horizontal_FOV_start = settings_json.getFloat("HorizontalFOVStart", horizontal_FOV_start);
             horizontal_FOV_end = settings_json.getFloat("HorizontalFOVEnd", horizontal_FOV_end);
 
+            filter.min_range = settings_json.getFloat("MinRange", filter.min_range);
+            filter.max_range = settings_json.getFloat("MaxRange", filter.max_range);
+            filter.horizontal_FOV_start = settings_json.getFloat("CropHorizontalFOVStart", filter.horizontal_FOV_start);
+            filter.horizontal_FOV_end = settings_json.getFloat("CropHorizontalFOVEnd", filter.horizontal_FOV_end);
+            filter.vertical_FOV_upper = settings_json.getFloat("CropVerticalFOVUpper", filter.vertical_FOV_upper);
+            filter.vertical_FOV_lower = settings_json.getFloat("CropVerticalFOVLower", filter.vertical_FOV_lower);
+            filter.voxel_size = settings_json.getFloat("VoxelSize", filter.voxel_size);
+            filter.ground_removal = settings_json.getBool("GroundRemoval", filter.ground_removal);
+            filter.ground_height = settings_json.getFloat("GroundHeight", filter.ground_height);
+            filter.ground_tolerance = settings_json.getFloat("GroundTolerance", filter.ground_tolerance);
+
             relative_pose.position = AirSimSettings::createVectorSetting(settings_json, VectorMath::nanVector());
             auto rotation = AirSimSettings::createRotationSetting(settings_json, AirSimSettings::Rotation::nanRotation());
 
@@ -0,0 +1,382 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef msr_airlib_PointCloudFilter_hpp
+#define msr_airlib_PointCloudFilter_hpp
+
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include "common/Common.hpp"
+
+namespace msr
+{
+namespace airlib
+{
+
+    /*
+        Post processing of raw lidar scans on flat xyz buffers (3 floats per point) with optional
+        parallel segmentation ids (one per point). Steps run in this order:
+            - compaction: drops points with FLT_MAX/NaN/inf coordinates left by ray casting for misses
+            - crop: min/max range and horizontal/vertical FOV window in the sensor frame
+            - ground removal: drops points near the ground plane assumed at ground_height below sensor
+            - voxel grid downsampling: one point per voxel at centroid of its points, segmentation
+              id of the first point that fell in the voxel
+        Compaction, crop and ground removal are done in a single in-place pass. Downsampling uses an
+        open addressing hash grid whose storage is reused between scans so steady state is allocation free.
+    */
+    class PointCloudFilter
+    {
+    public:
+        struct Params
+        {
+            real_T min_range = 0; // meters
+            real_T max_range = Utils::max<real_T>(); // meters
+
+            // crop window in the sensor frame, degrees, NaN disables
+            real_T horizontal_FOV_start = Utils::nan<real_T>();
+            real_T horizontal_FOV_end = Utils::nan<real_T>();
+            real_T vertical_FOV_upper = Utils::nan<real_T>();
+            real_T vertical_FOV_lower = Utils::nan<real_T>();
+
+            real_T voxel_size = 0; // meters, 0 disables downsampling
+
+            bool ground_removal = false;
+            real_T ground_height = 1; // meters from sensor down to ground
+            real_T ground_tolerance = 0.2f; // meters above ground_height still considered ground
+
+            bool isCropEnabled() const
+            {
+                return min_range > 0 || max_range < Utils::max<real_T>() || isHorizontalCropEnabled() || isVerticalCropEnabled();
+            }
+            bool isHorizontalCropEnabled() const
+            {
+                return !std::isnan(horizontal_FOV_start) && !std::isnan(horizontal_FOV_end);
+            }
+            bool isVerticalCropEnabled() const
+            {
+                return !std::isnan(vertical_FOV_upper) || !std::isnan(vertical_FOV_lower);
+            }
+            bool isEnabled() const
+            {
+                return isCropEnabled() || voxel_size > 0 || ground_removal;
+            }
+        };
+
+        struct Stats
+        {
+            size_t input = 0;
+            size_t invalid = 0;
+            size_t cropped = 0;
+            size_t ground = 0;
+            size_t merged = 0;
+            size_t output = 0;
+        };
+
+    public:
+        PointCloudFilter()
+            : PointCloudFilter(Params())
+        {
+        }
+        PointCloudFilter(const Params& params)
+        {
+            setParams(params);
+        }
+
+        void setParams(const Params& params)
+        {
+            if (params.min_range < 0 || params.max_range < params.min_range)
+                throw std::invalid_argument("PointCloudFilter range crop must have 0 <= min_range <= max_range");
+            if (!(params.voxel_size >= 0))
+                throw std::invalid_argument("PointCloudFilter voxel_size can't be negative");
+            params_ = params;
+        }
+        const Params& getParams() const
+        {
+            return params_;
+        }
+        const Stats& getLastStats() const
+        {
+            return stats_;
+        }
+
+        static bool isValidPoint(const real_T* point)
+        {
+            //comparisons are false for NaN so this rejects NaN, inf and FLT_MAX sentinels
+            return std::abs(point[0]) < FLT_MAX && std::abs(point[1]) < FLT_MAX && std::abs(point[2]) < FLT_MAX;
+        }
+
+        /*
+            Removes invalid points in one pass keeping points and segmentation ids paired. Segmentation
+            may be empty; otherwise it must have one entry per point. Returns number of points kept.
+        */
+        static size_t compact(vector<real_T>& point_cloud, vector<int>& segmentation)
+        {
+            const size_t count = checkSizes(point_cloud, segmentation);
+            const bool has_segmentation = segmentation.size() > 0;
+
+            size_t kept = 0;
+            for (size_t i = 0; i < count; ++i) {
+                const real_T* point = &point_cloud[i * 3];
+                if (!isValidPoint(point))
+                    continue;
+                if (kept != i) {
+                    point_cloud[kept * 3] = point[0];
+                    point_cloud[kept * 3 + 1] = point[1];
+                    point_cloud[kept * 3 + 2] = point[2];
+                    if (has_segmentation)
+                        segmentation[kept] = segmentation[i];
+                }
+                ++kept;
+            }
+            resize(point_cloud, segmentation, kept, has_segmentation);
+            return kept;
+        }
+
+        /*
+            Runs all enabled steps in place. sensor_pose is the lidar pose in the frame the points are
+            expressed in; when sensor_local_frame is true the points are already relative to the sensor
+            and only orientation of sensor_pose is used to find the ground. Returns number of points kept.
+        */
+        size_t apply(vector<real_T>& point_cloud, vector<int>& segmentation, const Pose& sensor_pose, bool sensor_local_frame)
+        {
+            const size_t count = checkSizes(point_cloud, segmentation);
+            const bool has_segmentation = segmentation.size() > 0;
+
+            stats_ = Stats();
+            stats_.input = count;
+
+            const bool crop_range = params_.min_range > 0 || params_.max_range < Utils::max<real_T>();
+            const bool crop_horizontal = params_.isHorizontalCropEnabled();
+            const bool crop_vertical = params_.isVerticalCropEnabled();
+            const real_T min_range_sq = params_.min_range * params_.min_range;
+            const real_T max_range_sq = params_.max_range < Utils::max<real_T>() ? params_.max_range * params_.max_range : Utils::max<real_T>();
+            const HorizontalWindow horizontal(params_.horizontal_FOV_start, params_.horizontal_FOV_end);
+            const VerticalWindow vertical(params_.vertical_FOV_upper, params_.vertical_FOV_lower);
+            const real_T ground_threshold = params_.ground_height - params_.ground_tolerance;
+
+            //rotation from sensor to the frame of points; transpose takes offsets back into sensor frame
+            const Matrix3x3r rotation = sensor_pose.orientation.toRotationMatrix();
+            const Matrix3x3r to_sensor = rotation.transpose();
+            const Vector3r origin = sensor_local_frame ? Vector3r(Vector3r::Zero()) : sensor_pose.position;
+
+            size_t kept = 0;
+            for (size_t i = 0; i < count; ++i) {
+                const real_T* point = &point_cloud[i * 3];
+                if (!isValidPoint(point)) {
+                    ++stats_.invalid;
+                    continue;
+                }
+
+                const Vector3r offset(point[0] - origin.x(), point[1] - origin.y(), point[2] - origin.z());
+                if (crop_range) {
+                    const real_T distance_sq = offset.squaredNorm();
+                    if (distance_sq < min_range_sq || distance_sq > max_range_sq) {
+                        ++stats_.cropped;
+                        continue;
+                    }
+                }
+                if (crop_horizontal || crop_vertical) {
+                    const Vector3r local = sensor_local_frame ? offset : Vector3r(to_sensor * offset);
+                    if ((crop_horizontal && !horizontal.contains(local)) || (crop_vertical && !vertical.contains(local))) {
+                        ++stats_.cropped;
+                        continue;
+                    }
+                }
+                if (params_.ground_removal) {
+                    //distance below sensor along gravity
+                    const real_T depth = sensor_local_frame ? rotation.row(2).dot(offset) : offset.z();
+                    if (depth >= ground_threshold) {
+                        ++stats_.ground;
+                        continue;
+                    }
+                }
+
+                if (kept != i) {
+                    point_cloud[kept * 3] = point[0];
+                    point_cloud[kept * 3 + 1] = point[1];
+                    point_cloud[kept * 3 + 2] = point[2];
+                    if (has_segmentation)
+                        segmentation[kept] = segmentation[i];
+                }
+                ++kept;
+            }
+
+            if (params_.voxel_size > 0)
+                kept = downsample(point_cloud, segmentation, kept, has_segmentation);
+            else
+                resize(point_cloud, segmentation, kept, has_segmentation);
+
+            stats_.output = kept;
+            return kept;
+        }
+
+    private:
+        static constexpr uint64_t kEmptyKey = ~static_cast<uint64_t>(0);
+        static constexpr int kKeyBits = 21;
+
+        static size_t checkSizes(const vector<real_T>& point_cloud, const vector<int>& segmentation)
+        {
+            if (point_cloud.size() % 3 != 0)
+                throw std::invalid_argument("Point cloud size must be multiple of 3");
+            const size_t count = point_cloud.size() / 3;
+            if (segmentation.size() != 0 && segmentation.size() != count)
+                throw std::invalid_argument("Segmentation must be empty or have one entry per point");
+            return count;
+        }
+
+        static void resize(vector<real_T>& point_cloud, vector<int>& segmentation, size_t count, bool has_segmentation)
+        {
+            point_cloud.resize(count * 3);
+            if (has_segmentation)
+                segmentation.resize(count);
+        }
+
+        static real_T normalizeAngle(real_T degrees)
+        {
+            const real_T angle = std::fmod(degrees, 360.0f);
+            return angle < 0 ? angle + 360 : angle;
+        }
+
+        /*
+            Azimuth window from start going counter clockwise (towards +y) to end, same semantics as
+            VectorMath::isAngleBetweenAngles. Tested with cross products of the edge directions instead
+            of atan2 per point.
+        */
+        struct HorizontalWindow
+        {
+            real_T start_x, start_y, end_x, end_y;
+            bool full, reflex;
+
+            HorizontalWindow(real_T start, real_T end)
+            {
+                start = normalizeAngle(start);
+                end = normalizeAngle(end);
+                const real_T span = start < end ? end - start : end + 360 - start;
+                full = !(start < end) && span >= 360;
+                reflex = span > 180;
+                start_x = std::cos(Utils::degreesToRadians(start));
+                start_y = std::sin(Utils::degreesToRadians(start));
+                end_x = std::cos(Utils::degreesToRadians(end));
+                end_y = std::sin(Utils::degreesToRadians(end));
+            }
+
+            bool contains(const Vector3r& point) const
+            {
+                if (full)
+                    return true;
+                const real_T from_start = start_x * point.y() - start_y * point.x();
+                const real_T to_end = point.x() * end_y - point.y() * end_x;
+                //windows wider than 180 deg are the complement of the narrow window from end to start
+                if (reflex)
+                    return !(from_start < 0 && to_end < 0);
+                return from_start >= 0 && to_end >= 0;
+            }
+        };
+
+        //elevation window, NED so up is -z, matching pitch of lidar lasers
+        struct VerticalWindow
+        {
+            real_T upper_slope, lower_slope;
+            bool check_upper, check_lower;
+
+            VerticalWindow(real_T upper, real_T lower)
+            {
+                check_upper = !std::isnan(upper) && upper < 90;
+                check_lower = !std::isnan(lower) && lower > -90;
+                upper_slope = check_upper ? std::tan(Utils::degreesToRadians(std::max(upper, -89.99f))) : 0;
+                lower_slope = check_lower ? std::tan(Utils::degreesToRadians(std::min(lower, 89.99f))) : 0;
+            }
+
+            bool contains(const Vector3r& point) const
+            {
+                const real_T up = -point.z();
+                const real_T horizontal = std::sqrt(point.x() * point.x() + point.y() * point.y());
+                return !(check_upper && up > upper_slope * horizontal) && !(check_lower && up < lower_slope * horizontal);
+            }
+        };
+
+        //voxel coordinates wrap every 2^21 voxels per axis, far beyond any lidar range
+        static uint64_t voxelKey(const real_T* point, real_T inv_size)
+        {
+            static constexpr uint64_t mask = (static_cast<uint64_t>(1) << kKeyBits) - 1;
+            const uint64_t x = static_cast<uint64_t>(static_cast<int64_t>(std::floor(point[0] * inv_size))) & mask;
+            const uint64_t y = static_cast<uint64_t>(static_cast<int64_t>(std::floor(point[1] * inv_size))) & mask;
+            const uint64_t z = static_cast<uint64_t>(static_cast<int64_t>(std::floor(point[2] * inv_size))) & mask;
+            return x | (y << kKeyBits) | (z << (2 * kKeyBits));
+        }
+
+        //fibonacci hashing, keeps top bits of the product
+        static size_t hashKey(uint64_t key, int bits)
+        {
+            return static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> (64 - bits));
+        }
+
+        size_t downsample(vector<real_T>& point_cloud, vector<int>& segmentation, size_t count, bool has_segmentation)
+        {
+            //at most half full so probe sequences stay short
+            int bits = 4;
+            while ((static_cast<size_t>(1) << bits) < count * 2)
+                ++bits;
+            const size_t capacity = static_cast<size_t>(1) << bits;
+            const size_t mask = capacity - 1;
+            keys_.assign(capacity, static_cast<uint64_t>(kEmptyKey));
+            slots_.resize(capacity);
+            sums_.resize(count * 3);
+            counts_.resize(count);
+
+            const real_T inv_size = 1 / params_.voxel_size;
+            size_t voxels = 0;
+            for (size_t i = 0; i < count; ++i) {
+                const real_T* point = &point_cloud[i * 3];
+                const uint64_t key = voxelKey(point, inv_size);
+
+                size_t index = hashKey(key, bits);
+                while (keys_[index] != kEmptyKey && keys_[index] != key)
+                    index = (index + 1) & mask;
+
+                uint32_t voxel;
+                if (keys_[index] == kEmptyKey) {
+                    keys_[index] = key;
+                    voxel = static_cast<uint32_t>(voxels++);
+                    slots_[index] = voxel;
+                    sums_[voxel * 3] = sums_[voxel * 3 + 1] = sums_[voxel * 3 + 2] = 0;
+                    counts_[voxel] = 0;
+                    //voxel <= i and entries before i are already consumed, so in place write is safe
+                    if (has_segmentation)
+                        segmentation[voxel] = segmentation[i];
+                }
+                else
+                    voxel = slots_[index];
+
+                sums_[voxel * 3] += point[0];
+                sums_[voxel * 3 + 1] += point[1];
+                sums_[voxel * 3 + 2] += point[2];
+                ++counts_[voxel];
+            }
+
+            for (size_t voxel = 0; voxel < voxels; ++voxel) {
+                const double inv_count = 1.0 / counts_[voxel];
+                point_cloud[voxel * 3] = static_cast<real_T>(sums_[voxel * 3] * inv_count);
+                point_cloud[voxel * 3 + 1] = static_cast<real_T>(sums_[voxel * 3 + 1] * inv_count);
+                point_cloud[voxel * 3 + 2] = static_cast<real_T>(sums_[voxel * 3 + 2] * inv_count);
+            }
+
+            stats_.merged = count - voxels;
+            resize(point_cloud, segmentation, voxels, has_segmentation);
+            return voxels;
+        }
+
+    private:
+        Params params_;
+        Stats stats_;
+
+        //hash grid storage reused between scans
+        vector<uint64_t> keys_;
+        vector<uint32_t> slots_;
+        vector<double> sums_;
+        vector<uint32_t> counts_;
+    };
+}
+} //namespace
+#endif
@@ -25,6 +25,19 @@ namespace airlib
             TTimePoint time_stamp;
             Vector3r magnetic_field_body; //in Gauss
             vector<real_T> magnetic_field_covariance; //9 elements 3x3 matrix
+
+            void saveState(StateSnapshot& snapshot) const
+            {
+                snapshot.writeTime(time_stamp);
+                snapshot.write(magnetic_field_body);
+                snapshot.write(magnetic_field_covariance);
+            }
+            void restoreState(StateSnapshot& snapshot)
+            {
+                snapshot.readTime(time_stamp);
+                snapshot.read(magnetic_field_body);
+                snapshot.read(magnetic_field_covariance);
+            }
         };
 
     public:
@@ -41,6 +54,16 @@ namespace airlib
             return output_;
         }
 
+        virtual void saveState(StateSnapshot& snapshot) const override
+        {
+            snapshot.write(output_);
+        }
+
+        virtual void restoreState(StateSnapshot& snapshot) override
+        {
+            snapshot.read(output_);
+        }
+
     protected:
         void setOutput(const Output& output)
         {
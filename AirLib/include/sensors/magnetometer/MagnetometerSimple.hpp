@@ -62,6 +62,29 @@ namespace airlib
             if (freq_limiter_.isWaitComplete())
                 setOutput(delay_line_.getOutput());
         }
+
+        virtual TTimePoint getNextUpdateTime() const override
+        {
+            return freq_limiter_.getNextUpdateTime();
+        }
+
+        virtual void saveState(StateSnapshot& snapshot) const override
+        {
+            MagnetometerBase::saveState(snapshot);
+            noise_vec_.saveState(snapshot);
+            snapshot.write(magnetic_field_true_);
+            freq_limiter_.saveState(snapshot);
+            delay_line_.saveState(snapshot);
+        }
+
+        virtual void restoreState(StateSnapshot& snapshot) override
+        {
+            MagnetometerBase::restoreState(snapshot);
+            noise_vec_.restoreState(snapshot);
+            snapshot.read(magnetic_field_true_);
+            freq_limiter_.restoreState(snapshot);
+            delay_line_.restoreState(snapshot);
+        }
         //*** End: UpdatableObject implementation ***//
 
         virtual ~MagnetometerSimple() = default;
@@ -0,0 +1,403 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef msr_airlib_CarPhysicsBody_hpp
+#define msr_airlib_CarPhysicsBody_hpp
+
+#include <cmath>
+#include "common/Common.hpp"
+#include "common/CommonStructs.hpp"
+#include "common/FirstOrderFilter.hpp"
+#include "physics/PhysicsBody.hpp"
+#include "vehicles/car/api/CarApiBase.hpp"
+#include "CarPhysicsParams.hpp"
+
+namespace msr
+{
+namespace airlib
+{
+
+    /*
+        Car dynamics in AirLib, so cars can be simulated by PhysicsWorld and FastPhysicsEngine without
+        Unreal's PhysX vehicle movement, headless and faster than real time.
+
+        The car is a single track (bicycle) model: the front and rear axles are wrench vertices with
+        tire forces from the Pacejka magic formula at their slip angle, limited together with the
+        drive and brake force to the friction circle of the axle's load. Load moves between the axles
+        with longitudinal acceleration. Slip angles are taken against at least min_slip_speed, which
+        keeps the model stable at any step size and makes it a kinematic bicycle at walking pace.
+        Drive force comes from an engine torque curve through an automatic or manual gearbox, and
+        aerodynamic drag from drag vertices like other bodies.
+
+        Controls are read from CarApiBase::getCarControls() and the resulting speed, gear and rpm are
+        given to CarApiBase::updateCarState() every step, as the PhysX car pawn does.
+        Ground is flat at the height the car was reset at: the car stays level on it, only moving in
+        x, y and yaw.
+    */
+    class CarPhysicsBody : public PhysicsBody
+    {
+    public:
+        //state of the drivetrain and tires after the last step
+        struct Output
+        {
+            real_T speed = 0; //forward, m/s
+            int gear = 0; //-1 reverse, 0 neutral, 1 to n forward
+            real_T rpm = 0;
+            real_T steering_angle = 0; //front wheels, radians
+            real_T front_slip_angle = 0, rear_slip_angle = 0;
+            real_T front_load = 0, rear_load = 0; //N
+        };
+
+    public:
+        CarPhysicsBody(const CarPhysicsParams& params, CarApiBase* vehicle_api,
+                       Kinematics* kinematics, Environment* environment)
+            : params_(params), vehicle_api_(vehicle_api)
+        {
+            setName("CarPhysicsBody");
+            vehicle_api_->setParent(this);
+            initialize(kinematics, environment);
+        }
+
+        //*** Start: UpdatableState implementation ***//
+        virtual void resetImplementation() override
+        {
+            //reset axles, kinematics and environment
+            PhysicsBody::resetImplementation();
+
+            steering_filter_.reset();
+            output_ = Output();
+            output_.rpm = params_.idle_rpm;
+            updateCarState();
+        }
+
+        virtual void update() override
+        {
+            //apply forces computed at the end of the last step to axles
+            PhysicsBody::update();
+
+            steering_filter_.update();
+        }
+
+        virtual void reportState(StateReporter& reporter) override
+        {
+            //call base
+            PhysicsBody::reportState(reporter);
+
+            reporter.writeValue("Speed", output_.speed);
+            reporter.writeValue("Gear", output_.gear);
+            reporter.writeValue("RPM", output_.rpm);
+            reporter.writeValue("Steering", output_.steering_angle);
+            reporter.writeValue("Slip F", output_.front_slip_angle);
+            reporter.writeValue("Slip R", output_.rear_slip_angle);
+        }
+
+        virtual void saveState(StateSnapshot& snapshot) const override
+        {
+            PhysicsBody::saveState(snapshot);
+            vehicle_api_->saveState(snapshot);
+            snapshot.write(steering_filter_);
+            snapshot.write(output_);
+        }
+
+        virtual void restoreState(StateSnapshot& snapshot) override
+        {
+            PhysicsBody::restoreState(snapshot);
+            vehicle_api_->restoreState(snapshot);
+            snapshot.read(steering_filter_);
+            snapshot.read(output_);
+        }
+        //*** End: UpdatableState implementation ***//
+
+        //Fast Physics engine calls this method to set next kinematics
+        virtual void updateKinematics(const Kinematics::State& state) override
+        {
+            PhysicsBody::updateKinematics(constrainToGround(state));
+
+            updateApiAndForces();
+        }
+
+        //External Physics engine calls this method to keep physics bodies updated
+        virtual void updateKinematics() override
+        {
+            PhysicsBody::updateKinematics();
+
+            updateApiAndForces();
+        }
+
+        //physics body interface
+        virtual uint wrenchVertexCount() const override
+        {
+            return 2;
+        }
+        virtual PhysicsBodyVertex& getWrenchVertex(uint index) override
+        {
+            return index == 0 ? front_axle_ : rear_axle_;
+        }
+        virtual const PhysicsBodyVertex& getWrenchVertex(uint index) const override
+        {
+            return index == 0 ? front_axle_ : rear_axle_;
+        }
+
+        virtual uint dragVertexCount() const override
+        {
+            return static_cast<uint>(drag_faces_.size());
+        }
+        virtual PhysicsBodyVertex& getDragVertex(uint index) override
+        {
+            return drag_faces_.at(index);
+        }
+        virtual const PhysicsBodyVertex& getDragVertex(uint index) const override
+        {
+            return drag_faces_.at(index);
+        }
+
+        virtual real_T getRestitution() const override
+        {
+            return params_.restitution;
+        }
+        virtual real_T getFriction() const override
+        {
+            return params_.friction;
+        }
+
+        const CarPhysicsParams& getParams() const
+        {
+            return params_;
+        }
+        const Output& getOutput() const
+        {
+            return output_;
+        }
+
+        virtual ~CarPhysicsBody() = default;
+
+    private: //types
+        //axle whose force in body frame is set by the car before each step
+        class Axle : public PhysicsBodyVertex
+        {
+        public:
+            void setForce(const Vector3r& force)
+            {
+                force_ = force;
+            }
+
+            virtual void resetImplementation() override
+            {
+                PhysicsBodyVertex::resetImplementation();
+                force_ = Vector3r::Zero();
+            }
+
+            virtual void saveState(StateSnapshot& snapshot) const override
+            {
+                PhysicsBodyVertex::saveState(snapshot);
+                snapshot.write(force_);
+            }
+
+            virtual void restoreState(StateSnapshot& snapshot) override
+            {
+                PhysicsBodyVertex::restoreState(snapshot);
+                snapshot.read(force_);
+            }
+
+        protected:
+            virtual void setWrench(Wrench& wrench) override
+            {
+                wrench.force = force_;
+                wrench.torque = Vector3r::Zero();
+            }
+
+        private:
+            Vector3r force_ = Vector3r::Zero();
+        };
+
+        //longitudinal and lateral force of an axle in its wheels' frame
+        struct AxleForce
+        {
+            real_T longitudinal = 0;
+            real_T lateral = 0;
+            real_T slip_angle = 0;
+        };
+
+        //below this speed brakes and rolling resistance fade out instead of pushing the car back
+        static constexpr real_T kStopSpeed = 0.5f;
+
+    private: //methods
+        void updateApiAndForces()
+        {
+            //sensors see the new kinematics
+            vehicle_api_->update();
+
+            updateForces();
+            updateCarState();
+        }
+
+        void initialize(Kinematics* kinematics, Environment* environment)
+        {
+            PhysicsBody::initialize(params_.mass, params_.inertia, kinematics, environment);
+
+            //at the height of the center of gravity so tire forces only turn the car around z
+            front_axle_.initialize(Vector3r(params_.cg_to_front_axle, 0, 0), Vector3r(1, 0, 0));
+            rear_axle_.initialize(Vector3r(-params_.cg_to_rear_axle, 0, 0), Vector3r(1, 0, 0));
+            createDragVertices();
+
+            steering_filter_.initialize(params_.steering_filter_tc, 0, 0);
+        }
+
+        void createDragVertices()
+        {
+            const Vector3r& box = params_.body_box;
+            const real_T front_back_factor = box.y() * box.z() * params_.drag_coefficient / 2;
+            //sides are not streamlined
+            const real_T left_right_factor = box.x() * box.z() / 2;
+
+            drag_faces_.clear();
+            drag_faces_.emplace_back(Vector3r(box.x() / 2, 0, 0), Vector3r(1, 0, 0), front_back_factor);
+            drag_faces_.emplace_back(Vector3r(-box.x() / 2, 0, 0), Vector3r(-1, 0, 0), front_back_factor);
+            drag_faces_.emplace_back(Vector3r(0, box.y() / 2, 0), Vector3r(0, 1, 0), left_right_factor);
+            drag_faces_.emplace_back(Vector3r(0, -box.y() / 2, 0), Vector3r(0, -1, 0), left_right_factor);
+        }
+
+        //keeps the car on flat ground at its reset height and level with it
+        Kinematics::State constrainToGround(const Kinematics::State& state) const
+        {
+            Kinematics::State next = state;
+            next.pose.position.z() = getInitialKinematics().pose.position.z();
+            next.twist.linear.z() = 0;
+            next.accelerations.linear.z() = 0;
+
+            next.pose.orientation.x() = 0;
+            next.pose.orientation.y() = 0;
+            next.pose.orientation.normalize();
+            next.twist.angular.x() = next.twist.angular.y() = 0;
+            next.accelerations.angular.x() = next.accelerations.angular.y() = 0;
+            return next;
+        }
+
+        void updateForces()
+        {
+            const CarApiBase::CarControls& controls = vehicle_api_->getCarControls();
+            const Kinematics::State& state = getKinematics();
+            const Vector3r velocity = VectorMath::transformToBodyFrame(state.twist.linear, state.pose.orientation);
+            const Vector3r acceleration = VectorMath::transformToBodyFrame(state.accelerations.linear, state.pose.orientation);
+            const real_T yaw_rate = state.twist.angular.z();
+
+            steering_filter_.setInput(Utils::clip(controls.steering, -1.0f, 1.0f));
+            const real_T steering_angle = steering_filter_.getOutput() * params_.max_steering_angle;
+
+            output_.speed = velocity.x();
+            updateGear(controls);
+            const real_T drive_force = getDriveForce(controls);
+
+            //static load moved to the rear under acceleration and to the front under braking
+            const real_T weight = getMass() * getEnvironment().getState().gravity.z();
+            const real_T wheelbase = params_.getWheelbase();
+            const real_T transfer = getMass() * acceleration.x() * params_.cg_height / wheelbase;
+            output_.front_load = std::max(0.0f, weight * params_.cg_to_rear_axle / wheelbase - transfer);
+            output_.rear_load = std::max(0.0f, weight * params_.cg_to_front_axle / wheelbase + transfer);
+
+            const real_T brake = Utils::clip(controls.brake, 0.0f, 1.0f) * params_.max_brake_force;
+            const real_T front_brake = brake * params_.front_brake_bias;
+            const real_T rear_brake = brake * (1 - params_.front_brake_bias) + (controls.handbrake ? params_.handbrake_force : 0);
+
+            //velocity of each axle is that of the body plus yaw rate times the distance from the center of gravity
+            const AxleForce front = getAxleForce(velocity.x(), velocity.y() + yaw_rate * params_.cg_to_front_axle, steering_angle,
+                                                 0, front_brake, output_.front_load, params_.front_tire);
+            const AxleForce rear = getAxleForce(velocity.x(), velocity.y() - yaw_rate * params_.cg_to_rear_axle, 0,
+                                                drive_force, rear_brake, output_.rear_load, params_.rear_tire);
+
+            const real_T cos_steering = std::cos(steering_angle), sin_steering = std::sin(steering_angle);
+            front_axle_.setForce(Vector3r(front.longitudinal * cos_steering - front.lateral * sin_steering,
+                                          front.longitudinal * sin_steering + front.lateral * cos_steering, 0));
+            rear_axle_.setForce(Vector3r(rear.longitudinal, rear.lateral, 0));
+
+            output_.steering_angle = steering_angle;
+            output_.front_slip_angle = front.slip_angle;
+            output_.rear_slip_angle = rear.slip_angle;
+        }
+
+        //forces of an axle from its velocity in body frame, steering it by steering_angle
+        AxleForce getAxleForce(real_T velocity_x, real_T velocity_y, real_T steering_angle,
+                               real_T drive_force, real_T brake_force, real_T load, const CarTireParams& tire) const
+        {
+            const real_T cos_steering = std::cos(steering_angle), sin_steering = std::sin(steering_angle);
+            const real_T wheel_longitudinal = velocity_x * cos_steering + velocity_y * sin_steering;
+            const real_T wheel_lateral = -velocity_x * sin_steering + velocity_y * cos_steering;
+
+            AxleForce force;
+            force.slip_angle = std::atan2(wheel_lateral, std::max(std::abs(wheel_longitudinal), params_.min_slip_speed));
+
+            //brakes and rolling resistance oppose the wheels rolling and fade out as they stop
+            const real_T rolling = std::tanh(wheel_longitudinal / kStopSpeed);
+            force.longitudinal = drive_force - (brake_force + params_.rolling_resistance * load) * rolling;
+            force.lateral = -tire.getForce(force.slip_angle, load);
+
+            //friction circle, longitudinal force takes what it needs first
+            const real_T max_force = tire.friction * load;
+            force.longitudinal = Utils::clip(force.longitudinal, -max_force, max_force);
+            const real_T max_lateral = std::sqrt(std::max(0.0f, max_force * max_force - force.longitudinal * force.longitudinal));
+            force.lateral = Utils::clip(force.lateral, -max_lateral, max_lateral);
+            return force;
+        }
+
+        void updateGear(const CarApiBase::CarControls& controls)
+        {
+            const int gear_count = static_cast<int>(params_.getGearCount());
+            if (controls.is_manual_gear) {
+                output_.gear = Utils::clip(controls.manual_gear, -1, gear_count);
+                return;
+            }
+
+            //negative throttle drives backwards, as with PhysX
+            if (controls.throttle < 0)
+                output_.gear = -1;
+            else if (controls.throttle > 0 && output_.gear <= 0)
+                output_.gear = 1;
+
+            if (output_.gear >= 1) {
+                const real_T rpm = getWheelRpm() * params_.getTotalRatio(output_.gear);
+                if (rpm > params_.shift_up_rpm && output_.gear < gear_count)
+                    ++output_.gear;
+                else if (rpm < params_.shift_down_rpm && output_.gear > 1)
+                    --output_.gear;
+            }
+        }
+
+        //sets the engine rpm and returns the force of the driven wheels
+        real_T getDriveForce(const CarApiBase::CarControls& controls)
+        {
+            const real_T throttle = std::min(std::abs(controls.throttle), 1.0f);
+            const real_T ratio = params_.getTotalRatio(output_.gear);
+            if (ratio == 0) {
+                output_.rpm = params_.idle_rpm + throttle * (params_.max_rpm - params_.idle_rpm);
+                return 0;
+            }
+
+            output_.rpm = Utils::clip(getWheelRpm() * ratio, params_.idle_rpm, params_.max_rpm);
+            const real_T force = throttle * params_.getEngineTorque(output_.rpm) * ratio * params_.drivetrain_efficiency / params_.wheel_radius;
+            return output_.gear < 0 ? -force : force;
+        }
+
+        real_T getWheelRpm() const
+        {
+            return std::abs(output_.speed) / params_.wheel_radius * 60 / (2 * M_PIf);
+        }
+
+        void updateCarState()
+        {
+            const CarApiBase::CarControls& controls = vehicle_api_->getCarControls();
+            vehicle_api_->updateCarState(CarApiBase::CarState(output_.speed, output_.gear, output_.rpm, params_.max_rpm,
+                                                              controls.handbrake, getKinematics(), clock()->nowNanos()));
+        }
+
+    private: //fields
+        CarPhysicsParams params_;
+        CarApiBase* vehicle_api_;
+
+        Axle front_axle_, rear_axle_;
+        vector<PhysicsBodyVertex> drag_faces_;
+        FirstOrderFilter<real_T> steering_filter_;
+        Output output_;
+    };
+}
+} //namespace
+#endif
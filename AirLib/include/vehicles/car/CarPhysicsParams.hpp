@@ -0,0 +1,125 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef msr_airlib_CarPhysicsParams_hpp
+#define msr_airlib_CarPhysicsParams_hpp
+
+#include <utility>
+#include "common/Common.hpp"
+
+namespace msr
+{
+namespace airlib
+{
+
+    //Pacejka magic formula F = D * sin(C * atan(B * x - E * (B * x - atan(B * x)))) with D = friction * load,
+    //defaults are typical for a road tire on dry asphalt
+    struct CarTireParams
+    {
+        real_T stiffness = 10.0f; //B
+        real_T shape = 1.9f; //C
+        real_T curvature = 0.97f; //E
+        real_T friction = 1.0f; //peak force per unit of load
+
+        real_T getForce(real_T slip, real_T load) const
+        {
+            const real_T bx = stiffness * slip;
+            return friction * load * std::sin(shape * std::atan(bx - curvature * (bx - std::atan(bx))));
+        }
+    };
+
+    //defaults are for a mid-size rear wheel drive sedan
+    struct CarPhysicsParams
+    {
+        real_T mass = 1500.0f; //kg
+        Vector3r body_box = Vector3r(4.5f, 1.8f, 1.4f); //length, width, height in meters
+        Matrix3x3r inertia; //computed from mass and body_box by calculateInertia()
+
+        real_T cg_to_front_axle = 1.2f; //meters
+        real_T cg_to_rear_axle = 1.5f;
+        real_T cg_height = 0.5f; //for load transfer between axles
+
+        real_T max_steering_angle = 0.6f; //front wheel angle at full steering, radians
+        real_T steering_filter_tc = 0.1f; //time constant for the steering to follow its input
+        real_T min_slip_speed = 3.0f; //slip angles are taken against at least this speed, see CarPhysicsBody
+
+        CarTireParams front_tire;
+        //more grip at the rear makes the car understeer when the tires saturate instead of spinning
+        CarTireParams rear_tire{ 10.0f, 1.9f, 0.97f, 1.1f };
+        real_T wheel_radius = 0.33f;
+
+        //engine torque in N.m at rpm, linearly interpolated between points in increasing rpm
+        vector<std::pair<real_T, real_T>> torque_curve = { { 1000.0f, 350.0f }, { 4000.0f, 450.0f }, { 6500.0f, 380.0f } };
+        real_T idle_rpm = 1000.0f;
+        real_T max_rpm = 6500.0f;
+
+        vector<real_T> gear_ratios = { 3.6f, 2.2f, 1.5f, 1.1f, 0.9f }; //forward gears 1 to n
+        real_T reverse_gear_ratio = 3.4f;
+        real_T final_drive_ratio = 3.9f;
+        real_T drivetrain_efficiency = 0.9f;
+        real_T shift_up_rpm = 5500.0f; //automatic gearbox
+        real_T shift_down_rpm = 2500.0f;
+
+        real_T max_brake_force = 12000.0f; //N for both axles at full brake
+        real_T front_brake_bias = 0.6f;
+        real_T handbrake_force = 6000.0f; //N on the rear axle
+
+        real_T drag_coefficient = 0.3f;
+        real_T rolling_resistance = 0.015f; //per unit of load
+
+        real_T restitution = 0.1f;
+        real_T friction = 0.7f;
+
+        CarPhysicsParams()
+        {
+            calculateInertia();
+        }
+
+        //inertia of a solid box of body_box, call after changing mass or body_box
+        void calculateInertia()
+        {
+            const real_T x2 = body_box.x() * body_box.x(), y2 = body_box.y() * body_box.y(), z2 = body_box.z() * body_box.z();
+            inertia = Matrix3x3r::Zero();
+            inertia(0, 0) = mass * (y2 + z2) / 12;
+            inertia(1, 1) = mass * (x2 + z2) / 12;
+            inertia(2, 2) = mass * (x2 + y2) / 12;
+        }
+
+        real_T getWheelbase() const
+        {
+            return cg_to_front_axle + cg_to_rear_axle;
+        }
+
+        uint getGearCount() const
+        {
+            return static_cast<uint>(gear_ratios.size());
+        }
+
+        //ratio from engine to wheels for gear -1 (reverse) to n, 0 for neutral
+        real_T getTotalRatio(int gear) const
+        {
+            if (gear < 0)
+                return reverse_gear_ratio * final_drive_ratio;
+            if (gear == 0 || gear > static_cast<int>(gear_ratios.size()))
+                return 0;
+            return gear_ratios[gear - 1] * final_drive_ratio;
+        }
+
+        real_T getEngineTorque(real_T rpm) const
+        {
+            if (torque_curve.empty() || rpm >= max_rpm)
+                return 0;
+            if (rpm <= torque_curve.front().first)
+                return torque_curve.front().second;
+            for (size_t i = 1; i < torque_curve.size(); ++i) {
+                if (rpm <= torque_curve[i].first) {
+                    const auto &a = torque_curve[i - 1], &b = torque_curve[i];
+                    return a.second + (b.second - a.second) * (rpm - a.first) / (b.first - a.first);
+                }
+            }
+            return torque_curve.back().second;
+        }
+    };
+}
+} //namespace
+#endif
@@ -107,6 +107,16 @@ namespace airlib
             getSensors().reportState(reporter);
         }
 
+        virtual void saveState(StateSnapshot& snapshot) const override
+        {
+            getSensors().saveState(snapshot);
+        }
+
+        virtual void restoreState(StateSnapshot& snapshot) override
+        {
+            getSensors().restoreState(snapshot);
+        }
+
         // sensor helpers
         virtual const SensorCollection& getSensors() const override
         {
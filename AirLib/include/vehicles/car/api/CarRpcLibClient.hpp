@@ -20,6 +20,7 @@ namespace airlib
     {
     public:
         CarRpcLibClient(const string& ip_address = "localhost", uint16_t port = RpcLibPort, float timeout_sec = 60);
+        explicit CarRpcLibClient(RpcLibConnectionPool& connection_pool);
 
         void setCarControls(const CarApiBase::CarControls& controls, const std::string& vehicle_name = "");
         CarApiBase::CarState getCarState(const std::string& vehicle_name = "");
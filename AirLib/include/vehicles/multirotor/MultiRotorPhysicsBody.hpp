@@ -64,6 +64,21 @@ namespace airlib
                 rotors_.at(rotor_index).reportState(reporter);
             }
         }
+
+        //rotors and drag faces are saved as the body's vertices
+        virtual void saveState(StateSnapshot& snapshot) const override
+        {
+            PhysicsBody::saveState(snapshot);
+            params_->getSensors().saveState(snapshot);
+            vehicle_api_->saveState(snapshot);
+        }
+
+        virtual void restoreState(StateSnapshot& snapshot) override
+        {
+            PhysicsBody::restoreState(snapshot);
+            params_->getSensors().restoreState(snapshot);
+            vehicle_api_->restoreState(snapshot);
+        }
         //*** End: UpdatableState implementation ***//
 
         //Fast Physics engine calls this method to set next kinematics
@@ -144,6 +159,12 @@ namespace airlib
 
         virtual ~MultiRotorPhysicsBody() = default;
 
+    protected:
+        virtual void updateWrenchVertices() override
+        {
+            RotorActuator::updateAll(rotors_);
+        }
+
     private: //methods
         void initialize(Kinematics* kinematics, Environment* environment)
         {
@@ -163,6 +184,8 @@ namespace airlib
                 const MultiRotorParams::RotorPose& rotor_pose = params.getParams().rotor_poses.at(rotor_index);
                 rotors.emplace_back(rotor_pose.position, rotor_pose.normal, rotor_pose.direction, params.getParams().rotor_params, environment, rotor_index);
             }
+            for (RotorActuator& rotor : rotors)
+                rotor.shareLookupTable(rotors.front());
         }
 
         void reportSensors(MultiRotorParams& params, StateReporter& reporter)
@@ -10,6 +10,7 @@
 #include "common/FirstOrderFilter.hpp"
 #include "physics/PhysicsBodyVertex.hpp"
 #include "RotorParams.hpp"
+#include "RotorLookupTable.hpp"
 
 namespace msr
 {
@@ -52,6 +53,13 @@ namespace airlib
             air_density_sea_level_ = EarthUtils::getAirDensity(0.0f);
 
             control_signal_filter_.initialize(params_.control_signal_filter_tc, 0, 0);
+            if (!params_.measured_curve.empty()) {
+                auto lookup_table = std::make_shared<RotorLookupTable>();
+                lookup_table->initialize(params_);
+                lookup_table_ = lookup_table;
+            }
+            else
+                lookup_table_.reset();
 
             PhysicsBodyVertex::initialize(position, normal); //call base initializer
         }
@@ -67,6 +75,12 @@ namespace airlib
             return output_;
         }
 
+        //rotors initialized with the same params can look up one table instead of a copy each
+        void shareLookupTable(const RotorActuator& other)
+        {
+            lookup_table_ = other.lookup_table_;
+        }
+
         //*** Start: UpdatableState implementation ***//
         virtual void resetImplementation() override
         {
@@ -77,7 +91,7 @@ namespace airlib
 
             control_signal_filter_.reset();
 
-            setOutput(output_, params_, control_signal_filter_, turning_direction_);
+            setOutput(output_, params_, getLookupTable(), control_signal_filter_, turning_direction_);
         }
 
         virtual void update() override
@@ -89,12 +103,48 @@ namespace airlib
             PhysicsBodyVertex::update();
 
             //update our state
-            setOutput(output_, params_, control_signal_filter_, turning_direction_);
+            setOutput(output_, params_, getLookupTable(), control_signal_filter_, turning_direction_);
 
             //update filter - this should be after so that first output is same as initial
             control_signal_filter_.update();
         }
 
+        //same as calling update() on each rotor, with the clock, air density and filter decay read once
+        //for rotors that share them as the rotors of one vehicle do
+        static void updateAll(vector<RotorActuator>& rotors)
+        {
+            if (rotors.empty())
+                return;
+
+            const TTimePoint now = rotors.front().clock()->nowNanos();
+            const Environment* environment = nullptr;
+            real_T air_density_ratio = 0;
+            TTimePoint decay_since = 0;
+            float decay_tc = 0;
+            double decay = 0;
+
+            for (RotorActuator& rotor : rotors) {
+                if (rotor.environment_ != environment) {
+                    environment = rotor.environment_;
+                    rotor.updateEnvironmentalFactors();
+                    air_density_ratio = rotor.air_density_ratio_;
+                }
+                else
+                    rotor.air_density_ratio_ = air_density_ratio;
+
+                rotor.PhysicsBodyVertex::update();
+                setOutput(rotor.output_, rotor.params_, rotor.getLookupTable(), rotor.control_signal_filter_, rotor.turning_direction_);
+
+                FirstOrderFilter<real_T>& filter = rotor.control_signal_filter_;
+                if (decay_tc == 0 || filter.getLastUpdateTime() != decay_since || filter.getTimeConstant() != decay_tc) {
+                    decay_since = filter.getLastUpdateTime();
+                    decay_tc = filter.getTimeConstant();
+                    decay = filter.getDecay(now);
+                }
+                filter.update(now, decay);
+            }
+        }
+
         virtual void reportState(StateReporter& reporter) override
         {
             reporter.writeValue("Dir", static_cast<int>(turning_direction_));
@@ -104,6 +154,22 @@ namespace airlib
             reporter.writeValue("thrust", output_.thrust);
             reporter.writeValue("torque", output_.torque_scaler);
         }
+
+        virtual void saveState(StateSnapshot& snapshot) const override
+        {
+            PhysicsBodyVertex::saveState(snapshot);
+            control_signal_filter_.saveState(snapshot);
+            snapshot.write(air_density_ratio_);
+            snapshot.write(output_);
+        }
+
+        virtual void restoreState(StateSnapshot& snapshot) override
+        {
+            PhysicsBodyVertex::restoreState(snapshot);
+            control_signal_filter_.restoreState(snapshot);
+            snapshot.read(air_density_ratio_);
+            snapshot.read(output_);
+        }
         //*** End: UpdatableState implementation ***//
 
     protected:
@@ -116,17 +182,31 @@ namespace airlib
         }
 
     private: //methods
-        static void setOutput(Output& output, const RotorParams& params, const FirstOrderFilter<real_T>& control_signal_filter, RotorTurningDirection turning_direction)
+        static void setOutput(Output& output, const RotorParams& params, const RotorLookupTable* lookup_table,
+                              const FirstOrderFilter<real_T>& control_signal_filter, RotorTurningDirection turning_direction)
         {
             output.control_signal_input = control_signal_filter.getInput();
             output.control_signal_filtered = control_signal_filter.getOutput();
-            //see relationship of rotation speed with thrust: http://physics.stackexchange.com/a/32013/14061
-            output.speed = sqrt(output.control_signal_filtered * params.max_speed_square);
-            output.thrust = output.control_signal_filtered * params.max_thrust;
-            output.torque_scaler = output.control_signal_filtered * params.max_torque * static_cast<int>(turning_direction);
+            if (lookup_table) {
+                const RotorLookupTable::Output measured = lookup_table->lookup(output.control_signal_filtered);
+                output.speed = measured.speed;
+                output.thrust = measured.thrust;
+                output.torque_scaler = measured.torque * static_cast<int>(turning_direction);
+            }
+            else {
+                //see relationship of rotation speed with thrust: http://physics.stackexchange.com/a/32013/14061
+                output.speed = sqrt(output.control_signal_filtered * params.max_speed_square);
+                output.thrust = output.control_signal_filtered * params.max_thrust;
+                output.torque_scaler = output.control_signal_filtered * params.max_torque * static_cast<int>(turning_direction);
+            }
             output.turning_direction = turning_direction;
         }
 
+        const RotorLookupTable* getLookupTable() const
+        {
+            return lookup_table_.get();
+        }
+
         void updateEnvironmentalFactors()
         {
             //update air density ration - this will affect generated force and torques by rotors
@@ -138,6 +218,7 @@ namespace airlib
         RotorTurningDirection turning_direction_;
         RotorParams params_;
         FirstOrderFilter<real_T> control_signal_filter_;
+        std::shared_ptr<const RotorLookupTable> lookup_table_; //only for params_.measured_curve
         const Environment* environment_ = nullptr;
         real_T air_density_sea_level_, air_density_ratio_;
         Output output_;
@@ -0,0 +1,76 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef msr_airlib_RotorLookupTable_hpp
+#define msr_airlib_RotorLookupTable_hpp
+
+#include <array>
+#include "common/Common.hpp"
+#include "RotorParams.hpp"
+
+namespace msr
+{
+namespace airlib
+{
+
+    //Rotor outputs sampled at even steps of control signal so a lookup is one multiply and a linear
+    //interpolation, whatever the number or spacing of points in RotorParams::measured_curve. Thrust
+    //and torque are at RotorParams::air_density, rotors scale them by air density as for the model.
+    class RotorLookupTable
+    {
+    public:
+        static constexpr uint kSize = 65;
+
+        struct Output
+        {
+            real_T speed;
+            real_T thrust;
+            real_T torque;
+        };
+
+        //measured_curve must have points, rotors compute the C_T and C_P model without a table
+        void initialize(const RotorParams& params)
+        {
+            for (uint i = 0; i < kSize; ++i)
+                table_[i] = sampleCurve(params.measured_curve, static_cast<real_T>(i) / (kSize - 1));
+        }
+
+        //control_signal from 0 to 1
+        Output lookup(real_T control_signal) const
+        {
+            const real_T position = Utils::clip(control_signal, 0.0f, 1.0f) * (kSize - 1);
+            const uint index = std::min(static_cast<uint>(position), kSize - 2);
+            const real_T fraction = position - index;
+            const Output &a = table_[index], &b = table_[index + 1];
+            return Output{ a.speed + (b.speed - a.speed) * fraction,
+                           a.thrust + (b.thrust - a.thrust) * fraction,
+                           a.torque + (b.torque - a.torque) * fraction };
+        }
+
+    private:
+        //linear between points, held at the first and last point outside them
+        static Output sampleCurve(const vector<RotorCurvePoint>& curve, real_T control_signal)
+        {
+            const RotorCurvePoint* a = &curve.front();
+            const RotorCurvePoint* b = a;
+            for (const RotorCurvePoint& point : curve) {
+                b = &point;
+                if (point.control_signal >= control_signal)
+                    break;
+                a = &point;
+            }
+
+            const real_T span = b->control_signal - a->control_signal;
+            const real_T fraction = span > 0 ? Utils::clip((control_signal - a->control_signal) / span, 0.0f, 1.0f) : 0;
+            return Output{ a->speed + (b->speed - a->speed) * fraction,
+                           a->thrust + (b->thrust - a->thrust) * fraction,
+                           a->torque + (b->torque - a->torque) * fraction };
+        }
+
+    private:
+        //outputs of one sample together so a lookup reads one or two cache lines
+        std::array<Output, kSize> table_;
+    };
+}
+} //namespace
+#endif
@@ -18,6 +18,15 @@ namespace airlib
         RotorTurningDirectionCW = 1
     };
 
+    //rotor output measured on a test stand at one control signal, at RotorParams::air_density
+    struct RotorCurvePoint
+    {
+        real_T control_signal; //0 to 1
+        real_T thrust; //N
+        real_T torque; //N.m, without turning direction
+        real_T speed; //radians per second
+    };
+
     struct RotorParams
     {
         /*
@@ -48,6 +57,10 @@ namespace airlib
         real_T max_thrust = 4.179446268f; //computed from above formula for the given constants
         real_T max_torque = 0.055562f; //computed from above formula
 
+        //outputs against control signal for motors that don't follow the model above, in increasing
+        //control signal from 0 to 1. Rotors look these up in a RotorLookupTable, empty uses the model
+        vector<RotorCurvePoint> measured_curve;
+
         // call this method to recalculate thrust if you want to use different numbers for C_T, C_P, max_rpm, etc.
         void calculateMaxThrust()
         {
@@ -21,42 +21,43 @@ namespace airlib
     {
     public:
         MultirotorRpcLibClient(const string& ip_address = "localhost", uint16_t port = RpcLibPort, float timeout_sec = 60);
+        explicit MultirotorRpcLibClient(RpcLibConnectionPool& connection_pool);
 
-        MultirotorRpcLibClient* takeoffAsync(float timeout_sec = 20, const std::string& vehicle_name = "");
-        MultirotorRpcLibClient* landAsync(float timeout_sec = 60, const std::string& vehicle_name = "");
-        MultirotorRpcLibClient* goHomeAsync(float timeout_sec = Utils::max<float>(), const std::string& vehicle_name = "");
+        MultirotorRpcLibClient* takeoffAsync(float timeout_sec = 20, const std::string& vehicle_name = "", RpcLibTaskHandle* task = nullptr);
+        MultirotorRpcLibClient* landAsync(float timeout_sec = 60, const std::string& vehicle_name = "", RpcLibTaskHandle* task = nullptr);
+        MultirotorRpcLibClient* goHomeAsync(float timeout_sec = Utils::max<float>(), const std::string& vehicle_name = "", RpcLibTaskHandle* task = nullptr);
 
         MultirotorRpcLibClient* moveToGPSAsync(float latitude, float longitude, float altitude, float velocity, float timeout_sec = Utils::max<float>(),
                                                DrivetrainType drivetrain = DrivetrainType::MaxDegreeOfFreedom, const YawMode& yaw_mode = YawMode(),
-                                               float lookahead = -1, float adaptive_lookahead = 1, const std::string& vehicle_name = "");
+                                               float lookahead = -1, float adaptive_lookahead = 1, const std::string& vehicle_name = "", RpcLibTaskHandle* task = nullptr);
         MultirotorRpcLibClient* moveByVelocityBodyFrameAsync(float vx, float vy, float vz, float duration,
-                                                             DrivetrainType drivetrain = DrivetrainType::MaxDegreeOfFreedom, const YawMode& yaw_mode = YawMode(), const std::string& vehicle_name = "");
+                                                             DrivetrainType drivetrain = DrivetrainType::MaxDegreeOfFreedom, const YawMode& yaw_mode = YawMode(), const std::string& vehicle_name = "", RpcLibTaskHandle* task = nullptr);
         MultirotorRpcLibClient* moveByVelocityZBodyFrameAsync(float vx, float vy, float z, float duration,
-                                                              DrivetrainType drivetrain = DrivetrainType::MaxDegreeOfFreedom, const YawMode& yaw_mode = YawMode(), const std::string& vehicle_name = "");
-        MultirotorRpcLibClient* moveByMotorPWMsAsync(float front_right_pwm, float rear_left_pwm, float front_left_pwm, float rear_right_pwm, float duration, const std::string& vehicle_name = "");
-        MultirotorRpcLibClient* moveByRollPitchYawZAsync(float roll, float pitch, float yaw, float z, float duration, const std::string& vehicle_name = "");
-        MultirotorRpcLibClient* moveByRollPitchYawThrottleAsync(float roll, float pitch, float yaw, float throttle, float duration, const std::string& vehicle_name = "");
-        MultirotorRpcLibClient* moveByRollPitchYawrateThrottleAsync(float roll, float pitch, float yaw_rate, float throttle, float duration, const std::string& vehicle_name = "");
-        MultirotorRpcLibClient* moveByRollPitchYawrateZAsync(float roll, float pitch, float yaw_rate, float z, float duration, const std::string& vehicle_name = "");
-        MultirotorRpcLibClient* moveByAngleRatesZAsync(float roll_rate, float pitch_rate, float yaw_rate, float z, float duration, const std::string& vehicle_name = "");
-        MultirotorRpcLibClient* moveByAngleRatesThrottleAsync(float roll_rate, float pitch_rate, float yaw_rate, float throttle, float duration, const std::string& vehicle_name = "");
+                                                              DrivetrainType drivetrain = DrivetrainType::MaxDegreeOfFreedom, const YawMode& yaw_mode = YawMode(), const std::string& vehicle_name = "", RpcLibTaskHandle* task = nullptr);
+        MultirotorRpcLibClient* moveByMotorPWMsAsync(float front_right_pwm, float rear_left_pwm, float front_left_pwm, float rear_right_pwm, float duration, const std::string& vehicle_name = "", RpcLibTaskHandle* task = nullptr);
+        MultirotorRpcLibClient* moveByRollPitchYawZAsync(float roll, float pitch, float yaw, float z, float duration, const std::string& vehicle_name = "", RpcLibTaskHandle* task = nullptr);
+        MultirotorRpcLibClient* moveByRollPitchYawThrottleAsync(float roll, float pitch, float yaw, float throttle, float duration, const std::string& vehicle_name = "", RpcLibTaskHandle* task = nullptr);
+        MultirotorRpcLibClient* moveByRollPitchYawrateThrottleAsync(float roll, float pitch, float yaw_rate, float throttle, float duration, const std::string& vehicle_name = "", RpcLibTaskHandle* task = nullptr);
+        MultirotorRpcLibClient* moveByRollPitchYawrateZAsync(float roll, float pitch, float yaw_rate, float z, float duration, const std::string& vehicle_name = "", RpcLibTaskHandle* task = nullptr);
+        MultirotorRpcLibClient* moveByAngleRatesZAsync(float roll_rate, float pitch_rate, float yaw_rate, float z, float duration, const std::string& vehicle_name = "", RpcLibTaskHandle* task = nullptr);
+        MultirotorRpcLibClient* moveByAngleRatesThrottleAsync(float roll_rate, float pitch_rate, float yaw_rate, float throttle, float duration, const std::string& vehicle_name = "", RpcLibTaskHandle* task = nullptr);
         MultirotorRpcLibClient* moveByVelocityAsync(float vx, float vy, float vz, float duration,
-                                                    DrivetrainType drivetrain = DrivetrainType::MaxDegreeOfFreedom, const YawMode& yaw_mode = YawMode(), const std::string& vehicle_name = "");
+                                                    DrivetrainType drivetrain = DrivetrainType::MaxDegreeOfFreedom, const YawMode& yaw_mode = YawMode(), const std::string& vehicle_name = "", RpcLibTaskHandle* task = nullptr);
         MultirotorRpcLibClient* moveByVelocityZAsync(float vx, float vy, float z, float duration,
-                                                     DrivetrainType drivetrain = DrivetrainType::MaxDegreeOfFreedom, const YawMode& yaw_mode = YawMode(), const std::string& vehicle_name = "");
+                                                     DrivetrainType drivetrain = DrivetrainType::MaxDegreeOfFreedom, const YawMode& yaw_mode = YawMode(), const std::string& vehicle_name = "", RpcLibTaskHandle* task = nullptr);
         MultirotorRpcLibClient* moveOnPathAsync(const vector<Vector3r>& path, float velocity, float timeout_sec = Utils::max<float>(),
                                                 DrivetrainType drivetrain = DrivetrainType::MaxDegreeOfFreedom, const YawMode& yaw_mode = YawMode(),
-                                                float lookahead = -1, float adaptive_lookahead = 1, const std::string& vehicle_name = "");
+                                                float lookahead = -1, float adaptive_lookahead = 1, const std::string& vehicle_name = "", RpcLibTaskHandle* task = nullptr);
         MultirotorRpcLibClient* moveToPositionAsync(float x, float y, float z, float velocity, float timeout_sec = Utils::max<float>(),
                                                     DrivetrainType drivetrain = DrivetrainType::MaxDegreeOfFreedom, const YawMode& yaw_mode = YawMode(),
-                                                    float lookahead = -1, float adaptive_lookahead = 1, const std::string& vehicle_name = "");
+                                                    float lookahead = -1, float adaptive_lookahead = 1, const std::string& vehicle_name = "", RpcLibTaskHandle* task = nullptr);
         MultirotorRpcLibClient* moveToZAsync(float z, float velocity, float timeout_sec = Utils::max<float>(),
-                                             const YawMode& yaw_mode = YawMode(), float lookahead = -1, float adaptive_lookahead = 1, const std::string& vehicle_name = "");
+                                             const YawMode& yaw_mode = YawMode(), float lookahead = -1, float adaptive_lookahead = 1, const std::string& vehicle_name = "", RpcLibTaskHandle* task = nullptr);
         MultirotorRpcLibClient* moveByManualAsync(float vx_max, float vy_max, float z_min, float duration,
-                                                  DrivetrainType drivetrain = DrivetrainType::MaxDegreeOfFreedom, const YawMode& yaw_mode = YawMode(), const std::string& vehicle_name = "");
-        MultirotorRpcLibClient* rotateToYawAsync(float yaw, float timeout_sec = Utils::max<float>(), float margin = 5, const std::string& vehicle_name = "");
-        MultirotorRpcLibClient* rotateByYawRateAsync(float yaw_rate, float duration, const std::string& vehicle_name = "");
-        MultirotorRpcLibClient* hoverAsync(const std::string& vehicle_name = "");
+                                                  DrivetrainType drivetrain = DrivetrainType::MaxDegreeOfFreedom, const YawMode& yaw_mode = YawMode(), const std::string& vehicle_name = "", RpcLibTaskHandle* task = nullptr);
+        MultirotorRpcLibClient* rotateToYawAsync(float yaw, float timeout_sec = Utils::max<float>(), float margin = 5, const std::string& vehicle_name = "", RpcLibTaskHandle* task = nullptr);
+        MultirotorRpcLibClient* rotateByYawRateAsync(float yaw_rate, float duration, const std::string& vehicle_name = "", RpcLibTaskHandle* task = nullptr);
+        MultirotorRpcLibClient* hoverAsync(const std::string& vehicle_name = "", RpcLibTaskHandle* task = nullptr);
 
         void setAngleLevelControllerGains(const vector<float>& kp, const vector<float>& ki, const vector<float>& kd, const std::string& vehicle_name = "");
         void setAngleRateControllerGains(const vector<float>& kp, const vector<float>& ki, const vector<float>& kd, const std::string& vehicle_name = "");
@@ -70,10 +71,19 @@ namespace airlib
         bool setSafety(SafetyEval::SafetyViolationType enable_reasons, float obs_clearance, SafetyEval::ObsAvoidanceStrategy obs_startegy,
                        float obs_avoidance_vel, const Vector3r& origin, float xy_length, float max_z, float min_z, const std::string& vehicle_name = "");
 
+        //each *Async call returns immediately and its task stays in flight until the server replies,
+        //so tasks for many vehicles can run at once on one connection. Pass task to get the handle of
+        //that call, to be joined with RpcLibTaskHandle::waitAll/waitAny. Handles of the most recent
+        //task overall and per vehicle are also kept, but other threads' calls may replace them.
+        RpcLibTaskHandle getLastTask() const;
+        RpcLibTaskHandle getLastTask(const std::string& vehicle_name) const;
         virtual MultirotorRpcLibClient* waitOnLastTask(bool* task_result = nullptr, float timeout_sec = Utils::nan<float>()) override;
 
         virtual ~MultirotorRpcLibClient(); //required for pimpl
 
+    private:
+        MultirotorRpcLibClient* setLastTask(const RpcLibTaskHandle& task, RpcLibTaskHandle* out_task);
+
     private:
         struct impl;
         std::unique_ptr<impl> pimpl_;
@@ -482,11 +482,17 @@ namespace airlib
             RotorControlMessage pkt;
             int recv_ret = udp_socket_->recv(&pkt, sizeof(pkt), 100);
             while (recv_ret != sizeof(pkt)) {
-                if (recv_ret <= 0) {
-                    Utils::log(Utils::stringf("Error while receiving rotor control data - ErrorNo: %d", recv_ret), Utils::kLogLevelInfo);
-                }
-                else {
-                    Utils::log(Utils::stringf("Received %d bytes instead of %zu bytes", recv_ret, sizeof(pkt)), Utils::kLogLevelInfo);
+                //this spins every 100 ms while ArduCopter is not sending, keep the log readable
+                static Utils::LogRateLimiter log_limiter(1);
+                if (log_limiter.allow()) {
+                    if (recv_ret <= 0) {
+                        Utils::logf(Utils::kLogLevelInfo, "Error while receiving rotor control data - ErrorNo: %d (%u similar messages suppressed)",
+                                    recv_ret, log_limiter.takeSuppressed());
+                    }
+                    else {
+                        Utils::logf(Utils::kLogLevelInfo, "Received %d bytes instead of %zu bytes (%u similar messages suppressed)",
+                                    recv_ret, sizeof(pkt), log_limiter.takeSuppressed());
+                    }
                 }
 
                 recv_ret = udp_socket_->recv(&pkt, sizeof(pkt), 100);
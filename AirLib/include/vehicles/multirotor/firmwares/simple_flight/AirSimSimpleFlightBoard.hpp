@@ -122,6 +122,20 @@ namespace airlib
             //no op for now
         }
 
+        virtual void saveState(StateSnapshot& snapshot) const override
+        {
+            snapshot.write(motor_output_);
+            snapshot.write(input_channels_);
+            snapshot.write(is_connected_);
+        }
+
+        virtual void restoreState(StateSnapshot& snapshot) override
+        {
+            snapshot.read(motor_output_);
+            snapshot.read(input_channels_);
+            snapshot.read(is_connected_);
+        }
+
     private:
         void sleep(double msec)
         {
@@ -0,0 +1,547 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef msr_airlib_AirSimSimpleFlightEkf_hpp
+#define msr_airlib_AirSimSimpleFlightEkf_hpp
+
+#include <array>
+#include "firmware/interfaces/CommonStructs.hpp"
+#include "firmware/interfaces/IStateEstimator.hpp"
+#include "firmware/interfaces/IUpdatable.hpp"
+#include "AirSimSimpleFlightCommon.hpp"
+#include "sensors/SensorCollection.hpp"
+#include "sensors/imu/ImuBase.hpp"
+#include "sensors/gps/GpsBase.hpp"
+#include "sensors/barometer/BarometerBase.hpp"
+#include "sensors/magnetometer/MagnetometerBase.hpp"
+#include "physics/Kinematics.hpp"
+#include "physics/Environment.hpp"
+#include "common/GeodeticConverter.hpp"
+#include "common/EarthUtils.hpp"
+#include "common/ClockFactory.hpp"
+#include "common/Common.hpp"
+
+namespace msr
+{
+namespace airlib
+{
+
+    //defaults are a bit above the noise of ImuSimpleParams and the other sensors' default params
+    struct AirSimSimpleFlightEkfParams
+    {
+        real_T gyro_noise = 2E-4f; //rad/s/sqrt(Hz)
+        real_T accel_noise = 5E-3f; //m/s^2/sqrt(Hz)
+        real_T gyro_bias_noise = 2E-6f; //rad/s^2/sqrt(Hz)
+        real_T accel_bias_noise = 4E-5f; //m/s^3/sqrt(Hz)
+
+        real_T gps_position_noise_min = 0.3f; //m, used when the GPS reports better
+        real_T gps_velocity_noise = 0.1f; //m/s
+        real_T barometer_noise = 0.5f; //m
+        real_T magnetometer_noise = 0.02f; //of a unit field vector
+
+        //measurements further than this many standard deviations off are dropped
+        real_T innovation_gate = 5.0f;
+
+        //standard deviations at reset
+        real_T initial_position_sigma = 0.1f;
+        real_T initial_velocity_sigma = 0.1f;
+        real_T initial_attitude_sigma = 0.02f;
+        real_T initial_gyro_bias_sigma = 1E-3f;
+        real_T initial_accel_bias_sigma = 0.05f;
+    };
+
+    /*
+    State estimator for simple_flight that fuses the vehicle's IMU, GPS, barometer and magnetometer
+    instead of reading ground truth as AirSimSimpleFlightEstimator does.
+
+    This is an error state Kalman filter: the IMU drives position, velocity and orientation at IMU
+    rate and the filter estimates the errors in those plus the gyro and accelerometer biases, which
+    keeps orientation errors small enough to be linear. The other sensors are fused as they produce
+    output, one scalar at a time so there is no matrix to invert. GPS output comes with a latency, so
+    it is compared against the state at its time stamp kept in a ring buffer. All matrices are fixed
+    size, update() doesn't allocate.
+
+    The filter starts from the vehicle's pose at reset, as a real vehicle sitting on its home point
+    would know it, the magnetometer and barometer references are taken from their first readings.
+*/
+    class AirSimSimpleFlightEkf : public simple_flight::IStateEstimator
+        , public simple_flight::IUpdatable
+    {
+    public:
+        AirSimSimpleFlightEkf(const SensorCollection* sensors, const AirSimSimpleFlightEkfParams& params = AirSimSimpleFlightEkfParams())
+            : sensors_(sensors), params_(params)
+        {
+        }
+
+        virtual ~AirSimSimpleFlightEkf() = default;
+
+        //start pose and home point, read on reset so the kinematics must be reset first as the
+        //vehicle's sim API does. The filter doesn't look at them after reset
+        void setGroundTruthKinematics(const Kinematics::State* kinematics, const Environment* environment)
+        {
+            kinematics_ = kinematics;
+            environment_ = environment;
+        }
+
+        virtual void reset() override
+        {
+            IUpdatable::reset();
+
+            imu_ = static_cast<const ImuBase*>(sensors_->getByType(SensorBase::SensorType::Imu));
+            gps_ = static_cast<const GpsBase*>(sensors_->getByType(SensorBase::SensorType::Gps));
+            barometer_ = static_cast<const BarometerBase*>(sensors_->getByType(SensorBase::SensorType::Barometer));
+            magnetometer_ = static_cast<const MagnetometerBase*>(sensors_->getByType(SensorBase::SensorType::Magnetometer));
+            if (imu_ == nullptr)
+                throw std::invalid_argument("AirSimSimpleFlightEkf needs an IMU in the vehicle's sensors");
+
+            home_geo_point_ = environment_->getHomeGeoPoint();
+            geodetic_converter_.setHome(home_geo_point_);
+            gravity_ = Vector3r(0, 0, EarthUtils::getGravity(home_geo_point_.altitude));
+
+            state_.position = kinematics_->pose.position;
+            state_.velocity = kinematics_->twist.linear;
+            state_.orientation = kinematics_->pose.orientation;
+            state_.gyro_bias = Vector3r::Zero();
+            state_.accel_bias = Vector3r::Zero();
+            angular_velocity_ = Vector3r::Zero();
+            linear_acceleration_ = Vector3r::Zero();
+
+            covariance_ = CovarianceMatrix::Zero();
+            setInitialVariance(kPosition, params_.initial_position_sigma);
+            setInitialVariance(kVelocity, params_.initial_velocity_sigma);
+            setInitialVariance(kAttitude, params_.initial_attitude_sigma);
+            setInitialVariance(kGyroBias, params_.initial_gyro_bias_sigma);
+            setInitialVariance(kAccelBias, params_.initial_accel_bias_sigma);
+
+            //sensor outputs from before reset are stale
+            const TTimePoint now = ClockFactory::get()->nowNanos();
+            last_imu_time_ = last_gps_time_ = last_barometer_time_ = last_magnetometer_time_ = now;
+            has_barometer_reference_ = has_magnetometer_reference_ = false;
+
+            history_count_ = 0;
+            history_next_ = 0;
+            pushHistory(now);
+        }
+
+        virtual void update() override
+        {
+            IUpdatable::update();
+
+            const TTimePoint now = ClockFactory::get()->nowNanos();
+
+            const ImuBase::Output& imu = imu_->getOutput();
+            if (isNewOutput(imu.time_stamp, last_imu_time_, now)) {
+                predict(imu, ClockBase::elapsedBetween(imu.time_stamp, last_imu_time_));
+                last_imu_time_ = imu.time_stamp;
+                pushHistory(imu.time_stamp);
+            }
+
+            if (gps_ != nullptr) {
+                const GpsBase::Output& gps = gps_->getOutput();
+                if (isNewOutput(gps.time_stamp, last_gps_time_, now)) {
+                    last_gps_time_ = gps.time_stamp;
+                    if (gps.is_valid && gps.gnss.fix_type == GpsBase::GnssFixType::GNSS_FIX_3D_FIX)
+                        fuseGps(gps);
+                }
+            }
+            if (barometer_ != nullptr) {
+                const BarometerBase::Output& barometer = barometer_->getOutput();
+                if (isNewOutput(barometer.time_stamp, last_barometer_time_, now)) {
+                    last_barometer_time_ = barometer.time_stamp;
+                    fuseBarometer(barometer);
+                }
+            }
+            if (magnetometer_ != nullptr) {
+                const MagnetometerBase::Output& magnetometer = magnetometer_->getOutput();
+                if (isNewOutput(magnetometer.time_stamp, last_magnetometer_time_, now)) {
+                    last_magnetometer_time_ = magnetometer.time_stamp;
+                    fuseMagnetometer(magnetometer);
+                }
+            }
+        }
+
+        virtual void saveState(StateSnapshot& snapshot) const override
+        {
+            snapshot.write(state_);
+            snapshot.write(covariance_);
+            snapshot.write(angular_velocity_);
+            snapshot.write(linear_acceleration_);
+            snapshot.writeTime(last_imu_time_);
+            snapshot.writeTime(last_gps_time_);
+            snapshot.writeTime(last_barometer_time_);
+            snapshot.writeTime(last_magnetometer_time_);
+            snapshot.write(barometer_reference_);
+            snapshot.write(magnetometer_reference_);
+            snapshot.write(has_barometer_reference_);
+            snapshot.write(has_magnetometer_reference_);
+            snapshot.write(history_count_);
+            snapshot.write(history_next_);
+            for (const HistoryEntry& entry : history_) {
+                snapshot.writeTime(entry.time);
+                snapshot.write(entry.position);
+                snapshot.write(entry.velocity);
+            }
+        }
+
+        virtual void restoreState(StateSnapshot& snapshot) override
+        {
+            snapshot.read(state_);
+            snapshot.read(covariance_);
+            snapshot.read(angular_velocity_);
+            snapshot.read(linear_acceleration_);
+            snapshot.readTime(last_imu_time_);
+            snapshot.readTime(last_gps_time_);
+            snapshot.readTime(last_barometer_time_);
+            snapshot.readTime(last_magnetometer_time_);
+            snapshot.read(barometer_reference_);
+            snapshot.read(magnetometer_reference_);
+            snapshot.read(has_barometer_reference_);
+            snapshot.read(has_magnetometer_reference_);
+            snapshot.read(history_count_);
+            snapshot.read(history_next_);
+            for (HistoryEntry& entry : history_) {
+                snapshot.readTime(entry.time);
+                snapshot.read(entry.position);
+                snapshot.read(entry.velocity);
+            }
+        }
+
+        //standard deviations of the estimated position, velocity and attitude errors
+        Vector3r getPositionSigma() const
+        {
+            return getSigma(kPosition);
+        }
+        Vector3r getVelocitySigma() const
+        {
+            return getSigma(kVelocity);
+        }
+        Vector3r getAttitudeSigma() const
+        {
+            return getSigma(kAttitude);
+        }
+        const Vector3r& getGyroBias() const
+        {
+            return state_.gyro_bias;
+        }
+        const Vector3r& getAccelBias() const
+        {
+            return state_.accel_bias;
+        }
+
+    public: //IStateEstimator implementation
+        virtual simple_flight::Axis3r getAngles() const override
+        {
+            simple_flight::Axis3r angles;
+            VectorMath::toEulerianAngle(state_.orientation, angles.pitch(), angles.roll(), angles.yaw());
+            return angles;
+        }
+
+        virtual simple_flight::Axis3r getAngularVelocity() const override
+        {
+            return AirSimSimpleFlightCommon::toAxis3r(angular_velocity_);
+        }
+
+        virtual simple_flight::Axis3r getPosition() const override
+        {
+            return AirSimSimpleFlightCommon::toAxis3r(state_.position);
+        }
+
+        virtual simple_flight::Axis3r transformToBodyFrame(const simple_flight::Axis3r& world_frame_val) const override
+        {
+            const Vector3r& vec = AirSimSimpleFlightCommon::toVector3r(world_frame_val);
+            return AirSimSimpleFlightCommon::toAxis3r(VectorMath::transformToBodyFrame(vec, state_.orientation));
+        }
+
+        virtual simple_flight::Axis3r getLinearVelocity() const override
+        {
+            return AirSimSimpleFlightCommon::toAxis3r(state_.velocity);
+        }
+
+        virtual simple_flight::Axis4r getOrientation() const override
+        {
+            return AirSimSimpleFlightCommon::toAxis4r(state_.orientation);
+        }
+
+        virtual simple_flight::GeoPoint getGeoPoint() const override
+        {
+            GeoPoint geo_point;
+            geodetic_converter_.ned2Geodetic(state_.position, geo_point);
+            return AirSimSimpleFlightCommon::toSimpleFlightGeoPoint(geo_point);
+        }
+
+        virtual simple_flight::GeoPoint getHomeGeoPoint() const override
+        {
+            return AirSimSimpleFlightCommon::toSimpleFlightGeoPoint(home_geo_point_);
+        }
+
+        //angular acceleration is not estimated and left zero
+        virtual simple_flight::KinematicsState getKinematicsEstimated() const override
+        {
+            simple_flight::KinematicsState state;
+            state.position = getPosition();
+            state.orientation = getOrientation();
+            state.linear_velocity = getLinearVelocity();
+            state.angular_velocity = getAngularVelocity();
+            state.linear_acceleration = AirSimSimpleFlightCommon::toAxis3r(linear_acceleration_);
+            state.angular_acceleration = AirSimSimpleFlightCommon::toAxis3r(Vector3r::Zero());
+
+            return state;
+        }
+
+    private:
+        //error state: position, velocity, attitude as a small rotation in body frame, gyro bias, accel bias
+        static constexpr int kPosition = 0;
+        static constexpr int kVelocity = 3;
+        static constexpr int kAttitude = 6;
+        static constexpr int kGyroBias = 9;
+        static constexpr int kAccelBias = 12;
+        static constexpr int kStateSize = 15;
+
+        //enough for the default GPS latency of 0.2 s at 3 ms ticks
+        static constexpr uint kHistorySize = 128;
+
+        typedef Eigen::Matrix<real_T, kStateSize, kStateSize> CovarianceMatrix;
+        typedef Eigen::Matrix<real_T, kStateSize, 1> StateVector;
+
+        struct NominalState
+        {
+            Vector3r position;
+            Vector3r velocity;
+            Quaternionr orientation;
+            Vector3r gyro_bias;
+            Vector3r accel_bias;
+        };
+
+        struct HistoryEntry
+        {
+            TTimePoint time = 0;
+            Vector3r position = Vector3r::Zero();
+            Vector3r velocity = Vector3r::Zero();
+        };
+
+        static Matrix3x3r skew(const Vector3r& v)
+        {
+            Matrix3x3r m;
+            m << 0, -v.z(), v.y(),
+                v.z(), 0, -v.x(),
+                -v.y(), v.x(), 0;
+            return m;
+        }
+
+        //orientation after a small rotation in body frame
+        static Quaternionr rotateBy(const Quaternionr& q, const Vector3r& rotation)
+        {
+            const Vector3r half = rotation * 0.5f;
+            return (q * Quaternionr(1, half.x(), half.y(), half.z())).normalized();
+        }
+
+        //time stamps before the last one read are old outputs, after now they were never set
+        static bool isNewOutput(TTimePoint time_stamp, TTimePoint last_time, TTimePoint now)
+        {
+            return time_stamp > last_time && time_stamp <= now;
+        }
+
+        void setInitialVariance(int index, real_T sigma)
+        {
+            covariance_.block<3, 3>(index, index) = Matrix3x3r::Identity() * (sigma * sigma);
+        }
+
+        Vector3r getSigma(int index) const
+        {
+            return covariance_.block<3, 3>(index, index).diagonal().cwiseSqrt();
+        }
+
+        void predict(const ImuBase::Output& imu, TTimeDelta dt_delta)
+        {
+            const real_T dt = static_cast<real_T>(dt_delta);
+            const Vector3r angular_velocity = imu.angular_velocity - state_.gyro_bias;
+            const Vector3r specific_force = imu.linear_acceleration - state_.accel_bias;
+            const Matrix3x3r rotation = state_.orientation.toRotationMatrix();
+
+            //nominal state
+            const Vector3r acceleration = rotation * specific_force + gravity_;
+            state_.position += state_.velocity * dt + acceleration * (0.5f * dt * dt);
+            state_.velocity += acceleration * dt;
+            state_.orientation = rotateBy(state_.orientation, angular_velocity * dt);
+            angular_velocity_ = angular_velocity;
+            linear_acceleration_ = acceleration;
+
+            //error state transition, only the blocks that are not identity or zero
+            const Matrix3x3r velocity_by_attitude = -rotation * skew(specific_force) * dt;
+            const Matrix3x3r velocity_by_accel_bias = -rotation * dt;
+            const Matrix3x3r attitude_by_attitude = Matrix3x3r::Identity() - skew(angular_velocity) * dt;
+
+            CovarianceMatrix transition = CovarianceMatrix::Identity();
+            transition.block<3, 3>(kPosition, kVelocity) = Matrix3x3r::Identity() * dt;
+            transition.block<3, 3>(kVelocity, kAttitude) = velocity_by_attitude;
+            transition.block<3, 3>(kVelocity, kAccelBias) = velocity_by_accel_bias;
+            transition.block<3, 3>(kAttitude, kAttitude) = attitude_by_attitude;
+            transition.block<3, 3>(kAttitude, kGyroBias) = -Matrix3x3r::Identity() * dt;
+
+            covariance_ = (transition * covariance_ * transition.transpose()).eval();
+            addProcessNoise(kVelocity, params_.accel_noise, dt);
+            addProcessNoise(kAttitude, params_.gyro_noise, dt);
+            addProcessNoise(kGyroBias, params_.gyro_bias_noise, dt);
+            addProcessNoise(kAccelBias, params_.accel_bias_noise, dt);
+        }
+
+        void addProcessNoise(int index, real_T noise_density, real_T dt)
+        {
+            covariance_.diagonal().segment<3>(index).array() += noise_density * noise_density * dt;
+        }
+
+        void pushHistory(TTimePoint time)
+        {
+            HistoryEntry& entry = history_[history_next_];
+            entry.time = time;
+            entry.position = state_.position;
+            entry.velocity = state_.velocity;
+            history_next_ = (history_next_ + 1) % kHistorySize;
+            history_count_ = std::min(history_count_ + 1, kHistorySize);
+        }
+
+        //newest state at or before time, the oldest kept if time is older than all of them
+        const HistoryEntry& getHistory(TTimePoint time) const
+        {
+            uint index = (history_next_ + kHistorySize - 1) % kHistorySize;
+            for (uint i = 1; i < history_count_ && history_[index].time > time; ++i)
+                index = (index + kHistorySize - 1) % kHistorySize;
+            return history_[index];
+        }
+
+        //fuses a measurement of one error state element, returns the correction to add to the state
+        bool fuseScalar(int index, real_T innovation, real_T noise_sigma, StateVector& correction)
+        {
+            const real_T variance = covariance_(index, index) + noise_sigma * noise_sigma;
+            if (innovation * innovation > params_.innovation_gate * params_.innovation_gate * variance)
+                return false;
+
+            const StateVector gain = covariance_.col(index) / variance;
+            correction += gain * (innovation - correction(index));
+            covariance_ -= gain * covariance_.row(index);
+            return true;
+        }
+
+        //fuses a measurement h * error_state with a dense row
+        bool fuseScalar(const StateVector& h, real_T innovation, real_T noise_sigma, StateVector& correction)
+        {
+            const StateVector ph = covariance_ * h;
+            const real_T variance = h.dot(ph) + noise_sigma * noise_sigma;
+            if (innovation * innovation > params_.innovation_gate * params_.innovation_gate * variance)
+                return false;
+
+            const StateVector gain = ph / variance;
+            correction += gain * (innovation - h.dot(correction));
+            covariance_ -= gain * ph.transpose();
+            return true;
+        }
+
+        void applyCorrection(const StateVector& correction)
+        {
+            state_.position += correction.segment<3>(kPosition);
+            state_.velocity += correction.segment<3>(kVelocity);
+            state_.orientation = rotateBy(state_.orientation, correction.segment<3>(kAttitude));
+            state_.gyro_bias += correction.segment<3>(kGyroBias);
+            state_.accel_bias += correction.segment<3>(kAccelBias);
+
+            //keep the covariance symmetric against round off
+            covariance_ = ((covariance_ + covariance_.transpose()) * 0.5f).eval();
+        }
+
+        void fuseGps(const GpsBase::Output& gps)
+        {
+            double north, east, down;
+            geodetic_converter_.geodetic2Ned(gps.gnss.geo_point.latitude, gps.gnss.geo_point.longitude, gps.gnss.geo_point.altitude,
+                                             &north, &east, &down);
+            const Vector3r position(static_cast<real_T>(north), static_cast<real_T>(east), static_cast<real_T>(down));
+
+            //the measurement is of the state at its time stamp, the correction goes to the state now
+            const HistoryEntry& then = getHistory(gps.time_stamp);
+            const Vector3r position_innovation = position - then.position;
+            const Vector3r velocity_innovation = gps.gnss.velocity - then.velocity;
+            const real_T horizontal_sigma = std::max(gps.gnss.eph, params_.gps_position_noise_min);
+            const real_T vertical_sigma = std::max(gps.gnss.epv, params_.gps_position_noise_min);
+
+            StateVector correction = StateVector::Zero();
+            for (int axis = 0; axis < 3; ++axis)
+                fuseScalar(kPosition + axis, position_innovation[axis], axis < 2 ? horizontal_sigma : vertical_sigma, correction);
+            for (int axis = 0; axis < 3; ++axis)
+                fuseScalar(kVelocity + axis, velocity_innovation[axis], params_.gps_velocity_noise, correction);
+            applyCorrection(correction);
+        }
+
+        void fuseBarometer(const BarometerBase::Output& barometer)
+        {
+            //altitude above the reading at the first one
+            if (!has_barometer_reference_) {
+                barometer_reference_ = barometer.altitude + state_.position.z();
+                has_barometer_reference_ = true;
+                return;
+            }
+
+            const real_T down = barometer_reference_ - barometer.altitude;
+            StateVector correction = StateVector::Zero();
+            fuseScalar(kPosition + 2, down - getHistory(barometer.time_stamp).position.z(), params_.barometer_noise, correction);
+            applyCorrection(correction);
+        }
+
+        void fuseMagnetometer(const MagnetometerBase::Output& magnetometer)
+        {
+            //only the direction of the field is used, its reference is the first reading in world frame
+            const real_T field_norm = magnetometer.magnetic_field_body.norm();
+            if (field_norm <= 0)
+                return;
+            const Vector3r field_body = magnetometer.magnetic_field_body / field_norm;
+            if (!has_magnetometer_reference_) {
+                magnetometer_reference_ = VectorMath::transformToWorldFrame(field_body, state_.orientation);
+                has_magnetometer_reference_ = true;
+                return;
+            }
+
+            //field in body frame is R^T m, a body frame rotation error e changes it by skew(R^T m) e
+            const Vector3r predicted = VectorMath::transformToBodyFrame(magnetometer_reference_, state_.orientation);
+            const Vector3r innovation = field_body - predicted;
+            const Matrix3x3r jacobian = skew(predicted);
+
+            StateVector correction = StateVector::Zero();
+            StateVector h = StateVector::Zero();
+            for (int axis = 0; axis < 3; ++axis) {
+                h.segment<3>(kAttitude) = jacobian.row(axis).transpose();
+                fuseScalar(h, innovation[axis], params_.magnetometer_noise, correction);
+            }
+            applyCorrection(correction);
+        }
+
+    private:
+        const SensorCollection* sensors_;
+        AirSimSimpleFlightEkfParams params_;
+
+        const ImuBase* imu_ = nullptr;
+        const GpsBase* gps_ = nullptr;
+        const BarometerBase* barometer_ = nullptr;
+        const MagnetometerBase* magnetometer_ = nullptr;
+
+        const Kinematics::State* kinematics_ = nullptr;
+        const Environment* environment_ = nullptr;
+        GeoPoint home_geo_point_;
+        //conversions don't change it but are not const
+        mutable GeodeticConverter geodetic_converter_;
+        Vector3r gravity_;
+
+        NominalState state_;
+        CovarianceMatrix covariance_;
+        //bias corrected IMU rate and acceleration in world frame
+        Vector3r angular_velocity_;
+        Vector3r linear_acceleration_;
+
+        TTimePoint last_imu_time_ = 0, last_gps_time_ = 0, last_barometer_time_ = 0, last_magnetometer_time_ = 0;
+        real_T barometer_reference_ = 0;
+        Vector3r magnetometer_reference_;
+        bool has_barometer_reference_ = false, has_magnetometer_reference_ = false;
+
+        std::array<HistoryEntry, kHistorySize> history_;
+        uint history_count_ = 0, history_next_ = 0;
+    };
+}
+} //namespace
+#endif
@@ -14,6 +14,7 @@
 #include "AirSimSimpleFlightBoard.hpp"
 #include "AirSimSimpleFlightCommLink.hpp"
 #include "AirSimSimpleFlightEstimator.hpp"
+#include "AirSimSimpleFlightEkf.hpp"
 #include "AirSimSimpleFlightCommon.hpp"
 #include "physics/PhysicsBody.hpp"
 #include "common/AirSimSettings.hpp"
@@ -41,9 +42,12 @@ namespace airlib
             board_.reset(new AirSimSimpleFlightBoard(&params_));
             comm_link_.reset(new AirSimSimpleFlightCommLink());
             estimator_.reset(new AirSimSimpleFlightEstimator());
+            if (use_ekf_)
+                ekf_.reset(new AirSimSimpleFlightEkf(&vehicle_params_->getSensors()));
 
             //create firmware
-            firmware_.reset(new simple_flight::Firmware(&params_, board_.get(), comm_link_.get(), estimator_.get()));
+            simple_flight::IStateEstimator* state_estimator = ekf_ ? static_cast<simple_flight::IStateEstimator*>(ekf_.get()) : estimator_.get();
+            firmware_.reset(new simple_flight::Firmware(&params_, board_.get(), comm_link_.get(), state_estimator));
         }
 
     public: //VehicleApiBase implementation
@@ -51,15 +55,36 @@ namespace airlib
         {
             MultirotorApiBase::resetImplementation();
 
+            //firmware reads the estimate on reset
+            if (ekf_)
+                ekf_->reset();
             firmware_->reset();
         }
         virtual void update() override
         {
             MultirotorApiBase::update();
 
+            //sensors are updated before the API, fuse their new outputs for the controller
+            if (ekf_)
+                ekf_->update();
+
             //update controller which will update actuator control signal
             firmware_->update();
         }
+        virtual void saveState(StateSnapshot& snapshot) const override
+        {
+            firmware_->saveState(snapshot);
+            if (ekf_)
+                ekf_->saveState(snapshot);
+            snapshot.write(last_rcData_);
+        }
+        virtual void restoreState(StateSnapshot& snapshot) override
+        {
+            firmware_->restoreState(snapshot);
+            if (ekf_)
+                ekf_->restoreState(snapshot);
+            snapshot.read(last_rcData_);
+        }
         virtual bool isApiControlEnabled() const override
         {
             return firmware_->offboardApi().hasApiControl();
@@ -114,6 +139,8 @@ namespace airlib
         {
             board_->setGroundTruthKinematics(kinematics);
             estimator_->setGroundTruthKinematics(kinematics, environment);
+            if (ekf_)
+                ekf_->setGroundTruthKinematics(kinematics, environment);
         }
         virtual bool setRCData(const RCData& rc_data) override
         {
@@ -409,6 +436,12 @@ namespace airlib
             remote_control_id_ = vehicle_setting.rc.remote_control_id;
             params_.rc.allow_api_when_disconnected = vehicle_setting.rc.allow_api_when_disconnected;
             params_.rc.allow_api_always = vehicle_setting.allow_api_always;
+
+            if (vehicle_setting.state_estimator == "Ekf")
+                use_ekf_ = true;
+            else if (vehicle_setting.state_estimator != "" && vehicle_setting.state_estimator != "GroundTruth")
+                throw std::invalid_argument(Utils::stringf("StateEstimator setting '%s' is not valid, use GroundTruth or Ekf",
+                                                           vehicle_setting.state_estimator.c_str()));
         }
 
     private:
@@ -420,6 +453,9 @@ namespace airlib
         unique_ptr<AirSimSimpleFlightBoard> board_;
         unique_ptr<AirSimSimpleFlightCommLink> comm_link_;
         unique_ptr<AirSimSimpleFlightEstimator> estimator_;
+        //replaces estimator_ for the firmware when the vehicle's StateEstimator setting is Ekf
+        bool use_ekf_ = false;
+        unique_ptr<AirSimSimpleFlightEkf> ekf_;
         unique_ptr<simple_flight::IFirmware> firmware_;
 
         MultirotorApiParams safety_params_;
@@ -87,6 +87,22 @@ public:
         return output_;
     }
 
+    virtual void saveState(common_utils::StateSnapshot& snapshot) const override
+    {
+        pid_->saveState(snapshot);
+        rate_controller_->saveState(snapshot);
+        snapshot.write(rate_goal_);
+        snapshot.write(output_);
+    }
+
+    virtual void restoreState(common_utils::StateSnapshot& snapshot) override
+    {
+        pid_->restoreState(snapshot);
+        rate_controller_->restoreState(snapshot);
+        snapshot.read(rate_goal_);
+        snapshot.read(output_);
+    }
+
     /********************  IGoal ********************/
     virtual const Axis4r& getGoalValue() const override
     {
@@ -59,6 +59,18 @@ public:
         return output_;
     }
 
+    virtual void saveState(common_utils::StateSnapshot& snapshot) const override
+    {
+        pid_->saveState(snapshot);
+        snapshot.write(output_);
+    }
+
+    virtual void restoreState(common_utils::StateSnapshot& snapshot) override
+    {
+        pid_->restoreState(snapshot);
+        snapshot.read(output_);
+    }
+
 private:
     unsigned int axis_;
     const IGoal* goal_;
@@ -63,40 +63,8 @@ public:
 
         for (unsigned int axis = 0; axis < Axis4r::AxisCount(); ++axis) {
             //re-create axis controllers if goal mode was changed since last time, or if gains have been updated
-            if (goal_mode[axis] != last_goal_mode_[axis] || params_->gains_changed == true) {
-                switch (goal_mode[axis]) {
-                case GoalModeType::AngleRate:
-                    axis_controllers_[axis].reset(new AngleRateController(params_, clock_));
-                    break;
-                case GoalModeType::AngleLevel:
-                    axis_controllers_[axis].reset(new AngleLevelController(params_, clock_));
-                    break;
-                case GoalModeType::VelocityWorld:
-                    axis_controllers_[axis].reset(new VelocityController(params_, clock_));
-                    break;
-                case GoalModeType::PositionWorld:
-                    axis_controllers_[axis].reset(new PositionController(params_, clock_));
-                    break;
-                case GoalModeType::Passthrough:
-                    axis_controllers_[axis].reset(new PassthroughController());
-                    break;
-                case GoalModeType::Unknown:
-                    axis_controllers_[axis].reset(nullptr);
-                    break;
-                case GoalModeType::ConstantOutput:
-                    axis_controllers_[axis].reset(new ConstantOutputController());
-                    break;
-                default:
-                    throw std::invalid_argument("Axis controller type is not yet implemented for axis " + std::to_string(axis));
-                }
-                last_goal_mode_[axis] = goal_mode[axis];
-
-                //initialize axis controller
-                if (axis_controllers_[axis] != nullptr) {
-                    axis_controllers_[axis]->initialize(axis, goal_, state_estimator_);
-                    axis_controllers_[axis]->reset();
-                }
-            }
+            if (goal_mode[axis] != last_goal_mode_[axis] || params_->gains_changed == true)
+                createAxisController(axis, goal_mode[axis]);
 
             //update axis controller
             if (axis_controllers_[axis] != nullptr) {
@@ -127,6 +95,70 @@ public:
         return is_last_goal_mode_all_passthrough_;
     }
 
+    virtual void saveState(common_utils::StateSnapshot& snapshot) const override
+    {
+        snapshot.write(last_goal_mode_);
+        snapshot.write(last_goal_val_);
+        snapshot.write(output_);
+        for (unsigned int axis = 0; axis < Axis4r::AxisCount(); ++axis) {
+            if (axis_controllers_[axis] != nullptr)
+                axis_controllers_[axis]->saveState(snapshot);
+        }
+    }
+
+    virtual void restoreState(common_utils::StateSnapshot& snapshot) override
+    {
+        const GoalMode goal_mode = snapshot.read<GoalMode>();
+        //controllers of the modes at the time of the snapshot, if they have changed since
+        for (unsigned int axis = 0; axis < Axis4r::AxisCount(); ++axis) {
+            if (goal_mode[axis] != last_goal_mode_[axis])
+                createAxisController(axis, goal_mode[axis]);
+        }
+        snapshot.read(last_goal_val_);
+        snapshot.read(output_);
+        for (unsigned int axis = 0; axis < Axis4r::AxisCount(); ++axis) {
+            if (axis_controllers_[axis] != nullptr)
+                axis_controllers_[axis]->restoreState(snapshot);
+        }
+    }
+
+private:
+    void createAxisController(unsigned int axis, GoalModeType mode)
+    {
+        switch (mode) {
+        case GoalModeType::AngleRate:
+            axis_controllers_[axis].reset(new AngleRateController(params_, clock_));
+            break;
+        case GoalModeType::AngleLevel:
+            axis_controllers_[axis].reset(new AngleLevelController(params_, clock_));
+            break;
+        case GoalModeType::VelocityWorld:
+            axis_controllers_[axis].reset(new VelocityController(params_, clock_));
+            break;
+        case GoalModeType::PositionWorld:
+            axis_controllers_[axis].reset(new PositionController(params_, clock_));
+            break;
+        case GoalModeType::Passthrough:
+            axis_controllers_[axis].reset(new PassthroughController());
+            break;
+        case GoalModeType::Unknown:
+            axis_controllers_[axis].reset(nullptr);
+            break;
+        case GoalModeType::ConstantOutput:
+            axis_controllers_[axis].reset(new ConstantOutputController());
+            break;
+        default:
+            throw std::invalid_argument("Axis controller type is not yet implemented for axis " + std::to_string(axis));
+        }
+        last_goal_mode_[axis] = mode;
+
+        //initialize axis controller
+        if (axis_controllers_[axis] != nullptr) {
+            axis_controllers_[axis]->initialize(axis, goal_, state_estimator_);
+            axis_controllers_[axis]->reset();
+        }
+    }
+
 private:
     Params* params_;
     const IBoardClock* clock_;
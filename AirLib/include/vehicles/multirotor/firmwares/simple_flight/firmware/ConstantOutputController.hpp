@@ -43,6 +43,16 @@ public:
         return output_;
     }
 
+    virtual void saveState(common_utils::StateSnapshot& snapshot) const override
+    {
+        snapshot.write(output_);
+    }
+
+    virtual void restoreState(common_utils::StateSnapshot& snapshot) override
+    {
+        snapshot.read(output_);
+    }
+
 private:
     unsigned int axis_;
     TReal update_output_;
@@ -82,6 +82,25 @@ public:
         return offboard_api_;
     }
 
+    //AdaptiveController keeps its state out of snapshots, it restarts from where it is
+    virtual void saveState(common_utils::StateSnapshot& snapshot) const override
+    {
+        board_->saveState(snapshot);
+        comm_link_->saveState(snapshot);
+        controller_->saveState(snapshot);
+        offboard_api_.saveState(snapshot);
+        snapshot.write(motor_outputs_);
+    }
+
+    virtual void restoreState(common_utils::StateSnapshot& snapshot) override
+    {
+        board_->restoreState(snapshot);
+        comm_link_->restoreState(snapshot);
+        controller_->restoreState(snapshot);
+        offboard_api_.restoreState(snapshot);
+        snapshot.read(motor_outputs_);
+    }
+
 private:
     //objects we use
     Params* params_;
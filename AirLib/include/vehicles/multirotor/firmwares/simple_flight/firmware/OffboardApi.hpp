@@ -61,6 +61,32 @@ public:
         detectTakingOff();
     }
 
+    virtual void saveState(common_utils::StateSnapshot& snapshot) const override
+    {
+        snapshot.write(vehicle_state_);
+        rc_.saveState(snapshot);
+        snapshot.write(goal_);
+        snapshot.write(goal_mode_);
+        snapshot.writeTime(goal_timestamp_);
+        snapshot.write(has_api_control_);
+        snapshot.write(is_api_timedout_);
+        snapshot.write(landed_);
+        snapshot.write(takenoff_);
+    }
+
+    virtual void restoreState(common_utils::StateSnapshot& snapshot) override
+    {
+        snapshot.read(vehicle_state_);
+        rc_.restoreState(snapshot);
+        snapshot.read(goal_);
+        snapshot.read(goal_mode_);
+        snapshot.readTime(goal_timestamp_, 1000);
+        snapshot.read(has_api_control_);
+        snapshot.read(is_api_timedout_);
+        snapshot.read(landed_);
+        snapshot.read(takenoff_);
+    }
+
     /**************** IOffboardApi ********************/
 
     virtual const Axis4r& getGoalValue() const override
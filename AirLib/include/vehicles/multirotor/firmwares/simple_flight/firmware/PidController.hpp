@@ -110,6 +110,28 @@ public:
         last_time_ = clock_->millis();
     }
 
+    virtual void saveState(common_utils::StateSnapshot& snapshot) const override
+    {
+        snapshot.write(goal_);
+        snapshot.write(measured_);
+        snapshot.write(output_);
+        snapshot.write(last_time_);
+        snapshot.write(last_error_);
+        integrator->saveState(snapshot);
+    }
+
+    virtual void restoreState(common_utils::StateSnapshot& snapshot) override
+    {
+        snapshot.read(goal_);
+        snapshot.read(measured_);
+        snapshot.read(output_);
+        snapshot.read(last_time_);
+        if (clock_ != nullptr)
+            snapshot.shiftTime(last_time_, 1000);
+        snapshot.read(last_error_);
+        integrator->restoreState(snapshot);
+    }
+
 private:
     //TODO: replace with std::clamp after moving to C++17
     static T clip(T val, T min_value, T max_value)
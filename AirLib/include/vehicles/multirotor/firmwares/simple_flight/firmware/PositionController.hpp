@@ -80,6 +80,22 @@ public:
         return output_;
     }
 
+    virtual void saveState(common_utils::StateSnapshot& snapshot) const override
+    {
+        pid_->saveState(snapshot);
+        velocity_controller_->saveState(snapshot);
+        snapshot.write(velocity_goal_);
+        snapshot.write(output_);
+    }
+
+    virtual void restoreState(common_utils::StateSnapshot& snapshot) override
+    {
+        pid_->restoreState(snapshot);
+        velocity_controller_->restoreState(snapshot);
+        snapshot.read(velocity_goal_);
+        snapshot.read(output_);
+    }
+
     /********************  IGoal ********************/
     virtual const Axis4r& getGoalValue() const override
     {
@@ -152,6 +152,28 @@ public:
         return board_inputs_->getAvgMotorOutput();
     }
 
+    virtual void saveState(common_utils::StateSnapshot& snapshot) const override
+    {
+        snapshot.write(goal_);
+        snapshot.write(goal_mode_);
+        snapshot.writeTime(last_rec_read_);
+        snapshot.write(angle_mode_);
+        snapshot.write(last_angle_mode_);
+        snapshot.write(allow_api_control_);
+        snapshot.write(request_duration_);
+    }
+
+    virtual void restoreState(common_utils::StateSnapshot& snapshot) override
+    {
+        snapshot.read(goal_);
+        snapshot.read(goal_mode_);
+        snapshot.readTime(last_rec_read_, 1000);
+        snapshot.read(angle_mode_);
+        snapshot.read(last_angle_mode_);
+        snapshot.read(allow_api_control_);
+        snapshot.read(request_duration_);
+    }
+
 private:
     enum class RcRequestType
     {
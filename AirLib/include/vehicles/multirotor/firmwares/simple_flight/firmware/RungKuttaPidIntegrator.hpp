@@ -45,6 +45,22 @@ public:
         return config_.ki * yp[0];
     }
 
+    virtual void saveState(common_utils::StateSnapshot& snapshot) const override
+    {
+        snapshot.write(iterm_int_);
+        snapshot.write(y_vec);
+        snapshot.write(yp_vec);
+        snapshot.write(error_int);
+    }
+
+    virtual void restoreState(common_utils::StateSnapshot& snapshot) override
+    {
+        snapshot.read(iterm_int_);
+        snapshot.read(y_vec);
+        snapshot.read(yp_vec);
+        snapshot.read(error_int);
+    }
+
 private:
     void clipIterm()
     {
@@ -44,6 +44,16 @@ public:
         return iterm_int_;
     }
 
+    virtual void saveState(common_utils::StateSnapshot& snapshot) const override
+    {
+        snapshot.write(iterm_int_);
+    }
+
+    virtual void restoreState(common_utils::StateSnapshot& snapshot) override
+    {
+        snapshot.read(iterm_int_);
+    }
+
 private:
     void clipIterm()
     {
@@ -126,6 +126,22 @@ public:
         return output_;
     }
 
+    virtual void saveState(common_utils::StateSnapshot& snapshot) const override
+    {
+        pid_->saveState(snapshot);
+        child_controller_->saveState(snapshot);
+        snapshot.write(child_goal_);
+        snapshot.write(output_);
+    }
+
+    virtual void restoreState(common_utils::StateSnapshot& snapshot) override
+    {
+        pid_->restoreState(snapshot);
+        child_controller_->restoreState(snapshot);
+        snapshot.read(child_goal_);
+        snapshot.read(output_);
+    }
+
     /********************  IGoal ********************/
     virtual const Axis4r& getGoalValue() const override
     {
@@ -76,6 +76,20 @@ public:
         return 3;
     }
 
+    //for state snapshots, which can't copy classes with a vtable as raw bytes
+    template <typename TSnapshot>
+    void saveState(TSnapshot& snapshot) const
+    {
+        for (unsigned int axis = 0; axis < AxisCount(); ++axis)
+            snapshot.write(vals_[axis]);
+    }
+    template <typename TSnapshot>
+    void restoreState(TSnapshot& snapshot)
+    {
+        for (unsigned int axis = 0; axis < AxisCount(); ++axis)
+            snapshot.read(vals_[axis]);
+    }
+
 private:
     T vals_[3];
 };
@@ -151,6 +165,19 @@ public:
         return Axis4<T>((*this)[0] * other[0], (*this)[1] * other[1], (*this)[2] * other[2], (*this)[3] * other[3]);
     }
 
+    template <typename TSnapshot>
+    void saveState(TSnapshot& snapshot) const
+    {
+        Axis3<T>::saveState(snapshot);
+        snapshot.write(val4_);
+    }
+    template <typename TSnapshot>
+    void restoreState(TSnapshot& snapshot)
+    {
+        Axis3<T>::restoreState(snapshot);
+        snapshot.read(val4_);
+    }
+
     T& throttle()
     {
         return val4_;
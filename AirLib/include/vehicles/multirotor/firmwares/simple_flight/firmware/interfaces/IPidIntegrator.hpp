@@ -1,6 +1,7 @@
 #pragma once
 
 #include "CommonStructs.hpp"
+#include "common/common_utils/StateSnapshot.hpp"
 #include <algorithm>
 
 namespace simple_flight
@@ -15,6 +16,8 @@ public:
     virtual void set(T val) = 0;
     virtual void update(float dt, T error, uint64_t last_time) = 0;
     virtual T getOutput() = 0;
+    virtual void saveState(common_utils::StateSnapshot& snapshot) const = 0;
+    virtual void restoreState(common_utils::StateSnapshot& snapshot) = 0;
 };
 
 } //namespace
\ No newline at end of file
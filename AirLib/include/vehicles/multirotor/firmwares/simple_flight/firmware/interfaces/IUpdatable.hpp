@@ -1,5 +1,8 @@
 #pragma once
 
+#include "common/common_utils/StateSnapshot.hpp"
+#include "common/common_utils/Utils.hpp"
+
 namespace simple_flight
 {
 
@@ -20,6 +23,17 @@ public:
         update_called = true;
     }
 
+    //run time state for common_utils::StateSnapshot, read back in the order it was written.
+    //Times from IBoardClock::millis() are read with readTime(time, 1000)
+    virtual void saveState(common_utils::StateSnapshot& snapshot) const
+    {
+        unused(snapshot);
+    }
+    virtual void restoreState(common_utils::StateSnapshot& snapshot)
+    {
+        unused(snapshot);
+    }
+
     virtual ~IUpdatable() = default;
 
 protected:
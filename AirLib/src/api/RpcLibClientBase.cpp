@@ -14,6 +14,12 @@
 #include <functional>
 #include <vector>
 #include <thread>
+#include <atomic>
+#include <future>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
 STRICT_MODE_OFF
 
 #ifndef RPCLIB_MSGPACK
@@ -46,23 +52,225 @@ __pragma(warning(disable : 4239))
     namespace airlib
     {
 
+        static std::shared_ptr<rpc::client> createConnection(const string& ip_address, uint16_t port, float timeout_sec)
+        {
+            auto connection = std::make_shared<rpc::client>(ip_address, port);
+            // some long flight path commands can take a while, so we give it up to 1 hour max.
+            connection->set_timeout(static_cast<int64_t>(timeout_sec * 1.0E3));
+            return connection;
+        }
+
+        struct RpcLibConnectionPool::impl
+        {
+            vector<std::shared_ptr<rpc::client>> connections;
+            std::atomic<uint> next{ 0 };
+
+            std::shared_ptr<rpc::client> acquire()
+            {
+                return connections[next++ % connections.size()];
+            }
+        };
+
+        RpcLibConnectionPool::RpcLibConnectionPool(const string& ip_address, uint16_t port, float timeout_sec, uint connection_count)
+        {
+            pimpl_.reset(new impl());
+            for (uint i = 0; i < std::max(connection_count, 1u); ++i)
+                pimpl_->connections.push_back(createConnection(ip_address, port, timeout_sec));
+        }
+
+        RpcLibConnectionPool::~RpcLibConnectionPool()
+        {
+        }
+
+        uint RpcLibConnectionPool::getConnectionCount() const
+        {
+            return static_cast<uint>(pimpl_->connections.size());
+        }
+
         struct RpcLibClientBase::impl
         {
-            impl(const string& ip_address, uint16_t port, float timeout_sec)
-                : client(ip_address, port)
+            impl(std::shared_ptr<rpc::client> shared_connection)
+                : connection(std::move(shared_connection)), client(*connection)
             {
-                // some long flight path commands can take a while, so we give it up to 1 hour max.
-                client.set_timeout(static_cast<int64_t>(timeout_sec * 1.0E3));
             }
 
-            rpc::client client;
+            //rpc::client is safe to call from several threads, so clients from the same pool just share it
+            std::shared_ptr<rpc::client> connection;
+            rpc::client& client;
+            //-1 until first call that can use packed arrays asks the server
+            std::atomic<int> server_version{ -1 };
         };
 
+        //one waitAny call, woken by the first of its tasks to finish
+        struct AnyTaskWaiter
+        {
+            std::mutex mutex;
+            std::condition_variable cv;
+            int done_index = -1;
+
+            void notify(int index)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (done_index < 0)
+                        done_index = index;
+                }
+                cv.notify_all();
+            }
+        };
+
+        struct RpcLibTaskHandle::State
+        {
+            std::shared_future<RPCLIB_MSGPACK::object_handle> future;
+            std::string vehicle_name;
+
+            //rpclib completes futures on its io thread without any callback we could hook, so the first
+            //waitAny on a task starts a continuation that blocks on the future and wakes the waiters
+            std::mutex waiters_mutex;
+            std::vector<std::pair<std::weak_ptr<AnyTaskWaiter>, int>> waiters;
+            bool watched = false;
+            bool done = false;
+
+            //false if the task is already done
+            static bool addWaiter(const std::shared_ptr<State>& state, const std::shared_ptr<AnyTaskWaiter>& waiter, int index)
+            {
+                std::lock_guard<std::mutex> lock(state->waiters_mutex);
+                if (state->done)
+                    return false;
+
+                state->waiters.erase(std::remove_if(state->waiters.begin(), state->waiters.end(), [](const auto& w) { return w.first.expired(); }),
+                                     state->waiters.end());
+                state->waiters.emplace_back(waiter, index);
+
+                if (!state->watched) {
+                    state->watched = true;
+                    std::thread([state]() {
+                        state->future.wait();
+
+                        std::vector<std::pair<std::weak_ptr<AnyTaskWaiter>, int>> waiters;
+                        {
+                            std::lock_guard<std::mutex> lock(state->waiters_mutex);
+                            state->done = true;
+                            waiters.swap(state->waiters);
+                        }
+                        for (const auto& w : waiters) {
+                            if (auto waiter = w.first.lock())
+                                waiter->notify(w.second);
+                        }
+                    }).detach();
+                }
+                return true;
+            }
+        };
+
+        RpcLibTaskHandle::RpcLibTaskHandle()
+        {
+        }
+
+        RpcLibTaskHandle::RpcLibTaskHandle(void* future, const std::string& vehicle_name)
+            : state_(std::make_shared<State>())
+        {
+            state_->future = std::move(*static_cast<std::future<RPCLIB_MSGPACK::object_handle>*>(future)).share();
+            state_->vehicle_name = vehicle_name;
+        }
+
+        bool RpcLibTaskHandle::valid() const
+        {
+            return state_ != nullptr && state_->future.valid();
+        }
+
+        const std::string& RpcLibTaskHandle::getVehicleName() const
+        {
+            static const std::string empty;
+            return state_ ? state_->vehicle_name : empty;
+        }
+
+        bool RpcLibTaskHandle::isDone() const
+        {
+            return valid() && state_->future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+        }
+
+        bool RpcLibTaskHandle::wait(float timeout_sec) const
+        {
+            if (!valid())
+                return false;
+
+            if (std::isnan(timeout_sec) || timeout_sec == Utils::max<float>()) {
+                state_->future.wait();
+                return true;
+            }
+            return state_->future.wait_for(std::chrono::duration<double>(timeout_sec)) == std::future_status::ready;
+        }
+
+        bool RpcLibTaskHandle::getResult() const
+        {
+            if (!valid())
+                throw std::logic_error("getResult() called on an empty RpcLibTaskHandle");
+
+            return state_->future.get().get().as<bool>();
+        }
+
+        static std::chrono::steady_clock::time_point getDeadline(float timeout_sec)
+        {
+            return std::chrono::steady_clock::now() +
+                   std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(timeout_sec));
+        }
+
+        bool RpcLibTaskHandle::waitAll(const vector<RpcLibTaskHandle>& tasks, float timeout_sec)
+        {
+            const bool forever = std::isnan(timeout_sec) || timeout_sec == Utils::max<float>();
+            const auto deadline = getDeadline(forever ? 0 : timeout_sec);
+
+            for (const auto& task : tasks) {
+                if (!task.valid())
+                    continue;
+                if (forever)
+                    task.state_->future.wait();
+                else if (task.state_->future.wait_until(deadline) != std::future_status::ready)
+                    return false;
+            }
+            return true;
+        }
+
+        int RpcLibTaskHandle::waitAny(const vector<RpcLibTaskHandle>& tasks, float timeout_sec)
+        {
+            const bool forever = std::isnan(timeout_sec) || timeout_sec == Utils::max<float>();
+            const auto deadline = getDeadline(forever ? 0 : timeout_sec);
+
+            bool any_valid = false;
+            for (size_t i = 0; i < tasks.size(); ++i) {
+                if (tasks[i].isDone())
+                    return static_cast<int>(i);
+                any_valid |= tasks[i].valid();
+            }
+            if (!any_valid || (!forever && timeout_sec <= 0))
+                return -1;
+
+            auto waiter = std::make_shared<AnyTaskWaiter>();
+            for (size_t i = 0; i < tasks.size(); ++i) {
+                if (tasks[i].valid() && !State::addWaiter(tasks[i].state_, waiter, static_cast<int>(i)))
+                    return static_cast<int>(i);
+            }
+
+            std::unique_lock<std::mutex> lock(waiter->mutex);
+            const auto is_done = [&waiter] { return waiter->done_index >= 0; };
+            if (forever)
+                waiter->cv.wait(lock, is_done);
+            else
+                waiter->cv.wait_until(lock, deadline, is_done);
+            return waiter->done_index;
+        }
+
         typedef msr::airlib_rpclib::RpcLibAdaptorsBase RpcLibAdaptorsBase;
 
         RpcLibClientBase::RpcLibClientBase(const string& ip_address, uint16_t port, float timeout_sec)
         {
-            pimpl_.reset(new impl(ip_address, port, timeout_sec));
+            pimpl_.reset(new impl(createConnection(ip_address, port, timeout_sec)));
+        }
+
+        RpcLibClientBase::RpcLibClientBase(RpcLibConnectionPool& connection_pool)
+        {
+            pimpl_.reset(new impl(connection_pool.pimpl_->acquire()));
         }
 
         RpcLibClientBase::~RpcLibClientBase()
@@ -112,6 +320,15 @@ __pragma(warning(disable : 4239))
         {
             return pimpl_->client.call("getServerVersion").as<int>();
         }
+        bool RpcLibClientBase::usePackedArrays() const
+        {
+            int server_version = pimpl_->server_version;
+            if (server_version < 0) {
+                server_version = getServerVersion();
+                pimpl_->server_version = server_version;
+            }
+            return server_version >= RpcLibAdaptorsBase::kPackedArraysServerVersion;
+        }
 
         void RpcLibClientBase::reset()
         {
@@ -176,7 +393,8 @@ __pragma(warning(disable : 4239))
 
         msr::airlib::LidarData RpcLibClientBase::getLidarData(const std::string& lidar_name, const std::string& vehicle_name) const
         {
-            return pimpl_->client.call("getLidarData", lidar_name, vehicle_name).as<RpcLibAdaptorsBase::LidarData>().to();
+            const char* method = usePackedArrays() ? "getLidarDataPacked" : "getLidarData";
+            return pimpl_->client.call(method, lidar_name, vehicle_name).as<RpcLibAdaptorsBase::LidarData>().to();
         }
 
         msr::airlib::ImuBase::Output RpcLibClientBase::getImuData(const std::string& imu_name, const std::string& vehicle_name) const
@@ -258,7 +476,8 @@ __pragma(warning(disable : 4239))
 
         vector<ImageCaptureBase::ImageResponse> RpcLibClientBase::simGetImages(vector<ImageCaptureBase::ImageRequest> request, const std::string& vehicle_name, bool external)
         {
-            const auto& response_adaptor = pimpl_->client.call("simGetImages",
+            const char* method = usePackedArrays() ? "simGetImagesPacked" : "simGetImages";
+            const auto& response_adaptor = pimpl_->client.call(method,
                                                                RpcLibAdaptorsBase::ImageRequest::from(request),
                                                                vehicle_name,
                                                                external)
@@ -378,7 +597,8 @@ __pragma(warning(disable : 4239))
 
         vector<MeshPositionVertexBuffersResponse> RpcLibClientBase::simGetMeshPositionVertexBuffers()
         {
-            const auto& response_adaptor = pimpl_->client.call("simGetMeshPositionVertexBuffers").as<vector<RpcLibAdaptorsBase::MeshPositionVertexBuffersResponse>>();
+            const char* method = usePackedArrays() ? "simGetMeshPositionVertexBuffersPacked" : "simGetMeshPositionVertexBuffers";
+            const auto& response_adaptor = pimpl_->client.call(method).as<vector<RpcLibAdaptorsBase::MeshPositionVertexBuffersResponse>>();
             return RpcLibAdaptorsBase::MeshPositionVertexBuffersResponse::to(response_adaptor);
         }
 
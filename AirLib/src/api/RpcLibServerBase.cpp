@@ -93,7 +93,7 @@ namespace airlib
         pimpl_->server.bind("ping", [&]() -> bool { return true; });
 
         pimpl_->server.bind("getServerVersion", []() -> int {
-            return 1;
+            return RpcLibAdaptorsBase::kPackedArraysServerVersion;
         });
 
         pimpl_->server.bind("getMinRequiredClientVersion", []() -> int {
@@ -149,6 +149,11 @@ namespace airlib
             return RpcLibAdaptorsBase::ImageResponse::from(response);
         });
 
+        pimpl_->server.bind("simGetImagesPacked", [&](const std::vector<RpcLibAdaptorsBase::ImageRequest>& request_adapter, const std::string& vehicle_name, bool external) -> vector<RpcLibAdaptorsBase::ImageResponse> {
+            const auto& response = getWorldSimApi()->getImages(RpcLibAdaptorsBase::ImageRequest::to(request_adapter), vehicle_name, external);
+            return RpcLibAdaptorsBase::ImageResponse::from(response, true);
+        });
+
         pimpl_->server.bind("simGetImage", [&](const std::string& camera_name, ImageCaptureBase::ImageType type, const std::string& vehicle_name, bool external) -> vector<uint8_t> {
             return getWorldSimApi()->getImage(type, CameraDetails(camera_name, vehicle_name, external));
         });
@@ -241,6 +246,11 @@ namespace airlib
             return RpcLibAdaptorsBase::MeshPositionVertexBuffersResponse::from(response);
         });
 
+        pimpl_->server.bind("simGetMeshPositionVertexBuffersPacked", [&]() -> vector<RpcLibAdaptorsBase::MeshPositionVertexBuffersResponse> {
+            const auto& response = getWorldSimApi()->getMeshPositionVertexBuffers();
+            return RpcLibAdaptorsBase::MeshPositionVertexBuffersResponse::from(response, true);
+        });
+
         pimpl_->server.bind("simAddVehicle", [&](const std::string& vehicle_name, const std::string& vehicle_type, const RpcLibAdaptorsBase::Pose& pose, const std::string& pawn_path) -> bool {
             return getWorldSimApi()->addVehicle(vehicle_name, vehicle_type, pose.to(), pawn_path);
         });
@@ -309,6 +319,11 @@ namespace airlib
             return RpcLibAdaptorsBase::LidarData(lidar_data);
         });
 
+        pimpl_->server.bind("getLidarDataPacked", [&](const std::string& lidar_name, const std::string& vehicle_name) -> RpcLibAdaptorsBase::LidarData {
+            const auto& lidar_data = getVehicleApi(vehicle_name)->getLidarData(lidar_name);
+            return RpcLibAdaptorsBase::LidarData(lidar_data, true);
+        });
+
         pimpl_->server.bind("getImuData", [&](const std::string& imu_name, const std::string& vehicle_name) -> RpcLibAdaptorsBase::ImuData {
             const auto& imu_data = getVehicleApi(vehicle_name)->getImuData(imu_name);
             return RpcLibAdaptorsBase::ImuData(imu_data);
@@ -0,0 +1,422 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+//in header only mode, control library is not available
+#ifndef AIRLIB_HEADER_ONLY
+
+#include "common/ReplayJournal.hpp"
+#include "common/ClockFactory.hpp"
+#include "common/SteppableClock.hpp"
+#include "common/common_utils/RandomGenerator.hpp"
+#include "api/VehicleApiBase.hpp"
+#include "physics/PhysicsEngineBase.hpp"
+#include "physics/World.hpp"
+#include <fstream>
+#include <stdexcept>
+
+namespace msr
+{
+namespace airlib
+{
+
+    static constexpr char kMagic[8] = { 'A', 'S', 'J', 'R', 'N', 'L', 0, 0 };
+    static constexpr uint32_t kVersion = 1;
+
+    //payloads and the file are raw little endian values, strings prefixed with their size
+    class JournalWriter
+    {
+    public:
+        explicit JournalWriter(vector<uint8_t>& bytes)
+            : bytes_(bytes)
+        {
+        }
+
+        template <typename T>
+        JournalWriter& write(const T& value)
+        {
+            static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value, "only plain values can be written");
+            const uint8_t* begin = reinterpret_cast<const uint8_t*>(&value);
+            bytes_.insert(bytes_.end(), begin, begin + sizeof(T));
+            return *this;
+        }
+        JournalWriter& write(const string& value)
+        {
+            write(static_cast<uint32_t>(value.size()));
+            bytes_.insert(bytes_.end(), value.begin(), value.end());
+            return *this;
+        }
+        JournalWriter& write(const vector<uint8_t>& value)
+        {
+            write(static_cast<uint32_t>(value.size()));
+            bytes_.insert(bytes_.end(), value.begin(), value.end());
+            return *this;
+        }
+        JournalWriter& write(const Vector3r& value)
+        {
+            return write(value.x()).write(value.y()).write(value.z());
+        }
+
+    private:
+        vector<uint8_t>& bytes_;
+    };
+
+    class JournalReader
+    {
+    public:
+        JournalReader(const uint8_t* data, size_t size)
+            : data_(data), size_(size)
+        {
+        }
+
+        template <typename T>
+        JournalReader& read(T& value)
+        {
+            static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value, "only plain values can be read");
+            check(sizeof(T));
+            std::memcpy(&value, data_ + pos_, sizeof(T));
+            pos_ += sizeof(T);
+            return *this;
+        }
+        JournalReader& read(string& value)
+        {
+            uint32_t size;
+            read(size);
+            check(size);
+            value.assign(reinterpret_cast<const char*>(data_ + pos_), size);
+            pos_ += size;
+            return *this;
+        }
+        JournalReader& read(vector<uint8_t>& value)
+        {
+            uint32_t size;
+            read(size);
+            check(size);
+            value.assign(data_ + pos_, data_ + pos_ + size);
+            pos_ += size;
+            return *this;
+        }
+        JournalReader& read(Vector3r& value)
+        {
+            return read(value.x()).read(value.y()).read(value.z());
+        }
+
+    private:
+        void check(size_t size) const
+        {
+            if (pos_ + size > size_)
+                throw std::runtime_error("ReplayJournal: data is truncated");
+        }
+
+        const uint8_t* data_;
+        size_t size_;
+        size_t pos_ = 0;
+    };
+
+    static vector<uint8_t> toPayload(const Vector3r& value)
+    {
+        vector<uint8_t> payload;
+        JournalWriter(payload).write(value);
+        return payload;
+    }
+
+    static Vector3r toVector3r(const vector<uint8_t>& payload)
+    {
+        Vector3r value;
+        JournalReader(payload.data(), payload.size()).read(value);
+        return value;
+    }
+
+    ReplayJournal::ReplayJournal()
+    {
+    }
+
+    ReplayJournal::~ReplayJournal()
+    {
+    }
+
+    void ReplayJournal::setPhysicsEngine(PhysicsEngineBase* physics_engine)
+    {
+        physics_engine_ = physics_engine;
+    }
+
+    void ReplayJournal::addVehicle(const string& vehicle_name, VehicleApiBase* api)
+    {
+        vehicles_[vehicle_name] = api;
+    }
+
+    void ReplayJournal::addCommandHandler(const string& command, const CommandHandler& handler)
+    {
+        command_handlers_[command] = handler;
+    }
+
+    void ReplayJournal::setWind(const Vector3r& wind)
+    {
+        Input input;
+        input.type = InputType::Wind;
+        input.payload = toPayload(wind);
+        submit(std::move(input));
+    }
+
+    void ReplayJournal::setExtForce(const Vector3r& ext_force)
+    {
+        Input input;
+        input.type = InputType::ExtForce;
+        input.payload = toPayload(ext_force);
+        submit(std::move(input));
+    }
+
+    void ReplayJournal::setRCData(const string& vehicle_name, const RCData& rc_data)
+    {
+        Input input;
+        input.type = InputType::RCData;
+        input.vehicle_name = vehicle_name;
+        JournalWriter(input.payload)
+            .write(rc_data.timestamp)
+            .write(rc_data.pitch)
+            .write(rc_data.roll)
+            .write(rc_data.throttle)
+            .write(rc_data.yaw)
+            .write(rc_data.left_z)
+            .write(rc_data.right_z)
+            .write(rc_data.switches)
+            .write(rc_data.vendor_id)
+            .write(static_cast<uint8_t>(rc_data.is_initialized))
+            .write(static_cast<uint8_t>(rc_data.is_valid));
+        submit(std::move(input));
+    }
+
+    void ReplayJournal::enableApiControl(const string& vehicle_name, bool is_enabled)
+    {
+        Input input;
+        input.type = InputType::ApiControl;
+        input.vehicle_name = vehicle_name;
+        JournalWriter(input.payload).write(static_cast<uint8_t>(is_enabled));
+        submit(std::move(input));
+    }
+
+    void ReplayJournal::armDisarm(const string& vehicle_name, bool arm)
+    {
+        Input input;
+        input.type = InputType::ArmDisarm;
+        input.vehicle_name = vehicle_name;
+        JournalWriter(input.payload).write(static_cast<uint8_t>(arm));
+        submit(std::move(input));
+    }
+
+    void ReplayJournal::sendCommand(const string& vehicle_name, const string& command, const vector<uint8_t>& payload)
+    {
+        Input input;
+        input.type = InputType::Command;
+        input.vehicle_name = vehicle_name;
+        input.command = command;
+        input.payload = payload;
+        submit(std::move(input));
+    }
+
+    void ReplayJournal::submit(Input&& input)
+    {
+        //replay only applies what was recorded
+        if (mode_ == Mode::Replaying)
+            return;
+
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        pending_.push_back(std::move(input));
+    }
+
+    void ReplayJournal::beginFrame(FrameType type)
+    {
+        if (mode_ == Mode::Replaying) {
+            if (replay_index_ >= frames_.size() || frames_[replay_index_].type != type)
+                throw std::logic_error("ReplayJournal: world ran a frame that is not next in the replay");
+            for (const Input& input : frames_[replay_index_].inputs)
+                apply(input);
+            ++replay_index_;
+            return;
+        }
+
+        vector<Input> inputs;
+        {
+            std::lock_guard<std::mutex> lock(pending_mutex_);
+            inputs.swap(pending_);
+        }
+        for (const Input& input : inputs)
+            apply(input);
+
+        if (mode_ == Mode::Recording) {
+            Frame frame;
+            frame.type = type;
+            frame.time = ClockFactory::get()->nowNanos();
+            frame.inputs = std::move(inputs);
+            frames_.push_back(std::move(frame));
+        }
+    }
+
+    VehicleApiBase* ReplayJournal::getVehicle(const string& vehicle_name) const
+    {
+        auto found = vehicles_.find(vehicle_name);
+        if (found == vehicles_.end()) {
+            Utils::log(Utils::stringf("ReplayJournal: input for unknown vehicle '%s' is ignored", vehicle_name.c_str()), Utils::kLogLevelWarn);
+            return nullptr;
+        }
+        return found->second;
+    }
+
+    void ReplayJournal::apply(const Input& input)
+    {
+        switch (input.type) {
+        case InputType::Wind:
+            if (physics_engine_)
+                physics_engine_->setWind(toVector3r(input.payload));
+            break;
+        case InputType::ExtForce:
+            if (physics_engine_)
+                physics_engine_->setExtForce(toVector3r(input.payload));
+            break;
+        case InputType::RCData:
+            if (VehicleApiBase* api = getVehicle(input.vehicle_name)) {
+                RCData rc_data;
+                uint8_t is_initialized, is_valid;
+                JournalReader(input.payload.data(), input.payload.size())
+                    .read(rc_data.timestamp)
+                    .read(rc_data.pitch)
+                    .read(rc_data.roll)
+                    .read(rc_data.throttle)
+                    .read(rc_data.yaw)
+                    .read(rc_data.left_z)
+                    .read(rc_data.right_z)
+                    .read(rc_data.switches)
+                    .read(rc_data.vendor_id)
+                    .read(is_initialized)
+                    .read(is_valid);
+                rc_data.is_initialized = is_initialized != 0;
+                rc_data.is_valid = is_valid != 0;
+                api->setRCData(rc_data);
+            }
+            break;
+        case InputType::ApiControl:
+            if (VehicleApiBase* api = getVehicle(input.vehicle_name))
+                api->enableApiControl(!input.payload.empty() && input.payload[0] != 0);
+            break;
+        case InputType::ArmDisarm:
+            if (VehicleApiBase* api = getVehicle(input.vehicle_name))
+                api->armDisarm(!input.payload.empty() && input.payload[0] != 0);
+            break;
+        case InputType::Command: {
+            auto handler = command_handlers_.find(input.command);
+            if (handler == command_handlers_.end()) {
+                Utils::log(Utils::stringf("ReplayJournal: no handler for command '%s'", input.command.c_str()), Utils::kLogLevelWarn);
+                break;
+            }
+            //commands may be for the world rather than one vehicle
+            VehicleApiBase* api = input.vehicle_name.empty() ? nullptr : getVehicle(input.vehicle_name);
+            handler->second(api, input.payload);
+            break;
+        }
+        }
+    }
+
+    void ReplayJournal::startRecording()
+    {
+        frames_.clear();
+        replay_index_ = 0;
+        seed_offset_ = common_utils::getRandomGeneratorSeedOffset();
+        mode_ = Mode::Recording;
+    }
+
+    void ReplayJournal::stopRecording()
+    {
+        if (mode_ == Mode::Recording)
+            mode_ = Mode::Idle;
+    }
+
+    void ReplayJournal::save(const string& file_name) const
+    {
+        vector<uint8_t> bytes(kMagic, kMagic + sizeof(kMagic));
+        JournalWriter writer(bytes);
+        writer.write(kVersion).write(static_cast<uint32_t>(seed_offset_)).write(static_cast<uint64_t>(frames_.size()));
+        for (const Frame& frame : frames_) {
+            writer.write(frame.type).write(frame.time).write(static_cast<uint32_t>(frame.inputs.size()));
+            for (const Input& input : frame.inputs)
+                writer.write(input.type).write(input.vehicle_name).write(input.command).write(input.payload);
+        }
+
+        std::ofstream file(file_name, std::ios::binary | std::ios::trunc);
+        if (!file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size()))
+            throw std::ios_base::failure(Utils::stringf("ReplayJournal: can't write %s", file_name.c_str()));
+    }
+
+    void ReplayJournal::load(const string& file_name)
+    {
+        std::ifstream file(file_name, std::ios::binary);
+        if (!file)
+            throw std::runtime_error(Utils::stringf("ReplayJournal: can't open %s", file_name.c_str()));
+        const vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        if (bytes.size() < sizeof(kMagic) || !std::equal(kMagic, kMagic + sizeof(kMagic), bytes.begin()))
+            throw std::runtime_error(Utils::stringf("ReplayJournal: %s is not a journal", file_name.c_str()));
+
+        JournalReader reader(bytes.data() + sizeof(kMagic), bytes.size() - sizeof(kMagic));
+        uint32_t version, seed_offset;
+        uint64_t frame_count;
+        reader.read(version).read(seed_offset).read(frame_count);
+        if (version != kVersion)
+            throw std::runtime_error(Utils::stringf("ReplayJournal: unsupported version %u", version));
+
+        vector<Frame> frames;
+        for (uint64_t f = 0; f < frame_count; ++f) {
+            Frame frame;
+            uint32_t input_count;
+            reader.read(frame.type).read(frame.time).read(input_count);
+            frame.inputs.resize(input_count);
+            for (Input& input : frame.inputs)
+                reader.read(input.type).read(input.vehicle_name).read(input.command).read(input.payload);
+            frames.push_back(std::move(frame));
+        }
+
+        frames_ = std::move(frames);
+        seed_offset_ = seed_offset;
+        replay_index_ = 0;
+        mode_ = Mode::Idle;
+    }
+
+    void ReplayJournal::startReplay()
+    {
+        {
+            std::lock_guard<std::mutex> lock(pending_mutex_);
+            pending_.clear();
+        }
+        common_utils::getRandomGeneratorSeedOffset() = seed_offset_;
+        //the world steps the clock by zero, every frame sets the time it was recorded at
+        replay_clock_ = std::make_shared<SteppableClock>(0, frames_.empty() ? 0 : frames_.front().time);
+        ClockFactory::get(replay_clock_);
+        replay_index_ = 0;
+        mode_ = Mode::Replaying;
+    }
+
+    bool ReplayJournal::replayFrame(World& world)
+    {
+        if (mode_ != Mode::Replaying)
+            return false;
+        if (replay_index_ >= frames_.size()) {
+            mode_ = Mode::Idle;
+            return false;
+        }
+
+        const Frame& frame = frames_[replay_index_];
+        replay_clock_->advanceTo(frame.time);
+        if (frame.type == FrameType::Reset)
+            world.reset();
+        else
+            world.update();
+        return true;
+    }
+
+    void ReplayJournal::replay(World& world)
+    {
+        startReplay();
+        while (replayFrame(world)) {
+        }
+    }
+}
+} //namespace
+
+#endif
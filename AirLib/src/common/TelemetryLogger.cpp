@@ -0,0 +1,705 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+//in header only mode, control library is not available
+#ifndef AIRLIB_HEADER_ONLY
+
+#include "common/TelemetryLogger.hpp"
+#include "common/common_utils/FileSystem.hpp"
+#include "common/common_utils/json.hpp"
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+
+#if defined _WIN32 || defined _WIN64
+
+#include "common/common_utils/WindowsApisCommonPre.hpp"
+
+#include "common/common_utils/MinWinDefines.hpp"
+
+#undef NOKERNEL // All KERNEL #undefs and routines
+
+#include <Windows.h>
+
+#include "common/common_utils/WindowsApisCommonPost.hpp"
+
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <errno.h>
+#endif
+
+namespace msr
+{
+namespace airlib
+{
+
+    //Windows maps views at multiples of the allocation granularity, which is 64KB
+    static constexpr uint64_t kMapAlignment = 64 * 1024;
+    static constexpr char kMagic[8] = { 'A', 'S', 'T', 'E', 'L', 'E', 'M', 0 };
+    static constexpr uint32_t kVersion = 1;
+    //columns are appended to their file in chunks this big so files don't have to stay open
+    static constexpr size_t kColumnChunk = 256 * 1024;
+
+    static uint64_t roundUp(uint64_t value, uint64_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    template <typename T>
+    static void appendBytes(vector<uint8_t>& bytes, const T& value)
+    {
+        const uint8_t* begin = reinterpret_cast<const uint8_t*>(&value);
+        bytes.insert(bytes.end(), begin, begin + sizeof(T));
+    }
+    static void appendString(vector<uint8_t>& bytes, const string& value)
+    {
+        appendBytes(bytes, static_cast<uint32_t>(value.size()));
+        bytes.insert(bytes.end(), value.begin(), value.end());
+    }
+
+    template <typename T>
+    static T readBytes(const vector<uint8_t>& bytes, size_t& pos)
+    {
+        if (pos + sizeof(T) > bytes.size())
+            throw std::runtime_error("TelemetryReader: schema is truncated");
+        T value;
+        std::memcpy(&value, &bytes[pos], sizeof(T));
+        pos += sizeof(T);
+        return value;
+    }
+    static string readString(const vector<uint8_t>& bytes, size_t& pos)
+    {
+        const uint32_t size = readBytes<uint32_t>(bytes, pos);
+        if (pos + size > bytes.size())
+            throw std::runtime_error("TelemetryReader: schema is truncated");
+        string value(bytes.begin() + pos, bytes.begin() + pos + size);
+        pos += size;
+        return value;
+    }
+
+    /******************** file mapping ********************/
+
+    struct TelemetryLogger::MappedFile
+    {
+#if defined _WIN32 || defined _WIN64
+        HANDLE file = INVALID_HANDLE_VALUE;
+
+        void open(const string& file_name)
+        {
+            file = CreateFileA(file_name.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+            if (file == INVALID_HANDLE_VALUE)
+                throw std::ios_base::failure(Utils::stringf("TelemetryLogger: can't create %s, error %d", file_name.c_str(), GetLastError()));
+        }
+
+        //grows the file to offset + size
+        uint8_t* map(uint64_t offset, uint64_t size)
+        {
+            const uint64_t end = offset + size;
+            HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READWRITE, static_cast<DWORD>(end >> 32), static_cast<DWORD>(end), NULL);
+            if (mapping == NULL)
+                throw std::ios_base::failure(Utils::stringf("TelemetryLogger: CreateFileMapping failed, error %d", GetLastError()));
+            void* data = MapViewOfFile(mapping, FILE_MAP_WRITE, static_cast<DWORD>(offset >> 32), static_cast<DWORD>(offset), static_cast<SIZE_T>(size));
+            //the view keeps the mapping alive
+            CloseHandle(mapping);
+            if (data == NULL)
+                throw std::ios_base::failure(Utils::stringf("TelemetryLogger: MapViewOfFile failed, error %d", GetLastError()));
+            return static_cast<uint8_t*>(data);
+        }
+
+        void unmap(uint8_t* data, uint64_t /*size*/)
+        {
+            UnmapViewOfFile(data);
+        }
+
+        void flush(uint8_t* data, uint64_t size, bool sync)
+        {
+            FlushViewOfFile(data, static_cast<SIZE_T>(size));
+            if (sync)
+                FlushFileBuffers(file);
+        }
+
+        void close(uint64_t file_size)
+        {
+            if (file == INVALID_HANDLE_VALUE)
+                return;
+            LARGE_INTEGER end;
+            end.QuadPart = static_cast<LONGLONG>(file_size);
+            if (SetFilePointerEx(file, end, NULL, FILE_BEGIN))
+                SetEndOfFile(file);
+            CloseHandle(file);
+            file = INVALID_HANDLE_VALUE;
+        }
+#else
+        int fd = -1;
+        uint64_t file_size = 0;
+
+        void open(const string& file_name)
+        {
+            fd = ::open(file_name.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+            if (fd < 0)
+                throw std::ios_base::failure(Utils::stringf("TelemetryLogger: can't create %s: %s", file_name.c_str(), strerror(errno)));
+            file_size = 0;
+        }
+
+        //grows the file to offset + size
+        uint8_t* map(uint64_t offset, uint64_t size)
+        {
+            if (offset + size > file_size) {
+                if (ftruncate(fd, static_cast<off_t>(offset + size)) != 0)
+                    throw std::ios_base::failure(Utils::stringf("TelemetryLogger: can't grow file: %s", strerror(errno)));
+                file_size = offset + size;
+            }
+            void* data = mmap(nullptr, static_cast<size_t>(size), PROT_READ | PROT_WRITE, MAP_SHARED, fd, static_cast<off_t>(offset));
+            if (data == MAP_FAILED)
+                throw std::ios_base::failure(Utils::stringf("TelemetryLogger: mmap failed: %s", strerror(errno)));
+            return static_cast<uint8_t*>(data);
+        }
+
+        void unmap(uint8_t* data, uint64_t size)
+        {
+            munmap(data, static_cast<size_t>(size));
+        }
+
+        void flush(uint8_t* data, uint64_t size, bool sync)
+        {
+            msync(data, static_cast<size_t>(size), sync ? MS_SYNC : MS_ASYNC);
+            if (sync)
+                fsync(fd);
+        }
+
+        void close(uint64_t size)
+        {
+            if (fd < 0)
+                return;
+            if (ftruncate(fd, static_cast<off_t>(size)) == 0)
+                fsync(fd);
+            ::close(fd);
+            fd = -1;
+        }
+#endif
+    };
+
+    /******************** TelemetryLogger ********************/
+
+    TelemetryLogger::TelemetryLogger()
+        : TelemetryLogger(Params())
+    {
+    }
+
+    TelemetryLogger::TelemetryLogger(const Params& params)
+        : params_(params)
+    {
+        if (params_.segment_size == 0 || params_.segment_size % kMapAlignment != 0)
+            throw std::invalid_argument("TelemetryLogger: segment_size must be a non-zero multiple of 64KB");
+    }
+
+    TelemetryLogger::~TelemetryLogger()
+    {
+        close();
+    }
+
+    vector<TelemetryLogger::Field> TelemetryLogger::vector3Fields(const string& name)
+    {
+        const FieldType type = sizeof(real_T) == 4 ? FieldType::Float32 : FieldType::Float64;
+        return { Field(name + ".x", type), Field(name + ".y", type), Field(name + ".z", type) };
+    }
+
+    vector<TelemetryLogger::Field> TelemetryLogger::quaternionFields(const string& name)
+    {
+        const FieldType type = sizeof(real_T) == 4 ? FieldType::Float32 : FieldType::Float64;
+        return { Field(name + ".w", type), Field(name + ".x", type), Field(name + ".y", type), Field(name + ".z", type) };
+    }
+
+    uint TelemetryLogger::getFieldSize(FieldType type)
+    {
+        switch (type) {
+        case FieldType::Float32:
+        case FieldType::Int32:
+        case FieldType::UInt32:
+            return 4;
+        case FieldType::Float64:
+        case FieldType::Int64:
+        case FieldType::UInt64:
+            return 8;
+        default:
+            throw std::invalid_argument(Utils::stringf("TelemetryLogger: unknown field type %u", static_cast<uint>(type)));
+        }
+    }
+
+    string TelemetryLogger::getFieldTypeName(FieldType type)
+    {
+        switch (type) {
+        case FieldType::Float32:
+            return "float32";
+        case FieldType::Float64:
+            return "float64";
+        case FieldType::Int32:
+            return "int32";
+        case FieldType::UInt32:
+            return "uint32";
+        case FieldType::Int64:
+            return "int64";
+        case FieldType::UInt64:
+            return "uint64";
+        default:
+            throw std::invalid_argument(Utils::stringf("TelemetryLogger: unknown field type %u", static_cast<uint>(type)));
+        }
+    }
+
+    uint TelemetryLogger::addChannel(const string& name, const vector<Field>& fields)
+    {
+        if (is_open_)
+            throw std::logic_error("TelemetryLogger: channels must be added before open()");
+
+        Channel channel;
+        channel.name = name;
+        channel.fields = fields;
+        for (const Field& field : fields)
+            channel.payload_size += getFieldSize(field.type);
+        channel.record_size = static_cast<uint>(roundUp(kRecordHeaderSize + channel.payload_size, 8));
+        if (channel.record_size > params_.segment_size)
+            throw std::invalid_argument(Utils::stringf("TelemetryLogger: record of channel %s doesn't fit in a segment", name.c_str()));
+
+        channels_.push_back(channel);
+        return static_cast<uint>(channels_.size() - 1);
+    }
+
+    void TelemetryLogger::open(const string& file_name)
+    {
+        close();
+
+        //schema, padded so segments after it stay aligned
+        vector<uint8_t> header(kMagic, kMagic + sizeof(kMagic));
+        appendBytes(header, kVersion);
+        appendBytes(header, static_cast<uint32_t>(channels_.size()));
+        appendBytes(header, params_.segment_size);
+        const size_t data_offset_pos = header.size();
+        appendBytes(header, uint64_t(0));
+        for (const Channel& channel : channels_) {
+            appendString(header, channel.name);
+            appendBytes(header, static_cast<uint32_t>(channel.fields.size()));
+            for (const Field& field : channel.fields) {
+                appendBytes(header, static_cast<uint32_t>(field.type));
+                appendString(header, field.name);
+            }
+        }
+        const uint64_t data_offset = roundUp(header.size(), kMapAlignment);
+        std::memcpy(&header[data_offset_pos], &data_offset, sizeof(data_offset));
+
+        file_.reset(new MappedFile());
+        file_->open(file_name);
+        uint8_t* header_data = file_->map(0, data_offset);
+        std::memcpy(header_data, header.data(), header.size());
+        file_->flush(header_data, data_offset, false);
+        file_->unmap(header_data, data_offset);
+
+        next_offset_ = data_offset;
+        for (Segment& segment : segments_)
+            mapSegment(segment);
+        segments_[0].ready = false;
+        active_ = &segments_[0];
+        record_count_ = 0;
+        dropped_count_ = 0;
+        segment_retired_ = false;
+        is_stopping_ = false;
+        {
+            std::lock_guard<std::mutex> lock(error_mutex_);
+            error_.clear();
+        }
+        is_open_ = true;
+
+        flush_thread_ = std::thread(&TelemetryLogger::flushLoop, this);
+    }
+
+    void TelemetryLogger::close()
+    {
+        if (!is_open_)
+            return;
+
+        Segment* last = active_.exchange(nullptr);
+        {
+            std::lock_guard<std::mutex> lock(flush_mutex_);
+            is_stopping_ = true;
+        }
+        flush_signal_.notify_one();
+        flush_thread_.join();
+
+        //segments were mapped in file order, so the file ends with the last active one
+        for (Segment& segment : segments_) {
+            while (segment.writers != 0)
+                std::this_thread::yield();
+            //data is null if the flush thread couldn't map it again
+            if (segment.data != nullptr) {
+                if (&segment == last || segment.retired) {
+                    const uint64_t used = segment.reserved > params_.segment_size ? segment.used.load() : segment.reserved.load();
+                    file_->flush(segment.data, used, true);
+                }
+                file_->unmap(segment.data, params_.segment_size);
+                segment.data = nullptr;
+            }
+            segment.retired = false;
+            segment.ready = false;
+        }
+        const uint64_t reserved = last->reserved;
+        file_->close(last->file_offset + (reserved > params_.segment_size ? last->used.load() : reserved));
+        file_.reset();
+        is_open_ = false;
+    }
+
+    bool TelemetryLogger::write(uint channel, TTimePoint time_stamp, const void* payload)
+    {
+        if (channel >= channels_.size())
+            throw std::invalid_argument(Utils::stringf("TelemetryLogger: unknown channel %u", channel));
+
+        Segment* segment;
+        uint8_t* record = beginRecord(channel, time_stamp, segment);
+        if (record == nullptr)
+            return false;
+        std::memcpy(record + kRecordHeaderSize, payload, channels_[channel].payload_size);
+        endRecord(segment);
+        return true;
+    }
+
+    uint8_t* TelemetryLogger::beginRecord(uint channel, TTimePoint time_stamp, Segment*& segment)
+    {
+        const uint32_t record_size = channels_[channel].record_size;
+        while (true) {
+            segment = active_.load();
+            if (segment == nullptr)
+                return nullptr;
+
+            //while counted as a writer the segment can't be recycled, so if it is still active
+            //after that it is the same one we loaded
+            segment->writers.fetch_add(1);
+            if (segment != active_.load()) {
+                segment->writers.fetch_sub(1);
+                continue;
+            }
+
+            const uint64_t offset = segment->reserved.fetch_add(record_size);
+            if (offset + record_size <= params_.segment_size) {
+                uint8_t* record = segment->data + offset;
+                std::memcpy(record, &time_stamp, 8);
+                std::memcpy(record + 8, &channel, 4);
+                std::memcpy(record + 12, &record_size, 4);
+                //padding, so files don't keep stale bytes from whoever used the page before
+                std::memset(record + kRecordHeaderSize + channels_[channel].payload_size, 0,
+                            record_size - kRecordHeaderSize - channels_[channel].payload_size);
+                return record;
+            }
+
+            //exactly one writer crosses the end, and everything before it fit
+            if (offset <= params_.segment_size)
+                segment->used = offset;
+
+            Segment* standby = getOther(segment);
+            const bool swapped = standby->ready.exchange(false);
+            if (swapped) {
+                segment->retired = true;
+                active_ = standby;
+            }
+            const bool is_stale = active_.load() != segment;
+            segment->writers.fetch_sub(1);
+
+            if (swapped) {
+                //no lock here so the flush thread may miss this, it looks again every sync_period
+                segment_retired_ = true;
+                flush_signal_.notify_one();
+            }
+            else if (!is_stale) {
+                ++dropped_count_;
+                return nullptr;
+            }
+        }
+    }
+
+    void TelemetryLogger::mapSegment(Segment& segment)
+    {
+        segment.data = file_->map(next_offset_, params_.segment_size);
+        segment.file_offset = next_offset_;
+        next_offset_ += params_.segment_size;
+        segment.reserved = 0;
+        segment.used = 0;
+        segment.retired = false;
+        segment.ready = true;
+    }
+
+    void TelemetryLogger::retireSegment(Segment& segment)
+    {
+        while (segment.writers != 0)
+            std::this_thread::yield();
+
+        //tail after used is still zero from when the file grew, which readers take as end of segment
+        //data is null if mapping it again failed before
+        if (segment.data != nullptr) {
+            file_->flush(segment.data, segment.used, true);
+            file_->unmap(segment.data, params_.segment_size);
+            segment.data = nullptr;
+        }
+        mapSegment(segment);
+    }
+
+    string TelemetryLogger::getError() const
+    {
+        std::lock_guard<std::mutex> lock(error_mutex_);
+        return error_;
+    }
+
+    void TelemetryLogger::flushLoop()
+    {
+        const auto period = std::chrono::duration<double>(params_.sync_period);
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(flush_mutex_);
+                flush_signal_.wait_for(lock, period, [this] { return is_stopping_ || segment_retired_; });
+                if (is_stopping_)
+                    break;
+            }
+            segment_retired_ = false;
+
+            for (Segment& segment : segments_) {
+                if (!segment.retired)
+                    continue;
+                //segment stays retired and not ready, so writers drop records and we retry every sync_period
+                try {
+                    retireSegment(segment);
+                }
+                catch (const std::ios_base::failure& e) {
+                    std::lock_guard<std::mutex> lock(error_mutex_);
+                    if (error_ != e.what())
+                        Utils::log(e.what(), Utils::kLogLevelError);
+                    error_ = e.what();
+                }
+            }
+
+            //start writing back what's there so far without waiting for it
+            Segment* active = active_.load();
+            if (active != nullptr)
+                file_->flush(active->data, std::min(active->reserved.load(), params_.segment_size), false);
+        }
+    }
+
+    /******************** TelemetryReader ********************/
+
+    TelemetryReader::TelemetryReader(const string& file_name)
+        : file_name_(file_name)
+    {
+        std::ifstream file(file_name, std::ios::binary | std::ios::ate);
+        if (!file)
+            throw std::runtime_error(Utils::stringf("TelemetryReader: can't open %s", file_name.c_str()));
+        file_size_ = static_cast<uint64_t>(file.tellg());
+
+        //magic, version, channel count, segment size, data offset
+        vector<uint8_t> header(32);
+        file.seekg(0);
+        if (file_size_ < header.size() || !file.read(reinterpret_cast<char*>(header.data()), header.size()) ||
+            !std::equal(header.begin(), header.begin() + sizeof(kMagic), kMagic))
+            throw std::runtime_error(Utils::stringf("TelemetryReader: %s is not a telemetry file", file_name.c_str()));
+
+        size_t pos = sizeof(kMagic);
+        const uint32_t version = readBytes<uint32_t>(header, pos);
+        if (version != kVersion)
+            throw std::runtime_error(Utils::stringf("TelemetryReader: unsupported version %u", version));
+        const uint32_t channel_count = readBytes<uint32_t>(header, pos);
+        segment_size_ = readBytes<uint64_t>(header, pos);
+        data_offset_ = readBytes<uint64_t>(header, pos);
+        if (segment_size_ == 0 || data_offset_ < header.size() || data_offset_ > file_size_)
+            throw std::runtime_error("TelemetryReader: header is corrupt");
+
+        header.resize(static_cast<size_t>(data_offset_));
+        file.read(reinterpret_cast<char*>(header.data() + pos), data_offset_ - pos);
+        for (uint32_t c = 0; c < channel_count; ++c) {
+            Channel channel;
+            channel.name = readString(header, pos);
+            const uint32_t field_count = readBytes<uint32_t>(header, pos);
+            vector<uint> offsets;
+            for (uint32_t f = 0; f < field_count; ++f) {
+                TelemetryLogger::Field field;
+                field.type = static_cast<FieldType>(readBytes<uint32_t>(header, pos));
+                field.name = readString(header, pos);
+                offsets.push_back(channel.payload_size);
+                channel.payload_size += TelemetryLogger::getFieldSize(field.type);
+                channel.fields.push_back(field);
+            }
+            channel.record_size = static_cast<uint>(roundUp(TelemetryLogger::kRecordHeaderSize + channel.payload_size, 8));
+            channels_.push_back(channel);
+            field_offsets_.push_back(offsets);
+        }
+    }
+
+    bool TelemetryReader::readSegment(uint64_t offset, vector<uint8_t>& segment) const
+    {
+        if (offset >= file_size_)
+            return false;
+        segment.resize(static_cast<size_t>(std::min(segment_size_, file_size_ - offset)));
+        std::ifstream file(file_name_, std::ios::binary);
+        file.seekg(static_cast<std::streamoff>(offset));
+        return static_cast<bool>(file.read(reinterpret_cast<char*>(segment.data()), segment.size()));
+    }
+
+    template <typename T>
+    static T readField(const uint8_t* data)
+    {
+        T value;
+        std::memcpy(&value, data, sizeof(T));
+        return value;
+    }
+
+    double TelemetryReader::getValue(const Record& record, uint field) const
+    {
+        const uint8_t* data = record.payload + field_offsets_[record.channel][field];
+        switch (channels_[record.channel].fields[field].type) {
+        case FieldType::Float32:
+            return readField<float>(data);
+        case FieldType::Float64:
+            return readField<double>(data);
+        case FieldType::Int32:
+            return readField<int32_t>(data);
+        case FieldType::UInt32:
+            return readField<uint32_t>(data);
+        case FieldType::Int64:
+            return static_cast<double>(readField<int64_t>(data));
+        case FieldType::UInt64:
+            return static_cast<double>(readField<uint64_t>(data));
+        default:
+            return 0;
+        }
+    }
+
+    //integers are printed exactly and floats with enough digits to read back the same value
+    static void writeCsvValue(std::ostream& out, const uint8_t* data, TelemetryLogger::FieldType type)
+    {
+        typedef TelemetryLogger::FieldType FieldType;
+        switch (type) {
+        case FieldType::Float32:
+            out << std::setprecision(std::numeric_limits<float>::max_digits10) << readField<float>(data);
+            break;
+        case FieldType::Float64:
+            out << std::setprecision(std::numeric_limits<double>::max_digits10) << readField<double>(data);
+            break;
+        case FieldType::Int32:
+            out << readField<int32_t>(data);
+            break;
+        case FieldType::UInt32:
+            out << readField<uint32_t>(data);
+            break;
+        case FieldType::Int64:
+            out << readField<int64_t>(data);
+            break;
+        case FieldType::UInt64:
+            out << readField<uint64_t>(data);
+            break;
+        }
+    }
+
+    string TelemetryReader::toFileName(const string& name)
+    {
+        string file_name = name;
+        for (char& c : file_name)
+            if (!std::isalnum(static_cast<unsigned char>(c)) && c != '_' && c != '-' && c != '.')
+                c = '_';
+        return file_name;
+    }
+
+    void TelemetryReader::exportCsv(const string& folder) const
+    {
+        common_utils::FileSystem::ensureFolder(folder);
+
+        vector<std::unique_ptr<std::ofstream>> files;
+        for (const Channel& channel : channels_) {
+            files.emplace_back(new std::ofstream(common_utils::FileSystem::combine(folder, toFileName(channel.name) + ".csv")));
+            std::ofstream& file = *files.back();
+            file << "time_stamp";
+            for (const TelemetryLogger::Field& field : channel.fields)
+                file << "," << field.name;
+            file << "\n";
+        }
+
+        forEachRecord([&](const Record& record) {
+            std::ofstream& file = *files[record.channel];
+            const Channel& channel = channels_[record.channel];
+            file << record.time_stamp;
+            for (uint f = 0; f < channel.fields.size(); ++f) {
+                file << ",";
+                writeCsvValue(file, record.payload + field_offsets_[record.channel][f], channel.fields[f].type);
+            }
+            file << "\n";
+        });
+    }
+
+    void TelemetryReader::exportColumns(const string& folder) const
+    {
+        common_utils::FileSystem::ensureFolder(folder);
+
+        //column 0 of every channel is time_stamp
+        struct Column
+        {
+            string file_name;
+            vector<uint8_t> pending;
+        };
+        vector<vector<Column>> columns(channels_.size());
+        vector<uint64_t> row_counts(channels_.size(), 0);
+        nlohmann::json manifest;
+        manifest["file"] = file_name_;
+        manifest["channels"] = nlohmann::json::array();
+        for (uint c = 0; c < channels_.size(); ++c) {
+            const Channel& channel = channels_[c];
+            const string prefix = toFileName(channel.name) + ".";
+            columns[c].push_back(Column{ prefix + "time_stamp.bin", {} });
+            for (const TelemetryLogger::Field& field : channel.fields)
+                columns[c].push_back(Column{ prefix + toFileName(field.name) + ".bin", {} });
+            //truncate whatever an earlier export left
+            for (const Column& column : columns[c])
+                std::ofstream(common_utils::FileSystem::combine(folder, column.file_name), std::ios::binary | std::ios::trunc);
+        }
+
+        auto flush_column = [&folder](Column& column) {
+            std::ofstream file(common_utils::FileSystem::combine(folder, column.file_name), std::ios::binary | std::ios::app);
+            file.write(reinterpret_cast<const char*>(column.pending.data()), column.pending.size());
+            column.pending.clear();
+        };
+
+        forEachRecord([&](const Record& record) {
+            vector<Column>& channel_columns = columns[record.channel];
+            const Channel& channel = channels_[record.channel];
+            ++row_counts[record.channel];
+
+            const uint8_t* time_stamp = reinterpret_cast<const uint8_t*>(&record.time_stamp);
+            channel_columns[0].pending.insert(channel_columns[0].pending.end(), time_stamp, time_stamp + sizeof(TTimePoint));
+            for (uint f = 0; f < channel.fields.size(); ++f) {
+                const uint8_t* data = record.payload + field_offsets_[record.channel][f];
+                vector<uint8_t>& pending = channel_columns[f + 1].pending;
+                pending.insert(pending.end(), data, data + TelemetryLogger::getFieldSize(channel.fields[f].type));
+            }
+            if (channel_columns[0].pending.size() >= kColumnChunk)
+                for (Column& column : channel_columns)
+                    flush_column(column);
+        });
+
+        for (uint c = 0; c < channels_.size(); ++c) {
+            nlohmann::json channel_json;
+            channel_json["name"] = channels_[c].name;
+            channel_json["rows"] = row_counts[c];
+            channel_json["columns"] = nlohmann::json::array();
+            for (uint i = 0; i < columns[c].size(); ++i) {
+                flush_column(columns[c][i]);
+                nlohmann::json column_json;
+                column_json["name"] = i == 0 ? string("time_stamp") : channels_[c].fields[i - 1].name;
+                column_json["type"] = i == 0 ? string("uint64") : TelemetryLogger::getFieldTypeName(channels_[c].fields[i - 1].type);
+                column_json["file"] = columns[c][i].file_name;
+                channel_json["columns"].push_back(column_json);
+            }
+            manifest["channels"].push_back(channel_json);
+        }
+        std::ofstream(common_utils::FileSystem::combine(folder, "columns.json")) << manifest.dump(4);
+    }
+}
+} //namespace
+
+#endif
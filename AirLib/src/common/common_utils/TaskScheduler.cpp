@@ -0,0 +1,134 @@
+// in header only mode, control library is not available
+#ifndef AIRLIB_HEADER_ONLY
+
+#include "common/common_utils/TaskScheduler.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#if defined _WIN32 || defined _WIN64
+
+#include "common/common_utils/WindowsApisCommonPre.hpp"
+#include "common/common_utils/MinWinDefines.hpp"
+#include <Windows.h>
+#include "common/common_utils/WindowsApisCommonPost.hpp"
+
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace common_utils
+{
+
+#if defined _WIN32 || defined _WIN64
+
+std::vector<std::vector<unsigned int>> CpuTopology::getNumaNodes()
+{
+    std::vector<std::vector<unsigned int>> nodes;
+    ULONG highest_node = 0;
+    if (!GetNumaHighestNodeNumber(&highest_node))
+        return nodes;
+
+    for (USHORT node = 0; node <= highest_node; ++node) {
+        GROUP_AFFINITY affinity;
+        if (!GetNumaNodeProcessorMaskEx(node, &affinity) || affinity.Mask == 0)
+            continue;
+
+        //processors are numbered 64 per group
+        std::vector<unsigned int> cpus;
+        for (unsigned int bit = 0; bit < sizeof(KAFFINITY) * 8; ++bit)
+            if (affinity.Mask & (static_cast<KAFFINITY>(1) << bit))
+                cpus.push_back(affinity.Group * 64 + bit);
+        nodes.push_back(cpus);
+    }
+    return nodes;
+}
+
+bool CpuTopology::pinCurrentThreadToNode(unsigned int node)
+{
+    GROUP_AFFINITY affinity;
+    if (!GetNumaNodeProcessorMaskEx(static_cast<USHORT>(node), &affinity) || affinity.Mask == 0)
+        return false;
+    return SetThreadGroupAffinity(GetCurrentThread(), &affinity, nullptr) != 0;
+}
+
+#elif defined(__linux__)
+
+namespace
+{
+    //parses lists like "0-3,8-11"
+    std::vector<unsigned int> parseCpuList(const std::string& list)
+    {
+        std::vector<unsigned int> cpus;
+        std::stringstream stream(list);
+        std::string range;
+        while (std::getline(stream, range, ',')) {
+            if (range.empty() || range == "\n")
+                continue;
+            const size_t dash = range.find('-');
+            const unsigned int first = static_cast<unsigned int>(std::stoul(range.substr(0, dash)));
+            const unsigned int last = dash == std::string::npos ? first : static_cast<unsigned int>(std::stoul(range.substr(dash + 1)));
+            for (unsigned int cpu = first; cpu <= last; ++cpu)
+                cpus.push_back(cpu);
+        }
+        return cpus;
+    }
+}
+
+std::vector<std::vector<unsigned int>> CpuTopology::getNumaNodes()
+{
+    std::vector<std::vector<unsigned int>> nodes;
+    for (unsigned int node = 0;; ++node) {
+        std::ifstream file(Utils::stringf("/sys/devices/system/node/node%u/cpulist", node));
+        if (!file)
+            break;
+
+        std::string list;
+        std::getline(file, list);
+        try {
+            std::vector<unsigned int> cpus = parseCpuList(list);
+            //memory only nodes have no processors
+            if (cpus.size() > 0)
+                nodes.push_back(cpus);
+        }
+        catch (const std::exception&) {
+            return std::vector<std::vector<unsigned int>>();
+        }
+    }
+    return nodes;
+}
+
+bool CpuTopology::pinCurrentThreadToNode(unsigned int node)
+{
+    const std::vector<std::vector<unsigned int>> nodes = getNumaNodes();
+    if (node >= nodes.size())
+        return false;
+
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    for (unsigned int cpu : nodes[node])
+        if (cpu < CPU_SETSIZE)
+            CPU_SET(cpu, &cpu_set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) == 0;
+}
+
+#else
+
+//no NUMA or thread affinity API, e.g. macOS
+std::vector<std::vector<unsigned int>> CpuTopology::getNumaNodes()
+{
+    return std::vector<std::vector<unsigned int>>();
+}
+
+bool CpuTopology::pinCurrentThreadToNode(unsigned int node)
+{
+    unused(node);
+    return false;
+}
+
+#endif
+}
+
+#endif
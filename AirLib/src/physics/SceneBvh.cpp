@@ -0,0 +1,807 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+//in header only mode, control library is not available
+#ifndef AIRLIB_HEADER_ONLY
+
+#include "physics/SceneBvh.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define AIRLIB_BVH_SSE 1
+#endif
+
+namespace msr
+{
+namespace airlib
+{
+
+    static constexpr uint kBinCount = 16;
+    static constexpr uint kMinLeafSize = 2;
+    static constexpr uint kMaxLeafSize = 16;
+    //below this many triangles a subtree is built on the calling thread
+    static constexpr size_t kParallelMinTriangles = 4096;
+    //past this depth splits are at the median so the tree never gets deeper than kMaxDepth
+    static constexpr uint kSahMaxDepth = 32;
+    static constexpr uint kMaxDepth = 64;
+
+    static real_T halfArea(const Vector3r& bounds_min, const Vector3r& bounds_max)
+    {
+        const Vector3r d = (bounds_max - bounds_min).cwiseMax(Vector3r::Zero());
+        return d.x() * d.y() + d.y() * d.z() + d.z() * d.x();
+    }
+
+    //direction components of zero would give inf * 0 = nan in slab tests
+    static Vector3r safeInverse(const Vector3r& direction)
+    {
+        Vector3r inv;
+        for (int i = 0; i < 3; ++i) {
+            const real_T d = std::abs(direction[i]) < 1E-20f ? std::copysign(1E-20f, direction[i]) : direction[i];
+            inv[i] = 1 / d;
+        }
+        return inv;
+    }
+
+    class SceneBvh::Builder
+    {
+    public:
+        Builder(vector<BuildRef>& refs, vector<Node>& nodes, common_utils::TaskScheduler* scheduler)
+            : refs_(refs), nodes_(nodes), scheduler_(scheduler), node_count_(1)
+        {
+        }
+
+        void build()
+        {
+            //binary tree with at least one triangle per leaf has at most 2n - 1 nodes
+            nodes_.resize(2 * refs_.size() - 1);
+            buildNode(0, 0, refs_.size(), 0);
+            nodes_.resize(node_count_.load());
+            nodes_.shrink_to_fit();
+        }
+
+    private:
+        struct Bin
+        {
+            Vector3r bounds_min = Vector3r::Constant(Utils::max<real_T>());
+            Vector3r bounds_max = Vector3r::Constant(-Utils::max<real_T>());
+            uint count = 0;
+        };
+
+        void buildNode(uint node_index, size_t begin, size_t end, uint depth)
+        {
+            Node& node = nodes_[node_index];
+            Vector3r bounds_min = Vector3r::Constant(Utils::max<real_T>()), bounds_max = -bounds_min;
+            Vector3r centroid_min = bounds_min, centroid_max = bounds_max;
+            for (size_t i = begin; i < end; ++i) {
+                bounds_min = bounds_min.cwiseMin(refs_[i].bounds_min);
+                bounds_max = bounds_max.cwiseMax(refs_[i].bounds_max);
+                centroid_min = centroid_min.cwiseMin(refs_[i].centroid);
+                centroid_max = centroid_max.cwiseMax(refs_[i].centroid);
+            }
+            for (int i = 0; i < 3; ++i) {
+                node.bounds_min[i] = bounds_min[i];
+                node.bounds_max[i] = bounds_max[i];
+            }
+
+            const size_t count = end - begin;
+            if (count <= kMinLeafSize) {
+                makeLeaf(node, begin, count);
+                return;
+            }
+
+            size_t mid = begin;
+            if (depth < kSahMaxDepth) {
+                int axis;
+                uint split;
+                const real_T cost = findSahSplit(begin, end, centroid_min, centroid_max, axis, split);
+                //leaf cost is one intersection per triangle, split cost is relative to this node's area
+                const real_T leaf_cost = static_cast<real_T>(count) * halfArea(bounds_min, bounds_max);
+                if (axis >= 0 && cost >= leaf_cost && count <= kMaxLeafSize) {
+                    makeLeaf(node, begin, count);
+                    return;
+                }
+                if (axis >= 0) {
+                    const real_T scale = kBinCount / (centroid_max[axis] - centroid_min[axis]);
+                    mid = std::partition(refs_.begin() + begin, refs_.begin() + end, [&](const BuildRef& ref) {
+                              return binIndex(ref.centroid[axis], centroid_min[axis], scale) < split;
+                          }) -
+                          refs_.begin();
+                }
+            }
+            //all centroids in one spot or too deep, halve by count along longest axis
+            if (mid == begin || mid == end) {
+                int axis;
+                (centroid_max - centroid_min).maxCoeff(&axis);
+                mid = begin + count / 2;
+                std::nth_element(refs_.begin() + begin, refs_.begin() + mid, refs_.begin() + end,
+                                 [axis](const BuildRef& a, const BuildRef& b) { return a.centroid[axis] < b.centroid[axis]; });
+            }
+
+            const uint left = node_count_.fetch_add(2);
+            node.first = left;
+            node.count = 0;
+
+            if (scheduler_ && count >= kParallelMinTriangles) {
+                common_utils::TaskGroup group;
+                scheduler_->submit(group, [this, left, begin, mid, depth] { buildNode(left, begin, mid, depth + 1); });
+                buildNode(left + 1, mid, end, depth + 1);
+                scheduler_->wait(group);
+            }
+            else {
+                buildNode(left, begin, mid, depth + 1);
+                buildNode(left + 1, mid, end, depth + 1);
+            }
+        }
+
+        static void makeLeaf(Node& node, size_t begin, size_t count)
+        {
+            node.first = static_cast<uint32_t>(begin);
+            node.count = static_cast<uint32_t>(count);
+        }
+
+        static uint binIndex(real_T centroid, real_T centroid_min, real_T scale)
+        {
+            return std::min(kBinCount - 1, static_cast<uint>((centroid - centroid_min) * scale));
+        }
+
+        //returns cost of best split as sum of count * half area of both sides, axis is -1 if no axis can be split
+        real_T findSahSplit(size_t begin, size_t end, const Vector3r& centroid_min, const Vector3r& centroid_max,
+                            int& best_axis, uint& best_split) const
+        {
+            real_T best_cost = Utils::max<real_T>();
+            best_axis = -1;
+            best_split = 0;
+
+            for (int axis = 0; axis < 3; ++axis) {
+                const real_T extent = centroid_max[axis] - centroid_min[axis];
+                if (extent <= 1E-6f)
+                    continue;
+                const real_T scale = kBinCount / extent;
+
+                Bin bins[kBinCount];
+                for (size_t i = begin; i < end; ++i) {
+                    Bin& bin = bins[binIndex(refs_[i].centroid[axis], centroid_min[axis], scale)];
+                    bin.bounds_min = bin.bounds_min.cwiseMin(refs_[i].bounds_min);
+                    bin.bounds_max = bin.bounds_max.cwiseMax(refs_[i].bounds_max);
+                    ++bin.count;
+                }
+
+                //right_cost[k] covers bins k and above
+                real_T right_cost[kBinCount];
+                Bin right;
+                for (uint k = kBinCount - 1; k > 0; --k) {
+                    right.bounds_min = right.bounds_min.cwiseMin(bins[k].bounds_min);
+                    right.bounds_max = right.bounds_max.cwiseMax(bins[k].bounds_max);
+                    right.count += bins[k].count;
+                    right_cost[k] = right.count * halfArea(right.bounds_min, right.bounds_max);
+                }
+
+                Bin left;
+                for (uint k = 1; k < kBinCount; ++k) {
+                    left.bounds_min = left.bounds_min.cwiseMin(bins[k - 1].bounds_min);
+                    left.bounds_max = left.bounds_max.cwiseMax(bins[k - 1].bounds_max);
+                    left.count += bins[k - 1].count;
+                    const real_T cost = left.count * halfArea(left.bounds_min, left.bounds_max) + right_cost[k];
+                    if (left.count > 0 && left.count < end - begin && cost < best_cost) {
+                        best_cost = cost;
+                        best_axis = axis;
+                        best_split = k;
+                    }
+                }
+            }
+            return best_cost;
+        }
+
+    private:
+        vector<BuildRef>& refs_;
+        vector<Node>& nodes_;
+        common_utils::TaskScheduler* scheduler_;
+        std::atomic<uint> node_count_;
+    };
+
+    SceneBvh::SceneBvh()
+    {
+    }
+
+    int SceneBvh::addMesh(const MeshPositionVertexBuffersResponse& mesh, const Matrix3x3r& linear, const Vector3r& offset)
+    {
+        return addTriangles(mesh.vertices, mesh.indices, mesh.name, linear, offset);
+    }
+
+    int SceneBvh::addTriangles(const vector<float>& vertices, const vector<uint32_t>& indices, const std::string& name,
+                               const Matrix3x3r& linear, const Vector3r& offset)
+    {
+        const int mesh_index = static_cast<int>(mesh_names_.size());
+        mesh_names_.push_back(name);
+
+        const size_t vertex_count = vertices.size() / 3;
+        auto vertex = [&](uint32_t index) {
+            return Vector3r(linear * Vector3r(vertices[3 * index], vertices[3 * index + 1], vertices[3 * index + 2]) + offset);
+        };
+
+        for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+            if (indices[i] >= vertex_count || indices[i + 1] >= vertex_count || indices[i + 2] >= vertex_count)
+                continue;
+
+            Triangle triangle;
+            triangle.v0 = vertex(indices[i]);
+            triangle.e1 = vertex(indices[i + 1]) - triangle.v0;
+            triangle.e2 = vertex(indices[i + 2]) - triangle.v0;
+            //degenerate triangles can't be hit
+            if (triangle.e1.cross(triangle.e2).squaredNorm() == 0)
+                continue;
+
+            triangles_.push_back(triangle);
+            triangle_meshes_.push_back(mesh_index);
+        }
+
+        return mesh_index;
+    }
+
+    void SceneBvh::build(common_utils::TaskScheduler* scheduler)
+    {
+        nodes_.clear();
+        if (triangles_.empty())
+            return;
+
+        vector<BuildRef> refs(triangles_.size());
+        auto make_ref = [&](size_t i) {
+            const Triangle& triangle = triangles_[i];
+            const Vector3r v1 = triangle.v0 + triangle.e1, v2 = triangle.v0 + triangle.e2;
+            BuildRef& ref = refs[i];
+            ref.bounds_min = triangle.v0.cwiseMin(v1).cwiseMin(v2);
+            ref.bounds_max = triangle.v0.cwiseMax(v1).cwiseMax(v2);
+            ref.centroid = (ref.bounds_min + ref.bounds_max) / 2;
+            ref.triangle = static_cast<uint>(i);
+        };
+        if (scheduler)
+            scheduler->parallelFor(0, refs.size(), make_ref);
+        else
+            for (size_t i = 0; i < refs.size(); ++i)
+                make_ref(i);
+
+        Builder(refs, nodes_, scheduler).build();
+
+        //store triangles in leaf order so each leaf reads one contiguous run
+        vector<Triangle> triangles(triangles_.size());
+        vector<int> triangle_meshes(triangles_.size());
+        for (size_t i = 0; i < refs.size(); ++i) {
+            triangles[i] = triangles_[refs[i].triangle];
+            triangle_meshes[i] = triangle_meshes_[refs[i].triangle];
+        }
+        triangles_.swap(triangles);
+        triangle_meshes_.swap(triangle_meshes);
+    }
+
+    void SceneBvh::clear()
+    {
+        triangles_.clear();
+        triangle_meshes_.clear();
+        mesh_names_.clear();
+        nodes_.clear();
+    }
+
+    static bool intersectNode(const float* bounds_min, const float* bounds_max, const Vector3r& origin, const Vector3r& inv_dir,
+                              real_T max_distance, real_T& t_enter)
+    {
+        real_T t_min = 0, t_max = max_distance;
+        for (int i = 0; i < 3; ++i) {
+            real_T t0 = (bounds_min[i] - origin[i]) * inv_dir[i];
+            real_T t1 = (bounds_max[i] - origin[i]) * inv_dir[i];
+            if (t0 > t1)
+                std::swap(t0, t1);
+            t_min = std::max(t_min, t0);
+            t_max = std::min(t_max, t1);
+        }
+        t_enter = t_min;
+        return t_min <= t_max;
+    }
+
+    //Moller-Trumbore, both faces count
+    bool SceneBvh::intersectTriangle(const Triangle& triangle, const Vector3r& origin, const Vector3r& direction,
+                                     real_T max_distance, real_T& distance)
+    {
+        const Vector3r p = direction.cross(triangle.e2);
+        const real_T det = triangle.e1.dot(p);
+        if (std::abs(det) < 1E-12f)
+            return false;
+        const real_T inv_det = 1 / det;
+
+        const Vector3r s = origin - triangle.v0;
+        const real_T u = s.dot(p) * inv_det;
+        if (u < 0 || u > 1)
+            return false;
+        const Vector3r q = s.cross(triangle.e1);
+        const real_T v = direction.dot(q) * inv_det;
+        if (v < 0 || u + v > 1)
+            return false;
+
+        const real_T t = triangle.e2.dot(q) * inv_det;
+        if (t < 0 || t >= max_distance)
+            return false;
+        distance = t;
+        return true;
+    }
+
+    template <bool kAnyHit>
+    bool SceneBvh::traverse(const Vector3r& origin, const Vector3r& direction, real_T max_distance, RayHit* hit) const
+    {
+        if (nodes_.empty())
+            return false;
+
+        const Vector3r inv_dir = safeInverse(direction);
+        real_T closest = max_distance;
+        int closest_triangle = -1;
+
+        struct StackEntry
+        {
+            uint node;
+            real_T t_enter;
+        } stack[kMaxDepth];
+        int stack_size = 0;
+
+        real_T t_enter;
+        if (!intersectNode(nodes_[0].bounds_min, nodes_[0].bounds_max, origin, inv_dir, closest, t_enter))
+            return false;
+        stack[stack_size++] = StackEntry{ 0, t_enter };
+
+        while (stack_size > 0) {
+            const StackEntry entry = stack[--stack_size];
+            //a closer hit may have been found since this node was pushed
+            if (entry.t_enter > closest)
+                continue;
+
+            uint node_index = entry.node;
+            while (true) {
+                const Node& node = nodes_[node_index];
+                if (node.count > 0) {
+                    for (uint i = node.first; i < node.first + node.count; ++i) {
+                        real_T distance;
+                        if (intersectTriangle(triangles_[i], origin, direction, closest, distance)) {
+                            closest = distance;
+                            closest_triangle = static_cast<int>(i);
+                            if (kAnyHit)
+                                return true;
+                        }
+                    }
+                    break;
+                }
+
+                //go to the nearer child, come back for the other one later
+                const uint left = node.first, right = node.first + 1;
+                real_T t_left, t_right;
+                const bool hit_left = intersectNode(nodes_[left].bounds_min, nodes_[left].bounds_max, origin, inv_dir, closest, t_left);
+                const bool hit_right = intersectNode(nodes_[right].bounds_min, nodes_[right].bounds_max, origin, inv_dir, closest, t_right);
+                if (hit_left && hit_right) {
+                    const bool left_first = t_left <= t_right;
+                    stack[stack_size++] = left_first ? StackEntry{ right, t_right } : StackEntry{ left, t_left };
+                    node_index = left_first ? left : right;
+                }
+                else if (hit_left)
+                    node_index = left;
+                else if (hit_right)
+                    node_index = right;
+                else
+                    break;
+            }
+        }
+
+        if (closest_triangle < 0)
+            return false;
+        if (hit)
+            fillHit(closest_triangle, closest, origin, direction, *hit);
+        return true;
+    }
+
+    void SceneBvh::fillHit(int triangle_index, real_T distance, const Vector3r& origin, const Vector3r& direction, RayHit& hit) const
+    {
+        const Triangle& triangle = triangles_[triangle_index];
+        hit.hit = true;
+        hit.distance = distance;
+        hit.point = origin + direction * distance;
+        hit.normal = triangle.e1.cross(triangle.e2).normalized();
+        if (hit.normal.dot(direction) > 0)
+            hit.normal = -hit.normal;
+        hit.mesh_index = triangle_meshes_[triangle_index];
+        hit.triangle_index = static_cast<uint>(triangle_index);
+    }
+
+    SceneBvh::RayHit SceneBvh::castRay(const Ray& ray) const
+    {
+        RayHit hit;
+        traverse<false>(ray.origin, ray.direction, ray.max_distance, &hit);
+        return hit;
+    }
+
+    void SceneBvh::castRays(const vector<Ray>& rays, vector<RayHit>& hits, common_utils::TaskScheduler* scheduler) const
+    {
+        hits.resize(rays.size());
+        auto cast_range = [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i)
+                hits[i] = castRay(rays[i]);
+        };
+        if (scheduler)
+            scheduler->parallelForRange(0, rays.size(), cast_range, 256);
+        else
+            cast_range(0, rays.size());
+    }
+
+    //four floats, one per ray of a packet, with comparisons giving a bit mask of lanes
+    struct Lanes
+    {
+#ifdef AIRLIB_BVH_SSE
+        __m128 v;
+
+        static Lanes set(float x)
+        {
+            return { _mm_set1_ps(x) };
+        }
+        static Lanes load(const float* p)
+        {
+            return { _mm_loadu_ps(p) };
+        }
+        void store(float* p) const
+        {
+            _mm_storeu_ps(p, v);
+        }
+        friend Lanes operator+(Lanes a, Lanes b) { return { _mm_add_ps(a.v, b.v) }; }
+        friend Lanes operator-(Lanes a, Lanes b) { return { _mm_sub_ps(a.v, b.v) }; }
+        friend Lanes operator*(Lanes a, Lanes b) { return { _mm_mul_ps(a.v, b.v) }; }
+        friend Lanes min(Lanes a, Lanes b) { return { _mm_min_ps(a.v, b.v) }; }
+        friend Lanes max(Lanes a, Lanes b) { return { _mm_max_ps(a.v, b.v) }; }
+        friend Lanes abs(Lanes a) { return { _mm_andnot_ps(_mm_set1_ps(-0.0f), a.v) }; }
+        friend Lanes reciprocal(Lanes a) { return { _mm_div_ps(_mm_set1_ps(1), a.v) }; }
+        friend int lessEqual(Lanes a, Lanes b) { return _mm_movemask_ps(_mm_cmple_ps(a.v, b.v)); }
+        friend int less(Lanes a, Lanes b) { return _mm_movemask_ps(_mm_cmplt_ps(a.v, b.v)); }
+#else
+        float v[SceneBvh::kPacketSize];
+
+        template <typename Func>
+        static Lanes map(Lanes a, Lanes b, Func func)
+        {
+            Lanes r;
+            for (uint i = 0; i < SceneBvh::kPacketSize; ++i)
+                r.v[i] = func(a.v[i], b.v[i]);
+            return r;
+        }
+        template <typename Func>
+        static int mask(Lanes a, Lanes b, Func func)
+        {
+            int r = 0;
+            for (uint i = 0; i < SceneBvh::kPacketSize; ++i)
+                r |= func(a.v[i], b.v[i]) ? 1 << i : 0;
+            return r;
+        }
+
+        static Lanes set(float x)
+        {
+            return { { x, x, x, x } };
+        }
+        static Lanes load(const float* p)
+        {
+            return { { p[0], p[1], p[2], p[3] } };
+        }
+        void store(float* p) const
+        {
+            std::copy(v, v + SceneBvh::kPacketSize, p);
+        }
+        friend Lanes operator+(Lanes a, Lanes b) { return map(a, b, [](float x, float y) { return x + y; }); }
+        friend Lanes operator-(Lanes a, Lanes b) { return map(a, b, [](float x, float y) { return x - y; }); }
+        friend Lanes operator*(Lanes a, Lanes b) { return map(a, b, [](float x, float y) { return x * y; }); }
+        friend Lanes min(Lanes a, Lanes b) { return map(a, b, [](float x, float y) { return std::min(x, y); }); }
+        friend Lanes max(Lanes a, Lanes b) { return map(a, b, [](float x, float y) { return std::max(x, y); }); }
+        friend Lanes abs(Lanes a) { return map(a, a, [](float x, float) { return std::abs(x); }); }
+        friend Lanes reciprocal(Lanes a) { return map(a, a, [](float x, float) { return 1 / x; }); }
+        friend int lessEqual(Lanes a, Lanes b) { return mask(a, b, [](float x, float y) { return x <= y; }); }
+        friend int less(Lanes a, Lanes b) { return mask(a, b, [](float x, float y) { return x < y; }); }
+#endif
+    };
+
+    //rays of a packet in structure of arrays layout, lanes without a ray have closest < 0 so they never hit
+    struct SceneBvh::Packet
+    {
+        Lanes origin[3], direction[3], inv_dir[3];
+        Lanes closest;
+        int hit_triangle[kPacketSize];
+
+        //bit per lane whose ray enters the node before its closest hit, t_enter is where
+        int intersectNode(const Node& node, Lanes& t_enter) const
+        {
+            Lanes t_min = Lanes::set(0), t_max = closest;
+            for (int i = 0; i < 3; ++i) {
+                const Lanes t0 = (Lanes::set(node.bounds_min[i]) - origin[i]) * inv_dir[i];
+                const Lanes t1 = (Lanes::set(node.bounds_max[i]) - origin[i]) * inv_dir[i];
+                t_min = max(t_min, min(t0, t1));
+                t_max = min(t_max, max(t0, t1));
+            }
+            t_enter = t_min;
+            return lessEqual(t_min, t_max);
+        }
+
+        //same test as SceneBvh::intersectTriangle on all lanes, lanes with a closer hit take this triangle
+        void intersectTriangle(const Triangle& triangle, uint triangle_index)
+        {
+            const Lanes e1[3] = { Lanes::set(triangle.e1.x()), Lanes::set(triangle.e1.y()), Lanes::set(triangle.e1.z()) };
+            const Lanes e2[3] = { Lanes::set(triangle.e2.x()), Lanes::set(triangle.e2.y()), Lanes::set(triangle.e2.z()) };
+            const Lanes p[3] = { direction[1] * e2[2] - direction[2] * e2[1],
+                                 direction[2] * e2[0] - direction[0] * e2[2],
+                                 direction[0] * e2[1] - direction[1] * e2[0] };
+            const Lanes det = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+            int mask = lessEqual(Lanes::set(1E-12f), abs(det));
+            if (!mask)
+                return;
+            const Lanes inv_det = reciprocal(det);
+
+            const Lanes s[3] = { origin[0] - Lanes::set(triangle.v0.x()), origin[1] - Lanes::set(triangle.v0.y()),
+                                 origin[2] - Lanes::set(triangle.v0.z()) };
+            const Lanes u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * inv_det;
+            const Lanes zero = Lanes::set(0), one = Lanes::set(1);
+            mask &= lessEqual(zero, u) & lessEqual(u, one);
+            if (!mask)
+                return;
+            const Lanes q[3] = { s[1] * e1[2] - s[2] * e1[1], s[2] * e1[0] - s[0] * e1[2], s[0] * e1[1] - s[1] * e1[0] };
+            const Lanes v = (direction[0] * q[0] + direction[1] * q[1] + direction[2] * q[2]) * inv_det;
+            mask &= lessEqual(zero, v) & lessEqual(u + v, one);
+            if (!mask)
+                return;
+
+            const Lanes t = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) * inv_det;
+            mask &= lessEqual(zero, t) & less(t, closest);
+            if (!mask)
+                return;
+
+            float t_lanes[kPacketSize], closest_lanes[kPacketSize];
+            t.store(t_lanes);
+            closest.store(closest_lanes);
+            for (uint i = 0; i < kPacketSize; ++i) {
+                if (mask & (1 << i)) {
+                    closest_lanes[i] = t_lanes[i];
+                    hit_triangle[i] = static_cast<int>(triangle_index);
+                }
+            }
+            closest = Lanes::load(closest_lanes);
+        }
+    };
+
+    //smallest entry distance over lanes in mask
+    static float minLane(const Lanes& lanes, int mask)
+    {
+        float values[SceneBvh::kPacketSize];
+        lanes.store(values);
+        float result = Utils::max<float>();
+        for (uint i = 0; i < SceneBvh::kPacketSize; ++i)
+            if (mask & (1 << i))
+                result = std::min(result, values[i]);
+        return result;
+    }
+
+    void SceneBvh::castRayPacket(const Ray* rays, RayHit* hits, uint count) const
+    {
+        count = std::min(count, kPacketSize);
+        for (uint i = 0; i < count; ++i)
+            hits[i] = RayHit();
+        if (nodes_.empty() || count == 0)
+            return;
+
+        Packet packet;
+        float values[10][kPacketSize];
+        for (uint i = 0; i < kPacketSize; ++i) {
+            //unused lanes copy the first ray so they stay finite but get no distance to hit within
+            const Ray& ray = rays[i < count ? i : 0];
+            const Vector3r inv_dir = safeInverse(ray.direction);
+            for (int k = 0; k < 3; ++k) {
+                values[k][i] = static_cast<float>(ray.origin[k]);
+                values[3 + k][i] = static_cast<float>(ray.direction[k]);
+                values[6 + k][i] = static_cast<float>(inv_dir[k]);
+            }
+            values[9][i] = i < count ? static_cast<float>(std::min<real_T>(ray.max_distance, Utils::max<float>())) : -1.0f;
+            packet.hit_triangle[i] = -1;
+        }
+        for (int k = 0; k < 3; ++k) {
+            packet.origin[k] = Lanes::load(values[k]);
+            packet.direction[k] = Lanes::load(values[3 + k]);
+            packet.inv_dir[k] = Lanes::load(values[6 + k]);
+        }
+        packet.closest = Lanes::load(values[9]);
+
+        //same walk as traverse with a node entered if any lane enters it
+        uint stack[kMaxDepth];
+        int stack_size = 0;
+        Lanes t_enter;
+        if (packet.intersectNode(nodes_[0], t_enter))
+            stack[stack_size++] = 0;
+
+        while (stack_size > 0) {
+            uint node_index = stack[--stack_size];
+            //lanes may have found closer hits since this node was pushed
+            if (node_index != 0 && !packet.intersectNode(nodes_[node_index], t_enter))
+                continue;
+
+            while (true) {
+                const Node& node = nodes_[node_index];
+                if (node.count > 0) {
+                    for (uint i = node.first; i < node.first + node.count; ++i)
+                        packet.intersectTriangle(triangles_[i], i);
+                    break;
+                }
+
+                const uint left = node.first, right = node.first + 1;
+                Lanes t_left, t_right;
+                const int mask_left = packet.intersectNode(nodes_[left], t_left);
+                const int mask_right = packet.intersectNode(nodes_[right], t_right);
+                if (mask_left && mask_right) {
+                    const bool left_first = minLane(t_left, mask_left) <= minLane(t_right, mask_right);
+                    stack[stack_size++] = left_first ? right : left;
+                    node_index = left_first ? left : right;
+                }
+                else if (mask_left)
+                    node_index = left;
+                else if (mask_right)
+                    node_index = right;
+                else
+                    break;
+            }
+        }
+
+        float closest[kPacketSize];
+        packet.closest.store(closest);
+        for (uint i = 0; i < count; ++i)
+            if (packet.hit_triangle[i] >= 0)
+                fillHit(packet.hit_triangle[i], closest[i], rays[i].origin, rays[i].direction, hits[i]);
+    }
+
+    void SceneBvh::castRayPackets(const vector<Ray>& rays, vector<RayHit>& hits, common_utils::TaskScheduler* scheduler) const
+    {
+        hits.resize(rays.size());
+        const size_t packet_count = (rays.size() + kPacketSize - 1) / kPacketSize;
+        auto cast_range = [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                const size_t first = i * kPacketSize;
+                castRayPacket(&rays[first], &hits[first], static_cast<uint>(std::min<size_t>(kPacketSize, rays.size() - first)));
+            }
+        };
+        if (scheduler)
+            scheduler->parallelForRange(0, packet_count, cast_range, 64);
+        else
+            cast_range(0, packet_count);
+    }
+
+    bool SceneBvh::testLineOfSight(const Vector3r& from, const Vector3r& to) const
+    {
+        const Vector3r d = to - from;
+        const real_T distance = d.norm();
+        if (distance < 1E-6f)
+            return true;
+        //end points lying on a surface don't block
+        return !traverse<true>(from, d / distance, distance * (1 - 1E-5f), nullptr);
+    }
+
+    //Akenine-Moller separating axis test: box faces, triangle plane and the 9 edge cross products
+    bool SceneBvh::triangleOverlapsBox(const Triangle& triangle, const Vector3r& box_center, const Vector3r& half_size)
+    {
+        const Vector3r v[3] = { triangle.v0 - box_center, triangle.v0 + triangle.e1 - box_center, triangle.v0 + triangle.e2 - box_center };
+
+        for (int i = 0; i < 3; ++i) {
+            if (std::min({ v[0][i], v[1][i], v[2][i] }) > half_size[i] || std::max({ v[0][i], v[1][i], v[2][i] }) < -half_size[i])
+                return false;
+        }
+
+        const Vector3r normal = triangle.e1.cross(triangle.e2);
+        if (std::abs(normal.dot(v[0])) > half_size.dot(normal.cwiseAbs()))
+            return false;
+
+        const Vector3r edges[3] = { v[1] - v[0], v[2] - v[1], v[0] - v[2] };
+        for (int i = 0; i < 3; ++i) {
+            for (const Vector3r& edge : edges) {
+                const Vector3r axis = Vector3r::Unit(i).cross(edge);
+                const real_T p0 = v[0].dot(axis), p1 = v[1].dot(axis), p2 = v[2].dot(axis);
+                const real_T r = half_size.dot(axis.cwiseAbs());
+                if (std::min({ p0, p1, p2 }) > r || std::max({ p0, p1, p2 }) < -r)
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    //calls visitor(triangle_index) for triangles intersecting the box until it returns true
+    template <typename TVisitor>
+    bool SceneBvh::visitBox(const Vector3r& box_min, const Vector3r& box_max, TVisitor&& visitor) const
+    {
+        if (nodes_.empty())
+            return false;
+
+        const Vector3r center = (box_min + box_max) / 2;
+        const Vector3r half_size = (box_max - box_min) / 2;
+        auto overlaps_node = [&](const Node& node) {
+            for (int i = 0; i < 3; ++i)
+                if (node.bounds_min[i] > box_max[i] || node.bounds_max[i] < box_min[i])
+                    return false;
+            return true;
+        };
+
+        //both children may be pushed at every level
+        uint stack[2 * kMaxDepth];
+        int stack_size = 0;
+        if (overlaps_node(nodes_[0]))
+            stack[stack_size++] = 0;
+
+        while (stack_size > 0) {
+            const Node& node = nodes_[stack[--stack_size]];
+            if (node.count > 0) {
+                for (uint i = node.first; i < node.first + node.count; ++i)
+                    if (triangleOverlapsBox(triangles_[i], center, half_size) && visitor(i))
+                        return true;
+            }
+            else {
+                for (uint child = node.first; child < node.first + 2; ++child)
+                    if (overlaps_node(nodes_[child]))
+                        stack[stack_size++] = child;
+            }
+        }
+        return false;
+    }
+
+    bool SceneBvh::overlapsBox(const Vector3r& box_min, const Vector3r& box_max) const
+    {
+        return visitBox(box_min, box_max, [](uint) { return true; });
+    }
+
+    uint SceneBvh::queryBox(const Vector3r& box_min, const Vector3r& box_max, vector<uint>& triangle_indices) const
+    {
+        const size_t initial_size = triangle_indices.size();
+        visitBox(box_min, box_max, [&triangle_indices](uint triangle_index) {
+            triangle_indices.push_back(triangle_index);
+            return false;
+        });
+        return static_cast<uint>(triangle_indices.size() - initial_size);
+    }
+
+    uint SceneBvh::getTriangleCount() const
+    {
+        return static_cast<uint>(triangles_.size());
+    }
+
+    uint SceneBvh::getNodeCount() const
+    {
+        return static_cast<uint>(nodes_.size());
+    }
+
+    uint SceneBvh::getMeshCount() const
+    {
+        return static_cast<uint>(mesh_names_.size());
+    }
+
+    const std::string& SceneBvh::getMeshName(int mesh_index) const
+    {
+        return mesh_names_.at(mesh_index);
+    }
+
+    int SceneBvh::getTriangleMesh(uint triangle_index) const
+    {
+        return triangle_meshes_.at(triangle_index);
+    }
+
+    void SceneBvh::getTriangle(uint triangle_index, Vector3r& v0, Vector3r& v1, Vector3r& v2) const
+    {
+        const Triangle& triangle = triangles_.at(triangle_index);
+        v0 = triangle.v0;
+        v1 = triangle.v0 + triangle.e1;
+        v2 = triangle.v0 + triangle.e2;
+    }
+
+    void SceneBvh::getBounds(Vector3r& bounds_min, Vector3r& bounds_max) const
+    {
+        if (nodes_.empty()) {
+            bounds_min = bounds_max = Vector3r::Zero();
+            return;
+        }
+        bounds_min = Vector3r(nodes_[0].bounds_min[0], nodes_[0].bounds_min[1], nodes_[0].bounds_min[2]);
+        bounds_max = Vector3r(nodes_[0].bounds_max[0], nodes_[0].bounds_max[1], nodes_[0].bounds_max[2]);
+    }
+}
+} //namespace
+
+#endif
@@ -18,9 +18,14 @@ namespace airlib
 //TODO: something defines max macro which interfears with code here
 #undef max
 
-    SafetyEval::SafetyEval(MultirotorApiParams vehicle_params, shared_ptr<IGeoFence> fence_ptr, shared_ptr<ObstacleMap> obs_xy_ptr)
-        : vehicle_params_(vehicle_params), fence_ptr_(fence_ptr), obs_xy_ptr_(obs_xy_ptr)
+    SafetyEval::SafetyEval(MultirotorApiParams vehicle_params, shared_ptr<IGeoFence> fence_ptr, shared_ptr<ObstacleMap> obs_xy_ptr,
+                           shared_ptr<VoxelOccupancyMap> obs_3d_ptr)
+        : vehicle_params_(vehicle_params), fence_ptr_(fence_ptr), obs_xy_ptr_(obs_xy_ptr), obs_3d_ptr_(obs_3d_ptr)
     {
+        //with 3D map we still need ticks to discretize directions for suggestions
+        if (obs_xy_ptr_ == nullptr && obs_3d_ptr_ != nullptr)
+            obs_xy_ptr_ = std::make_shared<ObstacleMap>(16);
+
         Utils::log(Utils::stringf("enable_reasons: %X, obs_strategy=%X", uint(enable_reasons_), uint(obs_strategy_)));
     }
 
@@ -70,10 +75,10 @@ namespace airlib
         return other_risk_dist - this_risk_dist <= vehicle_params_.distance_accuracy;
     }
 
-    void SafetyEval::isCurrentSafer(SafetyEval::EvalResult& result)
+    void SafetyEval::isCurrentSafer(SafetyEval::EvalResult& result, const Quaternionr& quaternion)
     {
         //are we doing better than closest obstacle?
-        result.cur_obs = obs_xy_ptr_->getClosestObstacle();
+        result.cur_obs = getClosestObstacle(result.cur_pos, quaternion);
 
         //if we stay where we are, what is the risk distance?
         result.cur_risk_dist = adjustClearanceForPrStl(vehicle_params_.obs_clearance, result.cur_obs.confidence) - result.cur_obs.distance;
@@ -107,7 +112,7 @@ namespace airlib
         if (cur_dest_norm < vehicle_params_.distance_accuracy) {
             //we are hovering
             result.dest_risk_dist = Utils::nan<float>();
-            isCurrentSafer(result);
+            isCurrentSafer(result, quaternion);
         }
         else { //see if we have obstacle in direction
             result.cur_dest_body = VectorMath::transformToBodyFrame(cur_dest, quaternion, true);
@@ -119,13 +124,18 @@ namespace airlib
             int point_tick = obs_xy_ptr_->angleToTick(point_angle);
 
             //get obstacles in the window at the tick direction around the window
-            result.dest_obs = obs_xy_ptr_->hasObstacle(point_tick - vehicle_params_.obs_window, point_tick + vehicle_params_.obs_window);
+            if (obs_3d_ptr_ != nullptr) {
+                //sweep clearance along the actual 3D path so obstacles above and below are accounted for
+                result.dest_obs = sweepObstacle(cur_pos, cur_dest / cur_dest_norm, cur_dest_norm + vehicle_params_.obs_clearance, point_tick);
+            }
+            else
+                result.dest_obs = obs_xy_ptr_->hasObstacle(point_tick - vehicle_params_.obs_window, point_tick + vehicle_params_.obs_window);
 
             //less risk distance is better
             result.dest_risk_dist = cur_dest_norm + adjustClearanceForPrStl(vehicle_params_.obs_clearance, result.dest_obs.confidence) - result.dest_obs.distance;
             if (result.dest_risk_dist >= 0) { //potential collision
                 //check obstacles around current position and see if it has lower risk
-                isCurrentSafer(result);
+                isCurrentSafer(result, quaternion);
             }
             //else obstacle is too far
         }
@@ -148,11 +158,65 @@ namespace airlib
         //3.2 comes from inverse CDF for epsilon = 0.05 (i.e. 95% confidence), author: akapoor
         float additional_clearance = (1 - obs_confidence) * 3.2f;
         if (additional_clearance != 0)
-            Utils::log(Utils::stringf("additional_clearance=%f", additional_clearance));
+            Utils::logf(Utils::kLogLevelInfo, "additional_clearance=%f", additional_clearance);
 
         return base_clearance + additional_clearance;
     }
 
+    ObstacleMap::ObstacleInfo SafetyEval::getClosestObstacle(const Vector3r& cur_pos, const Quaternionr& quaternion)
+    {
+        if (obs_3d_ptr_ == nullptr)
+            return obs_xy_ptr_->getClosestObstacle();
+
+        //anything beyond clearance + breaking distance doesn't influence risk distances
+        const VoxelOccupancyMap::ObstacleInfo obs_3d = obs_3d_ptr_->getClosestObstacle(cur_pos,
+                                                                                        vehicle_params_.obs_clearance + vehicle_params_.max_breaking_dist);
+
+        ObstacleMap::ObstacleInfo obs;
+        obs.confidence = 1;
+        if (obs_3d.found) {
+            const Vector3r obs_body = VectorMath::transformToBodyFrame(obs_3d.position - cur_pos, quaternion, true);
+            obs.tick = obs_xy_ptr_->angleToTick(std::atan2(obs_body[1], obs_body[0]));
+            obs.distance = obs_3d.distance;
+        }
+        else {
+            obs.tick = 0;
+            obs.distance = Utils::max<float>() / 2;
+        }
+        return obs;
+    }
+
+    ObstacleMap::ObstacleInfo SafetyEval::getObstacleInTicks(const Vector3r& cur_pos, const Quaternionr& quaternion, int from_tick, int to_tick)
+    {
+        if (obs_3d_ptr_ == nullptr)
+            return obs_xy_ptr_->hasObstacle(from_tick, to_tick);
+
+        ObstacleMap::ObstacleInfo closest_obs;
+        closest_obs.distance = Utils::max<float>();
+        for (int tick = from_tick; tick <= to_tick; ++tick) {
+            //in 3D map ticks are horizontal directions in body frame
+            float angle = obs_xy_ptr_->tickToAngleMid(tick);
+            const Vector3r dir_world = VectorMath::transformToWorldFrame(Vector3r(std::cos(angle), std::sin(angle), 0), quaternion, true);
+
+            ObstacleMap::ObstacleInfo obs = sweepObstacle(cur_pos, dir_world, vehicle_params_.obs_clearance, tick);
+            if (obs.distance < closest_obs.distance)
+                closest_obs = obs;
+        }
+        return closest_obs;
+    }
+
+    ObstacleMap::ObstacleInfo SafetyEval::sweepObstacle(const Vector3r& cur_pos, const Vector3r& dir_world, float length, int tick)
+    {
+        const VoxelOccupancyMap::ObstacleInfo obs_3d = obs_3d_ptr_->sweepSphere(cur_pos, cur_pos + dir_world * length, vehicle_params_.obs_clearance);
+
+        ObstacleMap::ObstacleInfo obs;
+        obs.tick = tick;
+        //occupancy map only has confirmed obstacles
+        obs.confidence = 1;
+        obs.distance = obs_3d.found ? obs_3d.distance : Utils::max<float>() / 2;
+        return obs;
+    }
+
     void SafetyEval::setSuggestedVelocity(SafetyEval::EvalResult& result, const Quaternionr& quaternion)
     {
         result.suggested_vec = Vector3r::Zero(); //default suggestion
@@ -170,8 +234,8 @@ namespace airlib
 
         for (int i = 0; i <= ticks / 2; ++i) {
             //evaluate right and left side of circle
-            ObstacleMap::ObstacleInfo right_obs = obs_xy_ptr_->hasObstacle(ref_tick + i, ref_tick + i);
-            ObstacleMap::ObstacleInfo left_obs = obs_xy_ptr_->hasObstacle(ref_tick - i, ref_tick - i);
+            ObstacleMap::ObstacleInfo right_obs = getObstacleInTicks(result.cur_pos, quaternion, ref_tick + i, ref_tick + i);
+            ObstacleMap::ObstacleInfo left_obs = getObstacleInTicks(result.cur_pos, quaternion, ref_tick - i, ref_tick - i);
 
             //find right and left risk distances
             float right_risk_dist = adjustClearanceForPrStl(vehicle_params_.obs_clearance, right_obs.confidence) - right_obs.distance;
@@ -187,7 +251,7 @@ namespace airlib
                 const Vector3r suggested_body = Vector3r(std::cos(suggested_angle), std::sin(suggested_angle), 0).normalized();
                 result.suggested_vec = VectorMath::transformToWorldFrame(suggested_body, quaternion, true);
 
-                Utils::log(Utils::stringf("right_risk_dist=%f, left_risk_dist=%f, suggested_tick=%i, suggested_angle=%f", right_risk_dist, left_risk_dist, suggested_tick, suggested_angle, suggested_angle));
+                Utils::logf(Utils::kLogLevelInfo, "right_risk_dist=%f, left_risk_dist=%f, suggested_tick=%i, suggested_angle=%f", right_risk_dist, left_risk_dist, suggested_tick, suggested_angle);
 
                 break; //if none found then suggested_vec is left as zero vec, meaning enter hover mode
             }
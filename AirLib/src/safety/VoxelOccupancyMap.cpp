@@ -0,0 +1,422 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+//in header only mode, control library is not available
+#ifndef AIRLIB_HEADER_ONLY
+
+#include "safety/VoxelOccupancyMap.hpp"
+#include "common/common_utils/Utils.hpp"
+#include "common/VectorMathBatch.hpp"
+#include <algorithm>
+#include <cmath>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace msr
+{
+namespace airlib
+{
+
+    static int lowestBitIndex(uint64_t word)
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward64(&index, word);
+        return static_cast<int>(index);
+#else
+        return __builtin_ctzll(word);
+#endif
+    }
+
+    struct VoxelOccupancyMap::Block
+    {
+        const BlockKey key;
+        //one word per z layer, bit index is x + y * kBlockSize
+        std::atomic<uint64_t> words[kBlockWords];
+        std::atomic<uint> version;
+
+        Block(BlockKey key_val)
+            : key(key_val), version(1)
+        {
+            for (auto& word : words)
+                word.store(0, std::memory_order_relaxed);
+        }
+    };
+
+    VoxelOccupancyMap::VoxelOccupancyMap(float voxel_size, uint block_capacity)
+        : voxel_size_(voxel_size), inv_voxel_size_(1.0f / voxel_size), block_count_(0), dropped_updates_(0), version_(0)
+    {
+        uint capacity = 1;
+        while (capacity < block_capacity)
+            capacity <<= 1;
+        capacity_mask_ = capacity - 1;
+        //bound probe sequence so full table doesn't turn every update in to full scan
+        max_probes_ = std::min(capacity, 256u);
+
+        slots_.reset(new std::atomic<Block*>[capacity]);
+        for (uint i = 0; i < capacity; ++i)
+            slots_[i].store(nullptr, std::memory_order_relaxed);
+    }
+
+    VoxelOccupancyMap::~VoxelOccupancyMap()
+    {
+        for (uint i = 0; i <= capacity_mask_; ++i)
+            delete slots_[i].load(std::memory_order_relaxed);
+    }
+
+    VoxelOccupancyMap::VoxelIndex VoxelOccupancyMap::toVoxelIndex(const Vector3r& point) const
+    {
+        return VoxelIndex{ static_cast<int>(std::floor(point.x() * inv_voxel_size_)),
+                           static_cast<int>(std::floor(point.y() * inv_voxel_size_)),
+                           static_cast<int>(std::floor(point.z() * inv_voxel_size_)) };
+    }
+
+    Vector3r VoxelOccupancyMap::toVoxelCenter(int x, int y, int z) const
+    {
+        return Vector3r((x + 0.5f) * voxel_size_, (y + 0.5f) * voxel_size_, (z + 0.5f) * voxel_size_);
+    }
+
+    VoxelOccupancyMap::BlockKey VoxelOccupancyMap::toBlockKey(int bx, int by, int bz)
+    {
+        //21 bits per axis is enough for +/-250km at 0.25m voxels
+        static constexpr uint64_t mask = (1 << 21) - 1;
+        return static_cast<BlockKey>(((static_cast<uint64_t>(bx) & mask) << 42) |
+                                     ((static_cast<uint64_t>(by) & mask) << 21) |
+                                     (static_cast<uint64_t>(bz) & mask));
+    }
+
+    uint VoxelOccupancyMap::hashKey(BlockKey key)
+    {
+        //fibonacci hashing, top bits are best mixed
+        return static_cast<uint>((static_cast<uint64_t>(key) * 0x9E3779B97F4A7C15ULL) >> 32);
+    }
+
+    VoxelOccupancyMap::Block* VoxelOccupancyMap::findBlock(BlockKey key) const
+    {
+        uint index = hashKey(key) & capacity_mask_;
+        for (uint probe = 0; probe < max_probes_; ++probe) {
+            Block* block = slots_[index].load(std::memory_order_acquire);
+            if (block == nullptr)
+                return nullptr; //slots are never removed so key can't be further down
+            if (block->key == key)
+                return block;
+            index = (index + 1) & capacity_mask_;
+        }
+        return nullptr;
+    }
+
+    VoxelOccupancyMap::Block* VoxelOccupancyMap::findOrCreateBlock(BlockKey key)
+    {
+        Block* new_block = nullptr;
+        uint index = hashKey(key) & capacity_mask_;
+        for (uint probe = 0; probe < max_probes_; ++probe) {
+            Block* block = slots_[index].load(std::memory_order_acquire);
+            if (block == nullptr) {
+                if (new_block == nullptr)
+                    new_block = new Block(key);
+
+                if (slots_[index].compare_exchange_strong(block, new_block, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                    ++block_count_;
+                    return new_block;
+                }
+                //else someone else filled this slot, block now has their value
+            }
+            if (block->key == key) {
+                delete new_block;
+                return block;
+            }
+            index = (index + 1) & capacity_mask_;
+        }
+
+        //table is full around this key
+        delete new_block;
+        ++dropped_updates_;
+        return nullptr;
+    }
+
+    void VoxelOccupancyMap::setVoxel(const VoxelIndex& index, bool occupied)
+    {
+        const BlockKey key = toBlockKey(index.x >> kBlockBits, index.y >> kBlockBits, index.z >> kBlockBits);
+        Block* block = occupied ? findOrCreateBlock(key) : findBlock(key);
+        if (block == nullptr) //clearing unknown space or table is full
+            return;
+
+        static constexpr int local_mask = kBlockSize - 1;
+        const uint64_t bit = uint64_t(1) << ((index.x & local_mask) + (index.y & local_mask) * kBlockSize);
+        std::atomic<uint64_t>& word = block->words[index.z & local_mask];
+
+        uint64_t old_word;
+        if (occupied)
+            old_word = word.fetch_or(bit, std::memory_order_release);
+        else
+            old_word = word.fetch_and(~bit, std::memory_order_release);
+
+        //only bump versions on actual change so readers don't see spurious updates
+        if (((old_word & bit) != 0) != occupied) {
+            block->version.fetch_add(1, std::memory_order_release);
+            version_.fetch_add(1, std::memory_order_release);
+        }
+    }
+
+    void VoxelOccupancyMap::insertPoint(const Vector3r& point)
+    {
+        setVoxel(toVoxelIndex(point), true);
+    }
+
+    void VoxelOccupancyMap::clearPoint(const Vector3r& point)
+    {
+        setVoxel(toVoxelIndex(point), false);
+    }
+
+    void VoxelOccupancyMap::insertRay(const Vector3r& origin, const Vector3r& end, bool end_occupied)
+    {
+        //3D DDA from Amanatides & Woo, "A Fast Voxel Traversal Algorithm for Ray Tracing"
+        const VoxelIndex start_index = toVoxelIndex(origin);
+        const VoxelIndex end_index = toVoxelIndex(end);
+        const Vector3r dir = end - origin;
+
+        int cur[3] = { start_index.x, start_index.y, start_index.z };
+        const int last[3] = { end_index.x, end_index.y, end_index.z };
+        int step[3];
+        float t_max[3], t_delta[3];
+        for (int axis = 0; axis < 3; ++axis) {
+            if (dir[axis] > 0) {
+                step[axis] = 1;
+                t_max[axis] = ((cur[axis] + 1) * voxel_size_ - origin[axis]) / dir[axis];
+                t_delta[axis] = voxel_size_ / dir[axis];
+            }
+            else if (dir[axis] < 0) {
+                step[axis] = -1;
+                t_max[axis] = (cur[axis] * voxel_size_ - origin[axis]) / dir[axis];
+                t_delta[axis] = -voxel_size_ / dir[axis];
+            }
+            else {
+                step[axis] = 0;
+                t_max[axis] = Utils::max<float>();
+                t_delta[axis] = Utils::max<float>();
+            }
+        }
+
+        const int steps = std::abs(last[0] - cur[0]) + std::abs(last[1] - cur[1]) + std::abs(last[2] - cur[2]);
+        for (int i = 0; i < steps; ++i) {
+            setVoxel(VoxelIndex{ cur[0], cur[1], cur[2] }, false);
+
+            int axis = t_max[0] < t_max[1] ? (t_max[0] < t_max[2] ? 0 : 2) : (t_max[1] < t_max[2] ? 1 : 2);
+            cur[axis] += step[axis];
+            t_max[axis] += t_delta[axis];
+        }
+
+        setVoxel(end_index, end_occupied);
+    }
+
+    void VoxelOccupancyMap::insertPointCloud(const vector<real_T>& point_cloud, const Pose& sensor_pose, bool clear_free_space)
+    {
+        const VectorMathBatch::AffineTransform transform = VectorMathBatch::AffineTransform::bodyToWorld(sensor_pose);
+
+        //transform in chunks on stack so we get SIMD without allocating copy of the cloud
+        static constexpr size_t chunk_points = 256;
+        float world_xyz[chunk_points * 3];
+
+        const size_t point_count = point_cloud.size() / 3;
+        for (size_t start = 0; start < point_count; start += chunk_points) {
+            const size_t count = std::min(chunk_points, point_count - start);
+            VectorMathBatch::transformPoints(point_cloud.data() + start * 3, world_xyz, count, transform);
+
+            for (size_t i = 0; i < count; ++i) {
+                const Vector3r point(world_xyz[i * 3], world_xyz[i * 3 + 1], world_xyz[i * 3 + 2]);
+
+                if (clear_free_space)
+                    insertRay(sensor_pose.position, point, true);
+                else
+                    insertPoint(point);
+            }
+        }
+    }
+
+    void VoxelOccupancyMap::insertDepthImage(const vector<float>& depth_planar, int width, int height, float fov_degrees,
+                                             const Pose& camera_pose, float max_depth, int pixel_stride)
+    {
+        if (width <= 0 || height <= 0 || depth_planar.size() < static_cast<size_t>(width) * height)
+            throw std::invalid_argument(Utils::stringf("Depth image of size %i does not match %ix%i", static_cast<int>(depth_planar.size()), width, height));
+
+        const Matrix3x3r rotation = camera_pose.orientation.toRotationMatrix();
+        const float inv_focal = std::tan(Utils::degreesToRadians(fov_degrees) / 2) / (width / 2.0f);
+        const float cx = width / 2.0f, cy = height / 2.0f;
+        pixel_stride = std::max(pixel_stride, 1);
+
+        for (int v = 0; v < height; v += pixel_stride) {
+            for (int u = 0; u < width; u += pixel_stride) {
+                const float depth = depth_planar[v * width + u];
+                if (!(depth > 0 && depth < max_depth)) //also rejects NaN
+                    continue;
+
+                //camera frame is NED: x is forward, y is right, z is down
+                const Vector3r point_camera(depth, (u + 0.5f - cx) * inv_focal * depth, (v + 0.5f - cy) * inv_focal * depth);
+                insertPoint(rotation * point_camera + camera_pose.position);
+            }
+        }
+    }
+
+    void VoxelOccupancyMap::insertDistance(float distance, float min_distance, float max_distance, const Pose& sensor_pose)
+    {
+        const Vector3r dir = VectorMath::transformToWorldFrame(VectorMath::front(), sensor_pose.orientation, true);
+
+        if (distance >= min_distance && distance < max_distance)
+            insertRay(sensor_pose.position, sensor_pose.position + dir * distance, true);
+        else if (distance >= max_distance) //nothing in range
+            insertRay(sensor_pose.position, sensor_pose.position + dir * max_distance, false);
+        //else too close to tell anything
+    }
+
+    void VoxelOccupancyMap::clear()
+    {
+        for (uint i = 0; i <= capacity_mask_; ++i) {
+            Block* block = slots_[i].load(std::memory_order_acquire);
+            if (block == nullptr)
+                continue;
+
+            for (auto& word : block->words)
+                word.store(0, std::memory_order_release);
+            block->version.fetch_add(1, std::memory_order_release);
+        }
+        version_.fetch_add(1, std::memory_order_release);
+    }
+
+    bool VoxelOccupancyMap::isOccupied(const Vector3r& point) const
+    {
+        const VoxelIndex index = toVoxelIndex(point);
+        const Block* block = findBlock(toBlockKey(index.x >> kBlockBits, index.y >> kBlockBits, index.z >> kBlockBits));
+        if (block == nullptr)
+            return false;
+
+        static constexpr int local_mask = kBlockSize - 1;
+        const uint64_t bit = uint64_t(1) << ((index.x & local_mask) + (index.y & local_mask) * kBlockSize);
+        return (block->words[index.z & local_mask].load(std::memory_order_acquire) & bit) != 0;
+    }
+
+    template <typename TVisitor>
+    void VoxelOccupancyMap::forEachOccupied(const VoxelIndex& min_index, const VoxelIndex& max_index, TVisitor&& visitor) const
+    {
+        static constexpr int local_mask = kBlockSize - 1;
+
+        for (int bz = min_index.z >> kBlockBits; bz <= (max_index.z >> kBlockBits); ++bz) {
+            const int z0 = std::max(min_index.z - bz * kBlockSize, 0), z1 = std::min(max_index.z - bz * kBlockSize, local_mask);
+            for (int by = min_index.y >> kBlockBits; by <= (max_index.y >> kBlockBits); ++by) {
+                const int y0 = std::max(min_index.y - by * kBlockSize, 0), y1 = std::min(max_index.y - by * kBlockSize, local_mask);
+                for (int bx = min_index.x >> kBlockBits; bx <= (max_index.x >> kBlockBits); ++bx) {
+                    const Block* block = findBlock(toBlockKey(bx, by, bz));
+                    if (block == nullptr)
+                        continue;
+
+                    const int x0 = std::max(min_index.x - bx * kBlockSize, 0), x1 = std::min(max_index.x - bx * kBlockSize, local_mask);
+
+                    //mask of bits inside x/y range of the box
+                    uint64_t row_mask = ((uint64_t(1) << (x1 - x0 + 1)) - 1) << x0;
+                    uint64_t box_mask = 0;
+                    for (int y = y0; y <= y1; ++y)
+                        box_mask |= row_mask << (y * kBlockSize);
+
+                    for (int z = z0; z <= z1; ++z) {
+                        uint64_t word = block->words[z].load(std::memory_order_acquire) & box_mask;
+                        while (word != 0) {
+                            const int bit = lowestBitIndex(word);
+                            word &= word - 1; //clear lowest set bit
+
+                            visitor(bx * kBlockSize + (bit & local_mask), by * kBlockSize + (bit >> kBlockBits), bz * kBlockSize + z);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    VoxelOccupancyMap::ObstacleInfo VoxelOccupancyMap::sweepSphere(const Vector3r& from, const Vector3r& to, float radius) const
+    {
+        ObstacleInfo result;
+
+        const Vector3r seg = to - from;
+        const float length = seg.norm();
+        const Vector3r dir = length > 0 ? Vector3r(seg / length) : Vector3r::Zero();
+        //voxel is treated as its bounding sphere so we never under estimate
+        const float hit_radius = radius + voxel_size_ * 0.8660254f;
+        const float hit_radius_sq = hit_radius * hit_radius;
+
+        const Vector3r extent(hit_radius, hit_radius, hit_radius);
+        const VoxelIndex min_index = toVoxelIndex(from.cwiseMin(to) - extent);
+        const VoxelIndex max_index = toVoxelIndex(from.cwiseMax(to) + extent);
+
+        forEachOccupied(min_index, max_index, [&](int x, int y, int z) {
+            const Vector3r center = toVoxelCenter(x, y, z);
+            const Vector3r offset = center - from;
+            const float t = offset.dot(dir);
+
+            //voxels behind the start don't block the sweep, this allows moving away from obstacles
+            if (t < 0 && length > 0)
+                return;
+            const float t_clamped = std::min(t, length);
+            if ((offset - dir * t_clamped).squaredNorm() > hit_radius_sq)
+                return;
+
+            if (t_clamped < result.distance) {
+                result.found = true;
+                result.distance = std::max(t_clamped, 0.0f);
+                result.position = center;
+            }
+        });
+
+        return result;
+    }
+
+    VoxelOccupancyMap::ObstacleInfo VoxelOccupancyMap::getClosestObstacle(const Vector3r& center, float max_radius) const
+    {
+        ObstacleInfo result;
+
+        const Vector3r extent(max_radius, max_radius, max_radius);
+        float closest_sq = max_radius * max_radius;
+
+        forEachOccupied(toVoxelIndex(center - extent), toVoxelIndex(center + extent), [&](int x, int y, int z) {
+            const Vector3r voxel_center = toVoxelCenter(x, y, z);
+            const float dist_sq = (voxel_center - center).squaredNorm();
+            if (dist_sq <= closest_sq) {
+                closest_sq = dist_sq;
+                result.found = true;
+                result.position = voxel_center;
+            }
+        });
+
+        if (result.found)
+            result.distance = std::sqrt(closest_sq);
+        return result;
+    }
+
+    uint VoxelOccupancyMap::getBlockVersion(const Vector3r& point) const
+    {
+        const VoxelIndex index = toVoxelIndex(point);
+        const Block* block = findBlock(toBlockKey(index.x >> kBlockBits, index.y >> kBlockBits, index.z >> kBlockBits));
+        return block == nullptr ? 0 : block->version.load(std::memory_order_acquire);
+    }
+
+    uint VoxelOccupancyMap::getVersion() const
+    {
+        return version_.load(std::memory_order_acquire);
+    }
+
+    float VoxelOccupancyMap::getVoxelSize() const
+    {
+        return voxel_size_;
+    }
+
+    uint VoxelOccupancyMap::getBlockCount() const
+    {
+        return block_count_.load(std::memory_order_relaxed);
+    }
+
+    uint VoxelOccupancyMap::getDroppedUpdates() const
+    {
+        return dropped_updates_.load(std::memory_order_relaxed);
+    }
+}
+} //namespace
+
+#endif
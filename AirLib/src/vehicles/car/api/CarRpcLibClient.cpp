@@ -51,6 +51,11 @@ __pragma(warning(disable : 4239))
         {
         }
 
+        CarRpcLibClient::CarRpcLibClient(RpcLibConnectionPool& connection_pool)
+            : RpcLibClientBase(connection_pool)
+        {
+        }
+
         CarRpcLibClient::~CarRpcLibClient()
         {
         }
@@ -11,6 +11,8 @@
 
 #include "common/Common.hpp"
 #include <thread>
+#include <mutex>
+#include <unordered_map>
 STRICT_MODE_OFF
 
 #ifndef RPCLIB_MSGPACK
@@ -48,7 +50,10 @@ __pragma(warning(disable : 4239))
         struct MultirotorRpcLibClient::impl
         {
         public:
-            std::future<RPCLIB_MSGPACK::object_handle> last_future;
+            //guards the handles below, async calls may come from several threads
+            mutable std::mutex mutex;
+            RpcLibTaskHandle last_task;
+            std::unordered_map<std::string, RpcLibTaskHandle> vehicle_tasks;
         };
 
         MultirotorRpcLibClient::MultirotorRpcLibClient(const string& ip_address, uint16_t port, float timeout_sec)
@@ -57,148 +62,154 @@ __pragma(warning(disable : 4239))
             pimpl_.reset(new impl());
         }
 
+        MultirotorRpcLibClient::MultirotorRpcLibClient(RpcLibConnectionPool& connection_pool)
+            : RpcLibClientBase(connection_pool)
+        {
+            pimpl_.reset(new impl());
+        }
+
         MultirotorRpcLibClient::~MultirotorRpcLibClient()
         {
         }
 
-        MultirotorRpcLibClient* MultirotorRpcLibClient::takeoffAsync(float timeout_sec, const std::string& vehicle_name)
+        MultirotorRpcLibClient* MultirotorRpcLibClient::takeoffAsync(float timeout_sec, const std::string& vehicle_name, RpcLibTaskHandle* task)
         {
-            pimpl_->last_future = static_cast<rpc::client*>(getClient())->async_call("takeoff", timeout_sec, vehicle_name);
-            return this;
+            auto future = static_cast<rpc::client*>(getClient())->async_call("takeoff", timeout_sec, vehicle_name);
+            return setLastTask(RpcLibTaskHandle(&future, vehicle_name), task);
         }
-        MultirotorRpcLibClient* MultirotorRpcLibClient::landAsync(float timeout_sec, const std::string& vehicle_name)
+        MultirotorRpcLibClient* MultirotorRpcLibClient::landAsync(float timeout_sec, const std::string& vehicle_name, RpcLibTaskHandle* task)
         {
-            pimpl_->last_future = static_cast<rpc::client*>(getClient())->async_call("land", timeout_sec, vehicle_name);
-            return this;
+            auto future = static_cast<rpc::client*>(getClient())->async_call("land", timeout_sec, vehicle_name);
+            return setLastTask(RpcLibTaskHandle(&future, vehicle_name), task);
         }
-        MultirotorRpcLibClient* MultirotorRpcLibClient::goHomeAsync(float timeout_sec, const std::string& vehicle_name)
+        MultirotorRpcLibClient* MultirotorRpcLibClient::goHomeAsync(float timeout_sec, const std::string& vehicle_name, RpcLibTaskHandle* task)
         {
-            pimpl_->last_future = static_cast<rpc::client*>(getClient())->async_call("goHome", timeout_sec, vehicle_name);
-            return this;
+            auto future = static_cast<rpc::client*>(getClient())->async_call("goHome", timeout_sec, vehicle_name);
+            return setLastTask(RpcLibTaskHandle(&future, vehicle_name), task);
         }
 
         MultirotorRpcLibClient* MultirotorRpcLibClient::moveByVelocityBodyFrameAsync(float vx, float vy, float vz, float duration,
-                                                                                     DrivetrainType drivetrain, const YawMode& yaw_mode, const std::string& vehicle_name)
+                                                                                     DrivetrainType drivetrain, const YawMode& yaw_mode, const std::string& vehicle_name, RpcLibTaskHandle* task)
         {
-            pimpl_->last_future = static_cast<rpc::client*>(getClient())->async_call("moveByVelocityBodyFrame", vx, vy, vz, duration, drivetrain, MultirotorRpcLibAdaptors::YawMode(yaw_mode), vehicle_name);
-            return this;
+            auto future = static_cast<rpc::client*>(getClient())->async_call("moveByVelocityBodyFrame", vx, vy, vz, duration, drivetrain, MultirotorRpcLibAdaptors::YawMode(yaw_mode), vehicle_name);
+            return setLastTask(RpcLibTaskHandle(&future, vehicle_name), task);
         }
 
         MultirotorRpcLibClient* MultirotorRpcLibClient::moveByVelocityZBodyFrameAsync(float vx, float vy, float z, float duration,
-                                                                                      DrivetrainType drivetrain, const YawMode& yaw_mode, const std::string& vehicle_name)
+                                                                                      DrivetrainType drivetrain, const YawMode& yaw_mode, const std::string& vehicle_name, RpcLibTaskHandle* task)
         {
-            pimpl_->last_future = static_cast<rpc::client*>(getClient())->async_call("moveByVelocityZBodyFrame", vx, vy, z, duration, drivetrain, MultirotorRpcLibAdaptors::YawMode(yaw_mode), vehicle_name);
-            return this;
+            auto future = static_cast<rpc::client*>(getClient())->async_call("moveByVelocityZBodyFrame", vx, vy, z, duration, drivetrain, MultirotorRpcLibAdaptors::YawMode(yaw_mode), vehicle_name);
+            return setLastTask(RpcLibTaskHandle(&future, vehicle_name), task);
         }
 
-        MultirotorRpcLibClient* MultirotorRpcLibClient::moveByMotorPWMsAsync(float front_right_pwm, float rear_left_pwm, float front_left_pwm, float rear_right_pwm, float duration, const std::string& vehicle_name)
+        MultirotorRpcLibClient* MultirotorRpcLibClient::moveByMotorPWMsAsync(float front_right_pwm, float rear_left_pwm, float front_left_pwm, float rear_right_pwm, float duration, const std::string& vehicle_name, RpcLibTaskHandle* task)
         {
-            pimpl_->last_future = static_cast<rpc::client*>(getClient())->async_call("moveByMotorPWMs", front_right_pwm, rear_left_pwm, front_left_pwm, rear_right_pwm, duration, vehicle_name);
-            return this;
+            auto future = static_cast<rpc::client*>(getClient())->async_call("moveByMotorPWMs", front_right_pwm, rear_left_pwm, front_left_pwm, rear_right_pwm, duration, vehicle_name);
+            return setLastTask(RpcLibTaskHandle(&future, vehicle_name), task);
         }
 
-        MultirotorRpcLibClient* MultirotorRpcLibClient::moveByRollPitchYawZAsync(float roll, float pitch, float yaw, float z, float duration, const std::string& vehicle_name)
+        MultirotorRpcLibClient* MultirotorRpcLibClient::moveByRollPitchYawZAsync(float roll, float pitch, float yaw, float z, float duration, const std::string& vehicle_name, RpcLibTaskHandle* task)
         {
-            pimpl_->last_future = static_cast<rpc::client*>(getClient())->async_call("moveByRollPitchYawZ", roll, pitch, yaw, z, duration, vehicle_name);
-            return this;
+            auto future = static_cast<rpc::client*>(getClient())->async_call("moveByRollPitchYawZ", roll, pitch, yaw, z, duration, vehicle_name);
+            return setLastTask(RpcLibTaskHandle(&future, vehicle_name), task);
         }
 
-        MultirotorRpcLibClient* MultirotorRpcLibClient::moveByRollPitchYawThrottleAsync(float roll, float pitch, float yaw, float throttle, float duration, const std::string& vehicle_name)
+        MultirotorRpcLibClient* MultirotorRpcLibClient::moveByRollPitchYawThrottleAsync(float roll, float pitch, float yaw, float throttle, float duration, const std::string& vehicle_name, RpcLibTaskHandle* task)
         {
-            pimpl_->last_future = static_cast<rpc::client*>(getClient())->async_call("moveByRollPitchYawThrottle", roll, pitch, yaw, throttle, duration, vehicle_name);
-            return this;
+            auto future = static_cast<rpc::client*>(getClient())->async_call("moveByRollPitchYawThrottle", roll, pitch, yaw, throttle, duration, vehicle_name);
+            return setLastTask(RpcLibTaskHandle(&future, vehicle_name), task);
         }
 
-        MultirotorRpcLibClient* MultirotorRpcLibClient::moveByRollPitchYawrateThrottleAsync(float roll, float pitch, float yaw_rate, float throttle, float duration, const std::string& vehicle_name)
+        MultirotorRpcLibClient* MultirotorRpcLibClient::moveByRollPitchYawrateThrottleAsync(float roll, float pitch, float yaw_rate, float throttle, float duration, const std::string& vehicle_name, RpcLibTaskHandle* task)
         {
-            pimpl_->last_future = static_cast<rpc::client*>(getClient())->async_call("moveByRollPitchYawrateThrottle", roll, pitch, yaw_rate, throttle, duration, vehicle_name);
-            return this;
+            auto future = static_cast<rpc::client*>(getClient())->async_call("moveByRollPitchYawrateThrottle", roll, pitch, yaw_rate, throttle, duration, vehicle_name);
+            return setLastTask(RpcLibTaskHandle(&future, vehicle_name), task);
         }
 
-        MultirotorRpcLibClient* MultirotorRpcLibClient::moveByRollPitchYawrateZAsync(float roll, float pitch, float yaw_rate, float z, float duration, const std::string& vehicle_name)
+        MultirotorRpcLibClient* MultirotorRpcLibClient::moveByRollPitchYawrateZAsync(float roll, float pitch, float yaw_rate, float z, float duration, const std::string& vehicle_name, RpcLibTaskHandle* task)
         {
-            pimpl_->last_future = static_cast<rpc::client*>(getClient())->async_call("moveByRollPitchYawrateZ", roll, pitch, yaw_rate, z, duration, vehicle_name);
-            return this;
+            auto future = static_cast<rpc::client*>(getClient())->async_call("moveByRollPitchYawrateZ", roll, pitch, yaw_rate, z, duration, vehicle_name);
+            return setLastTask(RpcLibTaskHandle(&future, vehicle_name), task);
         }
 
-        MultirotorRpcLibClient* MultirotorRpcLibClient::moveByAngleRatesZAsync(float roll_rate, float pitch_rate, float yaw_rate, float z, float duration, const std::string& vehicle_name)
+        MultirotorRpcLibClient* MultirotorRpcLibClient::moveByAngleRatesZAsync(float roll_rate, float pitch_rate, float yaw_rate, float z, float duration, const std::string& vehicle_name, RpcLibTaskHandle* task)
         {
-            pimpl_->last_future = static_cast<rpc::client*>(getClient())->async_call("moveByAngleRatesZ", roll_rate, pitch_rate, yaw_rate, z, duration, vehicle_name);
-            return this;
+            auto future = static_cast<rpc::client*>(getClient())->async_call("moveByAngleRatesZ", roll_rate, pitch_rate, yaw_rate, z, duration, vehicle_name);
+            return setLastTask(RpcLibTaskHandle(&future, vehicle_name), task);
         }
 
-        MultirotorRpcLibClient* MultirotorRpcLibClient::moveByAngleRatesThrottleAsync(float roll_rate, float pitch_rate, float yaw_rate, float throttle, float duration, const std::string& vehicle_name)
+        MultirotorRpcLibClient* MultirotorRpcLibClient::moveByAngleRatesThrottleAsync(float roll_rate, float pitch_rate, float yaw_rate, float throttle, float duration, const std::string& vehicle_name, RpcLibTaskHandle* task)
         {
-            pimpl_->last_future = static_cast<rpc::client*>(getClient())->async_call("moveByAngleRatesThrottle", roll_rate, pitch_rate, yaw_rate, throttle, duration, vehicle_name);
-            return this;
+            auto future = static_cast<rpc::client*>(getClient())->async_call("moveByAngleRatesThrottle", roll_rate, pitch_rate, yaw_rate, throttle, duration, vehicle_name);
+            return setLastTask(RpcLibTaskHandle(&future, vehicle_name), task);
         }
 
         MultirotorRpcLibClient* MultirotorRpcLibClient::moveByVelocityAsync(float vx, float vy, float vz, float duration,
-                                                                            DrivetrainType drivetrain, const YawMode& yaw_mode, const std::string& vehicle_name)
+                                                                            DrivetrainType drivetrain, const YawMode& yaw_mode, const std::string& vehicle_name, RpcLibTaskHandle* task)
         {
-            pimpl_->last_future = static_cast<rpc::client*>(getClient())->async_call("moveByVelocity", vx, vy, vz, duration, drivetrain, MultirotorRpcLibAdaptors::YawMode(yaw_mode), vehicle_name);
-            return this;
+            auto future = static_cast<rpc::client*>(getClient())->async_call("moveByVelocity", vx, vy, vz, duration, drivetrain, MultirotorRpcLibAdaptors::YawMode(yaw_mode), vehicle_name);
+            return setLastTask(RpcLibTaskHandle(&future, vehicle_name), task);
         }
 
         MultirotorRpcLibClient* MultirotorRpcLibClient::moveByVelocityZAsync(float vx, float vy, float z, float duration,
-                                                                             DrivetrainType drivetrain, const YawMode& yaw_mode, const std::string& vehicle_name)
+                                                                             DrivetrainType drivetrain, const YawMode& yaw_mode, const std::string& vehicle_name, RpcLibTaskHandle* task)
         {
-            pimpl_->last_future = static_cast<rpc::client*>(getClient())->async_call("moveByVelocityZ", vx, vy, z, duration, drivetrain, MultirotorRpcLibAdaptors::YawMode(yaw_mode), vehicle_name);
-            return this;
+            auto future = static_cast<rpc::client*>(getClient())->async_call("moveByVelocityZ", vx, vy, z, duration, drivetrain, MultirotorRpcLibAdaptors::YawMode(yaw_mode), vehicle_name);
+            return setLastTask(RpcLibTaskHandle(&future, vehicle_name), task);
         }
 
         MultirotorRpcLibClient* MultirotorRpcLibClient::moveOnPathAsync(const vector<Vector3r>& path, float velocity, float duration,
-                                                                        DrivetrainType drivetrain, const YawMode& yaw_mode, float lookahead, float adaptive_lookahead, const std::string& vehicle_name)
+                                                                        DrivetrainType drivetrain, const YawMode& yaw_mode, float lookahead, float adaptive_lookahead, const std::string& vehicle_name, RpcLibTaskHandle* task)
         {
             vector<MultirotorRpcLibAdaptors::Vector3r> conv_path;
             MultirotorRpcLibAdaptors::from(path, conv_path);
-            pimpl_->last_future = static_cast<rpc::client*>(getClient())->async_call("moveOnPath", conv_path, velocity, duration, drivetrain, MultirotorRpcLibAdaptors::YawMode(yaw_mode), lookahead, adaptive_lookahead, vehicle_name);
-            return this;
+            auto future = static_cast<rpc::client*>(getClient())->async_call("moveOnPath", conv_path, velocity, duration, drivetrain, MultirotorRpcLibAdaptors::YawMode(yaw_mode), lookahead, adaptive_lookahead, vehicle_name);
+            return setLastTask(RpcLibTaskHandle(&future, vehicle_name), task);
         }
 
         MultirotorRpcLibClient* MultirotorRpcLibClient::moveToGPSAsync(float latitude, float longitude, float altitude, float velocity, float timeout_sec,
-                                                                       DrivetrainType drivetrain, const YawMode& yaw_mode, float lookahead, float adaptive_lookahead, const std::string& vehicle_name)
+                                                                       DrivetrainType drivetrain, const YawMode& yaw_mode, float lookahead, float adaptive_lookahead, const std::string& vehicle_name, RpcLibTaskHandle* task)
         {
-            pimpl_->last_future = static_cast<rpc::client*>(getClient())->async_call("moveToGPS", latitude, longitude, altitude, velocity, timeout_sec, drivetrain, MultirotorRpcLibAdaptors::YawMode(yaw_mode), lookahead, adaptive_lookahead, vehicle_name);
-            return this;
+            auto future = static_cast<rpc::client*>(getClient())->async_call("moveToGPS", latitude, longitude, altitude, velocity, timeout_sec, drivetrain, MultirotorRpcLibAdaptors::YawMode(yaw_mode), lookahead, adaptive_lookahead, vehicle_name);
+            return setLastTask(RpcLibTaskHandle(&future, vehicle_name), task);
         }
 
         MultirotorRpcLibClient* MultirotorRpcLibClient::moveToPositionAsync(float x, float y, float z, float velocity, float timeout_sec,
-                                                                            DrivetrainType drivetrain, const YawMode& yaw_mode, float lookahead, float adaptive_lookahead, const std::string& vehicle_name)
+                                                                            DrivetrainType drivetrain, const YawMode& yaw_mode, float lookahead, float adaptive_lookahead, const std::string& vehicle_name, RpcLibTaskHandle* task)
         {
-            pimpl_->last_future = static_cast<rpc::client*>(getClient())->async_call("moveToPosition", x, y, z, velocity, timeout_sec, drivetrain, MultirotorRpcLibAdaptors::YawMode(yaw_mode), lookahead, adaptive_lookahead, vehicle_name);
-            return this;
+            auto future = static_cast<rpc::client*>(getClient())->async_call("moveToPosition", x, y, z, velocity, timeout_sec, drivetrain, MultirotorRpcLibAdaptors::YawMode(yaw_mode), lookahead, adaptive_lookahead, vehicle_name);
+            return setLastTask(RpcLibTaskHandle(&future, vehicle_name), task);
         }
 
-        MultirotorRpcLibClient* MultirotorRpcLibClient::moveToZAsync(float z, float velocity, float timeout_sec, const YawMode& yaw_mode, float lookahead, float adaptive_lookahead, const std::string& vehicle_name)
+        MultirotorRpcLibClient* MultirotorRpcLibClient::moveToZAsync(float z, float velocity, float timeout_sec, const YawMode& yaw_mode, float lookahead, float adaptive_lookahead, const std::string& vehicle_name, RpcLibTaskHandle* task)
         {
-            pimpl_->last_future = static_cast<rpc::client*>(getClient())->async_call("moveToZ", z, velocity, timeout_sec, MultirotorRpcLibAdaptors::YawMode(yaw_mode), lookahead, adaptive_lookahead, vehicle_name);
-            return this;
+            auto future = static_cast<rpc::client*>(getClient())->async_call("moveToZ", z, velocity, timeout_sec, MultirotorRpcLibAdaptors::YawMode(yaw_mode), lookahead, adaptive_lookahead, vehicle_name);
+            return setLastTask(RpcLibTaskHandle(&future, vehicle_name), task);
         }
 
         MultirotorRpcLibClient* MultirotorRpcLibClient::moveByManualAsync(float vx_max, float vy_max, float z_min, float duration,
-                                                                          DrivetrainType drivetrain, const YawMode& yaw_mode, const std::string& vehicle_name)
+                                                                          DrivetrainType drivetrain, const YawMode& yaw_mode, const std::string& vehicle_name, RpcLibTaskHandle* task)
         {
-            pimpl_->last_future = static_cast<rpc::client*>(getClient())->async_call("moveByManual", vx_max, vy_max, z_min, duration, drivetrain, MultirotorRpcLibAdaptors::YawMode(yaw_mode), vehicle_name);
-            return this;
+            auto future = static_cast<rpc::client*>(getClient())->async_call("moveByManual", vx_max, vy_max, z_min, duration, drivetrain, MultirotorRpcLibAdaptors::YawMode(yaw_mode), vehicle_name);
+            return setLastTask(RpcLibTaskHandle(&future, vehicle_name), task);
         }
 
-        MultirotorRpcLibClient* MultirotorRpcLibClient::rotateToYawAsync(float yaw, float timeout_sec, float margin, const std::string& vehicle_name)
+        MultirotorRpcLibClient* MultirotorRpcLibClient::rotateToYawAsync(float yaw, float timeout_sec, float margin, const std::string& vehicle_name, RpcLibTaskHandle* task)
         {
-            pimpl_->last_future = static_cast<rpc::client*>(getClient())->async_call("rotateToYaw", yaw, timeout_sec, margin, vehicle_name);
-            return this;
+            auto future = static_cast<rpc::client*>(getClient())->async_call("rotateToYaw", yaw, timeout_sec, margin, vehicle_name);
+            return setLastTask(RpcLibTaskHandle(&future, vehicle_name), task);
         }
 
-        MultirotorRpcLibClient* MultirotorRpcLibClient::rotateByYawRateAsync(float yaw_rate, float duration, const std::string& vehicle_name)
+        MultirotorRpcLibClient* MultirotorRpcLibClient::rotateByYawRateAsync(float yaw_rate, float duration, const std::string& vehicle_name, RpcLibTaskHandle* task)
         {
-            pimpl_->last_future = static_cast<rpc::client*>(getClient())->async_call("rotateByYawRate", yaw_rate, duration, vehicle_name);
-            return this;
+            auto future = static_cast<rpc::client*>(getClient())->async_call("rotateByYawRate", yaw_rate, duration, vehicle_name);
+            return setLastTask(RpcLibTaskHandle(&future, vehicle_name), task);
         }
 
-        MultirotorRpcLibClient* MultirotorRpcLibClient::hoverAsync(const std::string& vehicle_name)
+        MultirotorRpcLibClient* MultirotorRpcLibClient::hoverAsync(const std::string& vehicle_name, RpcLibTaskHandle* task)
         {
-            pimpl_->last_future = static_cast<rpc::client*>(getClient())->async_call("hover", vehicle_name);
-            return this;
+            auto future = static_cast<rpc::client*>(getClient())->async_call("hover", vehicle_name);
+            return setLastTask(RpcLibTaskHandle(&future, vehicle_name), task);
         }
 
         void MultirotorRpcLibClient::setAngleLevelControllerGains(const vector<float>& kp, const vector<float>& ki, const vector<float>& kd, const std::string& vehicle_name)
@@ -244,20 +255,36 @@ __pragma(warning(disable : 4239))
             static_cast<rpc::client*>(getClient())->call("moveByRC", MultirotorRpcLibAdaptors::RCData(rc_data), vehicle_name);
         }
 
+        MultirotorRpcLibClient* MultirotorRpcLibClient::setLastTask(const RpcLibTaskHandle& task, RpcLibTaskHandle* out_task)
+        {
+            if (out_task)
+                *out_task = task;
+
+            std::lock_guard<std::mutex> lock(pimpl_->mutex);
+            pimpl_->last_task = task;
+            pimpl_->vehicle_tasks[task.getVehicleName()] = task;
+            return this;
+        }
+
+        RpcLibTaskHandle MultirotorRpcLibClient::getLastTask() const
+        {
+            std::lock_guard<std::mutex> lock(pimpl_->mutex);
+            return pimpl_->last_task;
+        }
+
+        RpcLibTaskHandle MultirotorRpcLibClient::getLastTask(const std::string& vehicle_name) const
+        {
+            std::lock_guard<std::mutex> lock(pimpl_->mutex);
+            auto it = pimpl_->vehicle_tasks.find(vehicle_name);
+            return it != pimpl_->vehicle_tasks.end() ? it->second : RpcLibTaskHandle();
+        }
+
         //return value of last task. It should be true if task completed without
         //cancellation or timeout
         MultirotorRpcLibClient* MultirotorRpcLibClient::waitOnLastTask(bool* task_result, float timeout_sec)
         {
-            bool result;
-            if (std::isnan(timeout_sec) || timeout_sec == Utils::max<float>())
-                result = pimpl_->last_future.get().as<bool>();
-            else {
-                auto future_status = pimpl_->last_future.wait_for(std::chrono::duration<double>(timeout_sec));
-                if (future_status == std::future_status::ready)
-                    result = pimpl_->last_future.get().as<bool>();
-                else
-                    result = false;
-            }
+            const RpcLibTaskHandle task = getLastTask();
+            bool result = task.wait(timeout_sec) && task.getResult();
 
             if (task_result)
                 *task_result = result;
@@ -0,0 +1,69 @@
+
+#include "SettingsTest.hpp"
+#include "PixhawkTest.hpp"
+#include "SimpleFlightTest.hpp"
+#include "WorkerThreadTest.hpp"
+#include "QuaternionTest.hpp"
+#include "CelestialTests.hpp"
+#include "OccupancyMapTest.hpp"
+#include "VectorMathBatchTest.hpp"
+#include "GeodeticBatchTest.hpp"
+#include "BoundedMpmcQueueTest.hpp"
+#include "TaskSchedulerTest.hpp"
+#include "BufferPoolTest.hpp"
+#include "RpcLibAdaptorsTest.hpp"
+#include "PointCloudFilterTest.hpp"
+#include "RpcLibClientTest.hpp"
+#include "AsyncLoggerTest.hpp"
+#include "CollisionServiceTest.hpp"
+#include "SceneBvhTest.hpp"
+#include "LidarBvhTest.hpp"
+#include "MedianFilterTest.hpp"
+#include "TelemetryLoggerTest.hpp"
+#include "ReplayJournalTest.hpp"
+#include "StateSnapshotTest.hpp"
+#include "CarPhysicsBodyTest.hpp"
+#include "SensorCollectionTest.hpp"
+#include "SimpleFlightEkfTest.hpp"
+#include "RotorActuatorTest.hpp"
+
+int main()
+{
+    using namespace msr::airlib;
+
+    std::unique_ptr<TestBase> tests[] = {
+        std::unique_ptr<TestBase>(new QuaternionTest()),
+        std::unique_ptr<TestBase>(new CelestialTest()),
+        std::unique_ptr<TestBase>(new SettingsTest()),
+        std::unique_ptr<TestBase>(new SimpleFlightTest()),
+        std::unique_ptr<TestBase>(new OccupancyMapTest()),
+        std::unique_ptr<TestBase>(new VectorMathBatchTest()),
+        std::unique_ptr<TestBase>(new GeodeticBatchTest()),
+        std::unique_ptr<TestBase>(new BoundedMpmcQueueTest()),
+        std::unique_ptr<TestBase>(new TaskSchedulerTest()),
+        std::unique_ptr<TestBase>(new BufferPoolTest()),
+        std::unique_ptr<TestBase>(new RpcLibAdaptorsTest()),
+        std::unique_ptr<TestBase>(new PointCloudFilterTest()),
+        std::unique_ptr<TestBase>(new RpcLibClientTest()),
+        std::unique_ptr<TestBase>(new AsyncLoggerTest()),
+        std::unique_ptr<TestBase>(new CollisionServiceTest()),
+        std::unique_ptr<TestBase>(new SceneBvhTest()),
+        std::unique_ptr<TestBase>(new LidarBvhTest()),
+        std::unique_ptr<TestBase>(new MedianFilterTest()),
+        std::unique_ptr<TestBase>(new TelemetryLoggerTest()),
+        std::unique_ptr<TestBase>(new ReplayJournalTest()),
+        std::unique_ptr<TestBase>(new StateSnapshotTest()),
+        std::unique_ptr<TestBase>(new CarPhysicsBodyTest()),
+        std::unique_ptr<TestBase>(new WorkerThreadTest()),
+        std::unique_ptr<TestBase>(new SensorCollectionTest()),
+        std::unique_ptr<TestBase>(new SimpleFlightEkfTest()),
+        std::unique_ptr<TestBase>(new RotorActuatorTest())
+        //,
+        //std::unique_ptr<TestBase>(new PixhawkTest())
+    };
+
+    for (auto& test : tests)
+        test->benchmark();
+
+    return 0;
+}
@@ -0,0 +1,234 @@
+#ifndef msr_AirLibUnitTests_AsyncLoggerTest_hpp
+#define msr_AirLibUnitTests_AsyncLoggerTest_hpp
+
+#include <thread>
+#include <mutex>
+#include <iostream>
+#include "TestBase.hpp"
+#include "common/common_utils/AsyncLogger.hpp"
+#include "common/common_utils/Timer.hpp"
+
+namespace msr
+{
+namespace airlib
+{
+
+    class AsyncLoggerTest : public TestBase
+    {
+    public:
+        virtual void run() override
+        {
+            common_utils::Utils::Logger* previous_logger = common_utils::Utils::getSetLogger();
+
+            deferredMessageTest();
+            orderingTest();
+            slowSinkTest();
+            errorWakeTest();
+            minLevelTest();
+            rateLimiterTest();
+
+            common_utils::Utils::getSetLogger(previous_logger);
+        }
+
+        virtual void benchmark() override
+        {
+            common_utils::Utils::Logger* previous_logger = common_utils::Utils::getSetLogger();
+
+            static constexpr int kMessages = 100000;
+
+            //discards everything, so we only see the cost on the calling thread
+            class NullLogger : public common_utils::Utils::Logger
+            {
+            public:
+                virtual void log(int, const std::string&) override {}
+            } null_logger;
+
+            common_utils::Timer timer;
+            Utils::getSetLogger(&null_logger);
+            timer.start();
+            for (int i = 0; i < kMessages; ++i)
+                Utils::log(Utils::stringf("x=%f y=%f step=%d", 1.5, 2.5, i));
+            const double sync_ns = timer.milliseconds() * 1E6 / kMessages;
+
+            double async_ns;
+            {
+                common_utils::AsyncLogger logger(&null_logger, kMessages);
+                Utils::getSetLogger(&logger);
+                timer.start();
+                for (int i = 0; i < kMessages; ++i)
+                    Utils::logf(Utils::kLogLevelInfo, "x=%f y=%f step=%d", 1.5, 2.5, i);
+                async_ns = timer.milliseconds() * 1E6 / kMessages;
+            }
+            Utils::getSetLogger(&null_logger);
+
+            Utils::getSetMinLogLevel(true, Utils::kLogLevelWarn);
+            timer.start();
+            for (int i = 0; i < kMessages; ++i)
+                Utils::logf(Utils::kLogLevelError, "x=%f y=%f step=%d", 1.5, 2.5, i);
+            const double filtered_ns = timer.milliseconds() * 1E6 / kMessages;
+            Utils::getSetMinLogLevel(true);
+
+            std::cout << "AsyncLogger: caller cost per message sync " << sync_ns << " ns, async " << async_ns
+                      << " ns, below min level " << filtered_ns << " ns" << std::endl;
+
+            common_utils::Utils::getSetLogger(previous_logger);
+        }
+
+    private:
+        //records everything, optionally taking its time like a console under load
+        class CaptureLogger : public common_utils::Utils::Logger
+        {
+        public:
+            explicit CaptureLogger(int delay_us = 0)
+                : delay_us_(delay_us)
+            {
+            }
+
+            virtual void log(int level, const std::string& message) override
+            {
+                unused(level);
+                if (delay_us_ > 0)
+                    std::this_thread::sleep_for(std::chrono::microseconds(delay_us_));
+                std::lock_guard<std::mutex> lock(mutex_);
+                messages_.push_back(message);
+            }
+
+            std::vector<std::string> getMessages()
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                return messages_;
+            }
+
+        private:
+            int delay_us_;
+            std::mutex mutex_;
+            std::vector<std::string> messages_;
+        };
+
+        typedef common_utils::Utils Utils;
+
+        enum class Color
+        {
+            Red = 2
+        };
+
+        void deferredMessageTest()
+        {
+            const Utils::DeferredMessage message("%d %.1f %c %u %zu", -3, 2.5f, 'x', Color::Red, static_cast<size_t>(42));
+            const Utils::DeferredMessage copy = message;
+            testAssert(copy.toString() == "-3 2.5 x 2 42", "deferred arguments should format like stringf");
+            testAssert(Utils::DeferredMessage("no args").toString() == "no args", "message without arguments is the format itself");
+            testAssert(!Utils::DeferredMessage::IsDeferrable<const char*>::value, "pointers must not be deferred");
+        }
+
+        void orderingTest()
+        {
+            static constexpr int kThreads = 4;
+            static constexpr int kMessages = 500;
+
+            CaptureLogger capture;
+            {
+                common_utils::AsyncLogger logger(&capture, 4096);
+                Utils::getSetLogger(&logger);
+
+                std::vector<std::thread> threads;
+                for (int t = 0; t < kThreads; ++t)
+                    threads.emplace_back([t]() {
+                        for (int i = 0; i < kMessages; ++i)
+                            Utils::logf(Utils::kLogLevelInfo, "%d %d", t, i);
+                    });
+                for (auto& thread : threads)
+                    thread.join();
+                Utils::log("from main");
+
+                logger.flush();
+                testAssert(logger.getDroppedCount() == 0, "nothing should be dropped with large buffers");
+            }
+            testAssert(Utils::getSetLogger() == &capture, "destroyed logger should hand over to its sink");
+
+            const auto messages = capture.getMessages();
+            testAssert(messages.size() == kThreads * kMessages + 1, "every message should reach the sink");
+
+            int next[kThreads] = {};
+            for (const auto& message : messages) {
+                int t, i;
+                if (std::sscanf(message.c_str(), "%d %d", &t, &i) == 2) {
+                    testAssert(t >= 0 && t < kThreads && i == next[t], "messages of one thread should stay in order");
+                    ++next[t];
+                }
+            }
+        }
+
+        void slowSinkTest()
+        {
+            CaptureLogger capture(1000);
+            common_utils::Timer timer;
+            double log_ms;
+            uint64_t dropped;
+            {
+                common_utils::AsyncLogger logger(&capture, 64, std::chrono::milliseconds(1));
+                Utils::getSetLogger(&logger);
+
+                timer.start();
+                for (int i = 0; i < 10000; ++i)
+                    Utils::logf(Utils::kLogLevelInfo, "tick %d", i);
+                log_ms = timer.milliseconds();
+
+                logger.flush();
+                dropped = logger.getDroppedCount();
+            }
+
+            //a 1 ms sink would need 10 s if callers had to wait for it
+            testAssert(log_ms < 1000, "a slow sink must not block the caller");
+            testAssert(dropped > 0, "full buffer should drop");
+            const auto messages = capture.getMessages();
+            testAssert(messages.size() < 10000 && messages.back().find("dropped") != std::string::npos, "drops should be reported");
+        }
+
+        void errorWakeTest()
+        {
+            CaptureLogger capture;
+            common_utils::AsyncLogger logger(&capture, 64, std::chrono::seconds(10));
+            Utils::getSetLogger(&logger);
+
+            Utils::log("not yet", Utils::kLogLevelInfo);
+            Utils::log("error", Utils::kLogLevelError);
+            common_utils::Timer timer;
+            timer.start();
+            while (capture.getMessages().size() < 2 && timer.seconds() < 5)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+            testAssert(capture.getMessages().size() == 2, "an error should wake the sink before its flush interval");
+            Utils::getSetLogger(&capture);
+        }
+
+        void minLevelTest()
+        {
+            CaptureLogger capture;
+            Utils::getSetLogger(&capture);
+            Utils::getSetMinLogLevel(true, Utils::kLogLevelWarn);
+            //lower levels are more severe, min level drops everything below it
+            Utils::logf(Utils::kLogLevelError, "hidden %d", 1);
+            Utils::logf(Utils::kLogLevelInfo, "shown %s", std::string("now").c_str());
+            Utils::getSetMinLogLevel(true);
+
+            const auto messages = capture.getMessages();
+            testAssert(messages.size() == 1 && messages[0] == "shown now", "logf should respect min log level");
+        }
+
+        void rateLimiterTest()
+        {
+            Utils::LogRateLimiter limiter(10, 3);
+            int allowed = 0;
+            for (int i = 0; i < 100; ++i)
+                allowed += limiter.allow() ? 1 : 0;
+            testAssert(allowed == 3, "burst should pass, the rest should be limited");
+            testAssert(limiter.takeSuppressed() == 97 && limiter.takeSuppressed() == 0, "suppressed count should be taken once");
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(150));
+            testAssert(limiter.allow(), "limiter should recover after its interval");
+        }
+    };
+}
+}
+#endif
@@ -0,0 +1,223 @@
+#ifndef msr_AirLibUnitTests_BoundedMpmcQueueTest_hpp
+#define msr_AirLibUnitTests_BoundedMpmcQueueTest_hpp
+
+#include <thread>
+#include <atomic>
+#include <iostream>
+#include "TestBase.hpp"
+#include "common/common_utils/BoundedMpmcQueue.hpp"
+#include "common/common_utils/ProsumerQueue.hpp"
+#include "common/common_utils/Timer.hpp"
+
+namespace msr
+{
+namespace airlib
+{
+
+    class BoundedMpmcQueueTest : public TestBase
+    {
+    public:
+        virtual void run() override
+        {
+            singleThreadTest();
+            ownershipTest();
+            closeTest();
+            concurrencyTest(false);
+            concurrencyTest(true);
+            objectPoolTest();
+        }
+
+        virtual void benchmark() override
+        {
+            static constexpr int items_per_thread = 200000;
+            for (int thread_count : { 1, 2, 4 }) {
+                common_utils::ProsumerQueue<int> prosumer;
+                const double prosumer_rate = measure(
+                    thread_count, items_per_thread, [&](int i) { prosumer.push(i); }, [&] { prosumer.pop(); });
+
+                common_utils::BoundedMpmcQueue<int> mpmc(1024);
+                const double mpmc_rate = measure(
+                    thread_count, items_per_thread, [&](int i) { mpmc.push(i); }, [&] { int item; mpmc.pop(item); });
+
+                //batches of 16 with per thread buffers
+                common_utils::BoundedMpmcQueue<int> batched(1024);
+                const double batch_rate = measure(
+                    thread_count, items_per_thread / 16, [&](int i) {
+                        int items[16];
+                        std::fill(items, items + 16, i);
+                        batched.pushBatch(items, 16); },
+                    [&] {
+                        int items[16];
+                        for (size_t n = 0; n < 16;)
+                            n += batched.popBatch(items, 16 - n); });
+
+                std::cout << "BoundedMpmcQueue: " << thread_count << " producers/" << thread_count << " consumers, ProsumerQueue "
+                          << prosumer_rate << " items/sec, BoundedMpmcQueue " << mpmc_rate << " items/sec, batch of 16 "
+                          << batch_rate * 16 << " items/sec" << std::endl;
+            }
+        }
+
+    private:
+        void singleThreadTest()
+        {
+            common_utils::BoundedMpmcQueue<int> queue(5);
+            testAssert(queue.capacity() == 8, "capacity should be rounded up to power of two");
+
+            int item = -1;
+            testAssert(!queue.tryPop(item), "new queue should be empty");
+            for (int i = 0; i < 8; ++i)
+                testAssert(queue.tryPush(i), "push should succeed until full");
+            testAssert(!queue.tryPush(8), "push on full queue should fail");
+            testAssert(queue.sizeApprox() == 8, "size of full queue is wrong");
+
+            for (int i = 0; i < 3; ++i)
+                testAssert(queue.tryPop(item) && item == i, "items should come out in order");
+
+            //only 3 slots are free so batch is partially pushed
+            int batch[5] = { 8, 9, 10, 11, 12 };
+            testAssert(queue.tryPushBatch(batch, 5) == 3, "batch push should fill free slots only");
+
+            int out[16];
+            testAssert(queue.tryPopBatch(out, 16) == 8, "batch pop should return all items");
+            for (int i = 0; i < 8; ++i)
+                testAssert(out[i] == i + 3, "batch pop order is wrong");
+            testAssert(queue.tryPopBatch(out, 16) == 0, "queue should be empty after batch pop");
+        }
+
+        void ownershipTest()
+        {
+            auto counted = std::make_shared<int>(0);
+            {
+                common_utils::BoundedMpmcQueue<std::shared_ptr<int>> queue(4);
+                for (int i = 0; i < 3; ++i)
+                    queue.tryPush(counted);
+                std::shared_ptr<int> item;
+                queue.tryPop(item);
+                testAssert(counted.use_count() == 4, "queue should hold a copy per item");
+            }
+            testAssert(counted.use_count() == 1, "queue should destroy items left in it");
+        }
+
+        void closeTest()
+        {
+            common_utils::BoundedMpmcQueue<int> queue(4);
+            queue.push(1);
+
+            std::atomic<int> popped{ 0 };
+            std::thread consumer([&] {
+                int item;
+                while (queue.pop(item))
+                    ++popped;
+            });
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            queue.close();
+            consumer.join();
+
+            testAssert(popped == 1, "consumer should get item pushed before close");
+            testAssert(!queue.push(2), "push after close should fail");
+        }
+
+        //every item must be received exactly once and items of one producer in order
+        void concurrencyTest(bool use_batch)
+        {
+            static constexpr int producer_count = 4, consumer_count = 4, items_per_producer = 100000;
+            common_utils::BoundedMpmcQueue<uint64_t> queue(64);
+
+            std::vector<std::thread> producers;
+            for (int p = 0; p < producer_count; ++p) {
+                producers.emplace_back([&queue, p, use_batch] {
+                    uint64_t batch[7];
+                    for (int i = 0; i < items_per_producer;) {
+                        if (use_batch) {
+                            const int n = std::min(7, items_per_producer - i);
+                            for (int k = 0; k < n; ++k)
+                                batch[k] = (static_cast<uint64_t>(p) << 32) | static_cast<uint64_t>(i + k);
+                            queue.pushBatch(batch, n);
+                            i += n;
+                        }
+                        else
+                            queue.push((static_cast<uint64_t>(p) << 32) | static_cast<uint64_t>(i++));
+                    }
+                });
+            }
+
+            std::vector<std::vector<int>> received(consumer_count, std::vector<int>(producer_count, 0));
+            std::vector<int> order_errors(consumer_count, 0);
+            std::vector<std::thread> consumers;
+            for (int c = 0; c < consumer_count; ++c) {
+                consumers.emplace_back([&, c] {
+                    std::vector<int> last(producer_count, -1);
+                    uint64_t items[5];
+                    size_t count;
+                    while ((count = use_batch ? queue.popBatch(items, 5) : (queue.pop(items[0]) ? 1 : 0)) > 0) {
+                        for (size_t k = 0; k < count; ++k) {
+                            const int p = static_cast<int>(items[k] >> 32), i = static_cast<int>(items[k] & 0xFFFFFFFF);
+                            if (i <= last[p])
+                                ++order_errors[c];
+                            last[p] = i;
+                            ++received[c][p];
+                        }
+                    }
+                });
+            }
+
+            for (auto& producer : producers)
+                producer.join();
+            queue.close();
+            for (auto& consumer : consumers)
+                consumer.join();
+
+            for (int p = 0; p < producer_count; ++p) {
+                int total = 0;
+                for (int c = 0; c < consumer_count; ++c) {
+                    total += received[c][p];
+                    testAssert(order_errors[c] == 0, "items from one producer were received out of order");
+                }
+                testAssert(total == items_per_producer, "items were lost or duplicated");
+            }
+        }
+
+        void objectPoolTest()
+        {
+            common_utils::ObjectPool<std::vector<uint8_t>> pool(4);
+            const uint8_t* data;
+            {
+                auto buffer = pool.acquire();
+                buffer->resize(1 << 20);
+                data = buffer->data();
+            }
+            auto buffer = pool.acquire();
+            testAssert(buffer->data() == data && pool.getAllocationCount() == 1, "released buffer should be reused");
+
+            std::vector<common_utils::ObjectPool<std::vector<uint8_t>>::Ptr> buffers;
+            for (int i = 0; i < 6; ++i)
+                buffers.push_back(pool.acquire());
+            buffers.clear();
+            testAssert(pool.getAllocationCount() == 7, "pool should allocate when empty");
+        }
+
+        //moves ints from producers to consumers, with same thread counts on both sides
+        template <typename TPush, typename TPop>
+        double measure(int thread_count, int items_per_thread, TPush push, TPop pop)
+        {
+            std::vector<std::thread> threads;
+            common_utils::Timer timer;
+            timer.start();
+            for (int t = 0; t < thread_count; ++t) {
+                threads.emplace_back([&] {
+                    for (int i = 0; i < items_per_thread; ++i)
+                        push(i);
+                });
+                threads.emplace_back([&] {
+                    for (int i = 0; i < items_per_thread; ++i)
+                        pop();
+                });
+            }
+            for (auto& thread : threads)
+                thread.join();
+            return thread_count * static_cast<double>(items_per_thread) / timer.seconds();
+        }
+    };
+}
+}
+#endif
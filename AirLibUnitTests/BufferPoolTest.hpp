@@ -0,0 +1,171 @@
+#ifndef msr_AirLibUnitTests_BufferPoolTest_hpp
+#define msr_AirLibUnitTests_BufferPoolTest_hpp
+
+#include <thread>
+#include <iostream>
+#include "TestBase.hpp"
+#include "common/common_utils/BufferPool.hpp"
+#include "common/common_utils/Timer.hpp"
+#include "common/ImageCaptureBase.hpp"
+
+namespace msr
+{
+namespace airlib
+{
+
+    class BufferPoolTest : public TestBase
+    {
+    public:
+        virtual void run() override
+        {
+            poolTest();
+            copyOnWriteTest();
+            vectorCompatibilityTest();
+            concurrencyTest();
+        }
+
+        //allocation pattern of 6 cameras at 30 Hz returning 640x480 RGB and depth
+        virtual void benchmark() override
+        {
+            static constexpr int frames = 300, cameras = 6;
+            static constexpr size_t pixels = 640 * 480;
+            std::vector<uint8_t> source(pixels * 3, 7);
+            common_utils::Timer timer;
+
+            timer.start();
+            for (int frame = 0; frame < frames; ++frame) {
+                std::vector<std::vector<uint8_t>> images;
+                std::vector<std::vector<float>> depths;
+                for (int camera = 0; camera < cameras; ++camera) {
+                    //vector copies made by capture and RPC adaptor
+                    std::vector<uint8_t> captured(source.begin(), source.end());
+                    images.push_back(captured);
+                    depths.emplace_back(pixels);
+                }
+            }
+            const double vector_ms = timer.milliseconds() / frames;
+
+            BufferPool pool;
+            timer.start();
+            for (int frame = 0; frame < frames; ++frame) {
+                std::vector<common_utils::PooledBuffer<uint8_t>> images;
+                std::vector<common_utils::PooledBuffer<float>> depths;
+                for (int camera = 0; camera < cameras; ++camera) {
+                    common_utils::PooledBuffer<uint8_t> captured(source.data(), source.size(), pool);
+                    images.push_back(captured);
+                    depths.push_back(common_utils::PooledBuffer<float>(pixels, pool));
+                }
+            }
+            const double pooled_ms = timer.milliseconds() / frames;
+
+            const BufferPool::Stats stats = pool.getStats();
+            std::cout << "BufferPool: " << cameras << " cameras 640x480 per frame, std::vector " << vector_ms << " ms, pooled "
+                      << pooled_ms << " ms, " << stats.allocated << " blocks allocated for " << stats.acquired << " buffers, peak "
+                      << stats.peak_bytes_in_use / (1 << 20) << " MB in use" << std::endl;
+        }
+
+    private:
+        typedef common_utils::BufferPool BufferPool;
+
+        void poolTest()
+        {
+            BufferPool::Params params;
+            params.min_block_size = 1024;
+            params.max_block_size = 1024 * 1024;
+            params.max_free_blocks = 2;
+            BufferPool pool(params);
+
+            const uint8_t* first_data;
+            {
+                common_utils::PooledBuffer<uint8_t> buffer(1500, pool);
+                testAssert(buffer.capacity() == 2048, "size should be rounded up to size class");
+                testAssert(buffer[0] == 0 && buffer[1499] == 0, "sized constructor should value initialize");
+                first_data = buffer.data();
+            }
+            testAssert(pool.getStats().bytes_free == 2048 && pool.getStats().bytes_in_use == 0, "released block should be kept");
+
+            {
+                auto buffer = common_utils::PooledBuffer<float>::uninitialized(400, pool);
+                testAssert(reinterpret_cast<const uint8_t*>(buffer.data()) == first_data, "block of same class should be reused");
+                testAssert(pool.getStats().reused == 1, "reuse should be counted");
+            }
+
+            //more blocks than max_free_blocks are freed on release
+            {
+                std::vector<common_utils::PooledBuffer<uint8_t>> buffers;
+                for (int i = 0; i < 4; ++i)
+                    buffers.push_back(common_utils::PooledBuffer<uint8_t>::uninitialized(100, pool));
+            }
+            const BufferPool::Stats stats = pool.getStats();
+            testAssert(stats.allocated - stats.freed == 3 && stats.bytes_free == 2048 + 2 * 1024, "free list should be bounded");
+
+            //bigger than max_block_size isn't pooled
+            {
+                common_utils::PooledBuffer<uint8_t> buffer(2 * 1024 * 1024, pool);
+            }
+            testAssert(pool.getStats().freed == stats.freed + 1, "oversized block should be freed on release");
+            testAssert(pool.getStats().peak_bytes_in_use >= 2 * 1024 * 1024, "peak should include oversized block");
+
+            pool.trim();
+            testAssert(pool.getStats().bytes_free == 0, "trim should free all pooled blocks");
+        }
+
+        void copyOnWriteTest()
+        {
+            common_utils::PooledBuffer<float> a({ 1, 2, 3 });
+            common_utils::PooledBuffer<float> b = a;
+            const common_utils::PooledBuffer<float>& const_a = a;
+            const common_utils::PooledBuffer<float>& const_b = b;
+            testAssert(a.useCount() == 2 && const_a.data() == const_b.data(), "copy should share block");
+
+            b[1] = 20;
+            testAssert(a[1] == 2 && b[1] == 20 && a.useCount() == 1, "write should detach shared buffer");
+
+            b.push_back(4);
+            b.resize(6);
+            testAssert(b.size() == 6 && b[3] == 4 && b[5] == 0, "push_back and resize should keep contents");
+
+            //image responses are copied by value through the API layers without copying pixels
+            ImageCaptureBase::ImageResponse response;
+            response.image_data_uint8 = common_utils::PooledBuffer<uint8_t>::uninitialized(640 * 480 * 3);
+            std::vector<ImageCaptureBase::ImageResponse> responses{ response, response };
+            testAssert(response.image_data_uint8.useCount() == 3, "response copies should share pixel buffer");
+        }
+
+        void vectorCompatibilityTest()
+        {
+            const std::vector<uint8_t> vec{ 1, 2, 3, 4 };
+            common_utils::PooledBuffer<uint8_t> buffer = vec;
+            std::vector<uint8_t> back = buffer;
+            testAssert(back == vec, "conversion to and from vector should keep contents");
+
+            size_t sum = 0;
+            for (uint8_t value : buffer)
+                sum += value;
+            testAssert(sum == 10, "iteration should visit all elements");
+
+            buffer.clear();
+            testAssert(buffer.empty() && buffer.capacity() > 0, "clear should keep block");
+        }
+
+        void concurrencyTest()
+        {
+            BufferPool pool;
+            std::vector<std::thread> threads;
+            for (int t = 0; t < 4; ++t) {
+                threads.emplace_back([&pool, t] {
+                    for (int i = 0; i < 2000; ++i) {
+                        common_utils::PooledBuffer<uint8_t> buffer(static_cast<size_t>(1000 + (i * 7919 + t) % 200000), pool);
+                        common_utils::PooledBuffer<uint8_t> shared = buffer;
+                        shared[0] = 1;
+                    }
+                });
+            }
+            for (auto& thread : threads)
+                thread.join();
+            testAssert(pool.getStats().bytes_in_use == 0, "all blocks should be released");
+        }
+    };
+}
+}
+#endif
@@ -0,0 +1,210 @@
+#ifndef msr_AirLibUnitTests_CarPhysicsBodyTest_hpp
+#define msr_AirLibUnitTests_CarPhysicsBodyTest_hpp
+
+#include <iostream>
+#include <memory>
+#include "TestBase.hpp"
+#include "common/SteppableClock.hpp"
+#include "common/common_utils/Timer.hpp"
+#include "physics/World.hpp"
+#include "physics/FastPhysicsEngine.hpp"
+#include "vehicles/car/CarPhysicsBody.hpp"
+#include "vehicles/car/firmwares/physxcar/PhysXCarApi.hpp"
+
+namespace msr
+{
+namespace airlib
+{
+
+    class CarPhysicsBodyTest : public TestBase
+    {
+    public:
+        virtual void run() override
+        {
+            clock_ = std::make_shared<SteppableClock>(3E-3f);
+            ClockFactory::get(clock_);
+
+            accelerateAndBrakeTest();
+            turnTest();
+            reverseTest();
+            snapshotTest();
+        }
+
+        //many cars in one world stepping on one core
+        virtual void benchmark() override
+        {
+            clock_ = std::make_shared<SteppableClock>(3E-3f);
+            ClockFactory::get(clock_);
+
+            static constexpr uint kCars = 1000;
+            static constexpr uint kFrames = 1000;
+
+            vector<std::unique_ptr<Car>> cars;
+            World world(std::unique_ptr<PhysicsEngineBase>(new FastPhysicsEngine()));
+            for (uint i = 0; i < kCars; ++i) {
+                cars.emplace_back(new Car(Vector3r(0, i * 5.0f, -1)));
+                world.insert(cars.back()->body.get());
+                cars.back()->reset();
+                cars.back()->drive(0.5f + (i % 5) * 0.1f, (i % 7) * 0.1f - 0.3f);
+            }
+            world.reset();
+
+            common_utils::Timer timer;
+            timer.start();
+            for (uint frame = 0; frame < kFrames; ++frame)
+                world.update();
+            const double seconds = timer.seconds();
+            std::cout << "CarPhysicsBody: " << kCars << " cars for " << kFrames << " frames in " << seconds * 1E3 << " ms, "
+                      << kCars * kFrames / seconds << " car steps per second" << std::endl;
+        }
+
+    private:
+        //car without sensors, its state and controls kept by the API as in the simulator
+        struct Car
+        {
+            AirSimSettings::VehicleSetting setting{ "car", AirSimSettings::kVehicleTypePhysXCar };
+            Kinematics kinematics;
+            Environment environment;
+            std::unique_ptr<PhysXCarApi> api;
+            std::unique_ptr<CarPhysicsBody> body;
+
+            explicit Car(const Vector3r& position = Vector3r(0, 0, -1))
+                : kinematics(makeState(position)), environment(Environment::State(position, GeoPoint()))
+            {
+                api.reset(new PhysXCarApi(&setting, std::make_shared<SensorFactory>(), kinematics.getState(), environment));
+                body.reset(new CarPhysicsBody(CarPhysicsParams(), api.get(), &kinematics, &environment));
+            }
+
+            //as the vehicle's sim API does in the simulator
+            void reset()
+            {
+                kinematics.reset();
+                api->reset();
+            }
+
+            void drive(real_T throttle, real_T steering = 0, real_T brake = 0)
+            {
+                CarApiBase::CarControls controls;
+                controls.throttle = throttle;
+                controls.steering = steering;
+                controls.brake = brake;
+                api->setCarControls(controls);
+            }
+
+            static Kinematics::State makeState(const Vector3r& position)
+            {
+                Kinematics::State state = Kinematics::State::zero();
+                state.pose.position = position;
+                return state;
+            }
+        };
+
+        struct Sim
+        {
+            Car car;
+            World world{ std::unique_ptr<PhysicsEngineBase>(new FastPhysicsEngine()) };
+
+            Sim()
+            {
+                world.insert(car.body.get());
+                car.reset();
+                world.reset();
+            }
+
+            void run(real_T seconds)
+            {
+                for (uint frame = 0; frame < static_cast<uint>(seconds / 3E-3f); ++frame)
+                    world.update();
+            }
+
+            const Kinematics::State& state() const
+            {
+                return car.body->getKinematics();
+            }
+        };
+
+        void accelerateAndBrakeTest()
+        {
+            Sim sim;
+            sim.car.drive(1);
+            sim.run(10);
+            const CarPhysicsBody::Output& output = sim.car.body->getOutput();
+            testAssert(output.speed > 20 && output.speed < 60, "full throttle should reach highway speed in 10 s");
+            testAssert(output.gear > 1 && output.rpm <= sim.car.body->getParams().max_rpm, "gearbox should have shifted up");
+            testAssert(std::abs(sim.state().pose.position.y()) < 1E-3f && sim.state().pose.position.x() > 100,
+                       "car should drive straight ahead");
+            testAssert(sim.state().pose.position.z() == -1 && sim.state().twist.linear.z() == 0, "car should stay on the ground");
+
+            const CarApiBase::CarState& car_state = sim.car.api->getCarState();
+            testAssert(car_state.speed == output.speed && car_state.gear == output.gear && car_state.timestamp == clock_->nowNanos(),
+                       "API should get the car state every step");
+
+            sim.car.drive(0, 0, 1);
+            sim.run(8);
+            testAssert(std::abs(sim.car.body->getOutput().speed) < 0.1f, "full brake should stop the car");
+            const real_T stopped_x = sim.state().pose.position.x();
+            sim.run(2);
+            testAssert(std::abs(sim.state().pose.position.x() - stopped_x) < 0.05f, "braked car should not creep");
+        }
+
+        void turnTest()
+        {
+            Sim sim;
+            const CarPhysicsParams& params = sim.car.body->getParams();
+
+            //slow turn is close to a kinematic bicycle
+            sim.car.drive(0.1f, 0.2f);
+            sim.run(5);
+            real_T speed = sim.car.body->getOutput().speed;
+            real_T kinematic_rate = speed * std::tan(0.2f * params.max_steering_angle) / params.getWheelbase();
+            real_T yaw_rate = sim.state().twist.angular.z();
+            testAssert(speed > 1 && yaw_rate > 0, "positive steering should turn right");
+            testAssert(std::abs(yaw_rate - kinematic_rate) < 0.15f * kinematic_rate, "slow turn should follow the kinematic bicycle");
+
+            //understeer and slip at speed
+            Sim fast;
+            fast.car.drive(0.6f);
+            fast.run(6);
+            fast.car.drive(0.2f, 0.5f);
+            fast.run(2);
+            speed = fast.car.body->getOutput().speed;
+            kinematic_rate = speed * std::tan(0.5f * params.max_steering_angle) / params.getWheelbase();
+            yaw_rate = fast.state().twist.angular.z();
+            const real_T max_friction = std::max(params.front_tire.friction, params.rear_tire.friction);
+            testAssert(yaw_rate > 0 && yaw_rate < kinematic_rate, "fast turn should understeer");
+            testAssert(fast.state().accelerations.linear.norm() < max_friction * EarthUtils::Gravity * 1.05f, "tires should limit acceleration");
+            testAssert(fast.car.body->getOutput().front_slip_angle != 0, "front tires should slip at speed");
+        }
+
+        void reverseTest()
+        {
+            Sim sim;
+            CarApiBase::CarControls controls;
+            controls.set_throttle(0.5f, false);
+            sim.car.api->setCarControls(controls);
+            sim.run(3);
+            testAssert(sim.car.body->getOutput().gear == -1 && sim.car.body->getOutput().speed < -1, "negative throttle should drive backwards");
+            testAssert(sim.state().pose.position.x() < -1, "car should move backwards");
+        }
+
+        void snapshotTest()
+        {
+            Sim sim;
+            sim.car.drive(0.8f, 0.3f);
+            sim.run(2);
+            StateSnapshot snapshot = sim.world.saveSnapshot();
+            sim.run(2);
+            const Kinematics::State first = sim.state();
+
+            sim.world.restoreSnapshot(snapshot);
+            sim.run(2);
+            testAssert(sim.state().pose.position == first.pose.position && sim.state().twist.angular == first.twist.angular,
+                       "restored car should drive the same path");
+        }
+
+    private:
+        std::shared_ptr<SteppableClock> clock_;
+    };
+}
+}
+#endif
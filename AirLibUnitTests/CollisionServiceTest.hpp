@@ -0,0 +1,298 @@
+#ifndef msr_AirLibUnitTests_CollisionServiceTest_hpp
+#define msr_AirLibUnitTests_CollisionServiceTest_hpp
+
+#include <iostream>
+#include <random>
+#include <memory>
+#include "TestBase.hpp"
+#include "physics/CollisionService.hpp"
+#include "physics/FastPhysicsEngine.hpp"
+#include "common/SteppableClock.hpp"
+#include "common/common_utils/Timer.hpp"
+
+namespace msr
+{
+namespace airlib
+{
+
+    class CollisionServiceTest : public TestBase
+    {
+    public:
+        virtual void run() override
+        {
+            narrowphaseTest();
+            broadphaseTest();
+            collisionInfoTest();
+            engineTest();
+            sweepTest();
+            continuousCollisionTest();
+        }
+
+        virtual void benchmark() override
+        {
+            static constexpr int kBodies = 1000;
+            static constexpr int kSteps = 100;
+
+            std::mt19937 gen(11);
+            std::uniform_real_distribution<real_T> pos(-100, 100);
+            std::uniform_real_distribution<real_T> vel(-0.05f, 0.05f);
+
+            CollisionService service;
+            vector<std::unique_ptr<TestBody>> bodies;
+            for (int i = 0; i < kBodies; ++i) {
+                bodies.emplace_back(new TestBody(Vector3r(pos(gen), pos(gen), pos(gen) / 10)));
+                service.addBody(bodies.back().get(), CollisionShape::box(Vector3r(0.5f, 0.5f, 0.2f)));
+            }
+            service.addStatic(CollisionShape::box(Vector3r(1000, 1000, 1), Vector3r(0, 0, 11)), Pose(), "Ground");
+
+            common_utils::Timer timer;
+            timer.start();
+            size_t contacts = 0;
+            for (int step = 0; step < kSteps; ++step) {
+                for (auto& body : bodies)
+                    body->moveTo(body->getPose().position + Vector3r(vel(gen), vel(gen), vel(gen)));
+                service.update(step + 1);
+                contacts += service.getContacts().size();
+            }
+            const double update_us = timer.milliseconds() * 1000 / kSteps;
+
+            std::cout << "CollisionService: " << kBodies << " bodies, " << update_us << " us per update, "
+                      << static_cast<double>(contacts) / kSteps << " contacts per update" << std::endl;
+        }
+
+    private:
+        //just enough of a body to have a pose and receive collision info
+        class TestBody : public PhysicsBody
+        {
+        public:
+            explicit TestBody(const Vector3r& position, const std::string& name = "body", const Vector3r& velocity = Vector3r::Zero())
+                : kinematics_(makeState(position, velocity)), environment_(Environment::State(position, GeoPoint()))
+            {
+                initialize(1, Matrix3x3r::Identity(), &kinematics_, &environment_);
+                setName(name);
+                kinematics_.reset();
+            }
+
+            virtual real_T getRestitution() const override
+            {
+                return 0.5f;
+            }
+            virtual real_T getFriction() const override
+            {
+                return 0.5f;
+            }
+
+            void moveTo(const Vector3r& position)
+            {
+                setPose(Pose(position, Quaternionr::Identity()));
+            }
+
+        private:
+            static Kinematics::State makeState(const Vector3r& position, const Vector3r& velocity)
+            {
+                Kinematics::State state = Kinematics::State::zero();
+                state.pose.position = position;
+                state.twist.linear = velocity;
+                return state;
+            }
+
+            Kinematics kinematics_;
+            Environment environment_;
+        };
+
+        static CollisionVolume place(const CollisionShape& shape, const Vector3r& position,
+                                     const Quaternionr& orientation = Quaternionr::Identity())
+        {
+            CollisionVolume volume;
+            volume.place(shape, Pose(position, orientation));
+            return volume;
+        }
+
+        static bool near(const Vector3r& a, const Vector3r& b, real_T tolerance = 1E-3f)
+        {
+            return (a - b).norm() < tolerance;
+        }
+
+        void narrowphaseTest()
+        {
+            const auto sphere = CollisionShape::sphere(1);
+            const auto box = CollisionShape::box(Vector3r(1, 1, 1));
+            const auto capsule = CollisionShape::capsule(0.5f, 1);
+
+            auto contact = CollisionTests::test(place(sphere, Vector3r(1.5f, 0, 0)), place(sphere, Vector3r::Zero()));
+            testAssert(contact.has_contact && near(contact.normal, Vector3r(1, 0, 0)) && std::abs(contact.depth - 0.5f) < 1E-4f,
+                       "overlapping spheres should push apart along their centers");
+            testAssert(!CollisionTests::test(place(sphere, Vector3r(2.1f, 0, 0)), place(sphere, Vector3r::Zero())).has_contact,
+                       "separate spheres should not touch");
+
+            contact = CollisionTests::test(place(sphere, Vector3r(0, 0, -1.5f)), place(box, Vector3r::Zero()));
+            testAssert(contact.has_contact && near(contact.normal, Vector3r(0, 0, -1)) && std::abs(contact.depth - 0.5f) < 1E-4f,
+                       "sphere on box face should be pushed off that face");
+            contact = CollisionTests::test(place(box, Vector3r::Zero()), place(sphere, Vector3r(0.2f, 0, 0.8f)));
+            testAssert(contact.has_contact && near(contact.normal, Vector3r(0, 0, -1)) && std::abs(contact.depth - 1.2f) < 1E-4f,
+                       "sphere inside box should leave through nearest face, flipped when box is first");
+
+            //box turned 45 degrees about z touches only with its edge
+            const Quaternionr yaw45(AngleAxisr(M_PIf / 4, Vector3r::UnitZ()));
+            contact = CollisionTests::test(place(box, Vector3r(2.3f, 0, 0), yaw45), place(box, Vector3r::Zero()));
+            testAssert(contact.has_contact && near(contact.normal, Vector3r(1, 0, 0)) &&
+                           std::abs(contact.depth - (1 + std::sqrt(2.0f) - 2.3f)) < 1E-4f && std::abs(contact.point.x() - 1) < 0.2f,
+                       "rotated box should touch with its edge");
+            testAssert(!CollisionTests::test(place(box, Vector3r(2.5f, 0, 0), yaw45), place(box, Vector3r::Zero())).has_contact,
+                       "rotated box beyond its diagonal should not touch");
+
+            //parallel capsules side by side, then crossed
+            contact = CollisionTests::test(place(capsule, Vector3r(0, 0.8f, 0)), place(capsule, Vector3r::Zero()));
+            testAssert(contact.has_contact && near(contact.normal, Vector3r(0, 1, 0)) && std::abs(contact.depth - 0.2f) < 1E-4f,
+                       "parallel capsules should push apart sideways");
+            const Quaternionr pitch90(AngleAxisr(M_PIf / 2, Vector3r::UnitY()));
+            contact = CollisionTests::test(place(capsule, Vector3r(0, 0, -1.9f), pitch90), place(capsule, Vector3r::Zero()));
+            testAssert(contact.has_contact && near(contact.normal, Vector3r(0, 0, -1)) && std::abs(contact.depth - 0.1f) < 1E-4f,
+                       "capsule lying across another's end should touch that end");
+
+            //tilted capsule whose lower end reaches into the box top
+            const Quaternionr tilt(AngleAxisr(M_PIf / 6, Vector3r::UnitX()));
+            contact = CollisionTests::test(place(capsule, Vector3r(0, 0, -2.2f), tilt), place(box, Vector3r::Zero()));
+            const real_T end_z = -2.2f + std::cos(M_PIf / 6);
+            testAssert(contact.has_contact && near(contact.normal, Vector3r(0, 0, -1)) &&
+                           std::abs(contact.depth - (end_z + 1 + 0.5f)) < 1E-3f,
+                       "capsule end should be pushed out of the box top");
+        }
+
+        void broadphaseTest()
+        {
+            std::mt19937 gen(7);
+            std::uniform_real_distribution<real_T> pos(-10, 10);
+
+            CollisionService service(nullptr);
+            vector<std::unique_ptr<TestBody>> bodies;
+            for (int i = 0; i < 200; ++i) {
+                bodies.emplace_back(new TestBody(Vector3r(pos(gen), pos(gen), pos(gen))));
+                service.addBody(bodies.back().get(), i % 2 ? CollisionShape::sphere(0.8f) : CollisionShape::box(Vector3r(0.6f, 0.4f, 0.3f)));
+            }
+
+            for (int step = 0; step < 3; ++step) {
+                service.update(step + 1);
+
+                //brute force over all pairs
+                vector<CollisionVolume> volumes;
+                for (uint i = 0; i < bodies.size(); ++i)
+                    volumes.push_back(place(i % 2 ? CollisionShape::sphere(0.8f) : CollisionShape::box(Vector3r(0.6f, 0.4f, 0.3f)),
+                                            bodies[i]->getPose().position));
+                size_t expected = 0;
+                for (uint i = 0; i < volumes.size(); ++i)
+                    for (uint j = i + 1; j < volumes.size(); ++j)
+                        expected += CollisionTests::test(volumes[i], volumes[j]).has_contact ? 1 : 0;
+
+                testAssert(service.getContacts().size() == expected, "sweep and prune should find every touching pair");
+
+                for (auto& body : bodies)
+                    body->moveTo(body->getPose().position + Vector3r(pos(gen), pos(gen), pos(gen)) / 20);
+            }
+        }
+
+        void collisionInfoTest()
+        {
+            CollisionService service(nullptr);
+            TestBody a(Vector3r(0, 0, -0.1f), "a"), b(Vector3r(0, 0, -1.6f), "b"), c(Vector3r(20, 0, -5), "c");
+            service.addStatic(CollisionShape::box(Vector3r(100, 100, 1), Vector3r(0, 0, 1)), Pose(), "Ground", 3);
+            service.addBody(&a, CollisionShape::sphere(1));
+            service.addBody(&b, CollisionShape::sphere(0.7f));
+            service.addBody(&c, CollisionShape::sphere(1));
+
+            service.update(100);
+            const CollisionInfo info_a = a.getCollisionInfo();
+            const CollisionInfo info_b = b.getCollisionInfo();
+
+            //a sinks 0.9 into the ground but only 0.2 into b
+            testAssert(info_a.has_collided && info_a.object_name == "Ground" && info_a.object_id == 3 && info_a.time_stamp == 100,
+                       "deepest contact should be reported");
+            testAssert(near(info_a.normal, Vector3r(0, 0, -1)) && std::abs(info_a.penetration_depth - 0.9f) < 1E-4f &&
+                           near(info_a.position, a.getPose().position),
+                       "normal should push the body out of the ground");
+            testAssert(info_b.has_collided && info_b.object_name == "a" && near(info_b.normal, Vector3r(0, 0, -1)),
+                       "second body of a pair should get the reversed normal");
+            testAssert(!c.getCollisionInfo().has_collided, "free body should not collide");
+
+            service.update(200);
+            testAssert(a.getCollisionInfo().collision_count == 2 && a.getCollisionInfo().time_stamp == 200,
+                       "every update in contact should be a new collision");
+            testAssert(service.getCandidatePairCount() == 2, "static bodies should not be paired with each other");
+        }
+
+        void engineTest()
+        {
+            CollisionService service(nullptr);
+            TestBody a(Vector3r::Zero(), "a"), b(Vector3r(0, 0, -10), "b");
+            FastPhysicsEngine engine;
+            engine.insert(&a);
+            engine.setCollisionService(&service);
+            engine.insert(&b);
+            testAssert(service.size() == 2, "engine should register existing and new bodies");
+            engine.erase_remove(&a);
+            testAssert(service.size() == 1, "engine should unregister removed bodies");
+            engine.clear();
+            testAssert(service.size() == 0, "engine should unregister bodies on clear");
+        }
+
+        void sweepTest()
+        {
+            real_T fraction;
+            Vector3r normal;
+
+            //thin wall, path from 2 m before to 2 m behind it
+            const auto wall = place(CollisionShape::box(Vector3r(0.05f, 5, 5)), Vector3r::Zero());
+            testAssert(CollisionTests::sweepSphere(Vector3r(-2, 0, 0), Vector3r(2, 0, 0), 0.2f, wall, fraction, normal) &&
+                           std::abs(fraction - (2 - 0.25f) / 4) < 1E-4f && near(normal, Vector3r(-1, 0, 0)),
+                       "sweep should stop at the wall's near face");
+            testAssert(!CollisionTests::sweepSphere(Vector3r(-2, 6, 0), Vector3r(2, 6, 0), 0.2f, wall, fraction, normal),
+                       "sweep beside the wall should miss");
+            testAssert(!CollisionTests::sweepSphere(Vector3r(0, 0, 0), Vector3r(2, 0, 0), 0.2f, wall, fraction, normal),
+                       "sweep starting inside is left to discrete tests");
+
+            const auto ball = place(CollisionShape::sphere(1), Vector3r(5, 0, 0));
+            testAssert(CollisionTests::sweepSphere(Vector3r::Zero(), Vector3r(10, 0, 0), 0.5f, ball, fraction, normal) &&
+                           std::abs(fraction - 0.35f) < 1E-4f && near(normal, Vector3r(-1, 0, 0)),
+                       "sweep should touch the sphere at the sum of radii");
+
+            //pole along z, hit once on its side and once on its top cap
+            const auto pole = place(CollisionShape::capsule(0.1f, 2), Vector3r(5, 0, 0));
+            testAssert(CollisionTests::sweepSphere(Vector3r(0, 0, 1), Vector3r(10, 0, 1), 0.4f, pole, fraction, normal) &&
+                           std::abs(fraction - 0.45f) < 1E-4f && near(normal, Vector3r(-1, 0, 0)),
+                       "sweep should hit the capsule side");
+            testAssert(CollisionTests::sweepSphere(Vector3r(5, 0, -10), Vector3r(5, 0, 0), 0.4f, pole, fraction, normal) &&
+                           std::abs(fraction - 0.75f) < 1E-4f && near(normal, Vector3r(0, 0, -1)),
+                       "sweep should hit the capsule cap");
+        }
+
+        void continuousCollisionTest()
+        {
+            auto clock = std::make_shared<SteppableClock>(10E-3f);
+            ClockFactory::get(clock);
+
+            //3 m per step against a 10 cm wall, which a 30 cm body would step over between ticks
+            CollisionService service(nullptr);
+            service.addStatic(CollisionShape::box(Vector3r(0.05f, 5, 5)), Pose(Vector3r(4.5f, 0, 0), Quaternionr::Identity()), "Wall", 9);
+            TestBody body(Vector3r::Zero(), "fast", Vector3r(300, 0, 0));
+            FastPhysicsEngine engine;
+            engine.insert(&body);
+            engine.setCollisionService(&service);
+            service.addBody(&body, CollisionShape::sphere(0.3f));
+            engine.reset();
+
+            for (int i = 0; i < 10; ++i) {
+                clock->step();
+                engine.update();
+            }
+
+            const CollisionInfo info = body.getCollisionInfo();
+            testAssert(body.getPose().position.x() < 4.5f && body.getKinematics().twist.linear.x() < 0,
+                       "fast body should bounce off the wall instead of passing it");
+            testAssert(info.has_collided && info.object_name == "Wall" && info.object_id == 9 && near(info.normal, Vector3r(-1, 0, 0)) &&
+                           std::abs(info.position.x() - 4.15f) < 0.01f,
+                       "hit should be reported where the body meets the wall");
+        }
+    };
+}
+}
+#endif
@@ -0,0 +1,163 @@
+#ifndef msr_AirLibUnitTests_GeodeticBatchTest_hpp
+#define msr_AirLibUnitTests_GeodeticBatchTest_hpp
+
+#include "TestBase.hpp"
+#include "common/GeodeticBatchConverter.hpp"
+#include "common/GeodeticConverter.hpp"
+#include "common/common_utils/Timer.hpp"
+
+namespace msr
+{
+namespace airlib
+{
+
+    class GeodeticBatchTest : public TestBase
+    {
+    public:
+        virtual void run() override
+        {
+            const GeoPoint homes[] = { GeoPoint(0, 0, 0), GeoPoint(47.641468, -122.140165, 122),
+                                       GeoPoint(-33.8688, 151.2093, 20), GeoPoint(70.0, 25.0, 1500) };
+            for (const auto& home : homes) {
+                exactTest(home);
+                fastTest(home, 100);
+                fastTest(home, 1000);
+                fastTest(home, 10000);
+            }
+        }
+
+        virtual void benchmark() override
+        {
+            benchmarkPoints(1000000);
+        }
+
+    private:
+        void randomNed(size_t count, double distance, vector<double>& north, vector<double>& east, vector<double>& down)
+        {
+            RandomGeneratorR r(-1.0f, 1.0f);
+            north.resize(count);
+            east.resize(count);
+            down.resize(count);
+            for (size_t i = 0; i < count; ++i) {
+                north[i] = r.next() * distance;
+                east[i] = r.next() * distance;
+                down[i] = r.next() * std::min(distance, 500.0);
+            }
+        }
+
+        //largest distance in meters between given NED points and geodetic points converted back with exact method
+        double maxError(const GeodeticBatchConverter& converter, const vector<double>& north, const vector<double>& east, const vector<double>& down,
+                        const vector<double>& lat, const vector<double>& lon, const vector<double>& alt)
+        {
+            const size_t count = north.size();
+            vector<double> n(count), e(count), d(count);
+            converter.geodeticToNed(lat.data(), lon.data(), alt.data(), n.data(), e.data(), d.data(), count);
+
+            double max_error = 0;
+            for (size_t i = 0; i < count; ++i)
+                max_error = std::max(max_error, std::sqrt((n[i] - north[i]) * (n[i] - north[i]) + (e[i] - east[i]) * (e[i] - east[i]) + (d[i] - down[i]) * (d[i] - down[i])));
+            return max_error;
+        }
+
+        void exactTest(const GeoPoint& home)
+        {
+            //odd count to exercise padded last chunk
+            static constexpr size_t count = 1001;
+            GeodeticBatchConverter converter(home);
+            GeodeticConverter reference(home);
+
+            vector<double> north, east, down;
+            randomNed(count, 20000, north, east, down);
+
+            vector<double> lat(count), lon(count), alt(count);
+            converter.nedToGeodetic(north.data(), east.data(), down.data(), lat.data(), lon.data(), alt.data(), count);
+
+            for (size_t i = 0; i < count; ++i) {
+                double ref_lat, ref_lon;
+                float ref_alt;
+                reference.ned2Geodetic(north[i], east[i], static_cast<float>(down[i]), &ref_lat, &ref_lon, &ref_alt);
+                //1E-8 degrees is about 1mm, GeodeticConverter returns altitude as float
+                testAssert(std::abs(lat[i] - ref_lat) < 1E-8 && std::abs(lon[i] - ref_lon) < 1E-8 && std::abs(alt[i] - ref_alt) < 1E-2,
+                           "nedToGeodetic does not match GeodeticConverter");
+
+                double ref_north, ref_east, ref_down;
+                reference.geodetic2Ned(lat[i], lon[i], static_cast<float>(alt[i]), &ref_north, &ref_east, &ref_down);
+                double n, e, d;
+                converter.geodeticToNed(&lat[i], &lon[i], &alt[i], &n, &e, &d, 1);
+                testAssert(std::abs(n - ref_north) < 1E-2 && std::abs(e - ref_east) < 1E-2 && std::abs(d - ref_down) < 1E-2,
+                           "geodeticToNed does not match GeodeticConverter");
+            }
+
+            //round trip must be within 1mm
+            testAssert(maxError(converter, north, east, down, lat, lon, alt) < 1E-3, "geodeticToNed is not inverse of nedToGeodetic");
+
+            //AoS API must give same results as SoA API
+            vector<Vector3r> ned(count);
+            for (size_t i = 0; i < count; ++i)
+                ned[i] = Vector3r(static_cast<real_T>(north[i]), static_cast<real_T>(east[i]), static_cast<real_T>(down[i]));
+            vector<GeoPoint> geo;
+            converter.nedToGeodetic(ned, geo);
+            vector<Vector3r> ned_back;
+            converter.geodeticToNed(geo, ned_back);
+            for (size_t i = 0; i < count; ++i) {
+                testAssert(std::abs(geo[i].latitude - lat[i]) < 1E-7 && std::abs(geo[i].longitude - lon[i]) < 1E-7, "AoS nedToGeodetic does not match SoA");
+                testAssert((ned_back[i] - ned[i]).norm() < 0.05f, "AoS geodeticToNed is not inverse of nedToGeodetic");
+            }
+        }
+
+        void fastTest(const GeoPoint& home, double distance)
+        {
+            static constexpr size_t count = 1000;
+            GeodeticBatchConverter converter(home);
+
+            vector<double> north, east, down;
+            randomNed(count, distance, north, east, down);
+
+            vector<double> lat(count), lon(count), alt(count);
+            converter.nedToGeodeticFast(north.data(), east.data(), down.data(), lat.data(), lon.data(), alt.data(), count);
+            const double fast_error = maxError(converter, north, east, down, lat, lon, alt);
+            const double bound = converter.getFastErrorBound(distance * std::sqrt(2.0), std::min(distance, 500.0));
+            testAssert(fast_error <= bound, Utils::stringf("nedToGeodeticFast error %f m exceeds bound %f m", fast_error, bound));
+
+            //fast inverse must round trip exactly since both are linear
+            vector<double> n(count), e(count), d(count);
+            converter.geodeticToNedFast(lat.data(), lon.data(), alt.data(), n.data(), e.data(), d.data(), count);
+            for (size_t i = 0; i < count; ++i)
+                testAssert(std::abs(n[i] - north[i]) < 1E-6 && std::abs(e[i] - east[i]) < 1E-6 && std::abs(d[i] - down[i]) < 1E-6,
+                           "geodeticToNedFast is not inverse of nedToGeodeticFast");
+        }
+
+        void benchmarkPoints(size_t count)
+        {
+            const GeoPoint home(47.641468, -122.140165, 122);
+            GeodeticBatchConverter converter(home);
+            GeodeticConverter reference(home);
+
+            vector<double> north, east, down;
+            randomNed(count, 10000, north, east, down);
+            vector<double> lat(count), lon(count), alt(count);
+
+            common_utils::Timer timer;
+            timer.start();
+            for (size_t i = 0; i < count; ++i) {
+                float a;
+                reference.ned2Geodetic(north[i], east[i], static_cast<float>(down[i]), &lat[i], &lon[i], &a);
+                alt[i] = a;
+            }
+            double per_point_ms = timer.milliseconds();
+
+            timer.start();
+            converter.nedToGeodetic(north.data(), east.data(), down.data(), lat.data(), lon.data(), alt.data(), count);
+            double batch_ms = timer.milliseconds();
+
+            timer.start();
+            converter.nedToGeodeticFast(north.data(), east.data(), down.data(), lat.data(), lon.data(), alt.data(), count);
+            double fast_ms = timer.milliseconds();
+
+            std::cout << "GeodeticBatchConverter: " << count << " points, GeodeticConverter " << per_point_ms << " ms, batch "
+                      << batch_ms << " ms, batch tangent plane " << fast_ms << " ms" << std::endl;
+        }
+    };
+}
+}
+#endif
@@ -0,0 +1,253 @@
+#ifndef msr_AirLibUnitTests_LidarBvhTest_hpp
+#define msr_AirLibUnitTests_LidarBvhTest_hpp
+
+#include <iostream>
+#include <random>
+#include <cmath>
+#include <memory>
+#include "TestBase.hpp"
+#include "sensors/lidar/LidarBvh.hpp"
+#include "sensors/SceneSensorFactory.hpp"
+#include "common/common_utils/Timer.hpp"
+
+namespace msr
+{
+namespace airlib
+{
+
+    class LidarBvhTest : public TestBase
+    {
+    public:
+        virtual void run() override
+        {
+            packetTest();
+            scanTest();
+            frameTest();
+            factoryTest();
+        }
+
+        virtual void benchmark() override
+        {
+            //rolling terrain seen from 20 m up, 100000 points per scan
+            static constexpr uint kCells = 400;
+            vector<float> vertices;
+            vector<uint32_t> indices;
+            for (uint y = 0; y <= kCells; ++y)
+                for (uint x = 0; x <= kCells; ++x)
+                    vertices.insert(vertices.end(), { x - kCells / 2.0f, y - kCells / 2.0f, 5 * std::sin(x * 0.05f) * std::cos(y * 0.07f) });
+            for (uint y = 0; y < kCells; ++y)
+                for (uint x = 0; x < kCells; ++x) {
+                    const uint32_t i = y * (kCells + 1) + x;
+                    indices.insert(indices.end(), { i, i + 1, i + kCells + 2, i, i + kCells + 2, i + kCells + 1 });
+                }
+            auto terrain = std::make_shared<SceneBvh>();
+            terrain->addTriangles(vertices, indices, "terrain");
+            terrain->build();
+
+            auto setting = makeSetting(64, 1000000, 0, 359);
+            setting.settings.setDouble("VerticalFOVUpper", -5);
+            setting.settings.setDouble("VerticalFOVLower", -60);
+            const Pose vehicle_pose(Vector3r(0, 0, -20), Quaternionr::Identity());
+            static constexpr int kScans = 5;
+
+            vector<real_T> points;
+            vector<int> segmentation;
+            std::cout << "LidarBvh: " << terrain->getTriangleCount() << " triangles, Mpoints/s by threads:";
+            for (unsigned int threads : { 1u, 2u, 4u, 8u }) {
+                //the calling thread works too, so n threads need n - 1 workers
+                std::unique_ptr<TaskScheduler> scheduler;
+                if (threads > 1) {
+                    TaskScheduler::Params params;
+                    params.thread_count = threads - 1;
+                    scheduler.reset(new TaskScheduler(params));
+                }
+                TestLidar lidar(setting, terrain, {}, scheduler.get());
+
+                common_utils::Timer timer;
+                timer.start();
+                size_t rays = 0;
+                for (int i = 0; i < kScans; ++i) {
+                    lidar.scan(vehicle_pose, 0.1f, points, segmentation);
+                    rays += 100000;
+                }
+                std::cout << " " << threads << ": " << rays / timer.milliseconds() / 1000;
+            }
+            std::cout << " (" << segmentation.size() << " hits per scan)" << std::endl;
+        }
+
+    private:
+        typedef common_utils::TaskScheduler TaskScheduler;
+
+        //exposes one scan without going through clock and sensor update
+        class TestLidar : public LidarBvh
+        {
+        public:
+            using LidarBvh::LidarBvh;
+
+            void scan(const Pose& vehicle_pose, TTimeDelta delta_time, vector<real_T>& point_cloud, vector<int>& segmentation_cloud)
+            {
+                getPointCloud(getParams().relative_pose, vehicle_pose, delta_time, point_cloud, segmentation_cloud);
+            }
+        };
+
+        static AirSimSettings::LidarSetting makeSetting(int channels, int points_per_second, real_T fov_start, real_T fov_end,
+                                                        const std::string& frame = AirSimSettings::kVehicleInertialFrame)
+        {
+            AirSimSettings::LidarSetting setting;
+            setting.sensor_type = SensorBase::SensorType::Lidar;
+            setting.sensor_name = "TestLidar";
+            setting.settings.setInt("NumberOfChannels", channels);
+            setting.settings.setInt("PointsPerSecond", points_per_second);
+            setting.settings.setDouble("HorizontalFOVStart", fov_start);
+            setting.settings.setDouble("HorizontalFOVEnd", fov_end);
+            setting.settings.setDouble("VerticalFOVUpper", 10);
+            setting.settings.setDouble("VerticalFOVLower", -10);
+            setting.settings.setDouble("Z", 0);
+            setting.settings.setString("DataFrame", frame);
+            return setting;
+        }
+
+        //four walls 10 m from the origin, one mesh each in the order +x, -x, +y, -y
+        static std::shared_ptr<SceneBvh> makeRoom()
+        {
+            auto room = std::make_shared<SceneBvh>();
+            const vector<uint32_t> indices = { 0, 1, 2, 0, 2, 3 };
+            room->addTriangles({ 10, -20, -20, 10, 20, -20, 10, 20, 20, 10, -20, 20 }, indices, "wall_px");
+            room->addTriangles({ -10, -20, -20, -10, 20, -20, -10, 20, 20, -10, -20, 20 }, indices, "wall_nx");
+            room->addTriangles({ -20, 10, -20, 20, 10, -20, 20, 10, 20, -20, 10, 20 }, indices, "wall_py");
+            room->addTriangles({ -20, -10, -20, 20, -10, -20, 20, -10, 20, -20, -10, 20 }, indices, "wall_ny");
+            room->build(nullptr);
+            return room;
+        }
+
+        void packetTest()
+        {
+            std::mt19937 gen(7);
+            std::uniform_real_distribution<real_T> pos(-30, 30);
+            std::uniform_real_distribution<real_T> offset(-3, 3);
+            std::normal_distribution<real_T> dir(0, 1);
+
+            SceneBvh bvh;
+            vector<float> vertices;
+            vector<uint32_t> indices;
+            for (uint i = 0; i < 2000; ++i) {
+                const Vector3r center(pos(gen), pos(gen), pos(gen));
+                for (int k = 0; k < 3; ++k) {
+                    vertices.insert(vertices.end(), { center.x() + offset(gen), center.y() + offset(gen), center.z() + offset(gen) });
+                    indices.push_back(static_cast<uint32_t>(indices.size()));
+                }
+            }
+            bvh.addTriangles(vertices, indices, "soup");
+            bvh.build(nullptr);
+
+            //bundles of close rays, plus incoherent ones and a partial packet at the end
+            vector<SceneBvh::Ray> rays;
+            for (int i = 0; i < 500; ++i) {
+                const Vector3r origin(pos(gen), pos(gen), pos(gen));
+                const Vector3r direction = Vector3r(dir(gen), dir(gen), dir(gen)).normalized();
+                for (uint k = 0; k < SceneBvh::kPacketSize; ++k) {
+                    const Vector3r jitter = i % 4 == 0 ? Vector3r(dir(gen), dir(gen), dir(gen)) : Vector3r(dir(gen), dir(gen), dir(gen)) * 0.02f;
+                    rays.emplace_back(origin, (direction + jitter).normalized(), k % 2 ? 25.0f : Utils::max<real_T>());
+                }
+            }
+            rays.resize(rays.size() - 1);
+
+            vector<SceneBvh::RayHit> single, packets;
+            bvh.castRays(rays, single, nullptr);
+            bvh.castRayPackets(rays, packets, nullptr);
+
+            int hit_count = 0;
+            for (uint i = 0; i < rays.size(); ++i) {
+                testAssert(single[i].hit == packets[i].hit, "packet should hit what a single ray hits");
+                if (single[i].hit) {
+                    testAssert(std::abs(single[i].distance - packets[i].distance) < 1E-4f && single[i].mesh_index == packets[i].mesh_index &&
+                                   (single[i].normal - packets[i].normal).norm() < 1E-4f,
+                               "packet hit should match single ray hit");
+                    ++hit_count;
+                }
+            }
+            testAssert(hit_count > 200, "enough rays should hit to make the comparison meaningful");
+
+            SceneBvh empty;
+            empty.build(nullptr);
+            empty.castRayPackets(rays, packets, nullptr);
+            testAssert(packets.size() == rays.size() && !packets[0].hit, "empty scene should give misses");
+        }
+
+        void scanTest()
+        {
+            //16 channels, 10 rotations/s and 100000 points/s give 625 points per channel 0.576 degrees apart in 0.1 s
+            TestLidar lidar(makeSetting(16, 100000, 0, 359), makeRoom(), { 100, 101, 102, 103 }, nullptr);
+            vector<real_T> points;
+            vector<int> segmentation;
+            lidar.scan(Pose::zero(), 0.1f, points, segmentation);
+
+            //the last azimuth step, 359.4 degrees, is past the FOV end
+            testAssert(points.size() == 16 * 624 * 3 && segmentation.size() == 16 * 624, "every ray within FOV should hit a wall");
+            for (uint i = 0; i < segmentation.size(); ++i) {
+                const Vector3r point(points[3 * i], points[3 * i + 1], points[3 * i + 2]);
+                const int expected = std::abs(point.x() - 10) < 1E-3f ? 100 : std::abs(point.x() + 10) < 1E-3f ? 101 : std::abs(point.y() - 10) < 1E-3f ? 102 : std::abs(point.y() + 10) < 1E-3f ? 103 : -1;
+                testAssert(segmentation[i] == expected, "segmentation id should come from the wall hit");
+                testAssert(std::abs(point.z()) <= std::tan(Utils::degreesToRadians(10.0f)) * std::sqrt(200.0f) + 1E-3f,
+                           "points should stay within vertical FOV");
+            }
+            testAssert(segmentation.front() == 100 && std::abs(points[0] - 10) < 1E-3f && std::abs(points[1]) < 1E-3f,
+                       "first point should be straight ahead on the top channel");
+            testAssert(std::abs(lidar.getCurrentHorizontalAngle()) < 1E-2f || std::abs(lidar.getCurrentHorizontalAngle() - 360) < 1E-2f,
+                       "one full rotation should bring the scan back to its start");
+
+            //half a tick scans the next 180 degrees only
+            lidar.scan(Pose::zero(), 0.05f, points, segmentation);
+            testAssert(segmentation.size() == 16 * 313 && std::abs(lidar.getCurrentHorizontalAngle() - 180) < 1E-2f,
+                       "shorter tick should scan fewer points over a smaller arc");
+
+            TestLidar narrow(makeSetting(1, 100000, 80, 100), makeRoom(), {}, nullptr);
+            narrow.scan(Pose::zero(), 0.1f, points, segmentation);
+            testAssert(!segmentation.empty() && std::all_of(segmentation.begin(), segmentation.end(), [](int id) { return id == 2; }),
+                       "narrow FOV around +y should only see that wall, ids default to mesh index");
+        }
+
+        void frameTest()
+        {
+            //vehicle at (2, 3) turned 90 degrees, lidar turned another 90 degrees on it
+            auto setting = makeSetting(4, 20000, 0, 10);
+            setting.settings.setDouble("Yaw", 90);
+            auto local_setting = makeSetting(4, 20000, 0, 10, AirSimSettings::kSensorLocalFrame);
+            local_setting.settings.setDouble("Yaw", 90);
+            const Pose vehicle_pose(Vector3r(2, 3, 0), VectorMath::toQuaternion(0, 0, Utils::degreesToRadians(90.0f)));
+
+            auto room = makeRoom();
+            TestLidar inertial(setting, room, {}, nullptr), local(local_setting, room, {}, nullptr);
+            vector<real_T> inertial_points, local_points;
+            vector<int> segmentation;
+            inertial.scan(vehicle_pose, 0.1f, inertial_points, segmentation);
+            testAssert(!segmentation.empty() && segmentation.front() == 1 && std::abs(inertial_points[0] + 10) < 1E-3f &&
+                           std::abs(inertial_points[1] - 3) < 1E-3f,
+                       "lidar and vehicle yaw should add up to looking along -x");
+            local.scan(vehicle_pose, 0.1f, local_points, segmentation);
+
+            const Pose sensor_pose = local.getParams().relative_pose + vehicle_pose;
+            testAssert(local_points.size() == inertial_points.size(), "both frames should have the same points");
+            for (uint i = 0; i < local_points.size(); i += 3) {
+                const Vector3r world = VectorMath::transformToWorldFrame(Vector3r(local_points[i], local_points[i + 1], local_points[i + 2]), sensor_pose, true);
+                testAssert((world - Vector3r(inertial_points[i], inertial_points[i + 1], inertial_points[i + 2])).norm() < 1E-3f,
+                           "sensor frame points should map back to inertial frame points");
+            }
+            testAssert(local_points[0] > 9.9f && std::abs(local_points[1]) < 1E-3f, "sensor frame should have first point straight ahead");
+        }
+
+        void factoryTest()
+        {
+            SceneSensorFactory factory(makeRoom());
+            const auto setting = makeSetting(16, 100000, 0, 359);
+            const auto sensor = factory.createSensorFromSettings(&setting);
+            testAssert(std::dynamic_pointer_cast<LidarBvh>(sensor) != nullptr, "factory should create scene lidars");
+
+            AirSimSettings::BarometerSetting barometer;
+            barometer.sensor_type = SensorBase::SensorType::Barometer;
+            testAssert(factory.createSensorFromSettings(&barometer) != nullptr, "other sensors should come from the base factory");
+        }
+    };
+}
+}
+#endif
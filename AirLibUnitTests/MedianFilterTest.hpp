@@ -0,0 +1,202 @@
+#ifndef msr_AirLibUnitTests_MedianFilterTest_hpp
+#define msr_AirLibUnitTests_MedianFilterTest_hpp
+
+#include <iostream>
+#include <random>
+#include <set>
+#include <cmath>
+#include <limits>
+#include "TestBase.hpp"
+#include "common/common_utils/MedianFilter.hpp"
+#include "common/common_utils/IndexableSkipList.hpp"
+#include "common/common_utils/Timer.hpp"
+
+namespace msr
+{
+namespace airlib
+{
+
+    class MedianFilterTest : public TestBase
+    {
+    public:
+        virtual void run() override
+        {
+            skipListTest();
+            filterTest<float>();
+            filterTest<double>();
+            filterTest<int>();
+            warmupTest();
+        }
+
+        virtual void benchmark() override
+        {
+            static constexpr int kSamples = 200000;
+            std::mt19937 gen(17);
+            std::vector<float> samples(kSamples);
+            for (float& value : samples)
+                value = sample<float>(gen);
+
+            std::cout << "MedianFilter: ns/sample rolling vs sorting:";
+            for (int window_size : { 5, 31, 255 }) {
+                common_utils::MedianFilter<float> filter(window_size, 0.2f);
+                SortingMedianFilter<float> reference(window_size, 0.2f);
+                double checksum = 0;
+
+                common_utils::Timer timer;
+                timer.start();
+                for (float value : samples)
+                    checksum += std::get<0>(filter.filter(value));
+                const double rolling_ns = timer.seconds() * 1E9 / kSamples;
+
+                timer.start();
+                for (float value : samples)
+                    checksum -= std::get<0>(reference.filter(value));
+                const double sorting_ns = timer.seconds() * 1E9 / kSamples;
+
+                testAssert(std::abs(checksum) < 1E-3 * kSamples, "benchmark results should agree");
+                std::cout << " window " << window_size << ": " << rolling_ns << " vs " << sorting_ns;
+            }
+            std::cout << std::endl;
+        }
+
+    private:
+        //what the filter did before: sort a copy of the window for every sample
+        template <typename T>
+        class SortingMedianFilter
+        {
+        public:
+            SortingMedianFilter(int window_size, float outlier_factor)
+                : window_size_(window_size), outlier_factor_(outlier_factor)
+            {
+            }
+
+            std::tuple<double, double> filter(T value)
+            {
+                window_.push_back(value);
+                if (static_cast<int>(window_.size()) > window_size_)
+                    window_.erase(window_.begin());
+                if (static_cast<int>(window_.size()) < window_size_)
+                    return std::make_tuple(double(value), 0);
+
+                sorted_ = window_;
+                std::sort(sorted_.begin(), sorted_.end());
+                const double median = sorted_[window_size_ / 2];
+                const double half_range = std::isinf(outlier_factor_) ? std::numeric_limits<double>::infinity() : std::abs(median) * outlier_factor_;
+                double sum = 0, squares = 0;
+                int count = 0;
+                for (T x : sorted_)
+                    if (x >= median - half_range && x <= median + half_range) {
+                        sum += x;
+                        ++count;
+                    }
+                const double mean = sum / count;
+                for (T x : sorted_)
+                    if (x >= median - half_range && x <= median + half_range)
+                        squares += (x - mean) * (x - mean);
+                return std::make_tuple(mean, squares / count);
+            }
+
+        private:
+            int window_size_;
+            float outlier_factor_;
+            std::vector<T> window_, sorted_;
+        };
+
+        //noisy signal around 50 with spikes, or small integers with many repeats
+        template <typename T>
+        static T sample(std::mt19937& gen)
+        {
+            std::normal_distribution<double> noise(50, 2);
+            std::uniform_real_distribution<double> unit(0, 1);
+            double value = noise(gen);
+            if (unit(gen) < 0.05)
+                value *= unit(gen) < 0.5 ? 0.1 : 5;
+            return std::is_integral<T>::value ? static_cast<T>(std::round(value / 4)) : static_cast<T>(value);
+        }
+
+        void skipListTest()
+        {
+            std::mt19937 gen(11);
+            std::uniform_int_distribution<int> value_dist(0, 50);
+            common_utils::IndexableSkipList<int> list(300);
+            std::multiset<int> reference;
+
+            for (int i = 0; i < 20000; ++i) {
+                const int value = value_dist(gen);
+                if (reference.size() < 300 && (reference.empty() || value % 3 != 0)) {
+                    testAssert(list.insert(value), "insert should succeed below capacity");
+                    reference.insert(value);
+                }
+                else {
+                    const bool present = reference.count(value) > 0;
+                    testAssert(list.erase(value) == present, "erase should only find values in the list");
+                    if (present)
+                        reference.erase(reference.find(value));
+                }
+                testAssert(list.size() == reference.size(), "size should match");
+
+                if (i % 97 == 0 && !reference.empty()) {
+                    size_t rank = 0;
+                    for (int x : reference)
+                        testAssert(list.at(rank++) == x, "rank lookup should match sorted order");
+
+                    const int low = value_dist(gen), high = low + value_dist(gen) / 4;
+                    size_t count = 0;
+                    double sum = 0, squares = 0;
+                    for (int x : reference)
+                        if (x >= low && x <= high) {
+                            ++count;
+                            sum += x;
+                            squares += double(x) * x;
+                        }
+                    const auto sums = list.sumsBetween(low, high);
+                    testAssert(sums.count == count && std::abs(sums.sum - sum) < 1E-6 && std::abs(sums.sum_squares - squares) < 1E-6,
+                               "range sums should match");
+                }
+            }
+
+            common_utils::IndexableSkipList<int> full(2);
+            testAssert(full.insert(1) && full.insert(1) && !full.insert(2), "insert should fail when full");
+            testAssert(full.erase(1) && full.at(0) == 1 && !full.erase(2), "erase should remove one of equal values");
+        }
+
+        template <typename T>
+        void filterTest()
+        {
+            std::mt19937 gen(13);
+            for (int window_size : { 1, 2, 5, 16, 17, 31, 128, 129, 255 }) {
+                for (float outlier_factor : { 0.1f, 0.5f, std::numeric_limits<float>::infinity() }) {
+                    common_utils::MedianFilter<T> filter(window_size, outlier_factor);
+                    SortingMedianFilter<T> reference(window_size, outlier_factor);
+                    for (int i = 0; i < 3 * window_size + 500; ++i) {
+                        const T value = sample<T>(gen);
+                        double mean, variance, expected_mean, expected_variance;
+                        std::tie(mean, variance) = filter.filter(value);
+                        std::tie(expected_mean, expected_variance) = reference.filter(value);
+                        testAssert(std::abs(mean - expected_mean) < 1E-9 * (1 + std::abs(expected_mean)) &&
+                                       std::abs(variance - expected_variance) < 1E-7 * (1 + expected_mean * expected_mean),
+                                   "rolling median filter should match sorting the window");
+                    }
+                }
+            }
+        }
+
+        void warmupTest()
+        {
+            common_utils::MedianFilter<float> filter(3, 0.5f);
+            testAssert(std::get<0>(filter.filter(10)) == 10 && std::get<1>(filter.filter(12)) == 0, "input should pass until window fills");
+            //window 12, 100, 11 has median 12 and band [6, 18], so 100 is dropped
+            double mean, variance;
+            std::tie(mean, variance) = filter.filter(100);
+            std::tie(mean, variance) = filter.filter(11);
+            testAssert(std::abs(mean - 11.5) < 1E-9 && std::abs(variance - 0.25) < 1E-9, "outlier should not count towards mean");
+
+            common_utils::MedianFilter<float> zeros(3, std::numeric_limits<float>::infinity());
+            for (int i = 0; i < 3; ++i)
+                std::tie(mean, variance) = zeros.filter(i == 1 ? 3.0f : 0.0f);
+            testAssert(std::abs(mean - 1) < 1E-9, "infinite outlier factor should keep every sample even with zero median");
+        }
+    };
+}
+}
+#endif
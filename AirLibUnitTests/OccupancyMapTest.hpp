@@ -0,0 +1,156 @@
+#ifndef msr_AirLibUnitTests_OccupancyMapTest_hpp
+#define msr_AirLibUnitTests_OccupancyMapTest_hpp
+
+#include <thread>
+#include <atomic>
+#include "TestBase.hpp"
+#include "safety/SafetyEval.hpp"
+#include "common/common_utils/Timer.hpp"
+
+namespace msr
+{
+namespace airlib
+{
+
+    class OccupancyMapTest : public TestBase
+    {
+        class NoGeoFence : public IGeoFence
+        {
+        public:
+            virtual void setBoundry(const Vector3r& origin, float xy_length, float max_z, float min_z) override
+            {
+                unused(origin);
+                unused(xy_length);
+                unused(max_z);
+                unused(min_z);
+            }
+            virtual void checkFence(const Vector3r& cur_loc, const Vector3r& dest_loc, bool& in_fence, bool& allow) override
+            {
+                unused(cur_loc);
+                unused(dest_loc);
+                in_fence = allow = true;
+            }
+            virtual string toString() const override
+            {
+                return "NoGeoFence";
+            }
+        };
+
+    public:
+        virtual void run() override
+        {
+            insertQueryTest();
+            safetyEvalTest();
+            concurrencyTest();
+        }
+
+        virtual void benchmark() override
+        {
+            VoxelOccupancyMap map(0.25f, 1 << 18);
+            RandomGeneratorR r(-50.0f, 50.0f);
+
+            static constexpr int point_count = 1000000;
+            vector<real_T> cloud;
+            cloud.reserve(point_count * 3);
+            for (int i = 0; i < point_count * 3; ++i)
+                cloud.push_back(r.next());
+
+            common_utils::Timer timer;
+            timer.start();
+            map.insertPointCloud(cloud, Pose::zero());
+            double insert_secs = timer.seconds();
+
+            static constexpr int query_count = 10000;
+            timer.start();
+            for (int i = 0; i < query_count; ++i) {
+                const Vector3r from(r.next(), r.next(), r.next());
+                map.sweepSphere(from, from + Vector3r(5, 0, 0), 2);
+            }
+            double query_secs = timer.seconds();
+
+            std::cout << "VoxelOccupancyMap: insert rate " << point_count / insert_secs << " points/sec, "
+                      << "5m sweep query latency " << query_secs * 1E6 / query_count << " us" << std::endl;
+        }
+
+    private:
+        void insertQueryTest()
+        {
+            VoxelOccupancyMap map(0.5f);
+
+            map.insertPoint(Vector3r(10.1f, -3.2f, -5.6f));
+            testAssert(map.isOccupied(Vector3r(10.2f, -3.4f, -5.9f)), "point in same voxel should be occupied");
+            testAssert(!map.isOccupied(Vector3r(11.0f, -3.2f, -5.6f)), "neighbour voxel should be free");
+
+            //ray clears everything up to the end point
+            map.insertPoint(Vector3r(5, -3.2f, -5.6f));
+            map.insertRay(Vector3r(0, -3.2f, -5.6f), Vector3r(10.1f, -3.2f, -5.6f), true);
+            testAssert(!map.isOccupied(Vector3r(5, -3.2f, -5.6f)), "ray should clear voxels before end point");
+            testAssert(map.isOccupied(Vector3r(10.1f, -3.2f, -5.6f)), "ray end point should stay occupied");
+
+            //sweep along x hits the point, sweep away from it doesn't
+            auto hit = map.sweepSphere(Vector3r(0, -3.2f, -5.6f), Vector3r(20, -3.2f, -5.6f), 0.5f);
+            testAssert(hit.found && hit.distance > 9 && hit.distance < 10.5f, "sweep should find obstacle ahead");
+            hit = map.sweepSphere(Vector3r(0, -3.2f, -5.6f), Vector3r(-20, -3.2f, -5.6f), 0.5f);
+            testAssert(!hit.found, "sweep should ignore obstacle behind");
+            hit = map.sweepSphere(Vector3r(0, -3.2f, -15.6f), Vector3r(20, -3.2f, -15.6f), 2);
+            testAssert(!hit.found, "sweep should pass above obstacle");
+
+            auto closest = map.getClosestObstacle(Vector3r(10, -3, -3), 5);
+            testAssert(closest.found && Utils::isApproximatelyEqual(closest.distance, 2.75f, 0.5f), "closest obstacle distance is wrong");
+
+            //lidar points are in sensor frame
+            vector<real_T> cloud = { 1.2f, 0.2f, 0, 0.2f, 2.2f, 0 };
+            Pose sensor_pose(Vector3r(0, 0, -20), VectorMath::toQuaternion(0, 0, Utils::degreesToRadians(90.0f)));
+            map.insertPointCloud(cloud, sensor_pose);
+            testAssert(map.isOccupied(Vector3r(-0.2f, 1.2f, -20)) && map.isOccupied(Vector3r(-2.2f, 0.2f, -20)), "point cloud was not transformed to world frame");
+
+            uint version = map.getVersion();
+            map.clear();
+            testAssert(!map.isOccupied(Vector3r(-0.2f, 1.2f, -20)) && map.getVersion() > version, "clear should empty the map");
+        }
+
+        void safetyEvalTest()
+        {
+            MultirotorApiParams params;
+            auto fence = std::make_shared<NoGeoFence>();
+            auto map = std::make_shared<VoxelOccupancyMap>(0.25f);
+            SafetyEval safety_eval(params, fence, nullptr, map);
+            safety_eval.setSafety(SafetyEval::SafetyViolationType_::Obstacle, 1.0f, SafetyEval::ObsAvoidanceStrategy::RaiseException, Vector3r::Zero(), Utils::nan<float>(), Utils::nan<float>(), Utils::nan<float>());
+
+            //ceiling 3m above the vehicle which ObstacleMap could not represent
+            for (float x = -10; x <= 10; x += 0.2f)
+                for (float y = -10; y <= 10; y += 0.2f)
+                    map->insertPoint(Vector3r(x, y, -3));
+
+            const Quaternionr level = Quaternionr::Identity();
+            testAssert(safety_eval.isSafeVelocity(Vector3r::Zero(), Vector3r(2, 0, 0), level).is_safe, "flying under ceiling should be safe");
+            testAssert(!safety_eval.isSafeDestination(Vector3r(0, 0, -4), Vector3r::Zero(), level).is_safe, "flying through ceiling should be unsafe");
+        }
+
+        void concurrencyTest()
+        {
+            VoxelOccupancyMap map(0.25f, 1 << 14);
+            std::atomic<bool> done(false);
+
+            std::thread writer([&]() {
+                RandomGeneratorR r(-20.0f, 20.0f);
+                for (int i = 0; i < 200000; ++i)
+                    map.insertPoint(Vector3r(r.next(), r.next(), r.next()));
+                done = true;
+            });
+
+            //queries must not crash or block while writer is inserting
+            uint queries = 0;
+            while (!done) {
+                map.sweepSphere(Vector3r(-20, 0, 0), Vector3r(20, 0, 0), 1);
+                ++queries;
+            }
+            writer.join();
+
+            testAssert(queries > 0, "no queries completed during concurrent inserts");
+            testAssert(map.getDroppedUpdates() == 0, "block table should not overflow in this test");
+        }
+    };
+}
+}
+#endif
@@ -0,0 +1,255 @@
+#ifndef msr_AirLibUnitTests_PointCloudFilterTest_hpp
+#define msr_AirLibUnitTests_PointCloudFilterTest_hpp
+
+#include <iostream>
+#include <random>
+#include "TestBase.hpp"
+#include "sensors/lidar/PointCloudFilter.hpp"
+#include "common/common_utils/Timer.hpp"
+
+namespace msr
+{
+namespace airlib
+{
+
+    class PointCloudFilterTest : public TestBase
+    {
+    public:
+        virtual void run() override
+        {
+            compactTest();
+            cropTest();
+            groundTest();
+            voxelTest();
+        }
+
+        virtual void benchmark() override
+        {
+            //1M points/sec at 10 Hz
+            static constexpr size_t scan_points = 100000;
+            static constexpr int scans = 20;
+            std::mt19937 rng(42);
+            vector<real_T> source_cloud;
+            vector<int> source_segmentation;
+            makeScan(scan_points, rng, source_cloud, source_segmentation);
+            const Pose sensor_pose(Vector3r(0, 0, -1.8f), Quaternionr::Identity());
+
+            auto measure = [&](const std::string& name, const PointCloudFilter::Params& params) {
+                PointCloudFilter filter(params);
+                vector<real_T> cloud;
+                vector<int> segmentation;
+                common_utils::Timer timer;
+                double total_ms = 0;
+                for (int scan = 0; scan < scans; ++scan) {
+                    cloud = source_cloud;
+                    segmentation = source_segmentation;
+                    timer.start();
+                    if (params.isEnabled())
+                        filter.apply(cloud, segmentation, sensor_pose, false);
+                    else
+                        PointCloudFilter::compact(cloud, segmentation);
+                    total_ms += timer.milliseconds();
+                }
+                const double ms = total_ms / scans;
+                std::cout << "PointCloudFilter: " << name << " " << ms << " ms per " << scan_points << " point scan, "
+                          << scan_points / ms / 1000 << "M points/sec, " << segmentation.size() << " points out" << std::endl;
+            };
+
+            //reference: erase-remove idiom previously used by Unreal lidar
+            {
+                common_utils::Timer timer;
+                double total_ms = 0;
+                for (int scan = 0; scan < scans; ++scan) {
+                    vector<real_T> cloud = source_cloud;
+                    vector<int> segmentation = source_segmentation;
+                    timer.start();
+                    cloud.erase(std::remove(cloud.begin(), cloud.end(), FLT_MAX), cloud.end());
+                    segmentation.erase(std::remove(segmentation.begin(), segmentation.end(), -1), segmentation.end());
+                    total_ms += timer.milliseconds();
+                }
+                std::cout << "PointCloudFilter: erase-remove " << total_ms / scans << " ms per " << scan_points << " point scan" << std::endl;
+            }
+
+            PointCloudFilter::Params params;
+            measure("compact", params);
+
+            params.min_range = 4;
+            params.max_range = 50;
+            params.horizontal_FOV_start = -60;
+            params.horizontal_FOV_end = 60;
+            measure("compact+crop", params);
+
+            params.ground_removal = true;
+            params.ground_height = 1.8f;
+            measure("compact+crop+ground", params);
+
+            params.voxel_size = 0.2f;
+            measure("compact+crop+ground+voxel 0.2m", params);
+        }
+
+    private:
+        static void addPoint(vector<real_T>& cloud, vector<int>& segmentation, real_T x, real_T y, real_T z, int id)
+        {
+            cloud.push_back(x);
+            cloud.push_back(y);
+            cloud.push_back(z);
+            segmentation.push_back(id);
+        }
+
+        void compactTest()
+        {
+            vector<real_T> cloud;
+            vector<int> segmentation;
+            addPoint(cloud, segmentation, FLT_MAX, FLT_MAX, FLT_MAX, -1);
+            addPoint(cloud, segmentation, 1, 2, 3, -1);
+            addPoint(cloud, segmentation, Utils::nan<real_T>(), 0, 0, 5);
+            addPoint(cloud, segmentation, 4, 5, 6, 7);
+
+            //-1 is a valid segmentation id for hits on actors without stencil value
+            testAssert(PointCloudFilter::compact(cloud, segmentation) == 2, "invalid points should be removed");
+            testAssert(cloud == vector<real_T>({ 1, 2, 3, 4, 5, 6 }) && segmentation == vector<int>({ -1, 7 }),
+                       "points and segmentation should stay paired");
+
+            vector<int> no_segmentation;
+            cloud.push_back(FLT_MAX);
+            cloud.push_back(FLT_MAX);
+            cloud.push_back(FLT_MAX);
+            testAssert(PointCloudFilter::compact(cloud, no_segmentation) == 2 && cloud.size() == 6, "segmentation should be optional");
+        }
+
+        void cropTest()
+        {
+            vector<real_T> cloud;
+            vector<int> segmentation;
+            addPoint(cloud, segmentation, 10.5f, 0, 0, 0); //too close
+            addPoint(cloud, segmentation, 15, 0, 0, 1); //front
+            addPoint(cloud, segmentation, 10, 5, 0, 2); //right, 90 deg
+            addPoint(cloud, segmentation, 10, 0, -5, 3); //straight up
+            addPoint(cloud, segmentation, 60, 0, 0, 4); //too far
+
+            //sensor at x = 10 in the vehicle inertial frame
+            const Pose sensor_pose(Vector3r(10, 0, 0), Quaternionr::Identity());
+            PointCloudFilter::Params params;
+            params.min_range = 1;
+            params.max_range = 20;
+            params.horizontal_FOV_start = -45;
+            params.horizontal_FOV_end = 45;
+            params.vertical_FOV_upper = 30;
+            PointCloudFilter filter(params);
+
+            filter.apply(cloud, segmentation, sensor_pose, false);
+            testAssert(segmentation == vector<int>({ 1 }), "only front point is inside crop window");
+            testAssert(filter.getLastStats().cropped == 4 && filter.getLastStats().output == 1, "crop stats are wrong");
+
+            //same geometry with sensor yawed by 90 deg sees the right point in front
+            cloud.clear();
+            segmentation.clear();
+            addPoint(cloud, segmentation, 15, 0, 0, 1);
+            addPoint(cloud, segmentation, 10, 5, 0, 2);
+            const Pose yawed(Vector3r(10, 0, 0), VectorMath::toQuaternion(0, 0, Utils::degreesToRadians(90.0f)));
+            filter.apply(cloud, segmentation, yawed, false);
+            testAssert(segmentation == vector<int>({ 2 }), "crop window should follow sensor orientation");
+
+            bool thrown = false;
+            try {
+                params.min_range = 30;
+                filter.setParams(params);
+            }
+            catch (const std::invalid_argument&) {
+                thrown = true;
+            }
+            testAssert(thrown, "min_range above max_range should be rejected");
+        }
+
+        void groundTest()
+        {
+            PointCloudFilter::Params params;
+            params.ground_removal = true;
+            params.ground_height = 2;
+            params.ground_tolerance = 0.25f;
+            PointCloudFilter filter(params);
+
+            //NED: ground 2 m below sensor at z = -2
+            vector<real_T> cloud;
+            vector<int> segmentation;
+            addPoint(cloud, segmentation, 5, 0, 0, 0); //ground
+            addPoint(cloud, segmentation, 5, 1, -0.1f, 1); //ground, within tolerance
+            addPoint(cloud, segmentation, 5, 2, -1, 2); //obstacle
+            filter.apply(cloud, segmentation, Pose(Vector3r(0, 0, -2), Quaternionr::Identity()), false);
+            testAssert(segmentation == vector<int>({ 2 }) && filter.getLastStats().ground == 2, "ground points should be removed");
+
+            //sensor local frame of a lidar pitched down by 90 deg: ground is along +x of the sensor
+            cloud.clear();
+            segmentation.clear();
+            addPoint(cloud, segmentation, 2, 0, 0, 0);
+            addPoint(cloud, segmentation, 1, 0, 0, 1);
+            const Pose pitched(Vector3r(0, 0, -2), VectorMath::toQuaternion(Utils::degreesToRadians(-90.0f), 0, 0));
+            filter.apply(cloud, segmentation, pitched, true);
+            testAssert(segmentation == vector<int>({ 1 }), "ground should be found along gravity in sensor local frame");
+        }
+
+        void voxelTest()
+        {
+            PointCloudFilter::Params params;
+            params.voxel_size = 1;
+            PointCloudFilter filter(params);
+
+            vector<real_T> cloud;
+            vector<int> segmentation;
+            addPoint(cloud, segmentation, 0.25f, 0.25f, 0.25f, 1);
+            addPoint(cloud, segmentation, -0.5f, 0.5f, 0.5f, 2);
+            addPoint(cloud, segmentation, 0.75f, 0.75f, 0.75f, 3);
+            addPoint(cloud, segmentation, FLT_MAX, FLT_MAX, FLT_MAX, 4);
+            addPoint(cloud, segmentation, -0.25f, 0.5f, 0.5f, 5);
+
+            filter.apply(cloud, segmentation, Pose(), false);
+            testAssert(segmentation == vector<int>({ 1, 2 }), "voxels should be kept in first seen order with first segmentation id");
+            testAssert(cloud == vector<real_T>({ 0.5f, 0.5f, 0.5f, -0.375f, 0.5f, 0.5f }), "voxel point should be centroid");
+            testAssert(filter.getLastStats().merged == 2 && filter.getLastStats().invalid == 1, "voxel stats are wrong");
+
+            //every point of a dense random cloud must map to a voxel holding a point within the voxel
+            std::mt19937 rng(7);
+            std::uniform_real_distribution<real_T> dist(-50, 50);
+            cloud.clear();
+            segmentation.clear();
+            for (int i = 0; i < 20000; ++i)
+                addPoint(cloud, segmentation, dist(rng), dist(rng), dist(rng) * 0.05f, i);
+            params.voxel_size = 5;
+            filter.setParams(params);
+            const size_t voxels = filter.apply(cloud, segmentation, Pose(), false);
+            testAssert(voxels <= 20 * 20 * 2 && voxels > 20 * 20, "random cloud should fill each voxel");
+        }
+
+        //scan shaped like a 32 channel spinning lidar around a car: ground ring plus walls and misses
+        static void makeScan(size_t points, std::mt19937& rng, vector<real_T>& cloud, vector<int>& segmentation)
+        {
+            std::uniform_real_distribution<real_T> unit(0, 1);
+            cloud.resize(points * 3);
+            segmentation.resize(points);
+            for (size_t i = 0; i < points; ++i) {
+                const real_T azimuth = unit(rng) * 2 * M_PIf;
+                const real_T kind = unit(rng);
+                real_T range, z;
+                if (kind < 0.1f) {
+                    cloud[i * 3] = cloud[i * 3 + 1] = cloud[i * 3 + 2] = FLT_MAX;
+                    segmentation[i] = -1;
+                    continue;
+                }
+                else if (kind < 0.5f) {
+                    range = 3 + unit(rng) * 40;
+                    z = 0;
+                }
+                else {
+                    range = 5 + unit(rng) * 60;
+                    z = -unit(rng) * 6;
+                }
+                cloud[i * 3] = range * std::cos(azimuth);
+                cloud[i * 3 + 1] = range * std::sin(azimuth);
+                cloud[i * 3 + 2] = z;
+                segmentation[i] = static_cast<int>(i % 255);
+            }
+        }
+    };
+}
+}
+#endif
@@ -0,0 +1,363 @@
+#ifndef msr_AirLibUnitTests_ReplayJournalTest_hpp
+#define msr_AirLibUnitTests_ReplayJournalTest_hpp
+
+#include <iostream>
+#include <cstdio>
+#include <filesystem>
+#include <cstring>
+#include <thread>
+#include <atomic>
+#include "TestBase.hpp"
+#include "common/ReplayJournal.hpp"
+#include "common/SteppableClock.hpp"
+#include "common/common_utils/Timer.hpp"
+#include "api/VehicleApiBase.hpp"
+#include "physics/World.hpp"
+#include "physics/FastPhysicsEngine.hpp"
+
+namespace msr
+{
+namespace airlib
+{
+
+    class ReplayJournalTest : public TestBase
+    {
+    public:
+        virtual void run() override
+        {
+            setUp();
+
+            replayTest();
+            seedTest();
+
+            tearDown();
+        }
+
+        //replay runs as fast as the world updates instead of in step with the clock
+        virtual void benchmark() override
+        {
+            setUp();
+
+            static constexpr uint kSteps = 20000;
+            Sim recorded;
+            record(recorded, kSteps, false);
+            recorded.journal.save(file_name_);
+
+            Sim sim;
+            sim.journal.load(file_name_);
+            common_utils::Timer timer;
+            timer.start();
+            sim.journal.replay(sim.world);
+            const double seconds = timer.seconds();
+            const double sim_seconds = kSteps * 3E-3;
+            std::cout << "ReplayJournal: replayed " << sim_seconds << " s of simulation in " << seconds * 1E3 << " ms, "
+                      << sim_seconds / seconds << "x real time" << std::endl;
+
+            tearDown();
+        }
+
+    private:
+        void setUp()
+        {
+            Utils::getSetMinLogLevel(true, 100);
+            file_name_ = (std::filesystem::temp_directory_path() / "airsim_replay_journal_test.bin").string();
+        }
+
+        void tearDown()
+        {
+            std::remove(file_name_.c_str());
+            common_utils::getRandomGeneratorSeedOffset() = 0;
+            Utils::getSetMinLogLevel(true);
+        }
+
+        //vehicle that takes throttle from RC and yaw from a command
+        class TestApi : public VehicleApiBase
+        {
+        public:
+            virtual void enableApiControl(bool is_enabled) override
+            {
+                api_control_ = is_enabled;
+            }
+            virtual bool isApiControlEnabled() const override
+            {
+                return api_control_;
+            }
+            virtual bool armDisarm(bool arm) override
+            {
+                armed_ = arm;
+                return true;
+            }
+            virtual GeoPoint getHomeGeoPoint() const override
+            {
+                return GeoPoint();
+            }
+            virtual bool setRCData(const RCData& rc_data) override
+            {
+                rc_data_ = rc_data;
+                return true;
+            }
+            virtual RCData getRCData() const override
+            {
+                return rc_data_;
+            }
+
+            bool isArmed() const
+            {
+                return armed_;
+            }
+
+            real_T yaw_torque = 0;
+
+        protected:
+            virtual void resetImplementation() override
+            {
+                armed_ = api_control_ = false;
+                rc_data_ = RCData();
+                yaw_torque = 0;
+            }
+
+        private:
+            bool armed_ = false, api_control_ = false;
+            RCData rc_data_;
+        };
+
+        //a single thruster with noisy output
+        class Thruster : public PhysicsBodyVertex
+        {
+        public:
+            Thruster()
+                : PhysicsBodyVertex(Vector3r::Zero(), -Vector3r::UnitZ())
+            {
+            }
+
+            real_T thrust = 0, torque = 0;
+
+        protected:
+            virtual void setWrench(Wrench& wrench) override
+            {
+                wrench.force = getNormal() * (thrust + noise_.next());
+                wrench.torque = Vector3r(0, 0, torque);
+            }
+
+            virtual void resetImplementation() override
+            {
+                PhysicsBodyVertex::resetImplementation();
+                noise_.reset();
+            }
+
+        private:
+            RandomGeneratorGausianR noise_{ 0.0f, 0.5f };
+        };
+
+        class TestBody : public PhysicsBody
+        {
+        public:
+            explicit TestBody(TestApi* api)
+                : api_(api), kinematics_(makeState()), environment_(Environment::State(Vector3r(0, 0, -10), GeoPoint()))
+            {
+                initialize(1, Matrix3x3r::Identity(), &kinematics_, &environment_);
+                kinematics_.reset();
+            }
+
+            virtual real_T getRestitution() const override
+            {
+                return 0.5f;
+            }
+            virtual real_T getFriction() const override
+            {
+                return 0.5f;
+            }
+            virtual uint wrenchVertexCount() const override
+            {
+                return 1;
+            }
+            virtual PhysicsBodyVertex& getWrenchVertex(uint index) override
+            {
+                unused(index);
+                return thruster_;
+            }
+            virtual const PhysicsBodyVertex& getWrenchVertex(uint index) const override
+            {
+                unused(index);
+                return thruster_;
+            }
+
+            virtual void resetImplementation() override
+            {
+                api_->reset();
+                PhysicsBody::resetImplementation();
+            }
+
+            virtual void update() override
+            {
+                api_->update();
+                thruster_.thrust = api_->isArmed() ? 2 * EarthUtils::Gravity * api_->getRCData().throttle : 0;
+                thruster_.torque = api_->yaw_torque;
+                PhysicsBody::update();
+            }
+
+        private:
+            static Kinematics::State makeState()
+            {
+                Kinematics::State state = Kinematics::State::zero();
+                state.pose.position = Vector3r(0, 0, -10);
+                return state;
+            }
+
+            TestApi* api_;
+            Thruster thruster_;
+            Kinematics kinematics_;
+            Environment environment_;
+        };
+
+        //world with one vehicle wired to a journal
+        struct Sim
+        {
+            TestApi api;
+            TestBody body{ &api };
+            World world{ std::unique_ptr<PhysicsEngineBase>(new FastPhysicsEngine(false)) };
+            ReplayJournal journal;
+
+            Sim()
+            {
+                world.insert(&body);
+                world.setJournal(&journal);
+                journal.addVehicle("drone", &api);
+                journal.addCommandHandler("yaw", [](VehicleApiBase* api, const vector<uint8_t>& payload) {
+                    real_T torque;
+                    std::memcpy(&torque, payload.data(), sizeof(torque));
+                    static_cast<TestApi*>(api)->yaw_torque = torque;
+                });
+            }
+
+            void sendYaw(real_T torque)
+            {
+                vector<uint8_t> payload(sizeof(torque));
+                std::memcpy(payload.data(), &torque, sizeof(torque));
+                journal.sendCommand("drone", "yaw", payload);
+            }
+
+            vector<Kinematics::State> states;
+            void capture()
+            {
+                states.push_back(body.getKinematics());
+            }
+        };
+
+        static bool sameStates(const vector<Kinematics::State>& a, const vector<Kinematics::State>& b)
+        {
+            if (a.size() != b.size())
+                return false;
+            for (size_t i = 0; i < a.size(); ++i) {
+                const Kinematics::State &x = a[i], &y = b[i];
+                if (x.pose.position != y.pose.position || x.pose.orientation.coeffs() != y.pose.orientation.coeffs() ||
+                    x.twist.linear != y.twist.linear || x.twist.angular != y.twist.angular)
+                    return false;
+            }
+            return true;
+        }
+
+        //flies with inputs from this thread at fixed steps and wind from another thread at whatever
+        //step it gets to run, and keeps every frame's state
+        void record(Sim& sim, uint steps, bool with_gusts)
+        {
+            auto clock = std::make_shared<SteppableClock>(3E-3f);
+            ClockFactory::get(clock);
+
+            std::atomic<bool> done(false);
+            std::thread gusts;
+            if (with_gusts) {
+                gusts = std::thread([&]() {
+                    for (int i = 0; !done; ++i) {
+                        sim.journal.setWind(Vector3r(static_cast<real_T>(i % 7), 0, 0));
+                        std::this_thread::sleep_for(std::chrono::microseconds(200));
+                    }
+                });
+            }
+
+            sim.journal.startRecording();
+            sim.world.reset();
+            sim.capture();
+            for (uint step = 0; step < steps; ++step) {
+                if (step == 10) {
+                    sim.journal.enableApiControl("drone", true);
+                    sim.journal.armDisarm("drone", true);
+                }
+                if (step % 100 == 20) {
+                    RCData rc_data;
+                    rc_data.throttle = 0.45f + 0.01f * (step / 100 % 3);
+                    rc_data.is_valid = true;
+                    sim.journal.setRCData("drone", rc_data);
+                }
+                if (step == 500)
+                    sim.sendYaw(0.2f);
+                if (step == 700)
+                    sim.journal.setExtForce(Vector3r(0, 1, 0));
+                sim.world.update();
+                sim.capture();
+            }
+            sim.journal.stopRecording();
+
+            done = true;
+            if (gusts.joinable())
+                gusts.join();
+        }
+
+        void replayTest()
+        {
+            static constexpr uint kSteps = 2000;
+            vector<Kinematics::State> recorded;
+            size_t frame_count;
+            {
+                Sim sim;
+                record(sim, kSteps, true);
+                testAssert(sim.api.isArmed() && sim.api.getRCData().is_valid, "inputs should be applied while recording");
+                testAssert(sim.states.back().pose.position.y() > 0.1f && sim.states.back().twist.angular.z() > 0.1f, "ext force and yaw should have moved the vehicle");
+                sim.journal.save(file_name_);
+                recorded = sim.states;
+                frame_count = sim.journal.getFrames().size();
+            }
+            testAssert(frame_count == kSteps + 1, "every reset and update is a frame");
+
+            Sim sim;
+            sim.journal.load(file_name_);
+            testAssert(sim.journal.getFrames().size() == frame_count && sim.journal.getFrames()[0].type == ReplayJournal::FrameType::Reset,
+                       "frames should load back");
+            sim.journal.startReplay();
+            //inputs during replay are ignored
+            sim.journal.setWind(Vector3r(100, 100, 100));
+            while (sim.journal.replayFrame(sim.world))
+                sim.capture();
+            testAssert(sim.journal.getMode() == ReplayJournal::Mode::Idle, "replay should end after the last frame");
+            testAssert(sameStates(sim.states, recorded), "replay should reproduce every state bit for bit");
+        }
+
+        void seedTest()
+        {
+            static constexpr uint kSteps = 300;
+            common_utils::getRandomGeneratorSeedOffset() = 0;
+            Sim first;
+            record(first, kSteps, false);
+
+            common_utils::getRandomGeneratorSeedOffset() = 7;
+            Sim second;
+            record(second, kSteps, false);
+            second.journal.save(file_name_);
+            testAssert(second.journal.getSeedOffset() == 7 && !sameStates(first.states, second.states), "seed offset should change the noise");
+
+            common_utils::getRandomGeneratorSeedOffset() = 0;
+            Sim replayed;
+            replayed.journal.load(file_name_);
+            replayed.journal.startReplay();
+            while (replayed.journal.replayFrame(replayed.world))
+                replayed.capture();
+            testAssert(common_utils::getRandomGeneratorSeedOffset() == 7 && sameStates(replayed.states, second.states),
+                       "replay should restore the seed offset of the recording");
+        }
+
+    private:
+        string file_name_;
+    };
+}
+}
+#endif
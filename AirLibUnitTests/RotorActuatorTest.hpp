@@ -0,0 +1,181 @@
+#ifndef msr_AirLibUnitTests_RotorActuatorTest_hpp
+#define msr_AirLibUnitTests_RotorActuatorTest_hpp
+
+#include <iostream>
+#include <memory>
+#include "TestBase.hpp"
+#include "common/SteppableClock.hpp"
+#include "common/common_utils/Timer.hpp"
+#include "vehicles/multirotor/RotorActuator.hpp"
+
+namespace msr
+{
+namespace airlib
+{
+
+    class RotorActuatorTest : public TestBase
+    {
+    public:
+        virtual void run() override
+        {
+            clock_ = std::make_shared<SteppableClock>(3E-3f);
+            ClockFactory::get(clock_);
+
+            updateAllTest();
+            lookupTableTest();
+        }
+
+        //rotors of many quadrotors stepping on one core
+        virtual void benchmark() override
+        {
+            clock_ = std::make_shared<SteppableClock>(3E-3f);
+            ClockFactory::get(clock_);
+
+            static constexpr uint kVehicles = 1000;
+            static constexpr uint kTicks = 1000;
+
+            RotorParams measured;
+            measured.measured_curve = { { 0, 0, 0, 0 }, { 0.5f, 1.5f, 0.02f, 400 }, { 1, 4.2f, 0.056f, 670 } };
+            vector<std::unique_ptr<Rotors>> vehicles, measured_vehicles;
+            for (uint i = 0; i < kVehicles; ++i) {
+                vehicles.emplace_back(new Rotors());
+                measured_vehicles.emplace_back(new Rotors(measured));
+            }
+
+            common_utils::Timer timer;
+            timer.start();
+            for (uint tick = 0; tick < kTicks; ++tick) {
+                clock_->step();
+                for (auto& vehicle : vehicles) {
+                    vehicle->setControlSignals(tick);
+                    vehicle->updateEach();
+                }
+            }
+            const double each_seconds = timer.seconds();
+
+            timer.start();
+            for (uint tick = 0; tick < kTicks; ++tick) {
+                clock_->step();
+                for (auto& vehicle : vehicles) {
+                    vehicle->setControlSignals(tick);
+                    RotorActuator::updateAll(vehicle->rotors);
+                }
+            }
+            const double all_seconds = timer.seconds();
+
+            timer.start();
+            for (uint tick = 0; tick < kTicks; ++tick) {
+                clock_->step();
+                for (auto& vehicle : measured_vehicles) {
+                    vehicle->setControlSignals(tick);
+                    RotorActuator::updateAll(vehicle->rotors);
+                }
+            }
+            const double measured_seconds = timer.seconds();
+
+            std::cout << "RotorActuator: " << kVehicles << " quadrotors for " << kTicks << " ticks in " << all_seconds * 1E3
+                      << " ms updated together, " << each_seconds * 1E3 << " ms one by one, " << measured_seconds * 1E3
+                      << " ms together with a measured curve" << std::endl;
+        }
+
+    private:
+        //rotors of a quadrotor flying at altitude
+        struct Rotors
+        {
+            Environment environment{ Environment::State(Vector3r(0, 0, -1000), GeoPoint(47.641468, -122.140165, 122)) };
+            vector<RotorActuator> rotors;
+
+            explicit Rotors(const RotorParams& params = RotorParams())
+            {
+                for (uint i = 0; i < 4; ++i)
+                    rotors.emplace_back(Vector3r(i < 2 ? 0.2f : -0.2f, i % 2 ? 0.2f : -0.2f, 0), Vector3r(0, 0, -1),
+                                        i % 2 ? RotorTurningDirection::RotorTurningDirectionCW : RotorTurningDirection::RotorTurningDirectionCCW,
+                                        params, &environment, i);
+                //as MultiRotorPhysicsBody does
+                for (RotorActuator& rotor : rotors)
+                    rotor.shareLookupTable(rotors.front());
+                environment.reset();
+                for (RotorActuator& rotor : rotors)
+                    rotor.reset();
+            }
+
+            void setControlSignals(uint tick)
+            {
+                for (uint i = 0; i < rotors.size(); ++i)
+                    rotors[i].setControlSignal(0.5f + 0.4f * std::sin(tick * 0.01f + i));
+            }
+
+            void updateEach()
+            {
+                for (RotorActuator& rotor : rotors)
+                    rotor.update();
+            }
+        };
+
+        static bool sameOutputs(const RotorActuator& a, const RotorActuator& b)
+        {
+            const RotorActuator::Output &x = a.getOutput(), &y = b.getOutput();
+            return x.thrust == y.thrust && x.torque_scaler == y.torque_scaler && x.speed == y.speed &&
+                   x.control_signal_filtered == y.control_signal_filtered && a.getWrench().force == b.getWrench().force &&
+                   a.getWrench().torque == b.getWrench().torque;
+        }
+
+        void updateAllTest()
+        {
+            Rotors each, all;
+            bool same = true;
+            for (uint tick = 0; tick < 1000; ++tick) {
+                clock_->step();
+                each.setControlSignals(tick);
+                all.setControlSignals(tick);
+                each.updateEach();
+                RotorActuator::updateAll(all.rotors);
+                for (uint i = 0; i < each.rotors.size(); ++i)
+                    same = same && sameOutputs(each.rotors[i], all.rotors[i]);
+            }
+            testAssert(same, "rotors updated together should output the same as updated one by one");
+            testAssert(all.rotors[0].getWrench().force.z() < 0, "rotors should push up");
+        }
+
+        void lookupTableTest()
+        {
+            //motor with thrust rising faster than the model, measured at uneven steps
+            RotorParams params;
+            params.calculateMaxThrust();
+            const vector<real_T> measured_at = { 0, 0.1f, 0.15f, 0.3f, 0.5f, 0.55f, 0.7f, 0.9f, 1 };
+            for (real_T control_signal : measured_at)
+                params.measured_curve.push_back({ control_signal, params.max_thrust * control_signal * control_signal,
+                                                  params.max_torque * control_signal * control_signal, params.max_speed * control_signal });
+
+            RotorLookupTable table;
+            table.initialize(params);
+            real_T max_error = 0;
+            for (real_T control_signal : measured_at) {
+                const RotorLookupTable::Output output = table.lookup(control_signal);
+                max_error = std::max(max_error, std::abs(output.thrust - params.max_thrust * control_signal * control_signal));
+            }
+            testAssert(max_error < 0.01f * params.max_thrust, "table should pass through the measured points");
+            testAssert(table.lookup(-1).thrust == 0 && table.lookup(2).thrust == table.lookup(1).thrust,
+                       "table should hold its ends outside 0 to 1");
+
+            //a rotor with a measured curve settles on it, scaled by air density as the model is
+            Rotors rotors(params);
+            for (uint tick = 0; tick < 100; ++tick) {
+                clock_->step();
+                rotors.rotors[0].setControlSignal(0.5f);
+                RotorActuator::updateAll(rotors.rotors);
+            }
+            const real_T air_density_ratio = rotors.environment.getState().air_density / EarthUtils::getAirDensity(0.0f);
+            const RotorActuator& rotor = rotors.rotors[0];
+            testAssert(std::abs(rotor.getOutput().thrust - params.max_thrust * 0.25f) < 0.01f * params.max_thrust,
+                       "rotor should follow its measured curve");
+            testAssert(air_density_ratio < 1 && std::abs(-rotor.getWrench().force.z() - rotor.getOutput().thrust * air_density_ratio) < 1E-5f,
+                       "measured thrust should be scaled by air density");
+        }
+
+    private:
+        std::shared_ptr<SteppableClock> clock_;
+    };
+}
+}
+#endif
@@ -0,0 +1,115 @@
+#ifndef msr_AirLibUnitTests_RpcLibAdaptorsTest_hpp
+#define msr_AirLibUnitTests_RpcLibAdaptorsTest_hpp
+
+#include <iostream>
+#include "TestBase.hpp"
+#include "api/VehicleApiBase.hpp"
+#include "common/common_utils/Timer.hpp"
+#include "common/common_utils/StrictMode.hpp"
+STRICT_MODE_OFF
+#include "api/RpcLibAdaptorsBase.hpp"
+STRICT_MODE_ON
+
+namespace msr
+{
+namespace airlib
+{
+
+    class RpcLibAdaptorsTest : public TestBase
+    {
+    public:
+        virtual void run() override
+        {
+            lidarTest();
+            imageTest();
+        }
+
+        virtual void benchmark() override
+        {
+            const LidarData lidar = makeLidarData(100000);
+            measure("100k point lidar", RpcLibAdaptorsBase::LidarData(lidar, false), RpcLibAdaptorsBase::LidarData(lidar, true));
+
+            std::vector<ImageCaptureBase::ImageResponse> images(1);
+            images[0].pixels_as_float = true;
+            images[0].image_data_float = common_utils::PooledBuffer<float>(640 * 480);
+            measure("640x480 float image", RpcLibAdaptorsBase::ImageResponse::from(images, false), RpcLibAdaptorsBase::ImageResponse::from(images, true));
+        }
+
+    private:
+        typedef msr::airlib_rpclib::RpcLibAdaptorsBase RpcLibAdaptorsBase;
+
+        template <typename T>
+        T roundTrip(const T& value, size_t* bytes = nullptr)
+        {
+            clmdep_msgpack::sbuffer buffer;
+            clmdep_msgpack::pack(buffer, value);
+            if (bytes)
+                *bytes = buffer.size();
+            clmdep_msgpack::object_handle handle = clmdep_msgpack::unpack(buffer.data(), buffer.size());
+            return handle.get().as<T>();
+        }
+
+        LidarData makeLidarData(size_t points)
+        {
+            LidarData data;
+            data.time_stamp = 1234;
+            for (size_t i = 0; i < points * 3; ++i)
+                data.point_cloud.push_back(static_cast<float>(i) * 0.25f - 100.0f);
+            for (size_t i = 0; i < points; ++i)
+                data.segmentation.push_back(static_cast<int>(i % 7) - 1);
+            return data;
+        }
+
+        void lidarTest()
+        {
+            const LidarData data = makeLidarData(1000);
+            for (bool packed : { false, true }) {
+                size_t bytes;
+                const LidarData result = roundTrip(RpcLibAdaptorsBase::LidarData(data, packed), &bytes).to();
+                testAssert(result.time_stamp == data.time_stamp && result.point_cloud == data.point_cloud && result.segmentation == data.segmentation,
+                           "lidar data should survive round trip");
+                if (packed)
+                    testAssert(bytes < 1000 * 4 * sizeof(float) + 100, "packed lidar data should be raw values plus small header");
+            }
+
+            //unpacking doesn't depend on packed flag so new clients read old servers
+            RpcLibAdaptorsBase::LidarData plain(data, false);
+            clmdep_msgpack::sbuffer buffer;
+            clmdep_msgpack::pack(buffer, plain);
+            clmdep_msgpack::object_handle handle = clmdep_msgpack::unpack(buffer.data(), buffer.size());
+            testAssert(handle.get().as<RpcLibAdaptorsBase::LidarData>().point_cloud.data == data.point_cloud, "plain array should unpack");
+        }
+
+        void imageTest()
+        {
+            std::vector<ImageCaptureBase::ImageResponse> responses(2);
+            responses[0].image_data_uint8 = std::vector<uint8_t>{ 1, 2, 3 };
+            responses[1].pixels_as_float = true;
+            responses[1].image_data_float = common_utils::PooledBuffer<float>(64 * 48);
+            responses[1].image_data_float[5] = 2.5f;
+
+            const auto result = RpcLibAdaptorsBase::ImageResponse::to(roundTrip(RpcLibAdaptorsBase::ImageResponse::from(responses, true)));
+            testAssert(result.size() == 2 && result[0].image_data_uint8.toVector() == responses[0].image_data_uint8.toVector(), "uint8 image should survive round trip");
+            testAssert(result[1].image_data_float.size() == 64 * 48 && result[1].image_data_float[5] == 2.5f, "float image should survive round trip");
+        }
+
+        template <typename T>
+        void measure(const std::string& name, const T& plain, const T& packed)
+        {
+            static constexpr int iterations = 20;
+            common_utils::Timer timer;
+            double times[2];
+            const T* values[2] = { &plain, &packed };
+            for (int k = 0; k < 2; ++k) {
+                timer.start();
+                for (int i = 0; i < iterations; ++i)
+                    roundTrip(*values[k]);
+                times[k] = timer.milliseconds() / iterations;
+            }
+            std::cout << "RpcLibAdaptors: " << name << " pack+unpack plain " << times[0] << " ms, packed " << times[1]
+                      << " ms, " << times[0] / times[1] << "x" << std::endl;
+        }
+    };
+}
+}
+#endif
@@ -0,0 +1,116 @@
+#ifndef msr_AirLibUnitTests_RpcLibClientTest_hpp
+#define msr_AirLibUnitTests_RpcLibClientTest_hpp
+
+#include <thread>
+#include "TestBase.hpp"
+#include "vehicles/multirotor/api/MultirotorRpcLibClient.hpp"
+#include "common/common_utils/Timer.hpp"
+#include "common/common_utils/StrictMode.hpp"
+STRICT_MODE_OFF
+#ifndef RPCLIB_MSGPACK
+#define RPCLIB_MSGPACK clmdep_msgpack
+#endif // !RPCLIB_MSGPACK
+#include "rpc/server.h"
+STRICT_MODE_ON
+
+namespace msr
+{
+namespace airlib
+{
+
+    //runs async tasks against a bare rpc::server whose "takeoff" just sleeps for timeout_sec,
+    //so task overlap shows up directly in wall clock time
+    class RpcLibClientTest : public TestBase
+    {
+    public:
+        virtual void run() override
+        {
+            rpc::server server("127.0.0.1", kPort);
+            server.bind("takeoff", [](float timeout_sec, const std::string& vehicle_name) -> bool {
+                std::this_thread::sleep_for(std::chrono::duration<double>(timeout_sec));
+                return vehicle_name != "fail";
+            });
+            server.async_run(kVehicles + 2);
+
+            pipelineTest();
+            waitAnyTest();
+            poolTest();
+        }
+
+    private:
+        static constexpr uint16_t kPort = 41460;
+        static constexpr int kVehicles = 16;
+        static constexpr float kTaskSec = 0.2f;
+
+        static std::string vehicleName(int i)
+        {
+            return "Drone" + std::to_string(i);
+        }
+
+        void pipelineTest()
+        {
+            MultirotorRpcLibClient client("127.0.0.1", kPort);
+            common_utils::Timer timer;
+            timer.start();
+
+            //calls from several threads on one client each get their own handle
+            vector<RpcLibTaskHandle> tasks(kVehicles);
+            vector<std::thread> threads;
+            for (int i = 0; i < kVehicles; ++i)
+                threads.emplace_back([&client, &tasks, i]() {
+                    client.takeoffAsync(kTaskSec, vehicleName(i), &tasks[i]);
+                });
+            for (auto& thread : threads)
+                thread.join();
+
+            testAssert(RpcLibTaskHandle::waitAll(tasks, 10), "all tasks should finish");
+            const double elapsed = timer.seconds();
+            for (int i = 0; i < kVehicles; ++i) {
+                testAssert(tasks[i].getResult() && tasks[i].getVehicleName() == vehicleName(i), "task should report its own result");
+                testAssert(client.getLastTask(vehicleName(i)).isDone(), "per vehicle handle should be the vehicle's task");
+            }
+            testAssert(elapsed < kTaskSec * kVehicles / 4, "tasks on one connection should run concurrently");
+
+            bool result = false;
+            client.takeoffAsync(0.01f, "fail")->waitOnLastTask(&result);
+            testAssert(!result && !client.getLastTask("missing").valid(), "waitOnLastTask should still return the last result");
+        }
+
+        void waitAnyTest()
+        {
+            MultirotorRpcLibClient client("127.0.0.1", kPort);
+            vector<RpcLibTaskHandle> tasks(2);
+            client.takeoffAsync(2.0f, "slow", &tasks[0]);
+            client.takeoffAsync(0.05f, "fast", &tasks[1]);
+
+            testAssert(RpcLibTaskHandle::waitAny(tasks, 0.01f) == -1, "waitAny should time out while tasks are running");
+            testAssert(RpcLibTaskHandle::waitAny(tasks, 1.0f) == 1, "waitAny should return the task that finished first");
+            testAssert(!RpcLibTaskHandle::waitAll(tasks, 0.1f), "waitAll should time out on the slow task");
+            testAssert(RpcLibTaskHandle::waitAll(tasks), "waitAll without timeout should wait for every task");
+            testAssert(RpcLibTaskHandle::waitAny({ RpcLibTaskHandle() }, 0) == -1, "empty handles are never done");
+        }
+
+        void poolTest()
+        {
+            RpcLibConnectionPool pool("127.0.0.1", kPort, 60, 2);
+            vector<std::unique_ptr<MultirotorRpcLibClient>> clients;
+            for (int i = 0; i < kVehicles; ++i)
+                clients.emplace_back(new MultirotorRpcLibClient(pool));
+
+            common_utils::Timer timer;
+            timer.start();
+            vector<std::thread> threads;
+            for (int i = 0; i < kVehicles; ++i)
+                threads.emplace_back([&clients, i]() {
+                    clients[i]->takeoffAsync(kTaskSec, vehicleName(i))->waitOnLastTask();
+                });
+            for (auto& thread : threads)
+                thread.join();
+
+            testAssert(timer.seconds() < kTaskSec * kVehicles / 4, "clients sharing pooled connections should run concurrently");
+            testAssert(pool.getConnectionCount() == 2, "pool should keep the requested number of connections");
+        }
+    };
+}
+}
+#endif
@@ -0,0 +1,216 @@
+#ifndef msr_AirLibUnitTests_SceneBvhTest_hpp
+#define msr_AirLibUnitTests_SceneBvhTest_hpp
+
+#include <iostream>
+#include <random>
+#include <cmath>
+#include "TestBase.hpp"
+#include "physics/SceneBvh.hpp"
+#include "common/common_utils/Timer.hpp"
+
+namespace msr
+{
+namespace airlib
+{
+
+    class SceneBvhTest : public TestBase
+    {
+    public:
+        virtual void run() override
+        {
+            emptyTest();
+            rayTest();
+            lineOfSightTest();
+            overlapTest();
+            meshTest();
+        }
+
+        virtual void benchmark() override
+        {
+            //rolling terrain as height field, 2 triangles per cell
+            static constexpr uint kCells = 400;
+            static constexpr uint kRays = 1000000;
+
+            vector<float> vertices;
+            vector<uint32_t> indices;
+            for (uint y = 0; y <= kCells; ++y)
+                for (uint x = 0; x <= kCells; ++x) {
+                    vertices.push_back(static_cast<float>(x));
+                    vertices.push_back(static_cast<float>(y));
+                    vertices.push_back(5 * std::sin(x * 0.05f) * std::cos(y * 0.07f));
+                }
+            for (uint y = 0; y < kCells; ++y)
+                for (uint x = 0; x < kCells; ++x) {
+                    const uint32_t i = y * (kCells + 1) + x;
+                    indices.insert(indices.end(), { i, i + 1, i + kCells + 2, i, i + kCells + 2, i + kCells + 1 });
+                }
+
+            SceneBvh bvh;
+            bvh.addTriangles(vertices, indices, "terrain");
+            common_utils::Timer timer;
+            timer.start();
+            bvh.build();
+            const double build_ms = timer.milliseconds();
+
+            std::mt19937 gen(5);
+            std::uniform_real_distribution<real_T> pos(0, static_cast<real_T>(kCells));
+            std::normal_distribution<real_T> dir(0, 1);
+            vector<SceneBvh::Ray> rays;
+            for (uint i = 0; i < kRays; ++i)
+                rays.emplace_back(Vector3r(pos(gen), pos(gen), -10), Vector3r(dir(gen), dir(gen), std::abs(dir(gen)) + 0.1f).normalized(), 100);
+
+            vector<SceneBvh::RayHit> hits;
+            timer.start();
+            bvh.castRays(rays, hits, nullptr);
+            const double single_ms = timer.milliseconds();
+            timer.start();
+            bvh.castRays(rays, hits);
+            const double parallel_ms = timer.milliseconds();
+
+            std::cout << "SceneBvh: " << bvh.getTriangleCount() << " triangles built in " << build_ms << " ms, "
+                      << kRays / single_ms / 1000 << " Mrays/s on one thread, " << kRays / parallel_ms / 1000 << " Mrays/s on "
+                      << common_utils::TaskScheduler::getDefault().getThreadCount() + 1 << " threads" << std::endl;
+        }
+
+    private:
+        //two triangles covering [-size, size] in x and y at height z
+        static void addQuad(SceneBvh& bvh, real_T size, real_T z, const std::string& name)
+        {
+            bvh.addTriangles({ -size, -size, z, size, -size, z, size, size, z, -size, size, z }, { 0, 1, 2, 0, 2, 3 }, name);
+        }
+
+        //closest hit over every triangle, for reference
+        static real_T bruteForceRay(const SceneBvh& bvh, const SceneBvh::Ray& ray)
+        {
+            real_T closest = ray.max_distance;
+            for (uint i = 0; i < bvh.getTriangleCount(); ++i) {
+                Vector3r v0, v1, v2;
+                bvh.getTriangle(i, v0, v1, v2);
+                const Vector3r e1 = v1 - v0, e2 = v2 - v0;
+                const Vector3r p = ray.direction.cross(e2);
+                const real_T det = e1.dot(p);
+                if (std::abs(det) < 1E-12f)
+                    continue;
+                const Vector3r s = ray.origin - v0;
+                const real_T u = s.dot(p) / det;
+                const Vector3r q = s.cross(e1);
+                const real_T v = ray.direction.dot(q) / det;
+                const real_T t = e2.dot(q) / det;
+                if (u >= 0 && v >= 0 && u + v <= 1 && t >= 0 && t < closest)
+                    closest = t;
+            }
+            return closest;
+        }
+
+        void emptyTest()
+        {
+            SceneBvh bvh;
+            bvh.build(nullptr);
+            testAssert(!bvh.castRay(SceneBvh::Ray(Vector3r::Zero(), Vector3r::UnitX())).hit && bvh.getNodeCount() == 0,
+                       "empty scene should not be hit");
+            testAssert(bvh.testLineOfSight(Vector3r::Zero(), Vector3r(10, 0, 0)) && !bvh.overlapsBox(-Vector3r::Ones(), Vector3r::Ones()),
+                       "empty scene should not block anything");
+        }
+
+        void rayTest()
+        {
+            std::mt19937 gen(3);
+            std::uniform_real_distribution<real_T> pos(-50, 50);
+            std::uniform_real_distribution<real_T> offset(-2, 2);
+            std::normal_distribution<real_T> dir(0, 1);
+
+            SceneBvh bvh;
+            vector<float> vertices;
+            vector<uint32_t> indices;
+            for (uint i = 0; i < 3000; ++i) {
+                const Vector3r center(pos(gen), pos(gen), pos(gen));
+                for (int k = 0; k < 3; ++k) {
+                    vertices.push_back(center.x() + offset(gen));
+                    vertices.push_back(center.y() + offset(gen));
+                    vertices.push_back(center.z() + offset(gen));
+                    indices.push_back(static_cast<uint32_t>(indices.size()));
+                }
+            }
+            bvh.addTriangles(vertices, indices, "soup");
+            bvh.build();
+            testAssert(bvh.getTriangleCount() == 3000 && bvh.getNodeCount() < 2 * 3000, "every triangle should be in the tree");
+
+            vector<SceneBvh::Ray> rays;
+            for (int i = 0; i < 1000; ++i)
+                rays.emplace_back(Vector3r(pos(gen), pos(gen), pos(gen)), Vector3r(dir(gen), dir(gen), dir(gen)).normalized(),
+                                  i % 2 ? 40.0f : Utils::max<real_T>());
+            vector<SceneBvh::RayHit> hits;
+            bvh.castRays(rays, hits);
+
+            int hit_count = 0;
+            for (uint i = 0; i < rays.size(); ++i) {
+                const real_T expected = bruteForceRay(bvh, rays[i]);
+                const bool expected_hit = expected < rays[i].max_distance;
+                testAssert(hits[i].hit == expected_hit && (!expected_hit || std::abs(hits[i].distance - expected) < 1E-3f),
+                           "bvh should find the same closest hit as brute force");
+                hit_count += hits[i].hit ? 1 : 0;
+            }
+            testAssert(hit_count > 100, "enough rays should hit to make the comparison meaningful");
+        }
+
+        void lineOfSightTest()
+        {
+            SceneBvh bvh;
+            addQuad(bvh, 5, 0, "floor");
+            bvh.build(nullptr);
+
+            testAssert(!bvh.testLineOfSight(Vector3r(0, 0, -1), Vector3r(1, 1, 1)), "floor should block points on both sides");
+            testAssert(bvh.testLineOfSight(Vector3r(0, 0, -1), Vector3r(3, 3, -0.1f)), "points on one side should see each other");
+            testAssert(bvh.testLineOfSight(Vector3r(0, 0, -1), Vector3r(0, 0, 0)), "surface point should be visible");
+            testAssert(bvh.testLineOfSight(Vector3r(10, 0, -1), Vector3r(10, 0, 1)), "line past the floor edge should be clear");
+
+            const auto hit = bvh.castRay(SceneBvh::Ray(Vector3r(1, 2, -3), Vector3r(0, 0, 1)));
+            testAssert(hit.hit && std::abs(hit.distance - 3) < 1E-5f && (hit.normal - Vector3r(0, 0, -1)).norm() < 1E-5f &&
+                           (hit.point - Vector3r(1, 2, 0)).norm() < 1E-5f,
+                       "hit should report point and normal facing the ray");
+        }
+
+        void overlapTest()
+        {
+            SceneBvh bvh;
+            addQuad(bvh, 5, 0, "floor");
+            //slanted triangle, z = -4 + 0.875 * (y - 2)
+            bvh.addTriangles({ 2, 2, -4, 6, 2, -4, 2, 6, -0.5f }, { 0, 1, 2 }, "slope");
+            bvh.build(nullptr);
+
+            testAssert(bvh.overlapsBox(Vector3r(-1, -1, -0.5f), Vector3r(1, 1, 0.5f)), "box through the floor should overlap");
+            testAssert(!bvh.overlapsBox(Vector3r(-1, -1, -2), Vector3r(1, 1, -1)), "box above the floor should not overlap");
+            testAssert(!bvh.overlapsBox(Vector3r(3.6f, 3.6f, -3.5f), Vector3r(4, 4, -3)), "box inside slope bounds but off its plane should not overlap");
+            testAssert(bvh.overlapsBox(Vector3r(2.5f, 2.5f, -4.5f), Vector3r(3, 3, -3.5f)), "box through the slope should overlap");
+
+            vector<uint> triangles;
+            testAssert(bvh.queryBox(Vector3r(-6, -6, -0.1f), Vector3r(6, 6, 0.1f), triangles) == 2, "query should return both floor triangles");
+            for (uint triangle : triangles)
+                testAssert(bvh.getMeshName(bvh.getTriangleMesh(triangle)) == "floor", "query should return floor triangles only");
+        }
+
+        void meshTest()
+        {
+            //Unreal style export in centimeters, z up, with one bad index
+            MeshPositionVertexBuffersResponse mesh;
+            mesh.name = "Wall_3";
+            mesh.vertices = { 1000, -500, 0, 1000, 500, 0, 1000, 500, 1000, 1000, -500, 1000 };
+            mesh.indices = { 0, 1, 2, 0, 2, 3, 0, 2, 9 };
+
+            SceneBvh bvh;
+            addQuad(bvh, 1, 100, "far");
+            Matrix3x3r unreal_to_ned = Matrix3x3r::Zero();
+            unreal_to_ned.diagonal() << 0.01f, 0.01f, -0.01f;
+            const int mesh_index = bvh.addMesh(mesh, unreal_to_ned);
+            bvh.build(nullptr);
+
+            testAssert(bvh.getTriangleCount() == 4 && bvh.getMeshCount() == 2, "triangle with missing vertex should be skipped");
+            const auto hit = bvh.castRay(SceneBvh::Ray(Vector3r(0, 0, -5), Vector3r(1, 0, 0), 100));
+            testAssert(hit.hit && hit.mesh_index == mesh_index && bvh.getMeshName(hit.mesh_index) == "Wall_3" && std::abs(hit.distance - 10) < 1E-4f,
+                       "converted wall should be 10 m ahead, 0 to 10 m up");
+            testAssert(!bvh.castRay(SceneBvh::Ray(Vector3r(0, 0, 5), Vector3r(1, 0, 0), 100)).hit, "wall should not reach below ground");
+        }
+    };
+}
+}
+#endif
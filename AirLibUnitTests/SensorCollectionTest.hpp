@@ -0,0 +1,171 @@
+#ifndef msr_AirLibUnitTests_SensorCollectionTest_hpp
+#define msr_AirLibUnitTests_SensorCollectionTest_hpp
+
+#include <iostream>
+#include <memory>
+#include "TestBase.hpp"
+#include "common/SteppableClock.hpp"
+#include "common/common_utils/Timer.hpp"
+#include "sensors/SensorCollection.hpp"
+#include "sensors/imu/ImuSimple.hpp"
+#include "sensors/gps/GpsSimple.hpp"
+#include "sensors/barometer/BarometerSimple.hpp"
+#include "sensors/magnetometer/MagnetometerSimple.hpp"
+
+namespace msr
+{
+namespace airlib
+{
+
+    class SensorCollectionTest : public TestBase
+    {
+    public:
+        virtual void run() override
+        {
+            clock_ = std::make_shared<SteppableClock>(3E-3f);
+            ClockFactory::get(clock_);
+
+            scheduleTest();
+            resetTest();
+        }
+
+        //sensors of many vehicles stepping on one core
+        virtual void benchmark() override
+        {
+            clock_ = std::make_shared<SteppableClock>(3E-3f);
+            ClockFactory::get(clock_);
+
+            static constexpr uint kVehicles = 300;
+            static constexpr uint kTicks = 1000;
+
+            vector<std::unique_ptr<Sensors>> vehicles;
+            for (uint i = 0; i < kVehicles; ++i) {
+                vehicles.emplace_back(new Sensors());
+                vehicles.back()->collection.reset();
+            }
+
+            common_utils::Timer timer;
+            timer.start();
+            for (uint tick = 0; tick < kTicks; ++tick) {
+                clock_->step();
+                for (auto& vehicle : vehicles)
+                    vehicle->collection.update();
+            }
+            const double scheduled_seconds = timer.seconds();
+
+            timer.start();
+            for (uint tick = 0; tick < kTicks; ++tick) {
+                clock_->step();
+                for (auto& vehicle : vehicles)
+                    vehicle->updateEach();
+            }
+            const double every_tick_seconds = timer.seconds();
+
+            std::cout << "SensorCollection: " << kVehicles << " vehicles for " << kTicks << " ticks in " << scheduled_seconds * 1E3
+                      << " ms scheduled, " << every_tick_seconds * 1E3 << " ms updating every sensor every tick" << std::endl;
+        }
+
+    private:
+        //sensors of a simple_flight vehicle in a collection, and the same sensors updated every tick
+        //as the collection used to
+        struct Sensors
+        {
+            Kinematics::State kinematics = Kinematics::State::zero();
+            Environment environment{ Environment::State(Vector3r::Zero(), GeoPoint(47.641468, -122.140165, 122)) };
+            ImuSimple imu;
+            GpsSimple gps;
+            BarometerSimple barometer;
+            MagnetometerSimple magnetometer;
+            SensorCollection collection;
+
+            Sensors()
+            {
+                collection.insert(&magnetometer, SensorBase::SensorType::Magnetometer);
+                collection.insert(&gps, SensorBase::SensorType::Gps);
+                collection.insert(&imu, SensorBase::SensorType::Imu);
+                collection.insert(&barometer, SensorBase::SensorType::Barometer);
+                collection.initialize(&kinematics, &environment);
+                environment.reset();
+            }
+
+            void updateEach()
+            {
+                imu.update();
+                gps.update();
+                barometer.update();
+                magnetometer.update();
+            }
+
+            vector<TTimePoint> getOutputTimes() const
+            {
+                return { imu.getOutput().time_stamp, gps.getOutput().time_stamp, barometer.getOutput().time_stamp,
+                         magnetometer.getOutput().time_stamp };
+            }
+        };
+
+        void scheduleTest()
+        {
+            Sensors scheduled, every_tick;
+            scheduled.collection.reset();
+            every_tick.collection.reset();
+
+            //outputs are not set until the first interval is complete
+            vector<TTimePoint> scheduled_times = scheduled.getOutputTimes(), every_tick_times = every_tick.getOutputTimes();
+            uint gps_outputs = 0, barometer_outputs = 0, mismatches = 0;
+            for (uint tick = 0; tick < 1000; ++tick) {
+                clock_->step();
+                scheduled.collection.update();
+                every_tick.updateEach();
+
+                //outputs should change on the same ticks to the same times
+                const vector<TTimePoint> scheduled_now = scheduled.getOutputTimes(), every_tick_now = every_tick.getOutputTimes();
+                for (size_t i = 0; i < scheduled_now.size(); ++i) {
+                    const bool scheduled_changed = scheduled_now[i] != scheduled_times[i];
+                    if (scheduled_changed != (every_tick_now[i] != every_tick_times[i]) ||
+                        (scheduled_changed && scheduled_now[i] != every_tick_now[i]))
+                        ++mismatches;
+                }
+                gps_outputs += scheduled_now[1] != scheduled_times[1];
+                barometer_outputs += scheduled_now[2] != scheduled_times[2];
+
+                scheduled_times = scheduled_now;
+                every_tick_times = every_tick_now;
+            }
+
+            testAssert(mismatches == 0, "scheduled sensors should output on the same ticks as sensors updated every tick");
+            //3 s at 50 Hz on 3 ms ticks, which is every 7th tick, GPS starts after its startup delay of 1 s
+            //and update latency of 0.2 s
+            testAssert(barometer_outputs >= 140 && barometer_outputs <= 150, "barometer should output at its update frequency");
+            testAssert(gps_outputs >= 80 && gps_outputs <= 95, "GPS should start outputting after its startup delay");
+            testAssert(scheduled.gps.getOutput().gnss.geo_point.latitude == every_tick.gps.getOutput().gnss.geo_point.latitude,
+                       "scheduled GPS should output the same position");
+        }
+
+        void resetTest()
+        {
+            Sensors sensors;
+            sensors.collection.reset();
+            clock_->step();
+            sensors.collection.update();
+            clock_->step();
+            sensors.collection.update();
+
+            //sensors that were not due since the first tick still have to be fine with another reset
+            bool thrown = false;
+            try {
+                sensors.collection.reset();
+                clock_->step();
+                sensors.collection.update();
+            }
+            catch (const std::exception&) {
+                thrown = true;
+            }
+            testAssert(!thrown, "collection should reset after ticks where its sensors were not due");
+        }
+
+    private:
+        std::shared_ptr<SteppableClock> clock_;
+    };
+}
+}
+#endif
@@ -0,0 +1,241 @@
+#ifndef msr_AirLibUnitTests_SimpleFlightEkfTest_hpp
+#define msr_AirLibUnitTests_SimpleFlightEkfTest_hpp
+
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include "TestBase.hpp"
+#include "common/SteppableClock.hpp"
+#include "common/common_utils/Timer.hpp"
+#include "physics/World.hpp"
+#include "physics/FastPhysicsEngine.hpp"
+#include "vehicles/multirotor/MultiRotorParamsFactory.hpp"
+#include "vehicles/multirotor/MultiRotorPhysicsBody.hpp"
+#include "vehicles/multirotor/api/MultirotorApiBase.hpp"
+#include "vehicles/multirotor/firmwares/simple_flight/AirSimSimpleFlightEkf.hpp"
+#include "sensors/imu/ImuSimple.hpp"
+#include "sensors/gps/GpsSimple.hpp"
+#include "sensors/barometer/BarometerSimple.hpp"
+#include "sensors/magnetometer/MagnetometerSimple.hpp"
+
+namespace msr
+{
+namespace airlib
+{
+
+    class SimpleFlightEkfTest : public TestBase
+    {
+    public:
+        virtual void run() override
+        {
+            setUp();
+
+            flightTest();
+            snapshotTest();
+
+            tearDown();
+        }
+
+        //filters of many vehicles stepping on one core at IMU rate
+        virtual void benchmark() override
+        {
+            setUp();
+
+            static constexpr uint kVehicles = 100;
+            static constexpr uint kTicks = 1000;
+
+            vector<std::unique_ptr<Estimator>> estimators;
+            for (uint i = 0; i < kVehicles; ++i)
+                estimators.emplace_back(new Estimator());
+
+            common_utils::Timer timer;
+            double seconds = 0;
+            for (uint tick = 0; tick < kTicks; ++tick) {
+                clock_->step();
+                for (auto& estimator : estimators)
+                    estimator->sensors.update();
+
+                timer.start();
+                for (auto& estimator : estimators)
+                    estimator->ekf.update();
+                seconds += timer.seconds();
+            }
+
+            real_T max_position_error = 0;
+            for (const auto& estimator : estimators)
+                max_position_error = std::max(max_position_error, AirSimSimpleFlightCommon::toVector3r(estimator->ekf.getPosition()).norm());
+            testAssert(max_position_error < 0.5f, "estimate of a vehicle at rest should stay put");
+
+            std::cout << "SimpleFlightEkf: " << kVehicles << " vehicles for " << kTicks << " ticks in " << seconds * 1E3 << " ms, "
+                      << seconds * 1E6 / (kVehicles * kTicks) << " us per update" << std::endl;
+
+            tearDown();
+        }
+
+    private:
+        void setUp()
+        {
+            Utils::getSetMinLogLevel(true, 100);
+            AirSimSettings::initializeSettings(R"({ "SettingsVersion": 1.2, "SimMode": "Multirotor",
+                "Vehicles": { "SimpleFlight": { "VehicleType": "SimpleFlight", "StateEstimator": "Ekf" } } })");
+            AirSimSettings::singleton().load([]() { return AirSimSettings::kSimModeTypeMultirotor; });
+            clock_ = std::make_shared<SteppableClock>(3E-3f);
+            ClockFactory::get(clock_);
+        }
+
+        void tearDown()
+        {
+            Utils::getSetMinLogLevel(true);
+        }
+
+        //simple_flight drone flying on the EKF estimate in a world of its own
+        struct Sim
+        {
+            std::unique_ptr<MultiRotorParams> params;
+            std::unique_ptr<MultirotorApiBase> api;
+            Kinematics kinematics{ Kinematics::State::zero() };
+            Environment environment{ Environment::State(Vector3r::Zero(), GeoPoint(47.641468, -122.140165, 122)) };
+            std::unique_ptr<MultiRotorPhysicsBody> vehicle;
+            World world{ std::unique_ptr<PhysicsEngineBase>(new FastPhysicsEngine()) };
+
+            Sim()
+            {
+                params = MultiRotorParamsFactory::createConfig(AirSimSettings::singleton().getVehicleSetting("SimpleFlight"),
+                                                               std::make_shared<SensorFactory>());
+                api = params->createMultirotorApi();
+                vehicle.reset(new MultiRotorPhysicsBody(params.get(), api.get(), &kinematics, &environment));
+                world.insert(vehicle.get());
+                //as the vehicle's sim API does in the simulator, the EKF starts from the kinematics after reset
+                api->setSimulatedGroundTruth(&vehicle->getKinematics(), &vehicle->getEnvironment());
+                kinematics.reset();
+                api->reset();
+                world.reset();
+            }
+
+            //runs a command on another thread as the API server would
+            template <typename Command>
+            void fly(Command command)
+            {
+                std::atomic<bool> done(false);
+                std::thread thread([&]() {
+                    command(*api);
+                    done = true;
+                });
+                while (!done) {
+                    step();
+                    std::this_thread::sleep_for(std::chrono::microseconds(20));
+                }
+                thread.join();
+            }
+
+            //sensors read the environment at the vehicle, which the vehicle's sim API moves in the simulator
+            void step()
+            {
+                world.update();
+                environment.setPosition(state().pose.position);
+                environment.update();
+            }
+
+            void run(real_T seconds)
+            {
+                for (uint frame = 0; frame < static_cast<uint>(seconds / 3E-3f); ++frame)
+                    step();
+            }
+
+            const Kinematics::State& state() const
+            {
+                return vehicle->getKinematics();
+            }
+
+            Kinematics::State estimate() const
+            {
+                return api->getMultirotorState().kinematics_estimated;
+            }
+
+            real_T positionError() const
+            {
+                return (estimate().pose.position - state().pose.position).norm();
+            }
+
+            real_T attitudeError() const
+            {
+                return estimate().pose.orientation.angularDistance(state().pose.orientation);
+            }
+        };
+
+        void flightTest()
+        {
+            Sim sim;
+            //there is no ground without the simulator, the drone falls until it is flown and GPS has no
+            //fix until past its startup delay
+            sim.run(2);
+            testAssert(sim.positionError() < 0.5f && sim.attitudeError() < 0.05f, "estimate should follow the falling drone on IMU and barometer");
+
+            sim.fly([](MultirotorApiBase& api) {
+                api.enableApiControl(true);
+                api.armDisarm(true);
+                api.moveByVelocityZ(3, 1, -10, 5, DrivetrainType::MaxDegreeOfFreedom, YawMode());
+            });
+            testAssert(sim.state().pose.position.z() < -5 && sim.state().pose.position.x() > 5, "drone should fly on the estimate");
+
+            real_T max_position_error = 0, max_attitude_error = 0, max_velocity_error = 0;
+            for (uint sample = 0; sample < 50; ++sample) {
+                sim.run(0.1f);
+                max_position_error = std::max(max_position_error, sim.positionError());
+                max_attitude_error = std::max(max_attitude_error, sim.attitudeError());
+                max_velocity_error = std::max(max_velocity_error,
+                                              (sim.estimate().twist.linear - sim.state().twist.linear).norm());
+            }
+            testAssert(max_position_error < 1.5f, "estimated position should follow ground truth");
+            testAssert(max_velocity_error < 0.5f, "estimated velocity should follow ground truth");
+            testAssert(max_attitude_error < 0.05f, "estimated orientation should follow ground truth");
+        }
+
+        void snapshotTest()
+        {
+            Sim sim;
+            sim.run(2);
+            StateSnapshot snapshot = sim.world.saveSnapshot();
+            sim.run(1);
+            const Kinematics::State first = sim.estimate();
+
+            sim.world.restoreSnapshot(snapshot);
+            sim.run(1);
+            const Kinematics::State second = sim.estimate();
+            testAssert(first.pose.position == second.pose.position && first.pose.orientation.coeffs() == second.pose.orientation.coeffs(),
+                       "restored EKF should estimate the same states");
+        }
+
+        //sensors of a vehicle at rest and an EKF fusing them
+        struct Estimator
+        {
+            Kinematics::State kinematics = Kinematics::State::zero();
+            Environment environment{ Environment::State(Vector3r::Zero(), GeoPoint(47.641468, -122.140165, 122)) };
+            ImuSimple imu;
+            GpsSimple gps;
+            BarometerSimple barometer;
+            MagnetometerSimple magnetometer;
+            SensorCollection sensors;
+            AirSimSimpleFlightEkf ekf{ &sensors };
+
+            Estimator()
+            {
+                sensors.insert(&imu, SensorBase::SensorType::Imu);
+                sensors.insert(&gps, SensorBase::SensorType::Gps);
+                sensors.insert(&barometer, SensorBase::SensorType::Barometer);
+                sensors.insert(&magnetometer, SensorBase::SensorType::Magnetometer);
+                sensors.initialize(&kinematics, &environment);
+                environment.reset();
+                sensors.reset();
+                ekf.setGroundTruthKinematics(&kinematics, &environment);
+                ekf.reset();
+            }
+        };
+
+    private:
+        std::shared_ptr<SteppableClock> clock_;
+    };
+}
+}
+#endif
@@ -0,0 +1,209 @@
+#ifndef msr_AirLibUnitTests_StateSnapshotTest_hpp
+#define msr_AirLibUnitTests_StateSnapshotTest_hpp
+
+#include <iostream>
+#include <cstdio>
+#include <filesystem>
+#include <thread>
+#include <atomic>
+#include "TestBase.hpp"
+#include "common/SteppableClock.hpp"
+#include "common/common_utils/Timer.hpp"
+#include "physics/World.hpp"
+#include "physics/FastPhysicsEngine.hpp"
+#include "vehicles/multirotor/MultiRotorParamsFactory.hpp"
+#include "vehicles/multirotor/MultiRotorPhysicsBody.hpp"
+#include "vehicles/multirotor/api/MultirotorApiBase.hpp"
+
+namespace msr
+{
+namespace airlib
+{
+
+    class StateSnapshotTest : public TestBase
+    {
+    public:
+        virtual void run() override
+        {
+            setUp();
+
+            restoreTest();
+            mismatchTest();
+
+            tearDown();
+        }
+
+        //going back to the start of an episode by restoring against resetting and flying there again
+        virtual void benchmark() override
+        {
+            setUp();
+
+            static constexpr uint kRestores = 1000;
+            Sim sim;
+            common_utils::Timer timer;
+            timer.start();
+            const uint frames = sim.fly();
+            const double fly_seconds = timer.seconds();
+            StateSnapshot snapshot = sim.world.saveSnapshot();
+
+            timer.start();
+            for (uint i = 0; i < kRestores; ++i)
+                sim.world.restoreSnapshot(snapshot);
+            const double restore_seconds = timer.seconds() / kRestores;
+
+            std::cout << "StateSnapshot: " << snapshot.size() << " bytes, restore in " << restore_seconds * 1E6 << " us, reset and "
+                      << frames << " frames of takeoff in " << fly_seconds * 1E3 << " ms, " << fly_seconds / restore_seconds << "x faster" << std::endl;
+
+            tearDown();
+        }
+
+    private:
+        void setUp()
+        {
+            Utils::getSetMinLogLevel(true, 100);
+            //default settings, which have a SimpleFlight vehicle
+            AirSimSettings::initializeSettings("{}");
+            AirSimSettings::singleton().load([]() { return AirSimSettings::kSimModeTypeMultirotor; });
+            file_name_ = (std::filesystem::temp_directory_path() / "airsim_state_snapshot_test.bin").string();
+            clock_ = std::make_shared<SteppableClock>(3E-3f);
+            ClockFactory::get(clock_);
+        }
+
+        void tearDown()
+        {
+            std::remove(file_name_.c_str());
+            Utils::getSetMinLogLevel(true);
+        }
+
+        //simple_flight drone in a world of its own
+        struct Sim
+        {
+            std::unique_ptr<MultiRotorParams> params;
+            std::unique_ptr<MultirotorApiBase> api;
+            Kinematics kinematics{ Kinematics::State::zero() };
+            Environment environment{ Environment::State(Vector3r::Zero(), GeoPoint()) };
+            std::unique_ptr<MultiRotorPhysicsBody> vehicle;
+            World world{ std::unique_ptr<PhysicsEngineBase>(new FastPhysicsEngine()) };
+
+            Sim()
+            {
+                params = MultiRotorParamsFactory::createConfig(AirSimSettings::singleton().getVehicleSetting("SimpleFlight"),
+                                                               std::make_shared<SensorFactory>());
+                api = params->createMultirotorApi();
+                vehicle.reset(new MultiRotorPhysicsBody(params.get(), api.get(), &kinematics, &environment));
+                world.insert(vehicle.get());
+                //as the vehicle's sim API does in the simulator
+                api->setSimulatedGroundTruth(&vehicle->getKinematics(), &vehicle->getEnvironment());
+                api->reset();
+                kinematics.reset();
+                world.reset();
+            }
+
+            //climbs and moves forward with a command running on another thread as the API server would,
+            //returns the number of frames it took
+            uint fly()
+            {
+                std::atomic<bool> done(false);
+                std::thread command([&]() {
+                    api->enableApiControl(true);
+                    api->armDisarm(true);
+                    api->moveByVelocityZ(2, 0, -5, 2, DrivetrainType::MaxDegreeOfFreedom, YawMode());
+                    done = true;
+                });
+                uint frames = 0;
+                while (!done) {
+                    world.update();
+                    ++frames;
+                    std::this_thread::sleep_for(std::chrono::microseconds(20));
+                }
+                command.join();
+                return frames;
+            }
+
+            vector<Kinematics::State> run(uint frames)
+            {
+                vector<Kinematics::State> states;
+                for (uint frame = 0; frame < frames; ++frame) {
+                    world.update();
+                    states.push_back(vehicle->getKinematics());
+                }
+                return states;
+            }
+        };
+
+        static bool sameStates(const vector<Kinematics::State>& a, const vector<Kinematics::State>& b)
+        {
+            if (a.size() != b.size())
+                return false;
+            for (size_t i = 0; i < a.size(); ++i) {
+                const Kinematics::State &x = a[i], &y = b[i];
+                if (x.pose.position != y.pose.position || x.pose.orientation.coeffs() != y.pose.orientation.coeffs() ||
+                    x.twist.linear != y.twist.linear || x.twist.angular != y.twist.angular ||
+                    x.accelerations.linear != y.accelerations.linear || x.accelerations.angular != y.accelerations.angular)
+                    return false;
+            }
+            return true;
+        }
+
+        void restoreTest()
+        {
+            static constexpr uint kFrames = 1000;
+
+            Sim sim;
+            sim.fly();
+            testAssert(sim.vehicle->getKinematics().pose.position.z() < -1, "drone should have taken off");
+
+            StateSnapshot snapshot = sim.world.saveSnapshot();
+            const vector<Kinematics::State> first = sim.run(kFrames);
+
+            //clock is now kFrames steps past the snapshot, which restore has to make up for
+            sim.world.restoreSnapshot(snapshot);
+            testAssert(sameStates(sim.run(kFrames), first), "restored world should fly the same path bit for bit");
+
+            //a new world of the same vehicle starting from a saved file
+            snapshot.save(file_name_);
+            Sim other;
+            StateSnapshot loaded;
+            loaded.load(file_name_);
+            testAssert(loaded.getData() == snapshot.getData(), "snapshot should load back from the file");
+            other.world.restoreSnapshot(loaded);
+            testAssert(sameStates(other.run(kFrames), first), "snapshot should restore into another world with the same settings");
+        }
+
+        void mismatchTest()
+        {
+            Sim sim;
+            StateSnapshot snapshot = sim.world.saveSnapshot();
+
+            World empty(std::unique_ptr<PhysicsEngineBase>(new FastPhysicsEngine()));
+            empty.reset();
+            bool thrown = false;
+            try {
+                empty.restoreSnapshot(snapshot);
+            }
+            catch (const std::exception&) {
+                thrown = true;
+            }
+            testAssert(thrown, "restoring into a world without the vehicle should throw");
+
+            StateSnapshot truncated;
+            vector<uint8_t> data = snapshot.getData();
+            data.resize(data.size() / 2);
+            truncated.setData(data);
+            thrown = false;
+            try {
+                sim.world.restoreSnapshot(truncated);
+            }
+            catch (const std::out_of_range&) {
+                thrown = true;
+            }
+            testAssert(thrown, "restoring a truncated snapshot should throw");
+        }
+
+    private:
+        std::shared_ptr<SteppableClock> clock_;
+        string file_name_;
+    };
+}
+}
+#endif
@@ -0,0 +1,265 @@
+#ifndef msr_AirLibUnitTests_TaskSchedulerTest_hpp
+#define msr_AirLibUnitTests_TaskSchedulerTest_hpp
+
+#include <thread>
+#include <atomic>
+#include <iostream>
+#include <numeric>
+#include <cmath>
+#include "TestBase.hpp"
+#include "common/common_utils/TaskScheduler.hpp"
+#include "common/common_utils/AsyncTasker.hpp"
+#include "common/common_utils/ctpl_stl.h"
+#include "common/common_utils/Timer.hpp"
+
+namespace msr
+{
+namespace airlib
+{
+
+    class TaskSchedulerTest : public TestBase
+    {
+    public:
+        virtual void run() override
+        {
+            common_utils::TaskScheduler::Params params;
+            params.thread_count = 4;
+            common_utils::TaskScheduler scheduler(params);
+
+            parallelForTest(scheduler);
+            reduceTest(scheduler);
+            nestedTest(scheduler);
+            priorityTest();
+            errorTest(scheduler);
+            asyncTaskerTest();
+        }
+
+        virtual void benchmark() override
+        {
+            common_utils::TaskScheduler::Params params;
+            params.thread_count = 4;
+            common_utils::TaskScheduler scheduler(params);
+            benchmarkScheduler(scheduler);
+        }
+
+    private:
+        void parallelForTest(common_utils::TaskScheduler& scheduler)
+        {
+            for (size_t count : { 0, 1, 7, 1000, 100003 }) {
+                std::vector<std::atomic<int>> visits(count);
+                for (auto& visit : visits)
+                    visit = 0;
+                scheduler.parallelFor(0, count, [&](size_t i) { ++visits[i]; });
+
+                bool once = true;
+                for (const auto& visit : visits)
+                    once = once && visit == 1;
+                testAssert(once, "parallelFor should visit each index exactly once");
+            }
+
+            std::atomic<size_t> total{ 0 };
+            scheduler.parallelForRange(
+                10, 1010, [&](size_t begin, size_t end) {
+                    testAssert(end - begin <= 3 && begin >= 10 && end <= 1010, "chunk is outside range or bigger than grain");
+                    total += end - begin;
+                },
+                3);
+            testAssert(total == 1000, "parallelForRange chunks should cover range");
+        }
+
+        void reduceTest(common_utils::TaskScheduler& scheduler)
+        {
+            std::vector<double> values(200000);
+            for (size_t i = 0; i < values.size(); ++i)
+                values[i] = std::sin(static_cast<double>(i)) * 1E6;
+
+            auto sum = [&](size_t grain) {
+                return scheduler.parallelReduce(
+                    0, values.size(), 0.0, [&](size_t begin, size_t end) { return std::accumulate(values.begin() + begin, values.begin() + end, 0.0); }, [](double a, double b) { return a + b; }, grain);
+            };
+
+            //same grain must give bitwise same result regardless of which thread ran which chunk
+            const double first = sum(1000);
+            bool same = true;
+            for (int run = 0; run < 20; ++run)
+                same = same && sum(1000) == first;
+            testAssert(same, "parallelReduce should be deterministic for fixed grain");
+
+            const double serial = std::accumulate(values.begin(), values.end(), 0.0);
+            testAssert(std::abs(sum(0) - serial) < 1E-3, "parallelReduce result is wrong");
+        }
+
+        void nestedTest(common_utils::TaskScheduler& scheduler)
+        {
+            std::atomic<int> count{ 0 };
+            scheduler.parallelFor(0, 64, [&](size_t) {
+                scheduler.parallelFor(0, 64, [&](size_t) {
+                    scheduler.parallelFor(0, 4, [&](size_t) { ++count; });
+                });
+            });
+            testAssert(count == 64 * 64 * 4, "nested parallelFor should run all iterations");
+            testAssert(scheduler.getCurrentWorkerIndex() == -1, "test thread isn't a worker");
+        }
+
+        void priorityTest()
+        {
+            common_utils::TaskScheduler::Params params;
+            params.thread_count = 1;
+            common_utils::TaskScheduler scheduler(params);
+
+            //keep the only worker busy while tasks are queued
+            std::atomic<bool> started{ false }, release{ false };
+            common_utils::TaskGroup blocker;
+            scheduler.submit(blocker, [&] {
+                started = true;
+                while (!release)
+                    std::this_thread::yield();
+            });
+            while (!started)
+                std::this_thread::yield();
+
+            std::mutex order_mutex;
+            std::vector<int> order;
+            common_utils::TaskGroup group;
+            auto record = [&](int value) {
+                return [&order_mutex, &order, value] {
+                    std::lock_guard<std::mutex> lock(order_mutex);
+                    order.push_back(value);
+                };
+            };
+            scheduler.submit(group, record(2), common_utils::TaskPriority::Low);
+            scheduler.submit(group, record(1), common_utils::TaskPriority::Normal);
+            scheduler.submit(group, record(0), common_utils::TaskPriority::High);
+            release = true;
+            //polling instead of wait() so only the worker picks tasks
+            while (!group.isDone())
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            scheduler.wait(blocker);
+
+            testAssert(order == std::vector<int>({ 0, 1, 2 }), "tasks should run in priority order");
+        }
+
+        void errorTest(common_utils::TaskScheduler& scheduler)
+        {
+            common_utils::TaskGroup group;
+            std::atomic<int> completed{ 0 };
+            for (int i = 0; i < 100; ++i) {
+                scheduler.submit(group, [&completed, i] {
+                    if (i == 42)
+                        throw std::runtime_error("task 42 failed");
+                    ++completed;
+                });
+            }
+
+            bool thrown = false;
+            try {
+                scheduler.wait(group);
+            }
+            catch (const std::runtime_error& e) {
+                thrown = std::string(e.what()) == "task 42 failed";
+            }
+            testAssert(thrown, "wait should rethrow exception from group");
+            testAssert(completed == 99, "failing task shouldn't stop other tasks");
+
+            thrown = false;
+            try {
+                scheduler.parallelFor(0, 1000, [](size_t i) {
+                    if (i == 999)
+                        throw std::out_of_range("last");
+                });
+            }
+            catch (const std::out_of_range&) {
+                thrown = true;
+            }
+            testAssert(thrown, "parallelFor should rethrow exception from body");
+
+            std::atomic<int> reported{ 0 };
+            scheduler.setErrorHandler([&reported](std::exception&) { ++reported; });
+            scheduler.submit([] { throw std::runtime_error("ungrouped"); });
+            for (int i = 0; i < 1000 && reported == 0; ++i)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            testAssert(reported == 1, "ungrouped task exception should go to error handler");
+            scheduler.setErrorHandler(nullptr);
+        }
+
+        void asyncTaskerTest()
+        {
+            std::atomic<int> count{ 0 }, errors{ 0 };
+            {
+                AsyncTasker tasker(2);
+                tasker.setErrorHandler([&errors](std::exception&) { ++errors; });
+                tasker.execute([&count] { ++count; }, 10);
+                tasker.execute([] { throw std::runtime_error("tasker"); }, 5);
+            }
+            testAssert(count == 10, "AsyncTasker should run all iterations before destruction completes");
+            testAssert(errors == 1, "AsyncTasker should stop iterations after exception");
+        }
+
+        void benchmarkScheduler(common_utils::TaskScheduler& scheduler)
+        {
+            static constexpr int task_count = 200000;
+            std::atomic<int> sink{ 0 };
+            common_utils::Timer timer;
+
+            timer.start();
+            {
+                ctpl::thread_pool pool(scheduler.getThreadCount());
+                for (int i = 0; i < task_count; ++i)
+                    pool.push([&sink](int) { ++sink; });
+                pool.stop(true);
+            }
+            const double ctpl_rate = task_count / timer.seconds();
+
+            timer.start();
+            common_utils::TaskGroup group;
+            for (int i = 0; i < task_count; ++i)
+                scheduler.submit(group, [&sink] { ++sink; });
+            scheduler.wait(group);
+            const double submit_rate = task_count / timer.seconds();
+
+            //fine grained tasks spawned from inside workers go to local deques
+            timer.start();
+            scheduler.parallelFor(0, 64, [&](size_t) {
+                common_utils::TaskGroup inner;
+                for (int i = 0; i < task_count / 64; ++i)
+                    scheduler.submit(inner, [&sink] { ++sink; });
+                scheduler.wait(inner);
+            });
+            const double nested_rate = task_count / timer.seconds();
+
+            std::cout << "TaskScheduler: " << scheduler.getThreadCount() << " workers, tiny tasks ctpl::thread_pool "
+                      << ctpl_rate << " tasks/sec, submit " << submit_rate << " tasks/sec, nested submit "
+                      << nested_rate << " tasks/sec" << std::endl;
+
+            std::vector<float> data(1 << 22);
+            auto work = [&data](size_t i) { data[i] = std::sqrt(static_cast<float>(i)) * 0.5f + std::sin(static_cast<float>(i)); };
+
+            timer.start();
+            for (size_t i = 0; i < data.size(); ++i)
+                work(i);
+            const double serial_ms = timer.milliseconds();
+
+            timer.start();
+            scheduler.parallelFor(0, data.size(), work);
+            const double parallel_ms = timer.milliseconds();
+
+            timer.start();
+            const double total = scheduler.parallelReduce(
+                0, data.size(), 0.0, [&data](size_t begin, size_t end) {
+                    double sum = 0;
+                    for (size_t i = begin; i < end; ++i)
+                        sum += data[i];
+                    return sum; },
+                [](double a, double b) { return a + b; });
+            const double reduce_ms = timer.milliseconds();
+            unused(total);
+
+            const common_utils::TaskScheduler::Stats stats = scheduler.getStats();
+            std::cout << "TaskScheduler: " << data.size() << " element map serial " << serial_ms << " ms, parallelFor "
+                      << parallel_ms << " ms, parallelReduce " << reduce_ms << " ms, " << stats.executed
+                      << " tasks executed by workers, " << stats.stolen << " stolen" << std::endl;
+        }
+    };
+}
+}
+#endif
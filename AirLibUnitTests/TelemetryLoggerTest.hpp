@@ -0,0 +1,362 @@
+#ifndef msr_AirLibUnitTests_TelemetryLoggerTest_hpp
+#define msr_AirLibUnitTests_TelemetryLoggerTest_hpp
+
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <thread>
+#include <cmath>
+#include "TestBase.hpp"
+#include "common/TelemetryLogger.hpp"
+#include "common/LogFileWriter.hpp"
+#include "common/common_utils/json.hpp"
+#include "common/common_utils/Timer.hpp"
+#ifndef _WIN32
+#include <csignal>
+#include <sys/resource.h>
+#endif
+
+namespace msr
+{
+namespace airlib
+{
+
+    class TelemetryLoggerTest : public TestBase
+    {
+    public:
+        virtual void run() override
+        {
+            setUp();
+
+            roundTripTest();
+            concurrentTest();
+            exportTest();
+            misuseTest();
+#ifndef _WIN32
+            diskFullTest();
+#endif
+
+            tearDown();
+        }
+
+        //1 kHz IMU and state of 50 vehicles, time spent in the loop per record
+        virtual void benchmark() override
+        {
+            setUp();
+
+            static constexpr uint kVehicles = 50;
+            static constexpr uint kTicks = 2000;
+
+            TelemetryLogger logger;
+            vector<uint> imu_channels, state_channels;
+            for (uint v = 0; v < kVehicles; ++v) {
+                imu_channels.push_back(addImuChannel(logger, "vehicle" + std::to_string(v) + "/imu"));
+                state_channels.push_back(addStateChannel(logger, "vehicle" + std::to_string(v) + "/state"));
+            }
+
+            logger.open(path("benchmark.bin"));
+            common_utils::Timer timer;
+            timer.start();
+            for (uint64_t tick = 0; tick < kTicks; ++tick) {
+                const TTimePoint time_stamp = tick * 1000000;
+                for (uint v = 0; v < kVehicles; ++v) {
+                    const Vector3r value(tick * 1E-3f, static_cast<float>(v), 0);
+                    logger.log(imu_channels[v], time_stamp, value, value);
+                    logger.log(state_channels[v], time_stamp, value, Quaternionr::Identity(), 1.0, tick);
+                }
+            }
+            const double binary_ns = timer.seconds() * 1E9 / (2 * kVehicles * kTicks);
+            const uint64_t dropped = logger.getDroppedCount();
+            logger.close();
+
+            //same data through LogFileWriter, a line per record
+            LogFileWriter text(path("benchmark.txt"));
+            timer.start();
+            for (uint64_t tick = 0; tick < kTicks / 10; ++tick) {
+                for (uint v = 0; v < kVehicles; ++v) {
+                    const Vector3r value(tick * 1E-3f, static_cast<float>(v), 0);
+                    text.write(tick);
+                    text.write(value);
+                    text.write(value);
+                    text.endl();
+                    text.write(tick);
+                    text.write(value);
+                    text.write(Quaternionr::Identity());
+                    text.write(1.0);
+                    text.write(tick);
+                    text.endl();
+                }
+            }
+            const double text_ns = timer.seconds() * 1E9 / (2 * kVehicles * kTicks / 10);
+            text.close();
+
+            testAssert(dropped < kVehicles * kTicks / 10, "benchmark should not drop much");
+            std::cout << "TelemetryLogger: ns/record binary vs LogFileWriter: " << binary_ns << " vs " << text_ns
+                      << ", dropped " << dropped << " of " << 2 * kVehicles * kTicks << std::endl;
+
+            tearDown();
+        }
+
+    private:
+        void setUp()
+        {
+            folder_ = (std::filesystem::temp_directory_path() / "airsim_telemetry_test").string();
+            std::filesystem::create_directories(folder_);
+        }
+
+        void tearDown()
+        {
+            std::filesystem::remove_all(folder_);
+        }
+
+        typedef TelemetryLogger::Field Field;
+        typedef TelemetryLogger::FieldType FieldType;
+
+        static uint addStateChannel(TelemetryLogger& logger, const string& name)
+        {
+            vector<Field> fields = TelemetryLogger::vector3Fields("position");
+            const vector<Field> orientation = TelemetryLogger::quaternionFields("orientation");
+            fields.insert(fields.end(), orientation.begin(), orientation.end());
+            fields.push_back(Field("speed", FieldType::Float64));
+            fields.push_back(Field("tick", FieldType::UInt64));
+            return logger.addChannel(name, fields);
+        }
+
+        static uint addImuChannel(TelemetryLogger& logger, const string& name)
+        {
+            vector<Field> fields = TelemetryLogger::vector3Fields("angular_velocity");
+            const vector<Field> acceleration = TelemetryLogger::vector3Fields("linear_acceleration");
+            fields.insert(fields.end(), acceleration.begin(), acceleration.end());
+            return logger.addChannel(name, fields);
+        }
+
+        string path(const string& name) const
+        {
+            return (std::filesystem::path(folder_) / name).string();
+        }
+
+        //every record that log() accepted comes back in order with the same values, across many segments
+        void roundTripTest()
+        {
+            TelemetryLogger::Params params;
+            params.segment_size = 64 * 1024;
+            params.sync_period = 0.001;
+            TelemetryLogger logger(params);
+            const uint state = addStateChannel(logger, "drone/state");
+            const uint flag = logger.addChannel("flag", { Field("value", FieldType::Int32) });
+            testAssert(logger.getChannels()[state].payload_size == 7 * 4 + 8 + 8 && logger.getChannels()[state].record_size == 64, "record size");
+
+            const string file_name = path("round_trip.bin");
+            logger.open(file_name);
+            vector<uint64_t> written;
+            static constexpr uint64_t kTicks = 20000;
+            for (uint64_t i = 0; i < kTicks; ++i) {
+                const Vector3r position(i * 0.5f, -static_cast<float>(i), 1.0f);
+                const Quaternionr orientation(1, 0, 0, i * 1E-4f);
+                if (logger.log(state, 1000 * i, position, orientation, i * 0.25, i))
+                    written.push_back(i);
+                if (i % 3 == 0 && logger.log(flag, 1000 * i, static_cast<int32_t>(-static_cast<int64_t>(i))))
+                    written.push_back(kTicks + i);
+                //give the flush thread a chance now and then, a real physics loop sleeps between ticks
+                if (i % 500 == 0)
+                    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            }
+            const uint64_t record_count = logger.getRecordCount(), dropped_count = logger.getDroppedCount();
+            logger.close();
+            testAssert(record_count == written.size() && record_count + dropped_count == kTicks + (kTicks + 2) / 3, "every record is written or dropped");
+            testAssert(record_count > kTicks / 2, "most records should be written");
+
+            TelemetryReader reader(file_name);
+            testAssert(reader.getChannels().size() == 2 && reader.getChannels()[state].name == "drone/state" &&
+                           reader.getChannels()[state].fields[3].name == "orientation.w" && reader.getChannels()[flag].fields[0].type == FieldType::Int32,
+                       "schema should read back");
+
+            size_t index = 0;
+            bool values_match = true;
+            reader.forEachRecord([&](const TelemetryReader::Record& record) {
+                if (index >= written.size()) {
+                    values_match = false;
+                    return;
+                }
+                const uint64_t id = written[index++];
+                if (id < kTicks) {
+                    values_match &= record.channel == state && record.time_stamp == 1000 * id &&
+                                    reader.getValue(record, 0) == id * 0.5f && reader.getValue(record, 1) == -static_cast<float>(id) &&
+                                    reader.getValue(record, 6) == id * 1E-4f && reader.getValue(record, 7) == id * 0.25 && reader.getValue(record, 8) == id;
+                }
+                else {
+                    const uint64_t i = id - kTicks;
+                    values_match &= record.channel == flag && record.time_stamp == 1000 * i && reader.getValue(record, 0) == -static_cast<double>(i);
+                }
+            });
+            testAssert(values_match && index == written.size(), "records should read back in order");
+        }
+
+        //records of threads logging at once are all there and each thread's are in its own order
+        void concurrentTest()
+        {
+            static constexpr uint kThreads = 4;
+            static constexpr uint64_t kRecords = 50000;
+            TelemetryLogger::Params params;
+            params.segment_size = 256 * 1024;
+            params.sync_period = 0.001;
+            TelemetryLogger logger(params);
+            for (uint t = 0; t < kThreads; ++t)
+                addImuChannel(logger, "imu" + std::to_string(t));
+
+            const string file_name = path("concurrent.bin");
+            logger.open(file_name);
+            vector<std::thread> threads;
+            vector<uint64_t> written(kThreads, 0);
+            for (uint t = 0; t < kThreads; ++t) {
+                threads.emplace_back([&, t]() {
+                    for (uint64_t i = 0; i < kRecords; ++i) {
+                        const Vector3r value(static_cast<float>(i), static_cast<float>(t), 0);
+                        if (logger.log(t, i, value, value))
+                            ++written[t];
+                        if (i % 1000 == 0)
+                            std::this_thread::yield();
+                    }
+                });
+            }
+            for (std::thread& thread : threads)
+                thread.join();
+            logger.close();
+
+            TelemetryReader reader(file_name);
+            vector<uint64_t> counts(kThreads, 0);
+            vector<int64_t> last(kThreads, -1);
+            bool ordered = true;
+            reader.forEachRecord([&](const TelemetryReader::Record& record) {
+                ++counts[record.channel];
+                ordered &= static_cast<int64_t>(record.time_stamp) > last[record.channel] &&
+                           reader.getValue(record, 0) == static_cast<float>(record.time_stamp) && reader.getValue(record, 1) == record.channel;
+                last[record.channel] = static_cast<int64_t>(record.time_stamp);
+            });
+            testAssert(ordered && counts == written, "concurrent records should all read back in per thread order");
+        }
+
+        void exportTest()
+        {
+            TelemetryLogger logger;
+            const uint state = addStateChannel(logger, "drone/state");
+            const uint imu = addImuChannel(logger, "drone/imu");
+            const string file_name = path("export.bin");
+            logger.open(file_name);
+            for (uint64_t i = 0; i < 10; ++i) {
+                logger.log(state, i, Vector3r(0.1f * i, 2, 3), Quaternionr::Identity(), 1.0 / 3, i);
+                if (i % 2 == 0)
+                    logger.log(imu, i, Vector3r(1, 2, 3), Vector3r(4, 5, 6));
+            }
+            logger.close();
+
+            TelemetryReader reader(file_name);
+            const string csv_folder = path("csv"), column_folder = path("columns");
+            reader.exportCsv(csv_folder);
+            reader.exportColumns(column_folder);
+
+            std::ifstream csv((std::filesystem::path(csv_folder) / "drone_state.csv").string());
+            string header, line, last_line;
+            std::getline(csv, header);
+            int lines = 0;
+            while (std::getline(csv, line)) {
+                last_line = line;
+                ++lines;
+            }
+            testAssert(header == "time_stamp,position.x,position.y,position.z,orientation.w,orientation.x,orientation.y,orientation.z,speed,tick",
+                       "csv header should list fields");
+            testAssert(lines == 10 && last_line.rfind("9,", 0) == 0 && last_line.find(",9", last_line.size() - 2) != string::npos, "csv should have a row per record");
+
+            std::ifstream manifest_file((std::filesystem::path(column_folder) / "columns.json").string());
+            nlohmann::json manifest;
+            manifest_file >> manifest;
+            const auto& imu_json = manifest["channels"][imu];
+            testAssert(imu_json["name"] == "drone/imu" && imu_json["rows"] == 5 && imu_json["columns"].size() == 7 && imu_json["columns"][1]["type"] == "float32",
+                       "manifest should describe columns");
+
+            const auto speed_file = std::filesystem::path(column_folder) / manifest["channels"][state]["columns"][8]["file"].get<string>();
+            testAssert(std::filesystem::file_size(speed_file) == 10 * sizeof(double), "column should hold a value per row");
+            std::ifstream speed(speed_file.string(), std::ios::binary);
+            double value = 0;
+            speed.read(reinterpret_cast<char*>(&value), sizeof(value));
+            testAssert(value == 1.0 / 3, "column should hold raw values");
+        }
+
+        void misuseTest()
+        {
+            TelemetryLogger logger;
+            const uint channel = logger.addChannel("one", { Field("value", FieldType::Float32) });
+            testAssert(!logger.log(channel, 0, 1.0f), "closed logger should not accept records");
+
+            logger.open(path("misuse.bin"));
+            bool threw = false;
+            try {
+                logger.log(channel, 0, 1.0);
+            }
+            catch (const std::invalid_argument&) {
+                threw = true;
+            }
+            testAssert(threw, "log with arguments that don't match fields should throw");
+
+            threw = false;
+            try {
+                logger.addChannel("two", {});
+            }
+            catch (const std::logic_error&) {
+                threw = true;
+            }
+            testAssert(threw, "channels can't be added while open");
+            logger.close();
+        }
+
+#ifndef _WIN32
+        //a file size limit fails growing the file as a full disk would: the flush thread must not
+        //throw, writers drop records and what was written before still reads back
+        void diskFullTest()
+        {
+            TelemetryLogger::Params params;
+            params.segment_size = 64 * 1024;
+            params.sync_period = 0.001;
+            TelemetryLogger logger(params);
+            const uint flag = logger.addChannel("flag", { Field("value", FieldType::Int32) });
+
+            const string file_name = path("disk_full.bin");
+            logger.open(file_name);
+            //header and both segments are mapped, the next segment doesn't fit
+            rlimit previous_limit;
+            getrlimit(RLIMIT_FSIZE, &previous_limit);
+            rlimit limit = previous_limit;
+            limit.rlim_cur = static_cast<rlim_t>(std::filesystem::file_size(file_name));
+            const auto previous_handler = std::signal(SIGXFSZ, SIG_IGN);
+            setrlimit(RLIMIT_FSIZE, &limit);
+            Utils::getSetMinLogLevel(true, 100);
+
+            static constexpr int32_t kRecords = 20000;
+            uint64_t written = 0;
+            for (int32_t i = 0; i < kRecords; ++i) {
+                if (logger.log(flag, i, i))
+                    ++written;
+                if (i % 500 == 0)
+                    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            }
+            const string error = logger.getError();
+            const uint64_t dropped = logger.getDroppedCount();
+            logger.close();
+
+            Utils::getSetMinLogLevel(true);
+            setrlimit(RLIMIT_FSIZE, &previous_limit);
+            std::signal(SIGXFSZ, previous_handler);
+
+            testAssert(!error.empty() && dropped > 0 && written + dropped == kRecords, "records past a failed segment should be dropped and the error kept");
+            uint64_t read = 0;
+            TelemetryReader(file_name).forEachRecord([&read](const TelemetryReader::Record&) { ++read; });
+            testAssert(read == written, "records written before the error should read back");
+        }
+#endif
+
+    private:
+        string folder_;
+    };
+}
+}
+#endif
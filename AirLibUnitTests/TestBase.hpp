@@ -16,6 +16,9 @@ namespace airlib
         virtual ~TestBase() = default;
         virtual void run() = 0;
 
+        //timing runs, these are run by AirLibBenchmarks and not with the tests
+        virtual void benchmark() {}
+
         void testAssert(double lhs, double rhs, const std::string& message)
         {
             testAssert(lhs == rhs, message);
@@ -0,0 +1,127 @@
+#ifndef msr_AirLibUnitTests_VectorMathBatchTest_hpp
+#define msr_AirLibUnitTests_VectorMathBatchTest_hpp
+
+#include "TestBase.hpp"
+#include "common/Common.hpp"
+#include "common/VectorMathBatch.hpp"
+#include "common/common_utils/Timer.hpp"
+
+namespace msr
+{
+namespace airlib
+{
+
+    class VectorMathBatchTest : public TestBase
+    {
+    public:
+        virtual void run() override
+        {
+            equivalenceTest();
+        }
+
+        virtual void benchmark() override
+        {
+            benchmarkPoints(100000);
+            benchmarkPoints(1000000);
+        }
+
+    private:
+        Pose randomPose(int seed)
+        {
+            RandomGeneratorR r(-1.0f, 1.0f);
+            r.seed(seed);
+            Quaternionr q(r.next(), r.next(), r.next(), r.next());
+            q.normalize();
+            return Pose(Vector3r(r.next(), r.next(), r.next()) * 100, q);
+        }
+
+        vector<real_T> randomCloud(size_t count)
+        {
+            RandomGeneratorR r(-50.0f, 50.0f);
+            vector<real_T> cloud(count * 3);
+            for (auto& v : cloud)
+                v = r.next();
+            return cloud;
+        }
+
+        bool isClose(const Vector3r& lhs, const Vector3r& rhs)
+        {
+            return (lhs - rhs).norm() <= 1E-4f * std::max(1.0f, rhs.norm());
+        }
+
+        void equivalenceTest()
+        {
+            //odd count to exercise scalar tail after SIMD loop
+            static constexpr size_t count = 1003;
+            const Pose pose = randomPose(1);
+            const vector<real_T> cloud = randomCloud(count);
+
+            vector<real_T> world = cloud;
+            VectorMathBatch::transformToWorldFrame(world, pose);
+            vector<real_T> body = world;
+            VectorMathBatch::transformToBodyFrame(body, pose);
+            vector<real_T> enu = cloud;
+            VectorMathBatch::nedToEnu(enu);
+
+            //SoA
+            vector<real_T> xs(count), ys(count), zs(count);
+            for (size_t i = 0; i < count; ++i) {
+                xs[i] = cloud[i * 3];
+                ys[i] = cloud[i * 3 + 1];
+                zs[i] = cloud[i * 3 + 2];
+            }
+            VectorMathBatch::transformPoints(xs.data(), ys.data(), zs.data(), xs.data(), ys.data(), zs.data(), count,
+                                             VectorMathBatch::AffineTransform::bodyToWorld(pose));
+
+            for (size_t i = 0; i < count; ++i) {
+                const Vector3r p(cloud[i * 3], cloud[i * 3 + 1], cloud[i * 3 + 2]);
+                const Vector3r expected = VectorMath::transformToWorldFrame(p, pose, true);
+
+                testAssert(isClose(Vector3r(world[i * 3], world[i * 3 + 1], world[i * 3 + 2]), expected), "AoS transformToWorldFrame does not match VectorMath");
+                testAssert(isClose(Vector3r(xs[i], ys[i], zs[i]), expected), "SoA transformToWorldFrame does not match VectorMath");
+                testAssert(isClose(Vector3r(body[i * 3], body[i * 3 + 1], body[i * 3 + 2]), p), "transformToBodyFrame is not inverse of transformToWorldFrame");
+                testAssert(isClose(Vector3r(enu[i * 3], enu[i * 3 + 1], enu[i * 3 + 2]), Vector3r(p.y(), p.x(), -p.z())), "nedToEnu is wrong");
+            }
+
+            //composed transform must match applying both
+            const Pose sensor_body = randomPose(2);
+            const auto composed = VectorMathBatch::AffineTransform::bodyToWorld(pose).compose(VectorMathBatch::AffineTransform::bodyToWorld(sensor_body));
+            const Vector3r p(1, 2, 3);
+            testAssert(isClose(composed.apply(p), VectorMath::transformToWorldFrame(VectorMath::transformToWorldFrame(p, sensor_body, true), pose, true)),
+                       "composed transform does not match");
+
+            Pose poses_world[2];
+            const Pose poses_body[2] = { sensor_body, Pose::zero() };
+            VectorMathBatch::composePoses(poses_body, poses_world, 2, pose);
+            const Pose expected_pose = VectorMath::transformToWorldFrame(sensor_body, pose, true);
+            testAssert(isClose(poses_world[0].position, expected_pose.position) &&
+                           poses_world[0].orientation.angularDistance(expected_pose.orientation) < 1E-4f,
+                       "composePoses does not match VectorMath");
+        }
+
+        void benchmarkPoints(size_t count)
+        {
+            const Pose pose = randomPose(3);
+            const vector<real_T> cloud = randomCloud(count);
+            vector<real_T> out(cloud.size());
+
+            common_utils::Timer timer;
+            timer.start();
+            for (size_t i = 0; i < count; ++i) {
+                const Vector3r v = VectorMath::transformToWorldFrame(Vector3r(cloud[i * 3], cloud[i * 3 + 1], cloud[i * 3 + 2]), pose, true);
+                out[i * 3] = v.x();
+                out[i * 3 + 1] = v.y();
+                out[i * 3 + 2] = v.z();
+            }
+            double scalar_ms = timer.milliseconds();
+
+            timer.start();
+            VectorMathBatch::transformPoints(cloud.data(), out.data(), count, VectorMathBatch::AffineTransform::bodyToWorld(pose));
+            double batch_ms = timer.milliseconds();
+
+            std::cout << "VectorMathBatch: " << count << " points, per point " << scalar_ms << " ms, batch " << batch_ms << " ms" << std::endl;
+        }
+    };
+}
+}
+#endif
@@ -4,6 +4,7 @@
 #include "common/WorkerThread.hpp"
 #include "common/common_utils/Timer.hpp"
 #include <chrono>
+#include <iostream>
 #include "TestBase.hpp"
 
 namespace msr
@@ -46,8 +47,88 @@ namespace airlib
             std::atomic<unsigned int> counter_;
         };
 
+        class NoopItem : public CancelableAction
+        {
+        public:
+            virtual void executeAction() override
+            {
+            }
+        };
+
+        //how WorkerThreadSignal::wait used to wait, checking the cancel predicate every millisecond
+        class PollingSignal
+        {
+        public:
+            void signal()
+            {
+                {
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    signaled_ = true;
+                }
+                cv_.notify_one();
+            }
+
+            template <class _Predicate>
+            bool wait(_Predicate cancel)
+            {
+                while (!signaled_) {
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    cv_.wait_for(lock, std::chrono::milliseconds(1), [cancel] {
+                        return cancel();
+                    });
+                }
+                signaled_ = false;
+                return true;
+            }
+
+            void notifyCancel()
+            {
+            }
+
+        private:
+            std::condition_variable cv_;
+            std::mutex mutex_;
+            std::atomic<bool> signaled_{ false };
+        };
+
     public:
         virtual void run() override
+        {
+            //enqueueAndWait times out on the sim clock, which other tests may have left stepped
+            ClockFactory::get(std::make_shared<ScalableClock>());
+
+            enqueueTest();
+            signalTest();
+        }
+
+        virtual void benchmark() override
+        {
+            ClockFactory::get(std::make_shared<ScalableClock>());
+
+            static constexpr uint kCommands = 200;
+            static constexpr double kPeriod = 1.0 / 200; //200 Hz
+
+            const double event_latency = measureWakeLatency<WorkerThreadSignal>(kCommands, kPeriod);
+            const double polling_latency = measureWakeLatency<PollingSignal>(kCommands, kPeriod);
+
+            //commands that finish at once, which enqueueAndWait used to hold for the whole timeout
+            WorkerThread thread;
+            uint completed = 0;
+            common_utils::Timer timer;
+            timer.start();
+            for (uint i = 0; i < kCommands; ++i) {
+                if (thread.enqueueAndWait(std::make_shared<NoopItem>(), 1))
+                    ++completed;
+            }
+            const double round_trip = timer.seconds() / kCommands;
+
+            std::cout << "WorkerThreadSignal: wake up in " << event_latency * 1E6 << " us against " << polling_latency * 1E6
+                      << " us with 1 ms polling at 200 Hz, enqueueAndWait round trip " << round_trip * 1E6 << " us" << std::endl;
+            testAssert(completed == kCommands, "enqueueAndWait should have completed every command");
+        }
+
+    private:
+        void enqueueTest()
         {
             WorkerThread thread;
 
@@ -103,19 +184,97 @@ namespace airlib
 
             common_utils::Timer timer;
             timer.start();
-            thread.enqueueAndWait(item1, 0.5);
+            bool completed = thread.enqueueAndWait(item1, 0.5);
             double elapsed = timer.seconds();
-            testAssert(elapsed >= 0.5 && elapsed < 1 && item1->isCancelled() && !item1->isComplete(),
+            testAssert(!completed && elapsed >= 0.5 && elapsed < 1 && item1->isCancelled() && !item1->isComplete(),
                        "enqueueAndWait waited too long, should have timed out");
 
             item2->reset();
             item2->runTime = 0.5; // half a second
             timer.start();
-            thread.enqueueAndWait(item2, 2);
+            completed = thread.enqueueAndWait(item2, 2);
             elapsed = timer.seconds();
-            testAssert(elapsed >= 0.5 && elapsed < 1 && !item2->isCancelled() && item2->isComplete(),
+            testAssert(completed && elapsed >= 0.5 && elapsed < 1 && !item2->isCancelled() && item2->isComplete(),
                        "enqueueAndWait waited too long, task should have completed in 0.5 seconds");
         }
+
+        void signalTest()
+        {
+            WorkerThreadSignal signal;
+            common_utils::Timer timer;
+
+            signal.signal();
+            testAssert(signal.waitFor(0), "wait after signal should return at once");
+            timer.start();
+            testAssert(!signal.waitFor(0.05) && timer.seconds() >= 0.05, "waitFor should time out without a signal");
+
+            //cancel wakes the wait without a signal, a wait that misses it is signaled after 5 s
+            std::atomic<bool> cancelled(false);
+            std::atomic<bool> signaled(true);
+            std::atomic<bool> woken(false);
+            std::thread waiter([&]() {
+                signaled = signal.wait([&cancelled] { return static_cast<bool>(cancelled); });
+                woken = true;
+            });
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            cancelled = true;
+            signal.notifyCancel();
+            timer.start();
+            while (!woken && timer.seconds() < 5)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            if (!woken)
+                signal.signal();
+            waiter.join();
+            testAssert(!signaled, "cancel should wake the wait without a signal");
+
+            //cancel of the pending item wakes enqueueAndWait before its timeout
+            WorkerThread thread;
+            std::shared_ptr<WorkItem> item1 = std::make_shared<WorkItem>();
+            std::shared_ptr<WorkItem> item2 = std::make_shared<WorkItem>();
+            item1->runTime = item2->runTime = 5;
+            std::thread canceller([&]() {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                thread.enqueue(item2);
+            });
+            timer.start();
+            const bool completed = thread.enqueueAndWait(item1, 5);
+            const double elapsed = timer.seconds();
+            canceller.join();
+            testAssert(!completed && elapsed < 4, "enqueueAndWait should return before its timeout when its item is replaced");
+        }
+
+        //signal to wake up latency of a thread waiting for commands at a rate API clients send them
+        template <class TSignal>
+        static double measureWakeLatency(uint count, double period_sec)
+        {
+            TSignal signal;
+            std::atomic<bool> stop(false);
+            std::atomic<int64_t> sent_nanos(0);
+            double total_sec = 0;
+
+            std::thread consumer([&]() {
+                while (signal.wait([&stop] { return static_cast<bool>(stop); }) && !stop) {
+                    const int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                            std::chrono::steady_clock::now().time_since_epoch())
+                                            .count();
+                    total_sec += (now - sent_nanos) * 1E-9;
+                }
+            });
+
+            for (uint i = 0; i < count; ++i) {
+                std::this_thread::sleep_for(std::chrono::duration<double>(period_sec));
+                sent_nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                 std::chrono::steady_clock::now().time_since_epoch())
+                                 .count();
+                signal.signal();
+            }
+            std::this_thread::sleep_for(std::chrono::duration<double>(period_sec));
+            stop = true;
+            signal.notifyCancel();
+            signal.signal();
+            consumer.join();
+            return total_sec / count;
+        }
     };
 }
 }
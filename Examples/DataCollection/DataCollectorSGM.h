@@ -6,14 +6,17 @@
 #include <iostream>
 #include <iomanip>
 #include "common/Common.hpp"
-#include "common/common_utils/ProsumerQueue.hpp"
 #include "common/common_utils/FileSystem.hpp"
 #include "common/ClockFactory.hpp"
 #include "vehicles/multirotor/api/MultirotorRpcLibClient.hpp"
 #include "vehicles/multirotor/api/MultirotorApiBase.hpp"
 #include "RandomPointPoseGeneratorNoRoll.h"
+#include "DatasetPipeline.hpp"
 #include "../../SGM/src/sgmstereo/sgmstereo.h"
 #include "../../SGM/src/stereoPipeline/StateStereo.h"
+//PNGs are encoded in to memory by encode workers and written to archive by the pipeline
+#define SVPNG_OUTPUT std::vector<uint8_t>& png
+#define SVPNG_PUT(u) png.push_back(static_cast<uint8_t>(u))
 #include "writePNG.h"
 STRICT_MODE_OFF
 #ifndef RPCLIB_MSGPACK
@@ -33,85 +36,63 @@ private:
     float f = w / (2 * tan(fov / 2));
 
 public:
-    DataCollectorSGM(std::string storage_dir)
-        : storage_dir_(storage_dir)
+    //each vehicle gets its own client and capture thread so captures are in flight in parallel
+    DataCollectorSGM(std::string storage_dir, const std::vector<std::string>& vehicle_names = { "" })
+        : storage_dir_(storage_dir), vehicle_names_(vehicle_names)
     {
+        if (vehicle_names_.size() == 0)
+            throw std::invalid_argument("At least one vehicle name is required, use empty name for default vehicle");
         FileSystem::ensureFolder(storage_dir);
-        FileSystem::ensureFolder(FileSystem::combine(storage_dir, "left"));
-        FileSystem::ensureFolder(FileSystem::combine(storage_dir, "right"));
-        FileSystem::ensureFolder(FileSystem::combine(storage_dir, "depth_gt"));
-        FileSystem::ensureFolder(FileSystem::combine(storage_dir, "disparity_gt"));
-        FileSystem::ensureFolder(FileSystem::combine(storage_dir, "disparity_gt_viz"));
-        FileSystem::ensureFolder(FileSystem::combine(storage_dir, "depth_sgm"));
-        FileSystem::ensureFolder(FileSystem::combine(storage_dir, "disparity_sgm"));
-        FileSystem::ensureFolder(FileSystem::combine(storage_dir, "disparity_sgm_viz"));
-        FileSystem::ensureFolder(FileSystem::combine(storage_dir, "confidence_sgm"));
+    }
+
+    DatasetPipeline::Params& getPipelineParams()
+    {
+        return pipeline_params_;
     }
 
     int generate(int num_samples)
     {
-        msr::airlib::MultirotorRpcLibClient client;
-        client.confirmConnection();
-        client.reset();
+        msr::airlib::ClockBase* clock = msr::airlib::ClockFactory::get();
+        const int seed = static_cast<int>(clock->nowNanos());
+
+        std::vector<std::unique_ptr<msr::airlib::MultirotorRpcLibClient>> clients;
+        std::vector<std::unique_ptr<RandomPointPoseGeneratorNoRoll>> pose_generators;
+        std::vector<DatasetPipeline::CaptureFunc> capturers;
+        for (unsigned int i = 0; i < vehicle_names_.size(); ++i) {
+            clients.emplace_back(new msr::airlib::MultirotorRpcLibClient());
+            clients.back()->confirmConnection();
+            pose_generators.emplace_back(new RandomPointPoseGeneratorNoRoll(seed + i));
+
+            msr::airlib::MultirotorRpcLibClient* client = clients.back().get();
+            RandomPointPoseGeneratorNoRoll* pose_generator = pose_generators.back().get();
+            const std::string vehicle_name = vehicle_names_[i];
+            capturers.push_back([client, pose_generator, vehicle_name](DatasetPipeline::Sample& sample) {
+                return capture(*client, *pose_generator, vehicle_name, sample);
+            });
+        }
+        clients.front()->reset();
 
-        std::vector<ImageRequest> request = {
-            ImageRequest("front_left", ImageType::Scene, false, false),
-            ImageRequest("front_right", ImageType::Scene, false, false),
-            ImageRequest("front_left", ImageType::DepthPlanar, true),
-            ImageRequest("front_left", ImageType::DisparityNormalized, true)
-        };
-        const std::vector<ImageResponse>& response_init = client.simGetImages(request);
+        const std::vector<ImageResponse>& response_init = clients.front()->simGetImages(getImageRequest(), vehicle_names_.front());
         w = response_init.at(0).width;
         h = response_init.at(0).height;
 
-        msr::airlib::ClockBase* clock = msr::airlib::ClockFactory::get();
-        RandomPointPoseGeneratorNoRoll pose_generator(static_cast<int>(clock->nowNanos()));
-        std::fstream file_list(FileSystem::combine(storage_dir_, "files_list.txt"),
-                               std::ios::out | std::ios::in | std::ios_base::app);
-
-        int sample = getImageCount(file_list);
+        int sample = getImageCount(FileSystem::combine(storage_dir_, "files_list.txt"));
 
-        p_state = new CStateStereo();
-        p_state->Initialize(params, h, w);
+        //SGM state is not thread safe so each encode worker gets its own
+        p_states.clear();
+        dtimes.assign(pipeline_params_.encode_workers, 0.0f);
+        for (unsigned int i = 0; i < pipeline_params_.encode_workers; ++i) {
+            p_states.emplace_back(new CStateStereo());
+            p_states.back()->Initialize(params, h, w);
+        }
         //Print SGM parameters
         params.Print();
 
+        DatasetPipeline pipeline(storage_dir_, pipeline_params_);
         try {
-            while (sample < num_samples) {
-
-                pose_generator.next();
-                client.simSetVehiclePose(Pose(pose_generator.position, pose_generator.orientation), true);
-
-                const auto& collision_info = client.simGetCollisionInfo();
-                if (collision_info.has_collided) {
-                    std::cout << "Collision at " << VectorMath::toString(collision_info.position) << std::endl;
-                    continue;
-                }
-                ++sample;
-                //Get into position
-                clock->sleep_for(0.5);
-
-                auto start_nanos = clock->nowNanos();
-
-                const std::vector<ImageResponse>& response = client.simGetImages(request);
-                if (response.size() != 4) {
-                    std::cout << "Images were not received!" << std::endl;
-                    start_nanos = clock->nowNanos();
-                    continue;
-                }
-
-                ImagesResult result;
-                result.file_list = &file_list;
-                result.response = response;
-                result.sample = sample;
-                result.render_time = clock->elapsedSince(start_nanos);
-                ;
-                result.storage_dir_ = storage_dir_;
-                result.position = pose_generator.position;
-                result.orientation = pose_generator.orientation;
-
-                processImages(&result);
-            }
+            pipeline.run(capturers, [this](unsigned int worker, DatasetPipeline::Sample& sample, DatasetPipeline::EncodedSample& encoded) { processImages(worker, sample, encoded); },
+                         sample + 1,
+                         num_samples);
         }
         catch (rpc::timeout& t) {
             // will display a message like
@@ -136,64 +117,87 @@ private:
     typedef msr::airlib::ImageCaptureBase::ImageType ImageType;
 
     std::string storage_dir_;
+    std::vector<std::string> vehicle_names_;
+    DatasetPipeline::Params pipeline_params_;
     bool spawn_ue4 = false;
     SGMOptions params;
-    CStateStereo* p_state;
+    //one per encode worker
+    std::vector<std::unique_ptr<CStateStereo>> p_states;
+    std::vector<float> dtimes;
     //Image resolution
     int w;
     int h;
-    float dtime = 0;
 
 private:
-    struct ImagesResult
+    static std::vector<ImageRequest> getImageRequest()
     {
-        std::vector<ImageResponse> response;
-        msr::airlib::TTimeDelta render_time;
-        std::string storage_dir_;
-        std::fstream* file_list;
-        int sample;
-        Vector3r position;
-        Quaternionr orientation;
-    };
-
-    static int getImageCount(std::fstream& file_list)
+        return {
+            ImageRequest("front_left", ImageType::Scene, false, false),
+            ImageRequest("front_right", ImageType::Scene, false, false),
+            ImageRequest("front_left", ImageType::DepthPlanar, true),
+            ImageRequest("front_left", ImageType::DisparityNormalized, true)
+        };
+    }
+
+    static int getImageCount(const std::string& file_list_path)
     {
+        std::ifstream file_list(file_list_path);
         int sample = 0;
         std::string line;
         while (std::getline(file_list, line))
             ++sample;
-        if (file_list.eof())
-            file_list.clear(); //otherwise we can't do any further I/O
-        else if (file_list.bad()) {
+        if (file_list.bad()) {
             throw std::runtime_error("Error occurred while reading files_list.txt");
         }
 
         return sample;
     }
 
-    void processImages(ImagesResult* result)
+    //runs on capture thread of the vehicle
+    static bool capture(msr::airlib::MultirotorRpcLibClient& client, RandomPointPoseGeneratorNoRoll& pose_generator,
+                        const std::string& vehicle_name, DatasetPipeline::Sample& sample)
     {
+        pose_generator.next();
+        sample.pose = Pose(pose_generator.position, pose_generator.orientation);
+        client.simSetVehiclePose(sample.pose, true, vehicle_name);
+
+        const auto& collision_info = client.simGetCollisionInfo(vehicle_name);
+        if (collision_info.has_collided) {
+            std::cout << "Collision at " << VectorMath::toString(collision_info.position) << std::endl;
+            return false;
+        }
+        //Get into position
+        msr::airlib::ClockFactory::get()->sleep_for(0.5);
 
-        msr::airlib::ClockBase* clock = msr::airlib::ClockFactory::get();
+        sample.response = client.simGetImages(getImageRequest(), vehicle_name);
+        if (sample.response.size() != 4) {
+            std::cout << "Images were not received!" << std::endl;
+            return false;
+        }
+        return true;
+    }
 
-        auto process_time = clock->nowNanos();
+    //runs on encode worker
+    void processImages(unsigned int worker, DatasetPipeline::Sample& sample, DatasetPipeline::EncodedSample& encoded)
+    {
+        CStateStereo* p_state = p_states.at(worker).get();
 
         //Initialize file names
-        std::string left_file_name = Utils::stringf("left/%06d.png", result->sample);
-        std::string right_file_name = Utils::stringf("right/%06d.png", result->sample);
-        std::string depth_gt_file_name = Utils::stringf("depth_gt/%06d.pfm", result->sample);
-        std::string disparity_gt_file_name = Utils::stringf("disparity_gt/%06d.pfm", result->sample);
-        std::string disparity_gt_viz_file_name = Utils::stringf("disparity_gt_viz/%06d.png", result->sample);
-        std::string depth_sgm_file_name = Utils::stringf("depth_sgm/%06d.pfm", result->sample);
-        std::string disparity_sgm_file_name = Utils::stringf("disparity_sgm/%06d.pfm", result->sample);
-        std::string disparity_sgm_viz_file_name = Utils::stringf("disparity_sgm_viz/%06d.png", result->sample);
-        std::string confidence_sgm_file_name = Utils::stringf("confidence_sgm/%06d.png", result->sample);
+        std::string left_file_name = Utils::stringf("left/%06d.png", sample.index);
+        std::string right_file_name = Utils::stringf("right/%06d.png", sample.index);
+        std::string depth_gt_file_name = Utils::stringf("depth_gt/%06d.pfm", sample.index);
+        std::string disparity_gt_file_name = Utils::stringf("disparity_gt/%06d.pfm", sample.index);
+        std::string disparity_gt_viz_file_name = Utils::stringf("disparity_gt_viz/%06d.png", sample.index);
+        std::string depth_sgm_file_name = Utils::stringf("depth_sgm/%06d.pfm", sample.index);
+        std::string disparity_sgm_file_name = Utils::stringf("disparity_sgm/%06d.pfm", sample.index);
+        std::string disparity_sgm_viz_file_name = Utils::stringf("disparity_sgm_viz/%06d.png", sample.index);
+        std::string confidence_sgm_file_name = Utils::stringf("confidence_sgm/%06d.png", sample.index);
 
         //Initialize data containers
         std::vector<uint8_t> left_img(h * w * 3);
         std::vector<uint8_t> right_img(h * w * 3);
-        std::vector<float> gt_depth_data = result->response.at(2).image_data_float;
-        std::vector<float> gt_disparity_data = result->response.at(3).image_data_float;
+        common_utils::PooledBuffer<float>& gt_depth_data = sample.response.at(2).image_data_float;
+        common_utils::PooledBuffer<float>& gt_disparity_data = sample.response.at(3).image_data_float;
         std::vector<float> sgm_depth_data(h * w);
         std::vector<float> sgm_disparity_data(h * w);
         std::vector<uint8_t> sgm_confidence_data(h * w);
@@ -205,12 +209,12 @@ private:
                 counter++;
                 continue;
             }
-            left_img[idx - counter] = result->response.at(0).image_data_uint8[idx];
-            right_img[idx - counter] = result->response.at(1).image_data_uint8[idx];
+            left_img[idx - counter] = sample.response.at(0).image_data_uint8[idx];
+            right_img[idx - counter] = sample.response.at(1).image_data_uint8[idx];
         }
 
         //Get SGM disparity and confidence
-        p_state->ProcessFrameAirSim(result->sample, dtime, left_img, right_img);
+        p_state->ProcessFrameAirSim(sample.index, dtimes.at(worker), left_img, right_img);
 
         //Get adjust SGM disparity and compute depth
         for (int idx = 0; idx < (h * w); idx++) {
@@ -222,48 +226,45 @@ private:
             sgm_confidence_data[idx] = p_state->confMap[idx];
         }
 
-        //Write files to disk
+        //Encode files, pipeline writes them to archive
         //Left and right RGB image
-        FILE* img_l = fopen(FileSystem::combine(result->storage_dir_, left_file_name).c_str(), "wb");
-        svpng(img_l, w, h, reinterpret_cast<const unsigned char*>(left_img.data()), 0);
-        fclose(img_l);
-        FILE* img_r = fopen(FileSystem::combine(result->storage_dir_, right_file_name).c_str(), "wb");
-        svpng(img_r, w, h, reinterpret_cast<const unsigned char*>(right_img.data()), 0);
-        fclose(img_r);
+        addFile(encoded, left_file_name);
+        svpng(encoded.files.back().second, w, h, reinterpret_cast<const unsigned char*>(left_img.data()), 0);
+        addFile(encoded, right_file_name);
+        svpng(encoded.files.back().second, w, h, reinterpret_cast<const unsigned char*>(right_img.data()), 0);
 
         //GT disparity and depth
-        Utils::writePFMfile(gt_depth_data.data(), w, h, FileSystem::combine(result->storage_dir_, depth_gt_file_name));
+        addFile(encoded, depth_gt_file_name);
+        Utils::writePFMbuffer(gt_depth_data.data(), w, h, encoded.files.back().second);
         denormalizeDisparity(gt_disparity_data, w);
-        Utils::writePFMfile(gt_disparity_data.data(), w, h, FileSystem::combine(result->storage_dir_, disparity_gt_file_name));
+        addFile(encoded, disparity_gt_file_name);
+        Utils::writePFMbuffer(gt_disparity_data.data(), w, h, encoded.files.back().second);
 
         //SGM depth disparity and confidence
-        Utils::writePFMfile(sgm_depth_data.data(), w, h, FileSystem::combine(result->storage_dir_, depth_sgm_file_name));
-        Utils::writePFMfile(sgm_disparity_data.data(), w, h, FileSystem::combine(result->storage_dir_, disparity_sgm_file_name));
-        FILE* sgm_c = fopen(FileSystem::combine(result->storage_dir_, confidence_sgm_file_name).c_str(), "wb");
-        svpng(sgm_c, w, h, reinterpret_cast<const unsigned char*>(sgm_confidence_data.data()), 0, 1);
-        fclose(sgm_c);
+        addFile(encoded, depth_sgm_file_name);
+        Utils::writePFMbuffer(sgm_depth_data.data(), w, h, encoded.files.back().second);
+        addFile(encoded, disparity_sgm_file_name);
+        Utils::writePFMbuffer(sgm_disparity_data.data(), w, h, encoded.files.back().second);
+        addFile(encoded, confidence_sgm_file_name);
+        svpng(encoded.files.back().second, w, h, reinterpret_cast<const unsigned char*>(sgm_confidence_data.data()), 0, 1);
 
         //GT and SGM disparity for visualization
         std::vector<uint8_t> sgm_disparity_viz(h * w * 3);
         getColorVisualization(sgm_disparity_data, sgm_disparity_viz, h, w, 0.05f * w);
-        FILE* disparity_sgm = fopen(FileSystem::combine(result->storage_dir_, disparity_sgm_viz_file_name).c_str(), "wb");
-        svpng(disparity_sgm, w, h, reinterpret_cast<const unsigned char*>(sgm_disparity_viz.data()), 0);
-        fclose(disparity_sgm);
+        addFile(encoded, disparity_sgm_viz_file_name);
+        svpng(encoded.files.back().second, w, h, reinterpret_cast<const unsigned char*>(sgm_disparity_viz.data()), 0);
         std::vector<uint8_t> gt_disparity_viz(h * w * 3);
         getColorVisualization(gt_disparity_data, gt_disparity_viz, h, w, 0.05f * w);
-        FILE* disparity_gt = fopen(FileSystem::combine(result->storage_dir_, disparity_gt_viz_file_name).c_str(), "wb");
-        svpng(disparity_gt, w, h, reinterpret_cast<const unsigned char*>(gt_disparity_viz.data()), 0);
-        fclose(disparity_gt);
+        addFile(encoded, disparity_gt_viz_file_name);
+        svpng(encoded.files.back().second, w, h, reinterpret_cast<const unsigned char*>(gt_disparity_viz.data()), 0);
 
         //Add all to file record
-        (*result->file_list) << left_file_name << "," << right_file_name << "," << depth_gt_file_name << "," << disparity_gt_file_name << "," << depth_sgm_file_name << "," << disparity_sgm_file_name << "," << confidence_sgm_file_name << std::endl;
-
-        std::cout << "Image #" << result->sample
-                  << " pos:" << VectorMath::toString(result->position)
-                  << " ori:" << VectorMath::toString(result->orientation)
-                  << " render time " << result->render_time * 1E3f << "ms"
-                  << " process time " << clock->elapsedSince(process_time) * 1E3f << " ms"
-                  << std::endl;
+        encoded.list_entry = left_file_name + "," + right_file_name + "," + depth_gt_file_name + "," + disparity_gt_file_name + "," + depth_sgm_file_name + "," + disparity_sgm_file_name + "," + confidence_sgm_file_name;
+    }
+
+    static void addFile(DatasetPipeline::EncodedSample& encoded, const std::string& name)
+    {
+        encoded.files.emplace_back(name, std::vector<uint8_t>());
     }
 
     void getcolor(float d, float max_d, float& r, float& g, float& b)
@@ -323,13 +324,6 @@ private:
         }
     }
 
-    static void saveImageToFile(const std::vector<uint8_t>& image_data, const std::string& file_name)
-    {
-        std::ofstream file(file_name, std::ios::binary);
-        file.write((char*)image_data.data(), image_data.size());
-        file.close();
-    }
-
     static void convertToPlanDepth(std::vector<float>& image_data, int width, int height, float f_px = 320)
     {
         float center_i = width / 2.0f - 1;
@@ -353,7 +347,7 @@ private:
         }
     }
 
-    static void denormalizeDisparity(std::vector<float>& image_data, int width)
+    static void denormalizeDisparity(common_utils::PooledBuffer<float>& image_data, int width)
     {
         for (int i = 0; i < image_data.size(); ++i) {
             image_data[i] = image_data[i] * width;
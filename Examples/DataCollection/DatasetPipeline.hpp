@@ -0,0 +1,262 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <iostream>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <exception>
+#include "common/Common.hpp"
+#include "common/ImageCaptureBase.hpp"
+#include "common/common_utils/Timer.hpp"
+#include "common/common_utils/BoundedMpmcQueue.hpp"
+#include "ShardedArchiveWriter.hpp"
+
+/*
+    Runs dataset generation as three overlapping stages:
+
+        capture (one thread per capture function) -> encode (worker pool) -> write (calling thread)
+
+    Each capture function usually owns its own RPC client and vehicle so several pose->capture
+    requests are in flight at once. Encode workers turn captured images in to file buffers (PNG, PFM, ...)
+    and the write stage appends them to a ShardedArchiveWriter and files_list.txt. Stages are connected
+    by bounded queues so a slow disk or encoder throttles capture instead of growing memory.
+
+    Throughput of each stage is printed every report_interval seconds and at the end. Any exception
+    in a stage stops the pipeline and is rethrown from run() after all threads have exited.
+*/
+class DatasetPipeline
+{
+public:
+    typedef msr::airlib::ImageCaptureBase::ImageResponse ImageResponse;
+    typedef msr::airlib::Pose Pose;
+
+    struct Params
+    {
+        unsigned int encode_workers = std::max(1u, std::thread::hardware_concurrency());
+        //samples buffered between two stages before upstream stage blocks
+        unsigned int queue_capacity = 16;
+        uint64_t max_shard_bytes = 1ull << 30;
+        //seconds between throughput reports, 0 to only report at the end
+        float report_interval = 10;
+    };
+
+    struct Sample
+    {
+        int index = 0;
+        //index of capture function that produced this sample, e.g. the vehicle
+        unsigned int source = 0;
+        std::vector<ImageResponse> response;
+        Pose pose;
+    };
+
+    struct EncodedSample
+    {
+        int index = 0;
+        //archive member name and content
+        std::vector<std::pair<std::string, std::vector<uint8_t>>> files;
+        //line for files_list.txt, nothing is written if empty
+        std::string list_entry;
+    };
+
+    //returns false if capture should be retried, for example after collision
+    typedef std::function<bool(Sample& sample)> CaptureFunc;
+    //called concurrently from encode workers, worker is in [0, encode_workers) so encoders can keep per worker state
+    typedef std::function<void(unsigned int worker, Sample& sample, EncodedSample& encoded)> EncodeFunc;
+
+public:
+    DatasetPipeline(const std::string& storage_dir, const Params& params)
+        : storage_dir_(storage_dir), params_(params)
+    {
+        if (params_.encode_workers == 0 || params_.queue_capacity == 0)
+            throw std::invalid_argument("DatasetPipeline needs at least one encode worker and non-zero queue capacity");
+    }
+
+    explicit DatasetPipeline(const std::string& storage_dir)
+        : DatasetPipeline(storage_dir, Params())
+    {
+    }
+
+    const Params& getParams() const
+    {
+        return params_;
+    }
+
+    //captures, encodes and writes samples numbered first_sample to last_sample inclusive
+    void run(const std::vector<CaptureFunc>& capturers, const EncodeFunc& encoder, int first_sample, int last_sample)
+    {
+        if (capturers.size() == 0)
+            throw std::invalid_argument("DatasetPipeline needs at least one capture function");
+
+        ShardedArchiveWriter archive(storage_dir_, params_.max_shard_bytes);
+        std::ofstream file_list(FileSystem::combine(storage_dir_, "files_list.txt"), std::ios::out | std::ios::app);
+
+        captured_.reset(new common_utils::BoundedMpmcQueue<Sample>(params_.queue_capacity));
+        encoded_.reset(new common_utils::BoundedMpmcQueue<EncodedSample>(params_.queue_capacity));
+        stats_.reset();
+        error_ = nullptr;
+        error_flag_ = false;
+        next_index_ = first_sample;
+        last_index_ = last_sample;
+        active_capturers_ = static_cast<unsigned int>(capturers.size());
+        active_encoders_ = params_.encode_workers;
+
+        run_timer_.start();
+        std::vector<std::thread> threads;
+        for (unsigned int i = 0; i < capturers.size(); ++i)
+            threads.emplace_back(&DatasetPipeline::captureLoop, this, i, std::cref(capturers[i]));
+        for (unsigned int i = 0; i < params_.encode_workers; ++i)
+            threads.emplace_back(&DatasetPipeline::encodeLoop, this, i, std::cref(encoder));
+
+        common_utils::Timer report_timer;
+        report_timer.start();
+        try {
+            EncodedSample encoded;
+            while (!error_flag_ && encoded_->pop(encoded)) {
+                common_utils::Timer timer;
+                timer.start();
+                for (const auto& file : encoded.files) {
+                    archive.write(file.first, file.second);
+                    stats_.bytes += file.second.size();
+                }
+                if (encoded.list_entry.size())
+                    file_list << encoded.list_entry << "\n";
+                stats_.write_us += static_cast<uint64_t>(timer.microseconds());
+                ++stats_.written;
+
+                if (params_.report_interval > 0 && report_timer.seconds() >= params_.report_interval) {
+                    report(false);
+                    report_timer.start();
+                }
+            }
+            archive.close();
+            file_list.flush();
+        }
+        catch (...) {
+            setError(std::current_exception());
+        }
+
+        for (auto& thread : threads)
+            thread.join();
+
+        report(true);
+        if (error_)
+            std::rethrow_exception(error_);
+    }
+
+private:
+    typedef common_utils::FileSystem FileSystem;
+    typedef common_utils::Utils Utils;
+
+    struct Stats
+    {
+        std::atomic<uint64_t> captured{ 0 }, encoded{ 0 }, written{ 0 }, bytes{ 0 };
+        std::atomic<uint64_t> capture_us{ 0 }, encode_us{ 0 }, write_us{ 0 };
+
+        void reset()
+        {
+            captured = encoded = written = bytes = 0;
+            capture_us = encode_us = write_us = 0;
+        }
+    };
+
+    void captureLoop(unsigned int source, const CaptureFunc& capturer)
+    {
+        try {
+            while (!error_flag_) {
+                Sample sample;
+                common_utils::Timer timer;
+                timer.start();
+                if (!capturer(sample))
+                    continue;
+                stats_.capture_us += static_cast<uint64_t>(timer.microseconds());
+
+                //indices are assigned after capture so retries don't leave gaps
+                sample.index = next_index_++;
+                if (sample.index > last_index_)
+                    break;
+                sample.source = source;
+                ++stats_.captured;
+                if (!captured_->push(std::move(sample)))
+                    break;
+            }
+        }
+        catch (...) {
+            setError(std::current_exception());
+        }
+
+        if (--active_capturers_ == 0)
+            captured_->close();
+    }
+
+    void encodeLoop(unsigned int worker, const EncodeFunc& encoder)
+    {
+        try {
+            Sample sample;
+            while (!error_flag_ && captured_->pop(sample)) {
+                common_utils::Timer timer;
+                timer.start();
+                EncodedSample encoded;
+                encoded.index = sample.index;
+                encoder(worker, sample, encoded);
+                stats_.encode_us += static_cast<uint64_t>(timer.microseconds());
+                ++stats_.encoded;
+                if (!encoded_->push(std::move(encoded)))
+                    break;
+            }
+        }
+        catch (...) {
+            setError(std::current_exception());
+        }
+
+        if (--active_encoders_ == 0)
+            encoded_->close();
+    }
+
+    void setError(std::exception_ptr error)
+    {
+        {
+            std::lock_guard<std::mutex> lock(error_mutex_);
+            if (!error_)
+                error_ = error;
+        }
+        error_flag_ = true;
+        captured_->close();
+        encoded_->close();
+    }
+
+    void report(bool is_final)
+    {
+        const double secs = std::max(run_timer_.seconds(), 1E-6);
+        const uint64_t captured = stats_.captured, encoded = stats_.encoded, written = stats_.written;
+        auto average_ms = [](uint64_t total_us, uint64_t count) { return count ? total_us / 1E3 / count : 0.0; };
+
+        std::cout << (is_final ? "Dataset done: " : "Dataset: ") << written << " samples in " << secs << " s, "
+                  << written / secs << " samples/s, " << stats_.bytes / secs / (1 << 20) << " MB/s | "
+                  << "capture " << average_ms(stats_.capture_us, captured) << " ms, "
+                  << "encode " << average_ms(stats_.encode_us, encoded) << " ms, "
+                  << "write " << average_ms(stats_.write_us, written) << " ms per sample | "
+                  << "queued " << captured_->sizeApprox() << " to encode, " << encoded_->sizeApprox() << " to write"
+                  << std::endl;
+    }
+
+private:
+    std::string storage_dir_;
+    Params params_;
+
+    std::unique_ptr<common_utils::BoundedMpmcQueue<Sample>> captured_;
+    std::unique_ptr<common_utils::BoundedMpmcQueue<EncodedSample>> encoded_;
+    std::atomic<int> next_index_{ 0 };
+    int last_index_ = 0;
+    std::atomic<unsigned int> active_capturers_{ 0 }, active_encoders_{ 0 };
+
+    Stats stats_;
+    common_utils::Timer run_timer_;
+
+    std::mutex error_mutex_;
+    std::exception_ptr error_;
+    std::atomic<bool> error_flag_{ false };
+};
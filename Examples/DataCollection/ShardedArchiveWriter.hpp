@@ -0,0 +1,191 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstring>
+#include <cstdint>
+#include <ctime>
+#include <stdexcept>
+#include "common/common_utils/Utils.hpp"
+#include "common/common_utils/FileSystem.hpp"
+
+/*
+    Writes named files in to a sequence of tar (ustar) shards shard_000000.tar, shard_000001.tar, ...
+    so a dataset of hundreds of thousands of images ends up as a handful of large files that can be
+    listed or extracted with any tar tool. A new shard is started when the current one would grow
+    beyond max_shard_bytes.
+
+    index.csv next to the shards has one line per file with the shard number and the offset and
+    size of the file data within that shard, so a reader can get any file with a single seek.
+
+    Existing shards are never modified: a new writer starts at the next unused shard number and
+    appends to index.csv. The writer is not thread safe and is meant to be owned by one thread.
+*/
+class ShardedArchiveWriter
+{
+public:
+    ShardedArchiveWriter(const std::string& storage_dir, uint64_t max_shard_bytes = 1ull << 30)
+        : storage_dir_(storage_dir), max_shard_bytes_(max_shard_bytes)
+    {
+        FileSystem::ensureFolder(storage_dir_);
+
+        while (std::ifstream(FileSystem::combine(storage_dir_, getShardFileName(shard_))).good())
+            ++shard_;
+
+        const std::string index_path = FileSystem::combine(storage_dir_, "index.csv");
+        const bool index_exists = std::ifstream(index_path).good();
+        index_.open(index_path, std::ios::out | std::ios::app);
+        if (!index_)
+            throw std::runtime_error(Utils::stringf("Cannot open archive index %s", index_path.c_str()));
+        if (!index_exists)
+            index_ << "name,shard,offset,size" << std::endl;
+    }
+
+    ~ShardedArchiveWriter()
+    {
+        try {
+            close();
+        }
+        catch (...) {
+            //destructor must not throw, call close() explicitly to see errors
+        }
+    }
+
+    void write(const std::string& name, const std::vector<uint8_t>& data)
+    {
+        write(name, data.data(), data.size());
+    }
+
+    void write(const std::string& name, const void* data, size_t size)
+    {
+        if (name.size() == 0 || name.size() > kMaxNameLength)
+            throw std::invalid_argument(Utils::stringf("Archive member name '%s' must have 1 to %u characters",
+                                                       name.c_str(), static_cast<unsigned int>(kMaxNameLength)));
+
+        const uint64_t entry_bytes = kBlockSize + paddedSize(size);
+        if (shard_file_.is_open() && shard_bytes_ + entry_bytes + 2 * kBlockSize > max_shard_bytes_)
+            closeShard();
+        if (!shard_file_.is_open())
+            openShard();
+
+        writeHeader(name, size);
+        const uint64_t offset = shard_bytes_;
+        shard_file_.write(static_cast<const char*>(data), size);
+        static const char zeros[kBlockSize] = {};
+        shard_file_.write(zeros, paddedSize(size) - size);
+        if (!shard_file_)
+            throw std::runtime_error(Utils::stringf("Failed to write %s", getShardPath().c_str()));
+        shard_bytes_ += paddedSize(size);
+        total_bytes_ += entry_bytes;
+
+        index_ << name << "," << shard_ << "," << offset << "," << size << "\n";
+    }
+
+    //writes end of archive marker on current shard, further writes start a new shard
+    void close()
+    {
+        if (shard_file_.is_open())
+            closeShard();
+        index_.flush();
+    }
+
+    //bytes written to shards by this writer including tar headers and padding
+    uint64_t getBytesWritten() const
+    {
+        return total_bytes_;
+    }
+
+    unsigned int getShardCount() const
+    {
+        return shard_count_;
+    }
+
+    static std::string getShardFileName(unsigned int shard)
+    {
+        return Utils::stringf("shard_%06u.tar", shard);
+    }
+
+private:
+    typedef common_utils::Utils Utils;
+    typedef common_utils::FileSystem FileSystem;
+
+    static constexpr size_t kBlockSize = 512;
+    static constexpr size_t kMaxNameLength = 100;
+
+    static uint64_t paddedSize(uint64_t size)
+    {
+        return (size + kBlockSize - 1) / kBlockSize * kBlockSize;
+    }
+
+    std::string getShardPath() const
+    {
+        return FileSystem::combine(storage_dir_, getShardFileName(shard_));
+    }
+
+    void openShard()
+    {
+        FileSystem::createBinaryFile(getShardPath(), shard_file_);
+        if (!shard_file_)
+            throw std::runtime_error(Utils::stringf("Cannot create archive shard %s", getShardPath().c_str()));
+        shard_bytes_ = 0;
+        ++shard_count_;
+    }
+
+    void closeShard()
+    {
+        static const char zeros[2 * kBlockSize] = {};
+        shard_file_.write(zeros, sizeof(zeros));
+        total_bytes_ += sizeof(zeros);
+        shard_file_.close();
+        if (!shard_file_)
+            throw std::runtime_error(Utils::stringf("Failed to close %s", getShardPath().c_str()));
+        index_.flush();
+        ++shard_;
+    }
+
+    //numeric header fields are zero padded octal terminated by NUL
+    static void writeOctal(char* field, size_t field_size, uint64_t value)
+    {
+        for (size_t i = field_size - 1; i-- > 0; value >>= 3)
+            field[i] = static_cast<char>('0' + (value & 7));
+        field[field_size - 1] = '\0';
+    }
+
+    void writeHeader(const std::string& name, uint64_t size)
+    {
+        char header[kBlockSize] = {};
+        std::memcpy(header, name.data(), name.size()); //name
+        writeOctal(header + 100, 8, 0644); //mode
+        writeOctal(header + 108, 8, 0); //uid
+        writeOctal(header + 116, 8, 0); //gid
+        writeOctal(header + 124, 12, size); //size
+        writeOctal(header + 136, 12, static_cast<uint64_t>(std::time(nullptr))); //mtime
+        header[156] = '0'; //typeflag: regular file
+        std::memcpy(header + 257, "ustar", 6); //magic
+        std::memcpy(header + 263, "00", 2); //version
+
+        //checksum is computed with checksum field set to spaces
+        std::memset(header + 148, ' ', 8);
+        unsigned int checksum = 0;
+        for (size_t i = 0; i < kBlockSize; ++i)
+            checksum += static_cast<unsigned char>(header[i]);
+        writeOctal(header + 148, 7, checksum);
+
+        shard_file_.write(header, kBlockSize);
+        shard_bytes_ += kBlockSize;
+    }
+
+private:
+    std::string storage_dir_;
+    uint64_t max_shard_bytes_;
+    std::ofstream shard_file_;
+    std::ofstream index_;
+    unsigned int shard_ = 0;
+    unsigned int shard_count_ = 0;
+    uint64_t shard_bytes_ = 0;
+    uint64_t total_bytes_ = 0;
+};
@@ -6,12 +6,12 @@
 #include <iostream>
 #include <iomanip>
 #include "common/Common.hpp"
-#include "common/common_utils/ProsumerQueue.hpp"
 #include "common/common_utils/FileSystem.hpp"
 #include "common/ClockFactory.hpp"
 #include "vehicles/multirotor/api/MultirotorRpcLibClient.hpp"
 #include "vehicles/multirotor/api/MultirotorApiBase.hpp"
 #include "RandomPointPoseGenerator.hpp"
+#include "DatasetPipeline.hpp"
 STRICT_MODE_OFF
 #ifndef RPCLIB_MSGPACK
 #define RPCLIB_MSGPACK clmdep_msgpack
@@ -22,71 +22,46 @@ STRICT_MODE_ON
 class StereoImageGenerator
 {
 public:
-    StereoImageGenerator(std::string storage_dir)
-        : storage_dir_(storage_dir)
+    //each vehicle gets its own client and capture thread so captures are in flight in parallel
+    StereoImageGenerator(std::string storage_dir, const std::vector<std::string>& vehicle_names = { "" })
+        : storage_dir_(storage_dir), vehicle_names_(vehicle_names)
     {
+        if (vehicle_names_.size() == 0)
+            throw std::invalid_argument("At least one vehicle name is required, use empty name for default vehicle");
         FileSystem::ensureFolder(storage_dir);
     }
 
-    int generate(int num_samples)
+    DatasetPipeline::Params& getPipelineParams()
     {
-        msr::airlib::MultirotorRpcLibClient client;
-        client.confirmConnection();
+        return pipeline_params_;
+    }
 
+    int generate(int num_samples)
+    {
         msr::airlib::ClockBase* clock = msr::airlib::ClockFactory::get();
-        RandomPointPoseGenerator pose_generator(static_cast<int>(clock->nowNanos()));
-        std::fstream file_list(FileSystem::combine(storage_dir_, "files_list.txt"),
-                               std::ios::out | std::ios::in | std::ios_base::app);
-
-        int sample = getImageCount(file_list);
+        const int seed = static_cast<int>(clock->nowNanos());
+
+        std::vector<std::unique_ptr<msr::airlib::MultirotorRpcLibClient>> clients;
+        std::vector<std::unique_ptr<RandomPointPoseGenerator>> pose_generators;
+        std::vector<DatasetPipeline::CaptureFunc> capturers;
+        for (unsigned int i = 0; i < vehicle_names_.size(); ++i) {
+            clients.emplace_back(new msr::airlib::MultirotorRpcLibClient());
+            clients.back()->confirmConnection();
+            pose_generators.emplace_back(new RandomPointPoseGenerator(seed + i));
+
+            msr::airlib::MultirotorRpcLibClient* client = clients.back().get();
+            RandomPointPoseGenerator* pose_generator = pose_generators.back().get();
+            const std::string vehicle_name = vehicle_names_[i];
+            capturers.push_back([client, pose_generator, vehicle_name](DatasetPipeline::Sample& sample) {
+                return capture(*client, *pose_generator, vehicle_name, sample);
+            });
+        }
 
-        common_utils::ProsumerQueue<ImagesResult> results;
-        std::thread result_process_thread(processImages, &results);
+        int sample = getImageCount(FileSystem::combine(storage_dir_, "files_list.txt"));
 
+        DatasetPipeline pipeline(storage_dir_, pipeline_params_);
         try {
-            while (sample < num_samples) {
-                //const auto& collision_info = client.getCollisionInfo();
-                //if (collision_info.has_collided) {
-                //    pose_generator.next();
-                //    client.simSetPose(pose_generator.position, pose_generator.orientation);
-
-                //    std::cout << "Collision at " << VectorMath::toString(collision_info.position)
-                //        << "Moving to next pose: "  << VectorMath::toString(pose_generator.position)
-                //        << std::endl;
-
-                //    continue;
-                //}
-                ++sample;
-
-                auto start_nanos = clock->nowNanos();
-
-                std::vector<ImageRequest> request = {
-                    ImageRequest("0", ImageType::Scene),
-                    ImageRequest("1", ImageType::Scene),
-                    ImageRequest("1", ImageType::DisparityNormalized, true)
-                };
-                const std::vector<ImageResponse>& response = client.simGetImages(request);
-                if (response.size() != 3) {
-                    std::cout << "Images were not received!" << std::endl;
-                    start_nanos = clock->nowNanos();
-                    continue;
-                }
-
-                ImagesResult result;
-                result.file_list = &file_list;
-                result.response = response;
-                result.sample = sample;
-                result.render_time = clock->elapsedSince(start_nanos);
-                ;
-                result.storage_dir_ = storage_dir_;
-                result.position = pose_generator.position;
-                result.orientation = pose_generator.orientation;
-
-                results.push(result);
-
-                pose_generator.next();
-                client.simSetVehiclePose(Pose(pose_generator.position, pose_generator.orientation), true);
-            }
+            pipeline.run(capturers, &StereoImageGenerator::encode, sample + 1, num_samples);
         }
         catch (rpc::timeout& t) {
             // will display a message like
@@ -95,8 +70,6 @@ public:
             std::cout << t.what() << std::endl;
         }
 
-        results.setIsDone(true);
-        result_process_thread.join();
         return 0;
     }
 
@@ -113,86 +86,81 @@ private:
     typedef msr::airlib::ImageCaptureBase::ImageType ImageType;
 
     std::string storage_dir_;
+    std::vector<std::string> vehicle_names_;
+    DatasetPipeline::Params pipeline_params_;
     bool spawn_ue4 = false;
 
 private:
-    struct ImagesResult
-    {
-        std::vector<ImageResponse> response;
-        msr::airlib::TTimeDelta render_time;
-        std::string storage_dir_;
-        std::fstream* file_list;
-        int sample;
-        Vector3r position;
-        Quaternionr orientation;
-    };
-
-    static int getImageCount(std::fstream& file_list)
+    static int getImageCount(const std::string& file_list_path)
     {
+        std::ifstream file_list(file_list_path);
         int sample = 0;
         std::string line;
         while (std::getline(file_list, line))
             ++sample;
-        if (file_list.eof())
-            file_list.clear(); //otherwise we can't do any further I/O
-        else if (file_list.bad()) {
+        if (file_list.bad()) {
             throw std::runtime_error("Error occurred while reading files_list.txt");
         }
 
         return sample;
     }
 
-    static void processImages(common_utils::ProsumerQueue<ImagesResult>* results)
+    //runs on capture thread of the vehicle
+    static bool capture(msr::airlib::MultirotorRpcLibClient& client, RandomPointPoseGenerator& pose_generator,
+                        const std::string& vehicle_name, DatasetPipeline::Sample& sample)
     {
-        while (!results->getIsDone()) {
-            msr::airlib::ClockBase* clock = msr::airlib::ClockFactory::get();
-
-            ImagesResult result;
-            if (!results->tryPop(result)) {
-                clock->sleep_for(1);
-                continue;
-            }
-
-            auto process_time = clock->nowNanos();
+        //const auto& collision_info = client.simGetCollisionInfo(vehicle_name);
+        //if (collision_info.has_collided) {
+        //    std::cout << "Collision at " << VectorMath::toString(collision_info.position) << std::endl;
+        //    return false;
+        //}
+
+        pose_generator.next();
+        sample.pose = Pose(pose_generator.position, pose_generator.orientation);
+        client.simSetVehiclePose(sample.pose, true, vehicle_name);
+
+        std::vector<ImageRequest> request = {
+            ImageRequest("0", ImageType::Scene),
+            ImageRequest("1", ImageType::Scene),
+            ImageRequest("1", ImageType::DisparityNormalized, true)
+        };
+        sample.response = client.simGetImages(request, vehicle_name);
+        if (sample.response.size() != 3) {
+            std::cout << "Images were not received!" << std::endl;
+            return false;
+        }
+        return true;
+    }
 
-            std::string left_file_name = Utils::stringf("left_%06d.png", result.sample);
-            std::string right_file_name = Utils::stringf("right_%06d.png", result.sample);
-            std::string disparity_file_name = Utils::stringf("disparity_%06d.pfm", result.sample);
-            saveImageToFile(result.response.at(0).image_data_uint8,
-                            FileSystem::combine(result.storage_dir_, right_file_name));
-            saveImageToFile(result.response.at(1).image_data_uint8,
-                            FileSystem::combine(result.storage_dir_, left_file_name));
+    //runs on encode worker
+    static void encode(unsigned int worker, DatasetPipeline::Sample& sample, DatasetPipeline::EncodedSample& encoded)
+    {
+        unused(worker);
 
-            std::vector<float> disparity_data = result.response.at(2).image_data_float;
+        std::string left_file_name = Utils::stringf("left_%06d.png", sample.index);
+        std::string right_file_name = Utils::stringf("right_%06d.png", sample.index);
+        std::string disparity_file_name = Utils::stringf("disparity_%06d.pfm", sample.index);
 
-            //writeFilePFM(depth_data, response.at(2).width, response.at(2).height,
-            //    FileSystem::combine(storage_dir_, Utils::stringf("depth_%06d.pfm", i)));
+        //scene images already come PNG compressed from the simulator
+        encoded.files.emplace_back(right_file_name, sample.response.at(0).image_data_uint8.toVector());
+        encoded.files.emplace_back(left_file_name, sample.response.at(1).image_data_uint8.toVector());
 
-            //below is not needed because we get disparity directly
-            //convertToPlanDepth(depth_data, result.response.at(2).width, result.response.at(2).height);
-            //float f = result.response.at(2).width / 2.0f - 1;
-            //convertToDisparity(depth_data, result.response.at(2).width, result.response.at(2).height, f, 25 / 100.0f);
+        common_utils::PooledBuffer<float>& disparity_data = sample.response.at(2).image_data_float;
 
-            denormalizeDisparity(disparity_data, result.response.at(2).width);
+        //writeFilePFM(depth_data, response.at(2).width, response.at(2).height,
+        //    FileSystem::combine(storage_dir_, Utils::stringf("depth_%06d.pfm", i)));
 
-            Utils::writePFMfile(disparity_data.data(), result.response.at(2).width, result.response.at(2).height, FileSystem::combine(result.storage_dir_, disparity_file_name));
+        //below is not needed because we get disparity directly
+        //convertToPlanDepth(depth_data, result.response.at(2).width, result.response.at(2).height);
+        //float f = result.response.at(2).width / 2.0f - 1;
+        //convertToDisparity(depth_data, result.response.at(2).width, result.response.at(2).height, f, 25 / 100.0f);
 
-            (*result.file_list) << left_file_name << "," << right_file_name << "," << disparity_file_name << std::endl;
+        denormalizeDisparity(disparity_data, sample.response.at(2).width);
 
-            std::cout << "Image #" << result.sample
-                      << " pos:" << VectorMath::toString(result.position)
-                      << " ori:" << VectorMath::toString(result.orientation)
-                      << " render time " << result.render_time * 1E3f << "ms"
-                      << " process time " << clock->elapsedSince(process_time) * 1E3f << " ms"
-                      << std::endl;
-        }
-    }
+        encoded.files.emplace_back(disparity_file_name, std::vector<uint8_t>());
+        Utils::writePFMbuffer(disparity_data.data(), sample.response.at(2).width, sample.response.at(2).height, encoded.files.back().second);
 
-    static void saveImageToFile(const std::vector<uint8_t>& image_data, const std::string& file_name)
-    {
-        std::ofstream file(file_name, std::ios::binary);
-        file.write((char*)image_data.data(), image_data.size());
-        file.close();
+        encoded.list_entry = left_file_name + "," + right_file_name + "," + disparity_file_name;
     }
 
     static void convertToPlanDepth(std::vector<float>& image_data, int width, int height, float f = 320)
@@ -218,7 +186,7 @@ private:
         }
     }
 
-    static void denormalizeDisparity(std::vector<float>& image_data, int width)
+    static void denormalizeDisparity(common_utils::PooledBuffer<float>& image_data, int width)
     {
         for (int i = 0; i < image_data.size(); ++i) {
             image_data[i] = image_data[i] * width;
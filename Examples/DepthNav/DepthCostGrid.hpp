@@ -0,0 +1,316 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <cstdint>
+#include "common/Common.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define DEPTH_COST_GRID_SSE 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define DEPTH_COST_GRID_NEON 1
+#endif
+
+namespace msr
+{
+namespace airlib
+{
+
+    /*
+    DepthCostGrid is shared depth image engine for DepthNav planners. It is updated once per
+    control period with new depth image and then answers:
+        - stats (pixel count, obstacle count, depth sum and min depth) of cells in a regular
+          cell layout, each cell is computed with SSE/NEON on first query and cached for the frame
+          so planners visiting cells repeatedly (spiral search, cost comparisons) pay O(1) per visit
+        - min depth of any window using min-depth pyramid where each level is 2x2 min pooling
+          of previous level, this visits only O(perimeter) pyramid cells instead of all pixels.
+          Pyramid is built with SSE/NEON on first such query in a frame.
+
+    Windows are half open pixel ranges [x_min, x_max) x [y_min, y_max) and are clipped to the image.
+    Depth image is row major, pixel x, y is at y * width + x. Image is not copied, so it must stay
+    alive and unchanged until next update. This class is not thread safe.
+    */
+    class DepthCostGrid
+    {
+    public:
+        struct WindowStats
+        {
+            unsigned int pixel_count = 0;
+            unsigned int obstacle_count = 0;
+            float depth_sum = 0;
+            float min_depth = std::numeric_limits<float>::infinity();
+        };
+
+        //cell (col, row) covers cell_width x cell_height pixels with top-left corner at
+        //(x_offset + col * x_stride, y_offset + row * y_stride), linear cell index is row * cols + col
+        struct CellLayout
+        {
+            int x_offset = 0, y_offset = 0;
+            unsigned int x_stride = 0, y_stride = 0;
+            unsigned int cell_width = 0, cell_height = 0;
+            unsigned int cols = 0, rows = 0;
+        };
+
+    public:
+        void update(const std::vector<float>& depth_image, unsigned int width, unsigned int height, float obstacle_dist)
+        {
+            if (depth_image.size() < static_cast<size_t>(width) * height)
+                throw std::invalid_argument(Utils::stringf("Depth image has %d pixels but expected %dx%d", static_cast<int>(depth_image.size()), width, height));
+
+            image_ = depth_image.data();
+            width_ = width;
+            height_ = height;
+            obstacle_dist_ = obstacle_dist;
+
+            std::fill(cell_valid_.begin(), cell_valid_.end(), false);
+            pyramid_valid_ = false;
+        }
+
+        void setCellLayout(const CellLayout& layout)
+        {
+            layout_ = layout;
+            cells_.resize(static_cast<size_t>(layout.cols) * layout.rows);
+            cell_valid_.assign(cells_.size(), false);
+        }
+
+        const CellLayout& getCellLayout() const
+        {
+            return layout_;
+        }
+
+        const WindowStats& getCellStats(unsigned int index)
+        {
+            if (!cell_valid_.at(index)) {
+                const int x_min = layout_.x_offset + static_cast<int>((index % layout_.cols) * layout_.x_stride);
+                const int y_min = layout_.y_offset + static_cast<int>((index / layout_.cols) * layout_.y_stride);
+                cells_[index] = getWindowStats(x_min, y_min, x_min + layout_.cell_width, y_min + layout_.cell_height);
+                cell_valid_[index] = true;
+            }
+            return cells_[index];
+        }
+
+        const WindowStats& getCellStats(unsigned int col, unsigned int row)
+        {
+            return getCellStats(row * layout_.cols + col);
+        }
+
+        //scans all pixels in the window, prefer cells for repeated queries
+        WindowStats getWindowStats(int x_min, int y_min, int x_max, int y_max) const
+        {
+            WindowStats stats;
+            if (!clip(x_min, y_min, x_max, y_max))
+                return stats;
+
+            stats.pixel_count = static_cast<unsigned int>((x_max - x_min) * (y_max - y_min));
+            for (int y = y_min; y < y_max; ++y)
+                scanRow(image_ + static_cast<size_t>(y) * width_ + x_min, x_max - x_min, obstacle_dist_, stats);
+            return stats;
+        }
+
+        //returns infinity for empty window
+        float getMinDepth(int x_min, int y_min, int x_max, int y_max)
+        {
+            if (!clip(x_min, y_min, x_max, y_max))
+                return std::numeric_limits<float>::infinity();
+
+            if (!pyramid_valid_)
+                buildPyramid();
+
+            //start at coarsest level where window overlaps at most 3x3 cells
+            unsigned int level = 0;
+            const int extent = std::max(x_max - x_min, y_max - y_min);
+            while (level + 1 < getLevelCount() && (1 << (level + 1)) < extent)
+                ++level;
+
+            float min_depth = std::numeric_limits<float>::infinity();
+            for (int cy = y_min >> level; cy <= (y_max - 1) >> level; ++cy)
+                for (int cx = x_min >> level; cx <= (x_max - 1) >> level; ++cx)
+                    min_depth = std::min(min_depth, getMinDepth(level, cx, cy, x_min, y_min, x_max, y_max));
+            return min_depth;
+        }
+
+        unsigned int getWidth() const
+        {
+            return width_;
+        }
+        unsigned int getHeight() const
+        {
+            return height_;
+        }
+        float getObstacleDistance() const
+        {
+            return obstacle_dist_;
+        }
+
+    private:
+        struct Level
+        {
+            unsigned int width, height;
+            std::vector<float> data;
+        };
+
+        bool clip(int& x_min, int& y_min, int& x_max, int& y_max) const
+        {
+            x_min = std::max(x_min, 0);
+            y_min = std::max(y_min, 0);
+            x_max = std::min(x_max, static_cast<int>(width_));
+            y_max = std::min(y_max, static_cast<int>(height_));
+            return x_min < x_max && y_min < y_max;
+        }
+
+        //level 0 is the image itself
+        unsigned int getLevelCount() const
+        {
+            return static_cast<unsigned int>(levels_.size()) + 1;
+        }
+        float getLevelValue(unsigned int level, int cx, int cy) const
+        {
+            if (level == 0)
+                return image_[static_cast<size_t>(cy) * width_ + cx];
+            const Level& l = levels_[level - 1];
+            return l.data[static_cast<size_t>(cy) * l.width + cx];
+        }
+
+        float getMinDepth(unsigned int level, int cx, int cy, int x_min, int y_min, int x_max, int y_max) const
+        {
+            const int x0 = cx << level, y0 = cy << level;
+            const int x1 = (cx + 1) << level, y1 = (cy + 1) << level;
+
+            if (x0 >= x_max || y0 >= y_max || x1 <= x_min || y1 <= y_min)
+                return std::numeric_limits<float>::infinity();
+
+            //level 0 cells are single pixels so they are always fully inside at this point
+            if (x0 >= x_min && y0 >= y_min && x1 <= x_max && y1 <= y_max)
+                return getLevelValue(level, cx, cy);
+
+            //cell partially overlaps window, refine in to children
+            const unsigned int child = level - 1;
+            return std::min(std::min(getMinDepth(child, cx * 2, cy * 2, x_min, y_min, x_max, y_max),
+                                     getMinDepth(child, cx * 2 + 1, cy * 2, x_min, y_min, x_max, y_max)),
+                            std::min(getMinDepth(child, cx * 2, cy * 2 + 1, x_min, y_min, x_max, y_max),
+                                     getMinDepth(child, cx * 2 + 1, cy * 2 + 1, x_min, y_min, x_max, y_max)));
+        }
+
+        void buildPyramid()
+        {
+            unsigned int level_count = 1;
+            while ((1u << (level_count - 1)) < std::max(width_, height_))
+                ++level_count;
+            levels_.resize(level_count - 1);
+
+            const float* src = image_;
+            unsigned int src_width = width_, src_height = height_;
+            for (auto& dst : levels_) {
+                dst.width = (src_width + 1) / 2;
+                dst.height = (src_height + 1) / 2;
+                dst.data.resize(static_cast<size_t>(dst.width) * dst.height);
+
+                for (unsigned int y = 0; y < dst.height; ++y) {
+                    const float* row0 = src + static_cast<size_t>(y * 2) * src_width;
+                    //odd height: last row is pooled with itself
+                    const float* row1 = y * 2 + 1 < src_height ? row0 + src_width : row0;
+                    minPoolRow(row0, row1, src_width, &dst.data[static_cast<size_t>(y) * dst.width]);
+                }
+
+                src = dst.data.data();
+                src_width = dst.width;
+                src_height = dst.height;
+            }
+            pyramid_valid_ = true;
+        }
+
+        //out[i] = min of row0[2i], row0[2i+1], row1[2i], row1[2i+1]
+        static void minPoolRow(const float* row0, const float* row1, unsigned int src_width, float* out)
+        {
+            unsigned int x = 0;
+#if defined(DEPTH_COST_GRID_SSE)
+            for (; x + 8 <= src_width; x += 8) {
+                const __m128 m0 = _mm_min_ps(_mm_loadu_ps(row0 + x), _mm_loadu_ps(row1 + x));
+                const __m128 m1 = _mm_min_ps(_mm_loadu_ps(row0 + x + 4), _mm_loadu_ps(row1 + x + 4));
+                const __m128 even = _mm_shuffle_ps(m0, m1, _MM_SHUFFLE(2, 0, 2, 0));
+                const __m128 odd = _mm_shuffle_ps(m0, m1, _MM_SHUFFLE(3, 1, 3, 1));
+                _mm_storeu_ps(out + x / 2, _mm_min_ps(even, odd));
+            }
+#elif defined(DEPTH_COST_GRID_NEON)
+            for (; x + 8 <= src_width; x += 8) {
+                const float32x4x2_t r0 = vld2q_f32(row0 + x);
+                const float32x4x2_t r1 = vld2q_f32(row1 + x);
+                vst1q_f32(out + x / 2, vminq_f32(vminq_f32(r0.val[0], r0.val[1]), vminq_f32(r1.val[0], r1.val[1])));
+            }
+#endif
+            for (; x < src_width; x += 2) {
+                //odd width: last column is pooled with itself
+                const unsigned int x1 = x + 1 < src_width ? x + 1 : x;
+                out[x / 2] = std::min(std::min(row0[x], row0[x1]), std::min(row1[x], row1[x1]));
+            }
+        }
+
+        //accumulates depth sum, min depth and obstacle count of count pixels in to stats
+        static void scanRow(const float* row, int count, float obstacle_dist, WindowStats& stats)
+        {
+            int x = 0;
+#if defined(DEPTH_COST_GRID_SSE)
+            if (count >= 4) {
+                const __m128 threshold = _mm_set1_ps(obstacle_dist);
+                __m128 sum_v = _mm_setzero_ps(), min_v = _mm_set1_ps(stats.min_depth);
+                __m128i obstacles = _mm_setzero_si128();
+                for (; x + 4 <= count; x += 4) {
+                    const __m128 d = _mm_loadu_ps(row + x);
+                    sum_v = _mm_add_ps(sum_v, d);
+                    min_v = _mm_min_ps(min_v, d);
+                    //comparison gives -1 in lanes that are obstacles
+                    obstacles = _mm_sub_epi32(obstacles, _mm_castps_si128(_mm_cmplt_ps(d, threshold)));
+                }
+                float sums[4], mins[4];
+                int32_t counts[4];
+                _mm_storeu_ps(sums, sum_v);
+                _mm_storeu_ps(mins, min_v);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(counts), obstacles);
+                stats.depth_sum += (sums[0] + sums[1]) + (sums[2] + sums[3]);
+                stats.min_depth = std::min(std::min(mins[0], mins[1]), std::min(mins[2], mins[3]));
+                stats.obstacle_count += counts[0] + counts[1] + counts[2] + counts[3];
+            }
+#elif defined(DEPTH_COST_GRID_NEON)
+            if (count >= 4) {
+                const float32x4_t threshold = vdupq_n_f32(obstacle_dist);
+                float32x4_t sum_v = vdupq_n_f32(0), min_v = vdupq_n_f32(stats.min_depth);
+                uint32x4_t obstacles = vdupq_n_u32(0);
+                for (; x + 4 <= count; x += 4) {
+                    const float32x4_t d = vld1q_f32(row + x);
+                    sum_v = vaddq_f32(sum_v, d);
+                    min_v = vminq_f32(min_v, d);
+                    obstacles = vsubq_u32(obstacles, vcltq_f32(d, threshold));
+                }
+                stats.depth_sum += vaddvq_f32(sum_v);
+                stats.min_depth = vminvq_f32(min_v);
+                stats.obstacle_count += vaddvq_u32(obstacles);
+            }
+#endif
+            for (; x < count; ++x) {
+                const float d = row[x];
+                stats.depth_sum += d;
+                stats.min_depth = std::min(stats.min_depth, d);
+                stats.obstacle_count += d < obstacle_dist ? 1 : 0;
+            }
+        }
+
+    private:
+        const float* image_ = nullptr;
+        unsigned int width_ = 0, height_ = 0;
+        float obstacle_dist_ = 0;
+
+        CellLayout layout_;
+        std::vector<WindowStats> cells_;
+        std::vector<bool> cell_valid_;
+
+        std::vector<Level> levels_;
+        bool pyramid_valid_ = false;
+    };
+}
+}
@@ -14,7 +14,9 @@ STRICT_MODE_ON
 
 //includes for vector math and other common types
 #include "common/Common.hpp"
+#include "common/common_utils/FileSystem.hpp"
 #include <exception>
+#include "DepthCostGrid.hpp"
 
 #include "../../SGM/src/sgmstereo/sgmstereo.h"
 #include "../../SGM/src/stereoPipeline/StateStereo.h"
@@ -56,6 +58,9 @@ namespace airlib
             real_T control_loop_period = 0.25f * max_allowed_obs_dist; //30.0f / 1000; //sec
             real_T max_linear_speed = 10; // m/s
             real_T max_angular_speed = 6; // rad/s
+
+            //if not empty, depth frames used by gotoGoal are saved here as depth_%06d.pfm for DepthNavBenchmark
+            std::string record_folder;
         };
 
         class DepthNavException : public std::runtime_error
@@ -78,8 +83,13 @@ namespace airlib
         void initialize(RpcLibClientBase& client, const std::vector<ImageCaptureBase::ImageRequest>& request)
         {
             const std::vector<ImageCaptureBase::ImageResponse>& response_init = client.simGetImages(request);
-            params_.depth_width = response_init.at(0).width;
-            params_.depth_height = response_init.at(0).height;
+            initialize(response_init.at(0).width, response_init.at(0).height);
+        }
+
+        void initialize(unsigned int depth_width, unsigned int depth_height)
+        {
+            params_.depth_width = depth_width;
+            params_.depth_height = depth_height;
             params_.vehicle_height_px = int(ceil(params_.depth_height * params_.vehicle_height / (tan(params_.fov / 2) * params_.max_allowed_obs_dist * 2))); //height
             params_.vehicle_width_px = int(ceil(params_.depth_width * params_.vehicle_width / (tan(hfov2vfov(params_.fov, params_.depth_height, params_.depth_width) / 2) * params_.max_allowed_obs_dist * 2))); //width
         }
@@ -89,6 +99,8 @@ namespace airlib
 
             typedef ImageCaptureBase::ImageResponse ImageResponse;
 
+            int frame_index = 0;
+
             do {
                 const Pose current_pose = client.simGetVehiclePose();
 
@@ -97,6 +109,10 @@ namespace airlib
                 if (response.size() == 0)
                     throw std::length_error("No images received!");
 
+                if (!params_.record_folder.empty())
+                    Utils::writePFMfile(response.at(0).image_data_float.data(), response.at(0).width, response.at(0).height,
+                                        common_utils::FileSystem::combine(params_.record_folder, Utils::stringf("depth_%06d.pfm", frame_index++)));
+
                 const Pose next_pose = getNextPose(response.at(0).image_data_float, goal_pose.position, current_pose, params_.control_loop_period);
 
                 if (VectorMath::hasNan(next_pose))
@@ -387,6 +403,35 @@ namespace airlib
             return cell_centers;
         }
 
+        //set new depth image for depth_grid_, must be called after getCellCenters and before getCellStats
+        void updateDepthGrid(const std::vector<float>& depth_image)
+        {
+            //cells are vehicle sized windows around centers computed same way as getCellCenters
+            unsigned int M_offset = params_.depth_height - params_.vehicle_height_px * params_.M;
+            unsigned int N_offset = params_.depth_width - params_.vehicle_width_px * params_.N;
+            real_T center_x = 0.5f * (params_.vehicle_width_px + N_offset);
+            real_T center_y = 0.5f * (params_.vehicle_height_px + M_offset);
+
+            DepthCostGrid::CellLayout layout;
+            layout.x_offset = int(center_x - params_.vehicle_width_px / 2);
+            layout.y_offset = int(center_y - params_.vehicle_height_px / 2);
+            layout.cell_width = int(center_x + params_.vehicle_width_px / 2) - layout.x_offset;
+            layout.cell_height = int(center_y + params_.vehicle_height_px / 2) - layout.y_offset;
+            layout.x_stride = params_.vehicle_width_px;
+            layout.y_stride = params_.vehicle_height_px;
+            layout.cols = params_.N;
+            layout.rows = params_.M;
+
+            depth_grid_.setCellLayout(layout);
+            depth_grid_.update(depth_image, params_.depth_width, params_.depth_height, params_.max_allowed_obs_dist);
+        }
+
+        //stats of vehicle sized window around cell_centers[cell_index], computed once per frame
+        const DepthCostGrid::WindowStats& getCellStats(unsigned int cell_index)
+        {
+            return depth_grid_.getCellStats(cell_index);
+        }
+
         real_T getDistanceToGoal(Vector3r current_position, Vector3r goal)
         {
             Vector3r goalVec = goal - current_position;
@@ -404,6 +449,9 @@ namespace airlib
             real_T angle = VectorMath::angleBetween(VectorMath::front(), goal_body.normalized(), true);
             return std::abs(angle) <= params_.fov;
         }
+
+    protected:
+        DepthCostGrid depth_grid_;
     };
 }
 }
\ No newline at end of file
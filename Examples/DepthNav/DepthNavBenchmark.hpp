@@ -0,0 +1,184 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include "DepthNavThreshold.hpp"
+#include "DepthNavCost.hpp"
+#include "common/common_utils/Timer.hpp"
+#include "common/common_utils/FileSystem.hpp"
+#include <iostream>
+
+namespace msr
+{
+namespace airlib
+{
+
+    /*
+    Measures planner decisions/sec on recorded depth frames without the simulator. Frames are
+    depth_%06d.pfm files in a folder as saved by DepthNav::gotoGoal when Params::record_folder is set.
+    If folder is empty or has no frames, synthetic frames with random boxes are used instead.
+    */
+    class DepthNavBenchmark
+    {
+    public:
+        void run(const std::string& frames_folder, unsigned int repeat = 10)
+        {
+            loadFrames(frames_folder);
+            if (frames_.size() == 0)
+                generateFrames(200, 256, 144);
+
+            std::cout << "DepthNavBenchmark: " << frames_.size() << " frames of " << width_ << "x" << height_ << std::endl;
+
+            gridBenchmark(repeat);
+            plannerBenchmark<DepthNavThreshold>("DepthNavThreshold", repeat);
+            plannerBenchmark<DepthNavCost>("DepthNavCost", repeat);
+        }
+
+    private:
+        //exposes protected members of the planner
+        template <typename TPlanner>
+        class Planner : public TPlanner
+        {
+        public:
+            using TPlanner::getNextPose;
+            using TPlanner::getCellCenters;
+            using TPlanner::updateDepthGrid;
+            using TPlanner::getCellStats;
+        };
+
+        void loadFrames(const std::string& frames_folder)
+        {
+            frames_.clear();
+            if (frames_folder.empty())
+                return;
+
+            std::vector<float> frame;
+            int width, height;
+            while (Utils::readPFMfile(common_utils::FileSystem::combine(frames_folder, Utils::stringf("depth_%06d.pfm", static_cast<int>(frames_.size()))),
+                                      frame, width, height)) {
+                if (frames_.size() > 0 && (width != static_cast<int>(width_) || height != static_cast<int>(height_)))
+                    throw std::invalid_argument("All recorded depth frames must have same dimensions");
+                width_ = width;
+                height_ = height;
+                frames_.push_back(frame);
+            }
+        }
+
+        void generateFrames(unsigned int count, unsigned int width, unsigned int height)
+        {
+            width_ = width;
+            height_ = height;
+            common_utils::RandomGeneratorUI rnd_x(0, width - 1), rnd_y(0, height - 1);
+            common_utils::RandomGeneratorF rnd_depth(1.0f, 20.0f);
+
+            frames_.assign(count, std::vector<float>(width * height, 100.0f));
+            for (auto& frame : frames_) {
+                for (unsigned int box = 0; box < 8; ++box) {
+                    unsigned int x0 = rnd_x.next(), x1 = rnd_x.next(), y0 = rnd_y.next(), y1 = rnd_y.next();
+                    if (x0 > x1)
+                        std::swap(x0, x1);
+                    if (y0 > y1)
+                        std::swap(y0, y1);
+                    const float depth = rnd_depth.next();
+                    for (unsigned int y = y0; y <= y1; ++y)
+                        for (unsigned int x = x0; x <= x1; ++x)
+                            frame[y * width + x] = std::min(frame[y * width + x], depth);
+                }
+            }
+        }
+
+        //compares DepthCostGrid against per pixel scan of all planner cells
+        void gridBenchmark(unsigned int repeat)
+        {
+            Planner<DepthNavThreshold> planner;
+            planner.initialize(width_, height_);
+            const std::vector<Vector2r> cell_centers = planner.getCellCenters();
+            const int half_w = planner.params_.vehicle_width_px / 2, half_h = planner.params_.vehicle_height_px / 2;
+            const float obs_dist = planner.params_.max_allowed_obs_dist;
+
+            unsigned int scan_obstacles = 0, cell_obstacles = 0;
+            float scan_min = 0, cell_min = 0, pyramid_min = 0;
+
+            common_utils::Timer timer;
+            timer.start();
+            for (unsigned int r = 0; r < repeat; ++r) {
+                for (const auto& frame : frames_) {
+                    for (const auto& c : cell_centers) {
+                        float min_depth = std::numeric_limits<float>::infinity();
+                        for (int y = int(c.y()) - half_h; y < int(c.y()) + half_h; ++y)
+                            for (int x = int(c.x()) - half_w; x < int(c.x()) + half_w; ++x) {
+                                const float d = frame[y * width_ + x];
+                                scan_obstacles += d < obs_dist ? 1 : 0;
+                                min_depth = std::min(min_depth, d);
+                            }
+                        scan_min += min_depth;
+                    }
+                }
+            }
+            const double scan_ms = timer.milliseconds();
+
+            timer.start();
+            for (unsigned int r = 0; r < repeat; ++r) {
+                for (const auto& frame : frames_) {
+                    planner.updateDepthGrid(frame);
+                    for (unsigned int i = 0; i < cell_centers.size(); ++i) {
+                        const DepthCostGrid::WindowStats& stats = planner.getCellStats(i);
+                        cell_obstacles += stats.obstacle_count;
+                        cell_min += stats.min_depth;
+                    }
+                }
+            }
+            const double cell_ms = timer.milliseconds();
+
+            DepthCostGrid grid;
+            timer.start();
+            for (unsigned int r = 0; r < repeat; ++r) {
+                for (const auto& frame : frames_) {
+                    grid.update(frame, width_, height_, obs_dist);
+                    for (const auto& c : cell_centers)
+                        pyramid_min += grid.getMinDepth(int(c.x()) - half_w, int(c.y()) - half_h, int(c.x()) + half_w, int(c.y()) + half_h);
+                }
+            }
+            const double pyramid_ms = timer.milliseconds();
+
+            if (scan_obstacles != cell_obstacles || scan_min != cell_min || scan_min != pyramid_min)
+                throw std::runtime_error("DepthCostGrid results do not match pixel scan");
+
+            const double frame_count = static_cast<double>(repeat) * frames_.size();
+            std::cout << "DepthNavBenchmark: " << cell_centers.size() << " cells per frame, pixel scan " << scan_ms / frame_count
+                      << " ms/frame, DepthCostGrid cells " << cell_ms / frame_count << " ms/frame, min-depth pyramid "
+                      << pyramid_ms / frame_count << " ms/frame" << std::endl;
+        }
+
+        template <typename TPlanner>
+        void plannerBenchmark(const std::string& name, unsigned int repeat)
+        {
+            Planner<TPlanner> planner;
+            planner.initialize(width_, height_);
+
+            //goal straight ahead so planners search cells instead of only rotating
+            const Pose current_pose(Vector3r(0, 0, -1), Quaternionr::Identity());
+            const Vector3r goal(50, 2, -1);
+
+            unsigned int no_path_count = 0;
+            common_utils::Timer timer;
+            timer.start();
+            for (unsigned int r = 0; r < repeat; ++r) {
+                for (const auto& frame : frames_) {
+                    if (VectorMath::hasNan(planner.getNextPose(frame, goal, current_pose, planner.params_.control_loop_period)))
+                        ++no_path_count;
+                }
+            }
+            const double secs = timer.seconds();
+
+            std::cout << "DepthNavBenchmark: " << name << " " << repeat * frames_.size() / secs << " decisions/sec, "
+                      << no_path_count / repeat << " frames without path" << std::endl;
+        }
+
+    private:
+        std::vector<std::vector<float>> frames_;
+        unsigned int width_ = 0, height_ = 0;
+    };
+}
+}
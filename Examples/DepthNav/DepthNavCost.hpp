@@ -42,6 +42,7 @@ namespace airlib
                     unsigned int cell_idx = nearest_neighbor(cell_centers, Vector2r(y_px, z_px));
                     //Get spiral indexes
                     std::vector<int> spiral_idxs = spiralOrder(params_.M, params_.N, cell_idx);
+                    updateDepthGrid(depth_image);
                     /*7. Until free space is found
                 For p = -params.req_free_width to +params.req_free_width
                 For q = -params.req_free_height to +params.req_free_height
@@ -58,7 +59,7 @@ namespace airlib
                     float min_cost = FLT_MAX;
                     int min_cost_i = 0;
                     for (int i = 0; i < cell_centers.size(); ++i) {
-                        cost = computeCellCost(depth_image, cell_centers[spiral_idxs[i]], Vector2r(y_px, z_px));
+                        cost = computeCellCost(spiral_idxs[i], cell_centers[spiral_idxs[i]], Vector2r(y_px, z_px));
                         if (cost < min_cost) {
                             min_cost = cost;
                             min_cost_i = i;
@@ -92,26 +93,15 @@ namespace airlib
             }
         }
 
-        float computeCellCost(const std::vector<float>& img, Vector2r cell_center, Vector2r goal)
+        float computeCellCost(unsigned int cell_index, Vector2r cell_center, Vector2r goal)
         {
-
-            unsigned int counter = 0;
-            unsigned int count_min_depth = 0;
-            float depth_sum = 0;
+            const DepthCostGrid::WindowStats& stats = getCellStats(cell_index);
+            unsigned int counter = stats.pixel_count;
+            unsigned int count_min_depth = stats.obstacle_count;
+            float depth_sum = stats.depth_sum;
             Vector2r diff = goal - cell_center;
             float dist_to_goal = sqrt(diff.dot(diff));
 
-            for (int i = int(cell_center.y() - params_.vehicle_height_px / 2); i < int(cell_center.y() + params_.vehicle_height_px / 2); i++) {
-                for (int j = int(cell_center.x() - params_.vehicle_width_px / 2); j < int(cell_center.x() + params_.vehicle_width_px / 2); j++) {
-                    int idx = i * params_.depth_width + j;
-                    counter++;
-                    depth_sum += img[idx];
-                    if (img[idx] < params_.max_allowed_obs_dist) {
-                        count_min_depth++;
-                    }
-                }
-            }
-
             return (counter / depth_sum) * (2 ^ count_min_depth) * dist_to_goal;
         }
     };
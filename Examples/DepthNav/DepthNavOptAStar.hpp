@@ -4,6 +4,7 @@
 #include "common/common_utils/FileSystem.hpp"
 #include "common/common_utils/bitmap_image.hpp"
 #include "common/common_utils/ColorUtils.hpp"
+#include "DepthCostGrid.hpp"
 
 namespace msr
 {
@@ -28,6 +29,9 @@ namespace airlib
 
             real_T max_obs_dist = 1.0f;
 
+            //obstacle distance for a ray is min depth in square of this many pixels around it
+            unsigned int obs_footprint_px = 1;
+
             real_T collision_cost = 1.0E8f;
 
             unsigned int ray_samples_count = 25;
@@ -156,8 +160,10 @@ namespace airlib
             Vector3r goal_body = VectorMath::transformToBodyFrame(goal, current_pose, true);
             real_T goal_dist = goal_body.norm();
 
+            depth_grid_.update(depth_image, params_.depth_width, params_.depth_height, params_.max_obs_dist);
+
             SampleRay* min_cost_ray = &sample_rays.at(0);
-            setupRay(*min_cost_ray, depth_image, goal_body, goal_dist);
+            setupRay(*min_cost_ray, goal_body, goal_dist);
 
             if (generate_debug_info_) {
                 const auto& bmp = depth2bmp(depth_image);
@@ -169,7 +175,7 @@ namespace airlib
                 SampleRay& sample_ray = sample_rays.at(ray_index + extra_rays);
                 sample_ray.pixel_x = params_.env_x_oofset + rnd_width_.next();
                 sample_ray.pixel_y = params_.env_y_oofset + rnd_height_.next();
-                setupRay(sample_ray, depth_image, goal_body, goal_dist);
+                setupRay(sample_ray, goal_body, goal_dist);
 
                 if (min_cost_ray->cost > sample_ray.cost)
                     min_cost_ray = &sample_ray;
@@ -211,10 +217,12 @@ namespace airlib
             img.save_image(filepath);
         }
 
-        void setupRay(SampleRay& sample_ray, const std::vector<float>& depth_image, const Vector3r& goal_body, real_T goal_dist)
+        void setupRay(SampleRay& sample_ray, const Vector3r& goal_body, real_T goal_dist)
         {
-            sample_ray.index = sample_ray.pixel_y * params_.env_width + sample_ray.pixel_x;
-            sample_ray.obs_dist = depth_image.at(sample_ray.index);
+            sample_ray.index = sample_ray.pixel_y * params_.depth_width + sample_ray.pixel_x;
+            const int x_min = static_cast<int>(sample_ray.pixel_x) - static_cast<int>(params_.obs_footprint_px / 2);
+            const int y_min = static_cast<int>(sample_ray.pixel_y) - static_cast<int>(params_.obs_footprint_px / 2);
+            sample_ray.obs_dist = depth_grid_.getMinDepth(x_min, y_min, x_min + params_.obs_footprint_px, y_min + params_.obs_footprint_px);
             sample_ray.ray = pixel2ray(sample_ray.pixel_x, sample_ray.pixel_y);
             setRayCost(sample_ray, goal_body, goal_dist);
         }
@@ -259,6 +267,7 @@ namespace airlib
 
     private:
         Params params_;
+        DepthCostGrid depth_grid_;
         std::vector<SampleRay> sample_rays;
         common_utils::RandomGeneratorUI rnd_width_, rnd_height_;
         bool generate_debug_info_ = true;
@@ -45,6 +45,7 @@ namespace airlib
                     unsigned int cell_idx = nearest_neighbor(cell_centers, Vector2r(y_px, z_px));
                     //Get spiral indexes
                     std::vector<int> spiral_idxs = spiralOrder(params_.M, params_.N, cell_idx);
+                    updateDepthGrid(depth_image);
                     /*7. Until free space is found
                 For p = -params.req_free_width to +params.req_free_width
                 For q = -params.req_free_height to +params.req_free_height
@@ -58,7 +59,7 @@ namespace airlib
                 */
                     Vector2r goal_px;
                     for (int i = 0; i < cell_centers.size(); ++i) {
-                        if (isCellFree(depth_image, cell_centers[spiral_idxs[i]])) {
+                        if (isCellFree(spiral_idxs[i])) {
                             //8. We are here if we have found cell coordinates i, j as center of the free window from step #7
                             //9. Compute i_x_center, j_y_center that would be center pixel of this cell in the plane for x = 1
                             goal_px = cell_centers[spiral_idxs[i]];
@@ -89,21 +90,9 @@ namespace airlib
             }
         }
 
-        bool isCellFree(const std::vector<float>& img, Vector2r cell_center)
+        bool isCellFree(unsigned int cell_index)
         {
-
-            //std::vector<float> crop;
-            unsigned int counter = 0;
-
-            for (int i = int(cell_center.y() - params_.vehicle_height_px / 2); i < int(cell_center.y() + params_.vehicle_height_px / 2); i++) {
-                for (int j = int(cell_center.x() - params_.vehicle_width_px / 2); j < int(cell_center.x() + params_.vehicle_width_px / 2); j++) {
-                    int idx = i * params_.depth_width + j;
-                    //crop.push_back(img[idx]);
-                    if (img[idx] < params_.max_allowed_obs_dist) {
-                        counter++;
-                    }
-                }
-            }
+            unsigned int counter = getCellStats(cell_index).obstacle_count;
 
             if (counter > max_allowed_obs_per_block) {
                 return false;
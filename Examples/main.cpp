@@ -5,6 +5,8 @@
 #include "GaussianMarkovTest.hpp"
 #include "DepthNav/DepthNavCost.hpp"
 #include "DepthNav/DepthNavThreshold.hpp"
+#include "DepthNav/DepthNavBenchmark.hpp"
+#include "common/TelemetryLogger.hpp"
 #include <iostream>
 #include <string>
 #ifndef _USE_MATH_DEFINES
@@ -60,26 +62,34 @@ int runStandAlonePhysics(int argc, const char* argv[])
     return 0;
 }
 
-void runDataCollectorSGM(const int num_samples, const std::string storage_path)
+//optional comma separated vehicle names, each vehicle captures in parallel
+std::vector<std::string> getVehicleNames(const int argc, const char* argv[], const int arg_index)
 {
-    DataCollectorSGM gen(storage_path);
+    if (argc <= arg_index)
+        return { "" };
+    return common_utils::Utils::split(argv[arg_index], ",", 1);
+}
+
+void runDataCollectorSGM(const int num_samples, const std::string storage_path, const std::vector<std::string>& vehicle_names)
+{
+    DataCollectorSGM gen(storage_path, vehicle_names);
     gen.generate(num_samples);
 }
 
 void runDataCollectorSGM(const int argc, const char* argv[])
 {
-    runDataCollectorSGM(argc < 2 ? 5000 : std::stoi(argv[1]), argc < 3 ? common_utils::FileSystem::combine(common_utils::FileSystem::getAppDataFolder(), "data_sgm") : std::string(argv[2]));
+    runDataCollectorSGM(argc < 2 ? 5000 : std::stoi(argv[1]), argc < 3 ? common_utils::FileSystem::combine(common_utils::FileSystem::getAppDataFolder(), "data_sgm") : std::string(argv[2]), getVehicleNames(argc, argv, 3));
 }
 
-void runStereoImageGenerator(const int num_samples, const std::string storage_path)
+void runStereoImageGenerator(const int num_samples, const std::string storage_path, const std::vector<std::string>& vehicle_names)
 {
-    StereoImageGenerator gen(storage_path);
+    StereoImageGenerator gen(storage_path, vehicle_names);
     gen.generate(num_samples);
 }
 
 void runStereoImageGenerator(const int argc, const char* argv[])
 {
-    runStereoImageGenerator(argc < 2 ? 50000 : std::stoi(argv[1]), argc < 3 ? common_utils::FileSystem::combine(common_utils::FileSystem::getAppDataFolder(), "stereo_gen") : std::string(argv[2]));
+    runStereoImageGenerator(argc < 2 ? 50000 : std::stoi(argv[1]), argc < 3 ? common_utils::FileSystem::combine(common_utils::FileSystem::getAppDataFolder(), "stereo_gen") : std::string(argv[2]), getVehicleNames(argc, argv, 3));
 }
 
 void runGaussianMarkovTest()
@@ -166,10 +176,38 @@ void runDepthNavSGM()
     depthNav.gotoGoalSGM(goalPose, client, request, &p_state);
 }
 
+void runDepthNavBenchmark(const int argc, const char* argv[])
+{
+    using namespace msr::airlib;
+
+    //folder with depth_%06d.pfm frames recorded using DepthNav::Params::record_folder, synthetic frames if not specified
+    DepthNavBenchmark benchmark;
+    benchmark.run(argc < 2 ? "" : std::string(argv[1]));
+}
+
+//converts a TelemetryLogger file to one csv per channel, or a binary column per field with --columns
+int runTelemetryExport(const int argc, const char* argv[])
+{
+    if (argc < 3) {
+        std::cout << "Usage: " << argv[0] << " <telemetry_file> <out_folder> [--columns]" << std::endl;
+        return 1;
+    }
+
+    msr::airlib::TelemetryReader reader(argv[1]);
+    if (argc >= 4 && std::string(argv[3]) == "--columns")
+        reader.exportColumns(argv[2]);
+    else
+        reader.exportCsv(argv[2]);
+
+    return 0;
+}
+
 int main(const int argc, const char* argv[])
 {
     //runDepthNavGT();
+    //runDepthNavBenchmark(argc, argv);
     //runDepthNavSGM();
+    //runTelemetryExport(argc, argv);
     runDataCollectorSGM(argc, argv);
 
     return 0;
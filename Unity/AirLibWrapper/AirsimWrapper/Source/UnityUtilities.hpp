@@ -76,14 +76,8 @@ static void Convert_to_AirsimResponse(const AirSimUnity::AirSimImageResponse& sr
     dest.width = src.width;
     dest.height = src.height;
     dest.image_type = src.image_type;
-    dest.image_data_float.clear();
-    dest.image_data_uint8.clear();
-    for (int i = 0; i < src.image_uint_len; i++) {
-        dest.image_data_uint8.push_back(static_cast<unsigned char>(src.image_data_uint[i]));
-    }
-    for (int i = 0; i < src.image_float_len; i++) {
-        dest.image_data_float.push_back(src.image_data_float[i]);
-    }
+    dest.image_data_uint8.assign(src.image_data_uint, src.image_uint_len);
+    dest.image_data_float.assign(src.image_data_float, src.image_float_len);
 }
 
 static msr::airlib::Pose Convert_to_Pose(const AirSimUnity::AirSimPose& airSimPose)
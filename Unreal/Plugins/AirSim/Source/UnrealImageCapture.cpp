@@ -97,8 +97,9 @@ void UnrealImageCapture::getSceneCaptureImage(const std::vector<msr::airlib::Ima
 
         response.camera_name = request.camera_name;
         response.time_stamp = render_results[i]->time_stamp;
-        response.image_data_uint8 = std::vector<uint8_t>(render_results[i]->image_data_uint8.GetData(), render_results[i]->image_data_uint8.GetData() + render_results[i]->image_data_uint8.Num());
-        response.image_data_float = std::vector<float>(render_results[i]->image_data_float.GetData(), render_results[i]->image_data_float.GetData() + render_results[i]->image_data_float.Num());
+        //copied straight in to pooled buffers which are shared, not copied, up to RPC serialization
+        response.image_data_uint8.assign(render_results[i]->image_data_uint8.GetData(), render_results[i]->image_data_uint8.Num());
+        response.image_data_float.assign(render_results[i]->image_data_float.GetData(), render_results[i]->image_data_float.Num());
 
         if (use_safe_method) {
             // Currently, we don't have a way to synthronize image capturing and camera pose when safe method is used,